@@ -0,0 +1,585 @@
+/**
+ *  allocator.h
+ *  Purpose: allocators for the storage of matrices and transform buffers
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef ALLOCATOR_H
+
+#define ALLOCATOR_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "instrument.h"
+
+/**
+ *  The alignment, in bytes, used for all numeric buffers. One cache line, which is also
+ *  the width of the widest (AVX-512) vector registers.
+ */
+
+constexpr size_t buffer_alignment = 64;
+
+/**
+ *  aligned_allocator class, a standard allocator returning storage aligned to Alignment bytes.
+ *
+ *  @param T the data type being allocated.
+ *  @param Alignment the alignment of every allocation, in bytes.
+ */
+
+template <typename T, size_t Alignment = buffer_alignment>
+class aligned_allocator {
+
+    static_assert((Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+    public:
+
+    typedef T value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef aligned_allocator<U, Alignment> other;
+    };
+
+    aligned_allocator() noexcept = default;
+
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, Alignment> &) noexcept {}
+
+    /**
+     *  Allocates storage for n objects of type T.
+     *
+     *  @param n the number of objects to allocate.
+     *  @return a pointer to the allocated storage.
+     *  @throws std::bad_alloc if the allocation failed.
+     */
+
+    inline T *allocate(size_t n) {
+        if(n == 0) {
+            return nullptr;
+        }
+        if(n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        void *p = ::operator new(n * sizeof(T), std::align_val_t(Alignment));
+        algebra_detail::instrument_scope::allocated(n * sizeof(T));
+        return static_cast<T *>(p);
+    }
+
+    /**
+     *  Releases storage obtained from allocate.
+     *
+     *  @param p the pointer to release.
+     *  @param n the number of objects p was allocated for.
+     */
+
+    inline void deallocate(T *p, size_t) noexcept {
+        if(p != nullptr) {
+            ::operator delete(p, std::align_val_t(Alignment));
+        }
+    }
+
+    template <typename U>
+    inline bool operator == (const aligned_allocator<U, Alignment> &) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    inline bool operator != (const aligned_allocator<U, Alignment> &) const noexcept {
+        return false;
+    }
+};
+
+/**
+ *  monotonic_arena class, a bump allocator for short-lived buffers. Allocations are carved
+ *  out of large blocks, one after the other, and are never freed one at a time: release()
+ *  rewinds the arena in one step. Blocks grow geometrically, so once warmed up an arena
+ *  serves a whole request (every temporary matrix it builds) from a single block, without
+ *  touching the global heap.
+ *
+ *  Not synchronized: give each thread, or each request, its own arena.
+ */
+
+class monotonic_arena {
+
+    private:
+
+    struct block {
+        block *next;
+        size_t size;
+    };
+
+    static constexpr size_t header = (sizeof(block) + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+
+    block *head = nullptr;
+    char *cursor = nullptr;
+    char *end = nullptr;
+    size_t next_size;
+
+    static inline void free_block(block *b) noexcept {
+        ::operator delete(b, std::align_val_t(buffer_alignment));
+    }
+
+    inline void grow(size_t bytes) {
+        const size_t size = std::max(next_size, bytes + header);
+        block *b = static_cast<block *>(::operator new(size, std::align_val_t(buffer_alignment)));
+        algebra_detail::instrument_scope::allocated(size);
+        b->next = head;
+        b->size = size;
+        head = b;
+        cursor = reinterpret_cast<char *>(b) + header;
+        end = reinterpret_cast<char *>(b) + size;
+        next_size = size * 2;
+    }
+
+    public:
+
+    /**
+     *  Constructor for a monotonic_arena. No memory is taken until the first allocation.
+     *
+     *  @param initial the size, in bytes, of the first block.
+     */
+
+    inline explicit monotonic_arena(size_t initial = size_t(1) << 16) : next_size(std::max(initial, 2 * header)) {}
+
+    monotonic_arena(const monotonic_arena &) = delete;
+    monotonic_arena &operator = (const monotonic_arena &) = delete;
+
+    inline ~monotonic_arena() {
+        while(head != nullptr)
+            free_block(std::exchange(head, head->next));
+    }
+
+    /**
+     *  Allocates storage from the current block, starting a new one if it is full.
+     *
+     *  @param bytes the number of bytes to allocate.
+     *  @param alignment the alignment of the storage; at most buffer_alignment.
+     *  @return a pointer to the storage, valid until release() or the destruction of the arena.
+     *  @throws std::bad_alloc if a new block could not be allocated.
+     */
+
+    inline void *allocate(size_t bytes, size_t alignment = buffer_alignment) {
+        assert(alignment <= buffer_alignment && (alignment & (alignment - 1)) == 0);
+        (void) alignment;
+        const size_t rounded = (bytes + buffer_alignment - 1) / buffer_alignment * buffer_alignment;
+        if(rounded < bytes) {
+            throw std::bad_alloc();
+        }
+        if(size_t(end - cursor) < rounded) {
+            grow(rounded);
+        }
+        return std::exchange(cursor, cursor + rounded);
+    }
+
+    /**
+     *  Does nothing: the storage is reclaimed by release().
+     */
+
+    inline void deallocate(void *, size_t) noexcept {}
+
+    /**
+     *  Reclaims every allocation at once. The largest block is kept and rewound, so an arena
+     *  reused for requests of a similar size allocates from the heap only while warming up.
+     *  Everything allocated from the arena must be dead by then.
+     */
+
+    inline void release() noexcept {
+        if(head == nullptr) {
+            return;
+        }
+        while(head->next != nullptr)
+            free_block(std::exchange(head->next, head->next->next));
+        cursor = reinterpret_cast<char *>(head) + header;
+    }
+
+    /**
+     *  Retrieves the number of bytes held from the heap, in use or not.
+     *
+     *  @return the total size of the arena's blocks.
+     */
+
+    inline size_t capacity() const {
+        size_t total = 0;
+        for(const block *b = head; b != nullptr; b = b->next)
+            total += b->size;
+        return total;
+    }
+};
+
+/**
+ *  pool_resource class, recycles buffers by size class. Requests are rounded up to a power
+ *  of two of at least buffer_alignment bytes; freed buffers go on the free list of their
+ *  class and are handed out again in O(1), so a steady mix of matrix shapes stops
+ *  allocating once every class it uses has been seen. Classes are carved out of slabs of at
+ *  least 64 KiB, aligned to buffer_alignment like every buffer in them. Requests above
+ *  largest_block bytes go straight to the heap.
+ *
+ *  Not synchronized: give each thread its own pool, which also keeps it free of contention.
+ */
+
+class pool_resource {
+
+    private:
+
+    struct node {
+        node *next;
+    };
+
+    static constexpr size_t smallest_class = buffer_alignment;
+    static constexpr size_t slab_size = size_t(1) << 16;
+
+    size_t largest_block;
+    std::vector<node *> free_lists;
+    std::vector<void *> slabs;
+
+    static inline size_t size_class(size_t bytes) {
+        size_t c = 0;
+        while((smallest_class << c) < bytes)
+            ++ c;
+        return c;
+    }
+
+    inline void refill(size_t c) {
+        const size_t size = smallest_class << c, count = std::max<size_t>(1, slab_size / size);
+        slabs.reserve(slabs.size() + 1);
+        char *slab = static_cast<char *>(::operator new(size * count, std::align_val_t(buffer_alignment)));
+        slabs.push_back(slab);
+        algebra_detail::instrument_scope::allocated(size * count);
+        for(size_t i = count; i -- > 0;) {
+            node *n = reinterpret_cast<node *>(slab + i * size);
+            n->next = free_lists[c];
+            free_lists[c] = n;
+        }
+    }
+
+    public:
+
+    /**
+     *  Constructor for a pool_resource. No memory is taken until the first allocation.
+     *
+     *  @param largest the largest request, in bytes, served from the pool; rounded up to a
+     *  size class.
+     */
+
+    inline explicit pool_resource(size_t largest = size_t(1) << 20)
+        : largest_block(smallest_class << size_class(largest)), free_lists(size_class(largest) + 1, nullptr) {}
+
+    pool_resource(const pool_resource &) = delete;
+    pool_resource &operator = (const pool_resource &) = delete;
+
+    inline ~pool_resource() {
+        release();
+    }
+
+    /**
+     *  Allocates a buffer from the free list of its size class.
+     *
+     *  @param bytes the number of bytes to allocate.
+     *  @param alignment the alignment of the storage; at most buffer_alignment.
+     *  @return a pointer to the storage.
+     *  @throws std::bad_alloc if a new slab could not be allocated.
+     */
+
+    inline void *allocate(size_t bytes, size_t alignment = buffer_alignment) {
+        assert(alignment <= buffer_alignment && (alignment & (alignment - 1)) == 0);
+        (void) alignment;
+        if(bytes > largest_block) {
+            void *p = ::operator new(bytes, std::align_val_t(buffer_alignment));
+            algebra_detail::instrument_scope::allocated(bytes);
+            return p;
+        }
+        const size_t c = size_class(bytes);
+        if(free_lists[c] == nullptr) {
+            refill(c);
+        }
+        node *n = free_lists[c];
+        free_lists[c] = n->next;
+        return n;
+    }
+
+    /**
+     *  Returns a buffer to the free list of its size class.
+     *
+     *  @param p the buffer to return.
+     *  @param bytes the size it was allocated with.
+     */
+
+    inline void deallocate(void *p, size_t bytes) noexcept {
+        if(bytes > largest_block) {
+            ::operator delete(p, std::align_val_t(buffer_alignment));
+            return;
+        }
+        node *n = static_cast<node *>(p);
+        const size_t c = size_class(bytes);
+        n->next = free_lists[c];
+        free_lists[c] = n;
+    }
+
+    /**
+     *  Returns every slab to the heap at once. Buffers still in use from the pool (other than
+     *  those above largest_block bytes) must be dead by then.
+     */
+
+    inline void release() noexcept {
+        for(void *slab : slabs)
+            ::operator delete(slab, std::align_val_t(buffer_alignment));
+        slabs.clear();
+        std::fill(free_lists.begin(), free_lists.end(), nullptr);
+    }
+};
+
+/**
+ *  resource_allocator class, a standard allocator drawing from a monotonic_arena, a
+ *  pool_resource or any class with the same allocate and deallocate members. Containers
+ *  keep the resource they were built with through copy assignment and take it over on move
+ *  assignment and swap. A default-constructed allocator has no resource and uses the heap,
+ *  like aligned_allocator.
+ *
+ *  @param T the data type being allocated.
+ *  @param Resource the class providing the storage.
+ */
+
+template <typename T, typename Resource>
+class resource_allocator {
+
+    template <typename U, typename R>
+    friend class resource_allocator;
+
+    Resource *source = nullptr;
+
+    public:
+
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind {
+        typedef resource_allocator<U, Resource> other;
+    };
+
+    resource_allocator() noexcept = default;
+
+    /**
+     *  Constructor for an allocator drawing from r, which must outlive every container using
+     *  it.
+     *
+     *  @param r the resource to draw from.
+     */
+
+    resource_allocator(Resource &r) noexcept : source(&r) {}
+
+    template <typename U>
+    resource_allocator(const resource_allocator<U, Resource> &a) noexcept : source(a.source) {}
+
+    /**
+     *  Retrieves the resource the allocator draws from.
+     *
+     *  @return the resource, or nullptr for the heap.
+     */
+
+    inline Resource *resource() const noexcept {
+        return source;
+    }
+
+    /**
+     *  Allocates storage for n objects of type T, aligned to buffer_alignment bytes.
+     *
+     *  @param n the number of objects to allocate.
+     *  @return a pointer to the allocated storage.
+     *  @throws std::bad_alloc if the allocation failed.
+     */
+
+    inline T *allocate(size_t n) {
+        if(source == nullptr) {
+            return aligned_allocator<T>().allocate(n);
+        }
+        if(n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T *>(source->allocate(n * sizeof(T), buffer_alignment));
+    }
+
+    /**
+     *  Hands storage obtained from allocate back to the resource.
+     *
+     *  @param p the pointer to release.
+     *  @param n the number of objects p was allocated for.
+     */
+
+    inline void deallocate(T *p, size_t n) noexcept {
+        if(source == nullptr) {
+            aligned_allocator<T>().deallocate(p, n);
+        } else if(p != nullptr) {
+            source->deallocate(p, n * sizeof(T));
+        }
+    }
+
+    template <typename U>
+    inline bool operator == (const resource_allocator<U, Resource> &a) const noexcept {
+        return source == a.source;
+    }
+
+    template <typename U>
+    inline bool operator != (const resource_allocator<U, Resource> &a) const noexcept {
+        return source != a.source;
+    }
+};
+
+/**
+ *  Allocators drawing from a monotonic_arena and from a pool_resource, e.g.
+ *  matrix<double, arena_allocator<double>> m(n, n, 0.0, arena).
+ */
+
+template <typename T>
+using arena_allocator = resource_allocator<T, monotonic_arena>;
+
+template <typename T>
+using pool_allocator = resource_allocator<T, pool_resource>;
+
+namespace algebra_detail {
+
+/**
+ *  Computes the distance between the starts of consecutive rows of a row-major buffer. Rows
+ *  wider than a cache line are padded so every row starts on an aligned boundary.
+ *
+ *  @param Columns the number of columns.
+ *  @return the row stride, in elements.
+ */
+
+template <typename T>
+inline size_t padded_stride(size_t Columns) {
+    if(buffer_alignment % sizeof(T) != 0) {
+        return Columns;
+    }
+    const size_t lanes = buffer_alignment / sizeof(T);
+    if(Columns <= lanes) {
+        return Columns;
+    }
+    return (Columns + lanes - 1) / lanes * lanes;
+}
+
+/**
+ *  Scratch buffer owned by the calling thread, grown on demand and reused across calls so a
+ *  steady stream of operations does not allocate.
+ *
+ *  @param T the data type being stored.
+ *  @param Tag distinguishes independent buffers of the same type.
+ *  @param n the minimum number of elements required.
+ *  @param level separates buffers of calls nested on the same thread, e.g. a multiply run
+ *  by a thread that is waiting for the workers of an outer multiply.
+ *  @return a pointer to at least n elements.
+ */
+
+template <typename T, int Tag>
+inline T *scratch_buffer(size_t n, size_t level = 0) {
+    thread_local std::vector<std::vector<T, aligned_allocator<T>>> buffers;
+    if(buffers.size() <= level) {
+        buffers.resize(level + 1);
+    }
+    if(buffers[level].size() < n) {
+        buffers[level].resize(n);
+    }
+    return buffers[level].data();
+}
+
+/**
+ *  Counts the operations using scratch buffers in progress on the calling thread, while in
+ *  scope. Its level picks the scratch buffers of the current call.
+ */
+
+struct nesting_guard {
+    size_t level;
+
+    inline nesting_guard() : level(depth()++) {}
+
+    inline ~nesting_guard() {
+        -- depth();
+    }
+
+    static inline size_t &depth() {
+        thread_local size_t value = 0;
+        return value;
+    }
+};
+
+/**
+ *  The number of plans of one kind (e.g. fft_plan<double>) a plan_cache keeps before it
+ *  starts dropping the ones no caller holds.
+ */
+
+constexpr size_t plan_cache_capacity = 64;
+
+/**
+ *  plan_cache class, the shared plans of one kind, built on first use and then handed out
+ *  to every thread. Lookups of cached plans only take a read lock, so threads transforming
+ *  at the same time do not wait for each other; a plan is built outside the lock, so a slow
+ *  build does not stall lookups of other keys either. Once the cache holds
+ *  plan_cache_capacity plans, every plan no longer held outside the cache is dropped before
+ *  the next one is added, so it grows only with the plans actually in use.
+ *
+ *  @param Plan the plan type.
+ *  @param Key the key identifying a plan, e.g. its length and direction.
+ */
+
+template <typename Plan, typename Key>
+class plan_cache {
+
+    private:
+
+    std::shared_mutex lock;
+    std::map<Key, std::shared_ptr<const Plan>> plans;
+
+    public:
+
+    /**
+     *  Retrieves the plan for a key, building it from args if it is not cached.
+     *
+     *  @param key the key of the plan.
+     *  @param args the arguments of the Plan constructor.
+     *  @return the plan.
+     */
+
+    template <typename... Args>
+    inline std::shared_ptr<const Plan> get(const Key &key, const Args &... args) {
+        {
+            std::shared_lock<std::shared_mutex> guard(lock);
+            const auto it = plans.find(key);
+            if(it != plans.end()) {
+                return it->second;
+            }
+        }
+
+        auto plan = std::make_shared<const Plan>(args...);
+
+        std::unique_lock<std::shared_mutex> guard(lock);
+        if(plans.size() >= plan_cache_capacity && plans.find(key) == plans.end()) {
+            for(auto it = plans.begin(); it != plans.end(); ) {
+                it = it->second.use_count() == 1 ? plans.erase(it) : std::next(it);
+            }
+        }
+
+        // Another thread may have built the same plan meanwhile; every caller gets the first.
+
+        return plans.emplace(key, std::move(plan)).first->second;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,279 @@
+/**
+ *  batch.h
+ *  Purpose: batched operations on many small matrices stored as structures of arrays
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef BATCH_H
+
+#define BATCH_H
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "allocator.h"
+#include "simd.h"
+
+/**
+ *  matrix_batch class, count N x N matrices stored as a structure of arrays: entry (r, c) of
+ *  every matrix is contiguous, so batched kernels load the same entry of many matrices in one
+ *  vector register.
+ *
+ *  @param N the order of each matrix.
+ *  @param T the data type being stored.
+ */
+
+template <size_t N, typename T = double>
+class matrix_batch {
+
+    private:
+
+    size_t count = 0;
+    std::vector<T, aligned_allocator<T>> lanes[N * N];
+
+    public:
+
+    /**
+     *  Constructor for a matrix_batch. All entries are set to their default.
+     *
+     *  @param Count the number of matrices.
+     */
+
+    inline explicit matrix_batch(size_t Count = 0) : count(Count) {
+        for(auto &lane : lanes) {
+            lane.assign(Count, T());
+        }
+    }
+
+    /**
+     *  Retrieves the number of matrices in the batch.
+     *
+     *  @return the number of matrices.
+     */
+
+    inline size_t size() const {
+        return count;
+    }
+
+    /**
+     *  Retrieves entry (row, column) of every matrix.
+     *
+     *  @param row the row of the entry.
+     *  @param column the column of the entry.
+     *  @return a pointer to size() contiguous values.
+     */
+
+    inline T *entries(size_t row, size_t column) {
+        return lanes[row * N + column].data();
+    }
+
+    inline const T *entries(size_t row, size_t column) const {
+        return lanes[row * N + column].data();
+    }
+
+    /**
+     *  Allows access to entry (row, column) of matrix k.
+     *
+     *  @return a reference to the entry.
+     */
+
+    inline T &operator () (size_t k, size_t row, size_t column) {
+        return lanes[row * N + column][k];
+    }
+
+    inline const T &operator () (size_t k, size_t row, size_t column) const {
+        return lanes[row * N + column][k];
+    }
+
+    /**
+     *  Retrieves the N x N table of entry pointers expected by the batched kernels.
+     *
+     *  @param out receives entries(r, c) at out[r * N + c].
+     */
+
+    inline void pointers(T *out[N * N]) {
+        for(size_t i = 0; i < N * N; ++ i)
+            out[i] = lanes[i].data();
+    }
+
+    inline void pointers(const T *out[N * N]) const {
+        for(size_t i = 0; i < N * N; ++ i)
+            out[i] = lanes[i].data();
+    }
+};
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/**
+ *  Multiplies groups of matrices, loading entry (r, c) of consecutive matrices into one
+ *  vector V (or a single T for the remainder). Results are computed before any are stored,
+ *  so c may alias a or b.
+ */
+
+template <size_t N>
+struct batch_multiply_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *a, const T *const *b, T *const *c) {
+        V x[N * N], y[N * N], z[N * N];
+        for(size_t e = 0; e < N * N; ++ e) {
+            x[e] = simd_load<V>(a[e] + k);
+            y[e] = simd_load<V>(b[e] + k);
+        }
+        for(size_t r = 0; r < N; ++ r) {
+            for(size_t col = 0; col < N; ++ col) {
+                V s = x[r * N] * y[col];
+                for(size_t i = 1; i < N; ++ i)
+                    s += x[r * N + i] * y[i * N + col];
+                z[r * N + col] = s;
+            }
+        }
+        for(size_t e = 0; e < N * N; ++ e)
+            simd_store(c[e] + k, z[e]);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t count, const T *const *a, const T *const *b, T *const *c) {
+        size_t k = 0;
+#if ALGEBRA_VECTOR_EXTENSIONS
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        for(; k + L <= count; k += L)
+            step<vec>(k, a, b, c);
+#endif
+        for(; k < count; ++ k)
+            step<T>(k, a, b, c);
+    }
+};
+
+/**
+ *  Applies groups of matrices to vectors stored as one array per component.
+ */
+
+template <size_t N>
+struct batch_apply_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *m, const T *const *x, T *const *y) {
+        V u[N], v[N];
+        for(size_t i = 0; i < N; ++ i)
+            u[i] = simd_load<V>(x[i] + k);
+        for(size_t r = 0; r < N; ++ r) {
+            V s = simd_load<V>(m[r * N] + k) * u[0];
+            for(size_t i = 1; i < N; ++ i)
+                s += simd_load<V>(m[r * N + i] + k) * u[i];
+            v[r] = s;
+        }
+        for(size_t r = 0; r < N; ++ r)
+            simd_store(y[r] + k, v[r]);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t count, const T *const *m, const T *const *x, T *const *y) {
+        size_t k = 0;
+#if ALGEBRA_VECTOR_EXTENSIONS
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        for(; k + L <= count; k += L)
+            step<vec>(k, m, x, y);
+#endif
+        for(; k < count; ++ k)
+            step<T>(k, m, x, y);
+    }
+};
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+/**
+ *  Multiplies count pairs of N x N matrices, c[k] = a[k] * b[k], in one vectorised pass.
+ *
+ *  @param count the number of products.
+ *  @param a entry pointers of the left operands: a[r * N + c] holds entry (r, c) of each.
+ *  @param b entry pointers of the right operands, laid out like a.
+ *  @param c entry pointers of the results, laid out like a; may be a or b.
+ */
+
+template <size_t N, typename T>
+inline void batch_multiply(size_t count, const T *const a[N * N], const T *const b[N * N], T *const c[N * N]) {
+    typedef algebra_detail::batch_multiply_kernel<N> kernel;
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<kernel>(count, a, b, c);
+    }
+#endif
+    kernel::template run<sizeof(T)>(count, a, b, c);
+}
+
+/**
+ *  Multiplies two batches of matrices, c[k] = a[k] * b[k].
+ *
+ *  @param a the left operands.
+ *  @param b the right operands.
+ *  @param c receives the products; resized if needed, and may be a or b.
+ */
+
+template <size_t N, typename T>
+inline void batch_multiply(const matrix_batch<N, T> &a, const matrix_batch<N, T> &b, matrix_batch<N, T> &c) {
+    assert(a.size() == b.size());
+
+    if(c.size() != a.size()) {
+        c = matrix_batch<N, T>(a.size());
+    }
+
+    const T *pa[N * N], *pb[N * N];
+    T *pc[N * N];
+    a.pointers(pa);
+    b.pointers(pb);
+    c.pointers(pc);
+
+    batch_multiply<N, T>(a.size(), pa, pb, pc);
+}
+
+/**
+ *  Applies count N x N matrices to count N-vectors, y[k] = m[k] * x[k], in one vectorised
+ *  pass. Vectors are stored as one array per component (x[i][k] is component i of vector k).
+ *
+ *  @param count the number of vectors.
+ *  @param m entry pointers of the matrices: m[r * N + c] holds entry (r, c) of each.
+ *  @param x component pointers of the input vectors.
+ *  @param y component pointers of the output vectors; may be x.
+ */
+
+template <size_t N, typename T>
+inline void batch_apply(size_t count, const T *const m[N * N], const T *const x[N], T *const y[N]) {
+    typedef algebra_detail::batch_apply_kernel<N> kernel;
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<kernel>(count, m, x, y);
+    }
+#endif
+    kernel::template run<sizeof(T)>(count, m, x, y);
+}
+
+/**
+ *  Applies a batch of matrices to vectors stored as one array per component.
+ *
+ *  @param m the matrices.
+ *  @param x component pointers of m.size() input vectors.
+ *  @param y component pointers of m.size() output vectors; may be x.
+ */
+
+template <size_t N, typename T>
+inline void batch_apply(const matrix_batch<N, T> &m, const T *const x[N], T *const y[N]) {
+    const T *pm[N * N];
+    m.pointers(pm);
+
+    batch_apply<N, T>(m.size(), pm, x, y);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ *  common.h
+ *  Purpose: inputs and counters shared by the benchmarks
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef BENCHMARK_COMMON_H
+
+#define BENCHMARK_COMMON_H
+
+#include <complex>
+#include <cstddef>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "matrix.h"
+
+namespace algebra_benchmark {
+
+/**
+ *  The generator every input is drawn from, seeded the same way in every run so that
+ *  successive runs measure the same work.
+ */
+
+inline std::mt19937_64 &engine() {
+    static std::mt19937_64 generator(20240917);
+    return generator;
+}
+
+/**
+ *  Draws one value, uniform in [-1, 1) for floating types and in [-8, 8] for integers.
+ */
+
+template <typename T>
+inline T random_value() {
+    if constexpr (std::is_integral<T>::value) {
+        return T(std::uniform_int_distribution<int>(-8, 8)(engine()));
+    } else {
+        return T(std::uniform_real_distribution<double>(-1.0, 1.0)(engine()));
+    }
+}
+
+template <typename T>
+inline std::vector<T> random_values(size_t n) {
+    std::vector<T> ret(n);
+
+    for(T &t : ret)
+        t = random_value<T>();
+
+    return ret;
+}
+
+template <typename T>
+inline std::vector<std::complex<T>> random_signal(size_t n) {
+    std::vector<std::complex<T>> ret(n);
+
+    for(std::complex<T> &z : ret)
+        z = std::complex<T>(random_value<T>(), random_value<T>());
+
+    return ret;
+}
+
+template <typename T>
+inline matrix<T> random_matrix(size_t rows, size_t columns) {
+    matrix<T> ret(rows, columns);
+
+    for(size_t i = 0; i < rows; ++ i)
+        for(size_t j = 0; j < columns; ++ j)
+            ret(i,j) = random_value<T>();
+
+    return ret;
+}
+
+/**
+ *  Draws a diagonally dominant n x n matrix, which is well conditioned, so factoring it
+ *  never meets a zero pivot and measures the same work whatever the values.
+ */
+
+template <typename T>
+inline matrix<T> random_nonsingular(size_t n) {
+    matrix<T> ret = random_matrix<T>(n, n);
+
+    for(size_t i = 0; i < n; ++ i)
+        ret(i,i) = ret(i,i) + T(n);
+
+    return ret;
+}
+
+/**
+ *  Reports work done per iteration as a rate; Google Benchmark divides by the time taken.
+ *
+ *  @param name the counter to set, e.g. "flops".
+ *  @param work the amount of work in one iteration.
+ */
+
+inline void set_rate(benchmark::State &state, const char *name, double work) {
+    state.counters[name] = benchmark::Counter(work, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+}
+
+#endif
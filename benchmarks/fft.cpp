@@ -0,0 +1,167 @@
+/**
+ *  fft.cpp
+ *  Purpose: Fourier transform and convolution throughput, against length and precision
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#include "common.h"
+
+#include "convolution.h"
+#include "fft.h"
+#include "fftn.h"
+#include "ntt.h"
+
+using namespace algebra_benchmark;
+
+/**
+ *  The customary operation count of a length n complex transform, 5 n log2(n), used to
+ *  compare lengths and algorithms on one scale, whatever the plan actually does.
+ */
+
+static double fft_flops(double n) {
+    return 5.0 * n * std::log2(n);
+}
+
+/**
+ *  Transforms a signal forward and back through FFT, so that its magnitude stays put however
+ *  many iterations run; the rates count both transforms.
+ */
+
+template <typename T>
+static void BM_FFT(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    std::vector<std::complex<T>> P = random_signal<T>(n);
+
+    for(auto _ : state) {
+        FFT(P, 1);
+        FFT(P, -1);
+        benchmark::DoNotOptimize(P.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n));
+    set_rate(state, "flops", 2.0 * fft_flops(double(n)));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  Many short signals transformed together through batch_FFT, which vectorizes across them.
+ */
+
+template <typename T>
+static void BM_batch_FFT(benchmark::State &state) {
+    const size_t n = size_t(state.range(0)), count = 1024;
+    std::vector<std::complex<T>> P = random_signal<T>(n * count);
+
+    for(auto _ : state) {
+        batch_FFT(P, n, 1);
+        batch_FFT(P, n, -1);
+        benchmark::DoNotOptimize(P.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n * count));
+    set_rate(state, "flops", 2.0 * double(count) * fft_flops(double(n)));
+}
+
+template <typename T>
+static void BM_RFFT(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const rfft_plan<T> plan(n);
+    std::vector<T> x = random_values<T>(n);
+    std::vector<std::complex<T>> X(n / 2 + 1);
+
+    for(auto _ : state) {
+        plan.forward(x.data(), X.data());
+        plan.inverse(X.data(), x.data());
+        benchmark::DoNotOptimize(x.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n));
+    set_rate(state, "flops", fft_flops(double(n)));
+}
+
+template <typename T>
+static void BM_FFT2(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    matrix<std::complex<T>> m(n, n);
+
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < n; ++ j)
+            m(i,j) = std::complex<T>(random_value<T>(), random_value<T>());
+
+    for(auto _ : state) {
+        FFT2(m, 1);
+        FFT2(m, -1);
+        benchmark::DoNotOptimize(m.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(2 * n * n));
+    set_rate(state, "flops", 2.0 * fft_flops(double(n) * double(n)));
+}
+
+static void BM_NTT(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    std::vector<uint32_t> a(n);
+
+    for(uint32_t &v : a)
+        v = uint32_t(engine()() % 998244353);
+
+    for(auto _ : state) {
+        NTT(a, 1);
+        benchmark::DoNotOptimize(a.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  Full linear convolution of two signals of the same length.
+ */
+
+template <typename T>
+static void BM_convolve(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const std::vector<T> a = random_values<T>(n), b = random_values<T>(n);
+
+    for(auto _ : state) {
+        std::vector<T> c = convolve(a, b);
+        benchmark::DoNotOptimize(c.data());
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(n));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  Lengths the mixed-radix plans handle (products of 2, 3, 5 and 7) and primes, which go
+ *  through Bluestein's algorithm.
+ */
+
+static void fft_lengths(benchmark::internal::Benchmark *b) {
+    for(int64_t n = 64; n <= (1 << 20); n *= 4)
+        b->Arg(n);
+    for(int64_t n : {1000, 3 * 5 * 7 * 64, 1009, 65537})
+        b->Arg(n);
+}
+
+BENCHMARK_TEMPLATE(BM_FFT, float)->Apply(fft_lengths);
+BENCHMARK_TEMPLATE(BM_FFT, double)->Apply(fft_lengths);
+BENCHMARK_TEMPLATE(BM_FFT, long double)->RangeMultiplier(16)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_FFT, float)->RangeMultiplier(4)->Range(16, 1024);
+BENCHMARK_TEMPLATE(BM_batch_FFT, double)->RangeMultiplier(4)->Range(16, 1024);
+BENCHMARK_TEMPLATE(BM_RFFT, float)->RangeMultiplier(16)->Range(256, 1 << 20);
+BENCHMARK_TEMPLATE(BM_RFFT, double)->RangeMultiplier(16)->Range(256, 1 << 20);
+BENCHMARK_TEMPLATE(BM_FFT2, float)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_FFT2, double)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK(BM_NTT)->RangeMultiplier(16)->Range(256, 1 << 20)->Complexity(benchmark::oNLogN);
+BENCHMARK_TEMPLATE(BM_convolve, double)->RangeMultiplier(8)->Range(64, 1 << 18)->Complexity(benchmark::oNLogN);
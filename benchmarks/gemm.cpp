@@ -0,0 +1,129 @@
+/**
+ *  gemm.cpp
+ *  Purpose: matrix product throughput, in floating point operations per second
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include "common.h"
+
+#include "sparse.h"
+#include "symmetric.h"
+
+using namespace algebra_benchmark;
+
+/**
+ *  C = A B for square n x n operands, through multiply_into so that C is reused.
+ */
+
+template <typename T>
+static void BM_multiply(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_matrix<T>(n, n), b = random_matrix<T>(n, n);
+    matrix<T> c;
+
+    for(auto _ : state) {
+        multiply_into(c, a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+
+    set_rate(state, "flops", 2.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  C = A B for a tall, thin A and a wide B, the shape of a block update.
+ */
+
+template <typename T>
+static void BM_multiply_panel(benchmark::State &state) {
+    const size_t n = size_t(state.range(0)), k = 64;
+    const matrix<T> a = random_matrix<T>(n, k), b = random_matrix<T>(k, n);
+    matrix<T> c;
+
+    for(auto _ : state) {
+        multiply_into(c, a, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+
+    set_rate(state, "flops", 2.0 * double(n) * double(n) * double(k));
+}
+
+/**
+ *  C = A B^T through the transposed view, which gemm packs without materializing.
+ */
+
+template <typename T>
+static void BM_multiply_transposed(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_matrix<T>(n, n), b = random_matrix<T>(n, n);
+    matrix<T> c;
+
+    for(auto _ : state) {
+        multiply_into(c, a, transposed(b));
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+
+    set_rate(state, "flops", 2.0 * double(n) * double(n) * double(n));
+}
+
+/**
+ *  A^T A into a dense matrix, which computes one triangle and mirrors it.
+ */
+
+template <typename T>
+static void BM_gram(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_matrix<T>(n, n);
+    matrix<T> c;
+
+    for(auto _ : state) {
+        gram_into(c, a);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+
+    set_rate(state, "flops", double(n) * double(n) * double(n));
+}
+
+/**
+ *  S B for a sparse S with about eight nonzeros per row.
+ */
+
+template <typename T>
+static void BM_sparse_multiply(benchmark::State &state) {
+    const size_t n = size_t(state.range(0)), per_row = 8, k = 64;
+    std::vector<sparse_entry<T>> triplets;
+
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < per_row; ++ j)
+            triplets.push_back({i, size_t(engine()() % n), random_value<T>()});
+
+    const sparse_matrix<T> s(n, n, triplets);
+    const matrix<T> b = random_matrix<T>(n, k);
+    matrix<T> c;
+
+    for(auto _ : state) {
+        multiply_into(c, s, b);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+
+    set_rate(state, "flops", 2.0 * double(s.nonzeros()) * double(k));
+}
+
+BENCHMARK_TEMPLATE(BM_multiply, float)->RangeMultiplier(2)->Range(16, 1024)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_multiply, double)->RangeMultiplier(2)->Range(16, 1024)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_multiply, int)->RangeMultiplier(2)->Range(16, 512)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_multiply, long long)->RangeMultiplier(2)->Range(16, 512)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_multiply, long double)->RangeMultiplier(2)->Range(16, 256)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_multiply_panel, float)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_multiply_panel, double)->RangeMultiplier(4)->Range(256, 4096);
+BENCHMARK_TEMPLATE(BM_multiply_transposed, float)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_multiply_transposed, double)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_gram, double)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_sparse_multiply, double)->RangeMultiplier(4)->Range(1024, 65536);
@@ -0,0 +1,132 @@
+/**
+ *  linear.cpp
+ *  Purpose: inverse, determinant, gauss and the factorizations, against the matrix order
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include "common.h"
+
+#include "cholesky.h"
+#include "gauss.h"
+#include "lu.h"
+#include "symmetric.h"
+
+using namespace algebra_benchmark;
+
+template <typename T>
+static void BM_inverse(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_nonsingular<T>(n);
+
+    for(auto _ : state) {
+        matrix<T> inverse = a.template inverse<T>();
+        benchmark::DoNotOptimize(inverse.data());
+    }
+
+    set_rate(state, "flops", 2.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+template <typename T>
+static void BM_determinant(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_nonsingular<T>(n);
+
+    for(auto _ : state) {
+        benchmark::DoNotOptimize(a.template determinant<T>());
+    }
+
+    set_rate(state, "flops", 2.0 / 3.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  gauss takes its system by value, as nested vectors; copying them in is part of the call.
+ */
+
+template <typename T>
+static void BM_gauss(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_nonsingular<T>(n);
+    std::vector<std::vector<T>> A(n, std::vector<T>(n));
+    const std::vector<T> Y = random_values<T>(n);
+
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < n; ++ j)
+            A[i][j] = a(i,j);
+
+    for(auto _ : state) {
+        std::vector<T> x = gauss(A, Y);
+        benchmark::DoNotOptimize(x.data());
+    }
+
+    set_rate(state, "flops", 2.0 / 3.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+template <typename T>
+static void BM_lu_factor(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_nonsingular<T>(n);
+
+    for(auto _ : state) {
+        lu_decomposition<T> lu(a);
+        benchmark::DoNotOptimize(&lu);
+    }
+
+    set_rate(state, "flops", 2.0 / 3.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+/**
+ *  Solves against n right-hand sides with a factorization computed once, outside the loop.
+ */
+
+template <typename T>
+static void BM_lu_solve(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const lu_decomposition<T> lu(random_nonsingular<T>(n));
+    const matrix<T> B = random_matrix<T>(n, n);
+    matrix<T> X;
+
+    for(auto _ : state) {
+        X = B;
+        lu.solve_in_place(X);
+        benchmark::DoNotOptimize(X.data());
+    }
+
+    set_rate(state, "flops", 2.0 * double(n) * double(n) * double(n));
+}
+
+template <typename T>
+static void BM_cholesky(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    const matrix<T> a = random_matrix<T>(n, n);
+    matrix<T> s;
+
+    gram_into(s, a);
+    for(size_t i = 0; i < n; ++ i)
+        s(i,i) = s(i,i) + T(n);
+
+    for(auto _ : state) {
+        cholesky_decomposition<T> cholesky(s);
+        benchmark::DoNotOptimize(&cholesky);
+    }
+
+    set_rate(state, "flops", 1.0 / 3.0 * double(n) * double(n) * double(n));
+    state.SetComplexityN(state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_inverse, float)->RangeMultiplier(2)->Range(8, 512)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_inverse, double)->RangeMultiplier(2)->Range(8, 512)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_inverse, long double)->RangeMultiplier(2)->Range(8, 256)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_determinant, float)->RangeMultiplier(2)->Range(8, 1024)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_determinant, double)->RangeMultiplier(2)->Range(8, 1024)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_determinant, long double)->RangeMultiplier(2)->Range(8, 256)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_gauss, double)->RangeMultiplier(2)->Range(8, 512)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_gauss, long double)->RangeMultiplier(2)->Range(8, 256)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_lu_factor, double)->RangeMultiplier(2)->Range(64, 1024)->Complexity(benchmark::oNCubed);
+BENCHMARK_TEMPLATE(BM_lu_solve, double)->RangeMultiplier(4)->Range(64, 1024);
+BENCHMARK_TEMPLATE(BM_cholesky, double)->RangeMultiplier(2)->Range(64, 1024)->Complexity(benchmark::oNCubed);
@@ -0,0 +1,356 @@
+/**
+ *  rot.cpp
+ *  Purpose: rotations, quaternions and 3D vector operations, in operations per second
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include "common.h"
+
+#include "batch.h"
+#include "quaternion.h"
+#include "rot.h"
+#include "vector.h"
+#include "vector_batch.h"
+
+using namespace algebra_benchmark;
+
+/**
+ *  The number of items each iteration of the per-item benchmarks works through, so that the
+ *  loop overhead of the framework does not dominate.
+ */
+
+static const size_t item_count = 4096;
+
+static void BM_euler_angle(benchmark::State &state) {
+    const std::vector<long double> x = random_values<long double>(item_count), y = random_values<long double>(item_count),
+                                   z = random_values<long double>(item_count);
+
+    for(auto _ : state) {
+        for(size_t k = 0; k < item_count; ++ k) {
+            euler_angle r(x[k], y[k], z[k]);
+            benchmark::DoNotOptimize(r);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(item_count));
+}
+
+template <typename T>
+static void BM_batch_euler_angle(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const std::vector<T> x = random_values<T>(count), y = random_values<T>(count), z = random_values<T>(count);
+    matrix_batch<3, T> out(count);
+
+    for(auto _ : state) {
+        batch_euler_angle(count, x.data(), y.data(), z.data(), out);
+        benchmark::DoNotOptimize(out.entries(0, 0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <size_t N, typename T>
+static void fill_batch(matrix_batch<N, T> &m) {
+    for(size_t r = 0; r < N; ++ r)
+        for(size_t c = 0; c < N; ++ c)
+            for(size_t k = 0; k < m.size(); ++ k)
+                m.entries(r, c)[k] = random_value<T>();
+}
+
+template <typename T>
+static void BM_batch_multiply(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    matrix_batch<3, T> a(count), b(count), c(count);
+
+    fill_batch(a);
+    fill_batch(b);
+
+    for(auto _ : state) {
+        batch_multiply(a, b, c);
+        benchmark::DoNotOptimize(c.entries(0, 0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T>
+static void BM_batch_apply(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    matrix_batch<3, T> m(count);
+    std::vector<T> x[3], y[3];
+    const T *in[3];
+    T *out[3];
+
+    fill_batch(m);
+    for(size_t i = 0; i < 3; ++ i) {
+        x[i] = random_values<T>(count);
+        y[i].resize(count);
+        in[i] = x[i].data();
+        out[i] = y[i].data();
+    }
+
+    for(auto _ : state) {
+        batch_apply(m, in, out);
+        benchmark::DoNotOptimize(out[0]);
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T>
+static std::vector<vector<T>> random_vectors(size_t n) {
+    std::vector<vector<T>> ret;
+    ret.reserve(n);
+
+    for(size_t i = 0; i < n; ++ i)
+        ret.emplace_back(random_value<T>(), random_value<T>(), random_value<T>());
+
+    return ret;
+}
+
+/**
+ *  One vector operation applied to consecutive pairs of a fixed set of vectors.
+ */
+
+template <typename T, typename Op>
+static void vector_benchmark(benchmark::State &state, Op op) {
+    const std::vector<vector<T>> u = random_vectors<T>(item_count), v = random_vectors<T>(item_count);
+
+    for(auto _ : state) {
+        for(size_t k = 0; k < item_count; ++ k) {
+            auto r = op(u[k], v[k]);
+            benchmark::DoNotOptimize(r);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(item_count));
+}
+
+template <typename T>
+static void BM_vector_add(benchmark::State &state) {
+    vector_benchmark<T>(state, [](const vector<T> &a, const vector<T> &b) { return a + b; });
+}
+
+template <typename T>
+static void BM_vector_dot(benchmark::State &state) {
+    vector_benchmark<T>(state, [](const vector<T> &a, const vector<T> &b) { return a * b; });
+}
+
+template <typename T>
+static void BM_vector_cross(benchmark::State &state) {
+    vector_benchmark<T>(state, [](const vector<T> &a, const vector<T> &b) { return a ^ b; });
+}
+
+template <typename T>
+static void BM_vector_normalize(benchmark::State &state) {
+    vector_benchmark<T>(state, [](const vector<T> &a, const vector<T> &) { return a.normalize(); });
+}
+
+template <typename T>
+static vector_batch<T> random_batch(size_t n) {
+    vector_batch<T> ret(n);
+
+    for(size_t i = 0; i < 3; ++ i)
+        for(size_t k = 0; k < n; ++ k)
+            ret.component(i)[k] = random_value<T>();
+
+    return ret;
+}
+
+template <typename T>
+static void BM_batch_dot(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const vector_batch<T> a = random_batch<T>(count), b = random_batch<T>(count);
+    std::vector<T> out(count);
+
+    for(auto _ : state) {
+        batch_dot(a, b, out.data());
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T>
+static void BM_batch_cross(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const vector_batch<T> a = random_batch<T>(count), b = random_batch<T>(count);
+    vector_batch<T> c(count);
+
+    for(auto _ : state) {
+        batch_cross(a, b, c);
+        benchmark::DoNotOptimize(c.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T, normalize_mode Mode>
+static void BM_batch_normalize(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const vector_batch<T> a = random_batch<T>(count);
+    vector_batch<T> out(count);
+
+    for(auto _ : state) {
+        batch_normalize(a, out, Mode);
+        benchmark::DoNotOptimize(out.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+/**
+ *  Advances positions by their velocities, the update at the heart of a physics step.
+ */
+
+template <typename T>
+static void BM_batch_axpy(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const vector_batch<T> v = random_batch<T>(count);
+    vector_batch<T> p = random_batch<T>(count);
+
+    for(auto _ : state) {
+        batch_axpy(T(1e-3), v, p);
+        benchmark::DoNotOptimize(p.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T>
+static void BM_quaternion_from_euler(benchmark::State &state) {
+    const std::vector<T> x = random_values<T>(item_count), y = random_values<T>(item_count),
+                         z = random_values<T>(item_count);
+
+    for(auto _ : state) {
+        for(size_t k = 0; k < item_count; ++ k) {
+            quaternion<T> q = quaternion<T>::from_euler(x[k], y[k], z[k]);
+            benchmark::DoNotOptimize(q);
+        }
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(item_count));
+}
+
+template <typename T>
+static quaternion_batch<T> random_rotations(size_t n) {
+    const std::vector<T> x = random_values<T>(n), y = random_values<T>(n), z = random_values<T>(n);
+    quaternion_batch<T> ret;
+    batch_euler_quaternion(n, x.data(), y.data(), z.data(), ret);
+    return ret;
+}
+
+template <typename T>
+static void BM_batch_euler_quaternion(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const std::vector<T> x = random_values<T>(count), y = random_values<T>(count), z = random_values<T>(count);
+    quaternion_batch<T> out(count);
+
+    for(auto _ : state) {
+        batch_euler_quaternion(count, x.data(), y.data(), z.data(), out);
+        benchmark::DoNotOptimize(out.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+template <typename T>
+static void BM_batch_compose(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const quaternion_batch<T> a = random_rotations<T>(count), b = random_rotations<T>(count);
+    quaternion_batch<T> c(count);
+
+    for(auto _ : state) {
+        batch_compose(a, b, c);
+        benchmark::DoNotOptimize(c.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+/**
+ *  Rotates every vector by its own rotation.
+ */
+
+template <typename T>
+static void BM_batch_rotate(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const quaternion_batch<T> q = random_rotations<T>(count);
+    const vector_batch<T> x = random_batch<T>(count);
+    vector_batch<T> y(count);
+
+    for(auto _ : state) {
+        batch_rotate(q, x, y);
+        benchmark::DoNotOptimize(y.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+/**
+ *  Rotates every vector by one rotation, as when turning a whole scene.
+ */
+
+template <typename T>
+static void BM_batch_rotate_one(benchmark::State &state) {
+    const size_t count = size_t(state.range(0));
+    const quaternion<T> q = quaternion<T>::from_euler(T(0.3), T(-1.2), T(2.1));
+    const vector_batch<T> x = random_batch<T>(count);
+    vector_batch<T> y(count);
+
+    for(auto _ : state) {
+        batch_rotate(q, x, y);
+        benchmark::DoNotOptimize(y.component(0));
+        benchmark::ClobberMemory();
+    }
+
+    state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(count));
+}
+
+BENCHMARK(BM_euler_angle);
+BENCHMARK_TEMPLATE(BM_batch_euler_angle, float)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_euler_angle, double)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_multiply, float)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_multiply, double)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_apply, float)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_batch_apply, double)->RangeMultiplier(16)->Range(256, 1 << 16);
+BENCHMARK_TEMPLATE(BM_vector_add, float);
+BENCHMARK_TEMPLATE(BM_vector_add, double);
+BENCHMARK_TEMPLATE(BM_vector_dot, float);
+BENCHMARK_TEMPLATE(BM_vector_dot, double);
+BENCHMARK_TEMPLATE(BM_vector_cross, float);
+BENCHMARK_TEMPLATE(BM_vector_cross, double);
+BENCHMARK_TEMPLATE(BM_vector_normalize, float);
+BENCHMARK_TEMPLATE(BM_vector_normalize, double);
+BENCHMARK_TEMPLATE(BM_batch_dot, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_dot, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_cross, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_cross, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_normalize, float, normalize_mode::exact)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_normalize, float, normalize_mode::fast)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_normalize, double, normalize_mode::exact)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_normalize, double, normalize_mode::fast)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_axpy, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_axpy, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_quaternion_from_euler, float);
+BENCHMARK_TEMPLATE(BM_quaternion_from_euler, double);
+BENCHMARK_TEMPLATE(BM_batch_euler_quaternion, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_euler_quaternion, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_compose, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_compose, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_rotate, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_rotate, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_rotate_one, float)->RangeMultiplier(32)->Range(1024, 1 << 20);
+BENCHMARK_TEMPLATE(BM_batch_rotate_one, double)->RangeMultiplier(32)->Range(1024, 1 << 20);
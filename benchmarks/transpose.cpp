@@ -0,0 +1,60 @@
+/**
+ *  transpose.cpp
+ *  Purpose: transpose bandwidth, in bytes read and written per second
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include "common.h"
+
+#include "transpose.h"
+
+using namespace algebra_benchmark;
+
+template <typename T>
+static void BM_transpose(benchmark::State &state) {
+    const size_t rows = size_t(state.range(0)), columns = size_t(state.range(1));
+    const matrix<T> a = random_matrix<T>(rows, columns);
+    matrix<T> b;
+
+    for(auto _ : state) {
+        transpose_into(b, a);
+        benchmark::DoNotOptimize(b.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * rows * columns * sizeof(T)));
+}
+
+template <typename T>
+static void BM_transpose_in_place(benchmark::State &state) {
+    const size_t n = size_t(state.range(0));
+    matrix<T> a = random_matrix<T>(n, n);
+
+    for(auto _ : state) {
+        a.transpose_in_place();
+        benchmark::DoNotOptimize(a.data());
+        benchmark::ClobberMemory();
+    }
+
+    state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(2 * n * n * sizeof(T)));
+}
+
+/**
+ *  Square shapes, plus the tall and wide ones that stress one side of the tiling.
+ */
+
+static void transpose_shapes(benchmark::internal::Benchmark *b) {
+    for(int64_t n = 64; n <= 4096; n *= 4)
+        b->Args({n, n});
+    b->Args({4096, 64});
+    b->Args({64, 4096});
+    b->Args({1000, 1000});
+}
+
+BENCHMARK_TEMPLATE(BM_transpose, float)->Apply(transpose_shapes);
+BENCHMARK_TEMPLATE(BM_transpose, double)->Apply(transpose_shapes);
+BENCHMARK_TEMPLATE(BM_transpose, std::complex<double>)->Apply(transpose_shapes);
+BENCHMARK_TEMPLATE(BM_transpose_in_place, float)->RangeMultiplier(4)->Range(64, 4096);
+BENCHMARK_TEMPLATE(BM_transpose_in_place, double)->RangeMultiplier(4)->Range(64, 4096);
@@ -0,0 +1,212 @@
+/**
+ *  blas.h
+ *  Purpose: optional dispatch of large float and double kernels to a vendor BLAS and LAPACK
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef BLAS_H
+
+#define BLAS_H
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <type_traits>
+
+#include "allocator.h"
+#include "transpose.h"
+
+/**
+ *  Define ALGEBRA_USE_BLAS to 1, and link a CBLAS and LAPACK implementation (OpenBLAS, MKL,
+ *  BLIS with libflame, ...), to let gemm, lu_factor and lu_solve hand large float and double
+ *  problems to it. Everything else, and every other data type, keeps using the kernels in this
+ *  library.
+ */
+
+#ifndef ALGEBRA_USE_BLAS
+#define ALGEBRA_USE_BLAS 0
+#endif
+
+#if ALGEBRA_USE_BLAS
+
+#include <cblas.h>
+
+extern "C" {
+void sgetrf_(const int *m, const int *n, float *a, const int *lda, int *ipiv, int *info);
+void dgetrf_(const int *m, const int *n, double *a, const int *lda, int *ipiv, int *info);
+}
+
+#endif
+
+/**
+ *  When the vendor library is used. enabled switches it off at runtime (it starts on when the
+ *  library is compiled in); below the thresholds the native kernels, which avoid the call
+ *  overhead and layout conversions, are used. gemm_threshold is measured as rows * columns *
+ *  inner dimension, like gemm_blocking::threshold; factor_threshold is the order of the
+ *  matrix. Adjust these before any kernel runs; they are read without synchronisation.
+ */
+
+struct blas_settings {
+    bool enabled;
+    size_t gemm_threshold;
+    size_t factor_threshold;
+};
+
+/**
+ *  Retrieves the settings deciding when the vendor library is used.
+ *
+ *  @return a reference to the process-wide settings.
+ */
+
+inline blas_settings &blas_tuning() {
+    static blas_settings settings = {ALGEBRA_USE_BLAS != 0, 128 * 128 * 128, 256};
+    return settings;
+}
+
+/**
+ *  Whether the library was built with a vendor BLAS and LAPACK.
+ *
+ *  @return true if ALGEBRA_USE_BLAS is set.
+ */
+
+constexpr bool blas_available() {
+    return ALGEBRA_USE_BLAS != 0;
+}
+
+namespace algebra_detail {
+
+/**
+ *  The data types the vendor library handles.
+ */
+
+template <typename T>
+struct blas_supported
+    : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value> {};
+
+inline bool blas_fits(size_t n) {
+    return n <= size_t(INT_MAX);
+}
+
+/**
+ *  Computes C = alpha * op(A) * op(B) + beta * C through the vendor gemm, if it should be used.
+ *
+ *  @return true if the product was computed.
+ */
+
+template <typename T>
+inline bool blas_gemm(bool ta, bool tb, size_t M, size_t N, size_t K, T alpha, const T *A, size_t lda,
+                      const T *B, size_t ldb, T beta, T *C, size_t ldc) {
+#if ALGEBRA_USE_BLAS
+    if constexpr (blas_supported<T>::value) {
+        const blas_settings &settings = blas_tuning();
+        if(!settings.enabled || M == 0 || N == 0 || K == 0 || M * N * K < settings.gemm_threshold ||
+           !blas_fits(std::max({M, N, K, lda, ldb, ldc}))) {
+            return false;
+        }
+
+        // Strides of single-row operands are never followed, but must still pass the checks.
+
+        lda = std::max(lda, ta ? M : K);
+        ldb = std::max(ldb, tb ? K : N);
+        ldc = std::max(ldc, N);
+
+        const CBLAS_TRANSPOSE op_a = ta ? CblasTrans : CblasNoTrans, op_b = tb ? CblasTrans : CblasNoTrans;
+        if constexpr (std::is_same<T, float>::value) {
+            cblas_sgemm(CblasRowMajor, op_a, op_b, int(M), int(N), int(K), alpha, A, int(lda), B, int(ldb), beta, C,
+                        int(ldc));
+        } else {
+            cblas_dgemm(CblasRowMajor, op_a, op_b, int(M), int(N), int(K), alpha, A, int(lda), B, int(ldb), beta, C,
+                        int(ldc));
+        }
+        return true;
+    }
+#endif
+    (void) ta, (void) tb, (void) M, (void) N, (void) K, (void) alpha, (void) A, (void) lda;
+    (void) B, (void) ldb, (void) beta, (void) C, (void) ldc;
+    return false;
+}
+
+/**
+ *  Factors the n x n row-major matrix A as P A = L U through the vendor getrf, if it should be
+ *  used, leaving A and pivots exactly as lu_factor does. LAPACK works on column-major storage,
+ *  so A is transposed into a scratch buffer owned by the calling thread and back.
+ *
+ *  @param singular receives the first step with a zero pivot, or n if there is none.
+ *  @return true if A was factored.
+ */
+
+template <typename T>
+inline bool blas_lu_factor(size_t n, T *A, size_t lda, size_t *pivots, size_t &singular) {
+#if ALGEBRA_USE_BLAS
+    if constexpr (blas_supported<T>::value) {
+        const blas_settings &settings = blas_tuning();
+        if(!settings.enabled || n == 0 || n < settings.factor_threshold || !blas_fits(n)) {
+            return false;
+        }
+
+        const nesting_guard nesting;
+        T *work = scratch_buffer<T, 12>(n * n, nesting.level);
+        int *ipiv = scratch_buffer<int, 12>(n, nesting.level);
+        const int order = int(n);
+        int info = 0;
+
+        transpose_copy(n, n, A, lda, work, n);
+        if constexpr (std::is_same<T, float>::value) {
+            sgetrf_(&order, &order, work, &order, ipiv, &info);
+        } else {
+            dgetrf_(&order, &order, work, &order, ipiv, &info);
+        }
+        transpose_copy(n, n, work, n, A, lda);
+
+        for(size_t i = 0; i < n; ++ i)
+            pivots[i] = size_t(ipiv[i] - 1);
+        singular = info > 0 ? size_t(info - 1) : n;
+        return true;
+    }
+#endif
+    (void) n, (void) A, (void) lda, (void) pivots, (void) singular;
+    return false;
+}
+
+/**
+ *  Solves L U X = B for m right-hand sides through two vendor triangular solves, if they
+ *  should be used. The row exchanges must already have been applied to B.
+ *
+ *  @return true if B was overwritten by X.
+ */
+
+template <typename T>
+inline bool blas_triangular_solve(size_t n, const T *LU, size_t ldlu, size_t m, T *B, size_t ldb) {
+#if ALGEBRA_USE_BLAS
+    if constexpr (blas_supported<T>::value) {
+        const blas_settings &settings = blas_tuning();
+        if(!settings.enabled || n == 0 || m < 2 || n * n * m < settings.gemm_threshold ||
+           !blas_fits(std::max({n, m, ldlu, ldb}))) {
+            return false;
+        }
+
+        ldlu = std::max(ldlu, n);
+        ldb = std::max(ldb, m);
+        if constexpr (std::is_same<T, float>::value) {
+            cblas_strsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit, int(n), int(m), 1.0f, LU,
+                        int(ldlu), B, int(ldb));
+            cblas_strsm(CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, int(n), int(m), 1.0f, LU,
+                        int(ldlu), B, int(ldb));
+        } else {
+            cblas_dtrsm(CblasRowMajor, CblasLeft, CblasLower, CblasNoTrans, CblasUnit, int(n), int(m), 1.0, LU,
+                        int(ldlu), B, int(ldb));
+            cblas_dtrsm(CblasRowMajor, CblasLeft, CblasUpper, CblasNoTrans, CblasNonUnit, int(n), int(m), 1.0, LU,
+                        int(ldlu), B, int(ldb));
+        }
+        return true;
+    }
+#endif
+    (void) n, (void) LU, (void) ldlu, (void) m, (void) B, (void) ldb;
+    return false;
+}
+
+}
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ *  cholesky.h
+ *  Purpose: Cholesky and LDL^T factorizations of symmetric matrices, for repeated solves
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef CHOLESKY_H
+
+#define CHOLESKY_H
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "elimination.h"
+#include "matrix.h"
+#include "symmetric.h"
+
+namespace algebra_detail {
+
+/**
+ *  Copies the lower triangle of a symmetric matrix into a dense one, leaving the upper
+ *  triangle zero.
+ */
+
+template <typename T, typename U>
+inline matrix<T> lower_triangle(const symmetric_matrix<U> &a) {
+    matrix<T> ret(a.size(), a.size(), T(0));
+
+    for(size_t i = 0; i < a.size(); ++ i)
+        for(size_t j = 0; j <= i; ++ j)
+            ret(i,j) = T(a(i,j));
+
+    return ret;
+}
+
+/**
+ *  Zeroes the strictly upper triangle, which the symmetric factorizations leave untouched.
+ */
+
+template <typename T>
+inline void clear_upper(matrix<T> &a) {
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = i + 1; j < a.columns(); ++ j)
+            a(i,j) = T(0);
+}
+
+}
+
+/**
+ *  cholesky_decomposition class, factors a symmetric positive definite matrix once as
+ *  A = L L^T and reuses the factor for solves, the determinant and the inverse. Takes half the
+ *  work of lu_decomposition and needs no pivoting.
+ *
+ *  @param T the data type the factorization is computed in.
+ */
+
+template <typename T = long double>
+class cholesky_decomposition {
+
+    private:
+
+    matrix<T> l;
+    size_t first_bad_pivot = 0;
+
+    inline void require_positive_definite() const {
+        if(!positive_definite()) {
+            throw degenerate_matrix_error();
+        }
+    }
+
+    public:
+
+    /**
+     *  Constructor for a cholesky_decomposition. Factors a, reading only its lower triangle.
+     *
+     *  @param a the symmetric matrix to factor.
+     */
+
+    template <typename U, typename A>
+    inline explicit cholesky_decomposition(const matrix<U, A> &a) : l(a) {
+        assert(a.rows() == a.columns());
+        first_bad_pivot = cholesky_factor(l.rows(), l.data(), l.stride());
+        algebra_detail::clear_upper(l);
+    }
+
+    /**
+     *  Constructor for a cholesky_decomposition of a block or an external buffer. Its entries
+     *  are copied once, into the factor.
+     *
+     *  @param a the symmetric view to factor.
+     */
+
+    template <typename U>
+    inline explicit cholesky_decomposition(const matrix_view<U> &a) : l(a) {
+        assert(a.rows() == a.columns());
+        first_bad_pivot = cholesky_factor(l.rows(), l.data(), l.stride());
+        algebra_detail::clear_upper(l);
+    }
+
+    template <typename U>
+    inline explicit cholesky_decomposition(const matrix_ref<U> &a) : cholesky_decomposition(matrix_view<U>(a)) {}
+
+    /**
+     *  Constructor for a cholesky_decomposition of a matrix in packed storage.
+     *
+     *  @param a the symmetric matrix to factor.
+     */
+
+    template <typename U>
+    inline explicit cholesky_decomposition(const symmetric_matrix<U> &a) : l(algebra_detail::lower_triangle<T>(a)) {
+        first_bad_pivot = cholesky_factor(l.rows(), l.data(), l.stride());
+        algebra_detail::clear_upper(l);
+    }
+
+    /**
+     *  Retrieves the order of the factored matrix.
+     *
+     *  @return the number of rows (and columns) of the factored matrix.
+     */
+
+    inline size_t size() const {
+        return l.rows();
+    }
+
+    /**
+     *  Checks whether the factored matrix is positive definite. When it is not, the factor is
+     *  only complete up to the first non-positive pivot.
+     *
+     *  @return true if every pivot was positive.
+     */
+
+    inline bool positive_definite() const {
+        return first_bad_pivot == size();
+    }
+
+    /**
+     *  Retrieves the lower triangular factor L; its upper triangle is zero.
+     *
+     *  @return L.
+     */
+
+    inline const matrix<T> &factor() const {
+        return l;
+    }
+
+    /**
+     *  Solves A x = b for one right-hand side.
+     *
+     *  @param b the right-hand side.
+     *  @return the solution x.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    inline std::vector<T> solve(std::vector<T> b) const {
+        assert(b.size() == size());
+        require_positive_definite();
+
+        cholesky_solve(size(), l.data(), l.stride(), 1, b.data(), 1);
+
+        return b;
+    }
+
+    /**
+     *  Solves A X = B for every column of B.
+     *
+     *  @param B the right-hand sides, one per column.
+     *  @return the solutions X, one per column.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    template <typename A>
+    inline matrix<T, A> solve(const matrix<T, A> &B) const {
+        matrix<T, A> X(B);
+
+        solve_in_place(X);
+
+        return X;
+    }
+
+    /**
+     *  Solves A X = B for every column of B, overwriting B with X.
+     *
+     *  @param B the right-hand sides, one per column; replaced by the solutions.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    template <typename A>
+    inline void solve_in_place(matrix<T, A> &B) const {
+        assert(B.rows() == size());
+        require_positive_definite();
+
+        cholesky_solve(size(), l.data(), l.stride(), B.columns(), B.data(), B.stride());
+    }
+
+    /**
+     *  Computes the determinant, the squared product of the diagonal of L.
+     *
+     *  @return the determinant of the factored matrix.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    inline T determinant() const {
+        require_positive_definite();
+        T res = T(1);
+
+        for(size_t i = 0; i < size(); ++ i)
+            res = res * l(i,i) * l(i,i);
+
+        return res;
+    }
+
+    /**
+     *  Computes log|det| from the diagonal of L, without overflow. The sign is always 1.
+     *
+     *  @return the sign and the natural logarithm of the determinant.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    inline log_det<T> log_determinant() const {
+        require_positive_definite();
+        log_det<T> ret = {T(1), T(0)};
+
+        for(size_t i = 0; i < size(); ++ i)
+            ret.log_abs = ret.log_abs + T(2) * std::log(l(i,i));
+
+        return ret;
+    }
+
+    /**
+     *  Computes the inverse by solving against the identity.
+     *
+     *  @return the inverse of the factored matrix.
+     *  @throws degenerate_matrix_error if the matrix is not positive definite
+     */
+
+    inline matrix<T> inverse() const {
+        matrix<T> ret = matrix<T>::identity(size());
+
+        solve_in_place(ret);
+
+        return ret;
+    }
+};
+
+/**
+ *  ldlt_decomposition class, factors a symmetric matrix once as A = L D L^T, with L unit lower
+ *  triangular and D diagonal, and reuses the factors for solves, the determinant and the
+ *  inverse. Unlike cholesky_decomposition it takes no square roots and accepts negative
+ *  definite matrices, but it does not pivot, so an indefinite matrix may still hit a zero
+ *  pivot.
+ *
+ *  @param T the data type the factorization is computed in.
+ */
+
+template <typename T = long double>
+class ldlt_decomposition {
+
+    private:
+
+    matrix<T> ld;
+    size_t first_zero_pivot = 0;
+
+    inline void require_nonsingular() const {
+        if(singular()) {
+            throw degenerate_matrix_error();
+        }
+    }
+
+    public:
+
+    /**
+     *  Constructor for an ldlt_decomposition. Factors a, reading only its lower triangle.
+     *
+     *  @param a the symmetric matrix to factor.
+     */
+
+    template <typename U, typename A>
+    inline explicit ldlt_decomposition(const matrix<U, A> &a) : ld(a) {
+        assert(a.rows() == a.columns());
+        first_zero_pivot = ldlt_factor(ld.rows(), ld.data(), ld.stride());
+        algebra_detail::clear_upper(ld);
+    }
+
+    /**
+     *  Constructor for an ldlt_decomposition of a block or an external buffer. Its entries are
+     *  copied once, into the factors.
+     *
+     *  @param a the symmetric view to factor.
+     */
+
+    template <typename U>
+    inline explicit ldlt_decomposition(const matrix_view<U> &a) : ld(a) {
+        assert(a.rows() == a.columns());
+        first_zero_pivot = ldlt_factor(ld.rows(), ld.data(), ld.stride());
+        algebra_detail::clear_upper(ld);
+    }
+
+    template <typename U>
+    inline explicit ldlt_decomposition(const matrix_ref<U> &a) : ldlt_decomposition(matrix_view<U>(a)) {}
+
+    /**
+     *  Constructor for an ldlt_decomposition of a matrix in packed storage.
+     *
+     *  @param a the symmetric matrix to factor.
+     */
+
+    template <typename U>
+    inline explicit ldlt_decomposition(const symmetric_matrix<U> &a) : ld(algebra_detail::lower_triangle<T>(a)) {
+        first_zero_pivot = ldlt_factor(ld.rows(), ld.data(), ld.stride());
+        algebra_detail::clear_upper(ld);
+    }
+
+    /**
+     *  Retrieves the order of the factored matrix.
+     *
+     *  @return the number of rows (and columns) of the factored matrix.
+     */
+
+    inline size_t size() const {
+        return ld.rows();
+    }
+
+    /**
+     *  Checks whether a zero pivot stopped the factorization.
+     *
+     *  @return true if D has a zero on its diagonal.
+     */
+
+    inline bool singular() const {
+        return first_zero_pivot < size();
+    }
+
+    /**
+     *  Retrieves the packed factors: L below the diagonal (with an implied unit diagonal) and D
+     *  on it. The upper triangle is zero.
+     *
+     *  @return the combined L and D factors.
+     */
+
+    inline const matrix<T> &factors() const {
+        return ld;
+    }
+
+    /**
+     *  Retrieves the diagonal factor D.
+     *
+     *  @return the diagonal of D.
+     */
+
+    inline std::vector<T> diagonal() const {
+        std::vector<T> ret(size());
+
+        for(size_t i = 0; i < size(); ++ i)
+            ret[i] = ld(i,i);
+
+        return ret;
+    }
+
+    /**
+     *  Solves A x = b for one right-hand side.
+     *
+     *  @param b the right-hand side.
+     *  @return the solution x.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    inline std::vector<T> solve(std::vector<T> b) const {
+        assert(b.size() == size());
+        require_nonsingular();
+
+        ldlt_solve(size(), ld.data(), ld.stride(), 1, b.data(), 1);
+
+        return b;
+    }
+
+    /**
+     *  Solves A X = B for every column of B.
+     *
+     *  @param B the right-hand sides, one per column.
+     *  @return the solutions X, one per column.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    template <typename A>
+    inline matrix<T, A> solve(const matrix<T, A> &B) const {
+        matrix<T, A> X(B);
+
+        solve_in_place(X);
+
+        return X;
+    }
+
+    /**
+     *  Solves A X = B for every column of B, overwriting B with X.
+     *
+     *  @param B the right-hand sides, one per column; replaced by the solutions.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    template <typename A>
+    inline void solve_in_place(matrix<T, A> &B) const {
+        assert(B.rows() == size());
+        require_nonsingular();
+
+        ldlt_solve(size(), ld.data(), ld.stride(), B.columns(), B.data(), B.stride());
+    }
+
+    /**
+     *  Computes the determinant, the product of D.
+     *
+     *  @return the determinant of the factored matrix.
+     */
+
+    inline T determinant() const {
+        if(singular()) {
+            return T(0);
+        }
+        T res = T(1);
+
+        for(size_t i = 0; i < size(); ++ i)
+            res = res * ld(i,i);
+
+        return res;
+    }
+
+    /**
+     *  Computes the sign and log|det| from D, without overflow.
+     *
+     *  @return the sign (-1, 0 or 1) and the natural logarithm of |det|.
+     */
+
+    inline log_det<T> log_determinant() const {
+        if(singular()) {
+            return {T(0), -std::numeric_limits<T>::infinity()};
+        }
+
+        log_det<T> ret = {T(1), T(0)};
+
+        for(size_t i = 0; i < size(); ++ i) {
+            if(ld(i,i) < T(0)) {
+                ret.sign = -ret.sign;
+            }
+            ret.log_abs = ret.log_abs + std::log(std::abs(ld(i,i)));
+        }
+
+        return ret;
+    }
+
+    /**
+     *  Computes the inverse by solving against the identity.
+     *
+     *  @return the inverse of the factored matrix.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    inline matrix<T> inverse() const {
+        matrix<T> ret = matrix<T>::identity(size());
+
+        solve_in_place(ret);
+
+        return ret;
+    }
+};
+
+#endif
@@ -0,0 +1,249 @@
+/**
+ *  convolution.h
+ *  Purpose: linear convolution of real sequences, directly or through the real FFT
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef CONVOLUTION_H
+
+#define CONVOLUTION_H
+
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "fft.h"
+#include "simd.h"
+
+/**
+ *  The length of the shorter sequence up to which convolve and fir_filter multiply directly
+ *  instead of going through the FFT.
+ */
+
+constexpr size_t convolve_direct_threshold = 64;
+
+namespace algebra_detail {
+
+/**
+ *  Adds the full linear convolution of a (na values) and b (nb values) to out, which holds
+ *  na + nb - 1 values.
+ */
+
+template <typename T>
+inline void convolve_direct(const T *a, size_t na, const T *b, size_t nb, T *out) {
+    for(size_t i = 0; i < na; ++ i)
+        simd_axpy(nb, a[i], b, out + i);
+}
+
+/**
+ *  The smallest power of two that is at least n (and at least 2).
+ */
+
+inline size_t fft_length(size_t n) {
+    size_t length = 2;
+    while(length < n) length <<= 1;
+    return length;
+}
+
+/**
+ *  Convolves blocks of a signal with a fixed kernel through one rfft_plan: the spectrum of
+ *  the zero-padded kernel is computed once, and each block of up to block() values costs one
+ *  forward and one inverse real transform.
+ */
+
+template <typename T>
+class fft_convolver {
+
+    private:
+
+    size_t taps;
+    std::shared_ptr<const rfft_plan<T>> plan;
+    std::vector<std::complex<T>> kernel, spectrum;
+    std::vector<T> work;
+
+    public:
+
+    inline fft_convolver(const T *h, size_t m, size_t n)
+        : taps(m), plan(cached_rfft_plan<T>(n)), kernel(n / 2 + 1), spectrum(n / 2 + 1), work(n) {
+        assert(m >= 1 && m <= n);
+        std::copy(h, h + m, work.begin());
+        plan->forward(work.data(), kernel.data());
+    }
+
+    inline size_t block() const {
+        return plan->size() - taps + 1;
+    }
+
+    /**
+     *  Computes the l + taps - 1 values of the convolution of x (l <= block() values) with
+     *  the kernel.
+     *
+     *  @return a pointer to the values, valid until the next call.
+     */
+
+    inline const T *apply(const T *x, size_t l) {
+        assert(l <= block());
+        std::copy(x, x + l, work.begin());
+        std::fill(work.begin() + l, work.end(), T(0));
+
+        plan->forward(work.data(), spectrum.data());
+        for(size_t k = 0; k < spectrum.size(); ++ k)
+            spectrum[k] *= kernel[k];
+        plan->inverse(spectrum.data(), work.data());
+
+        return work.data();
+    }
+};
+
+}
+
+/**
+ *  Computes the linear convolution of two real sequences, c[k] = sum of a[i] * b[k - i], e.g.
+ *  the coefficients of the product of two polynomials.
+ *
+ *  Short operands are multiplied directly. Otherwise the longer sequence is split into blocks
+ *  that are convolved with the shorter one through the real FFT and overlap-added, so a long
+ *  signal with a short filter costs O(n log m) rather than one transform of the full length.
+ *
+ *  @param a the first sequence.
+ *  @param b the second sequence.
+ *  @return the a.size() + b.size() - 1 values of the convolution, or nothing if either is empty.
+ */
+
+template <typename T>
+std::vector<T> convolve(const std::vector<T> &a, const std::vector<T> &b) {
+    static_assert(std::is_floating_point<T>::value, "convolve needs a floating point type");
+
+    if(a.empty() || b.empty()) {
+        return {};
+    }
+
+    const std::vector<T> &x = a.size() >= b.size() ? a : b, &h = a.size() >= b.size() ? b : a;
+    const size_t nx = x.size(), m = h.size();
+    std::vector<T> out(nx + m - 1, T(0));
+
+    if(m <= convolve_direct_threshold) {
+        algebra_detail::convolve_direct(h.data(), m, x.data(), nx, out.data());
+        return out;
+    }
+
+    // Blocks four times the kernel length keep most of each transform useful without
+    // transforming the whole of a long signal at once.
+
+    const size_t n = std::min(algebra_detail::fft_length(nx + m - 1), algebra_detail::fft_length(4 * m));
+    algebra_detail::fft_convolver<T> convolver(h.data(), m, n);
+
+    for(size_t s = 0; s < nx; s += convolver.block()) {
+        const size_t l = std::min(convolver.block(), nx - s);
+        const T *y = convolver.apply(x.data() + s, l);
+        for(size_t i = 0; i < l + m - 1; ++ i)
+            out[s + i] += y[i];
+    }
+
+    return out;
+}
+
+/**
+ *  fir_filter class, a streaming finite impulse response filter: successive calls to
+ *  process() continue one long convolution of the input with the taps, so a stream can be
+ *  filtered in chunks of any size.
+ *
+ *  Long filters run overlap-add on the real FFT; short filters multiply directly.
+ *
+ *  @param T the (floating point) data type of the samples.
+ */
+
+template <typename T>
+class fir_filter {
+
+    static_assert(std::is_floating_point<T>::value, "fir_filter needs a floating point type");
+
+    private:
+
+    std::vector<T> taps;
+
+    /**
+     *  The contributions of past input to the next taps.size() - 1 outputs.
+     */
+
+    std::vector<T> tail;
+    std::unique_ptr<algebra_detail::fft_convolver<T>> convolver;
+    std::vector<T> direct;
+
+    public:
+
+    /**
+     *  Constructor for a fir_filter.
+     *
+     *  @param h the filter taps (impulse response); must not be empty.
+     */
+
+    inline explicit fir_filter(std::vector<T> h) : taps(std::move(h)), tail(taps.size() - 1, T(0)) {
+        assert(!taps.empty());
+
+        if(taps.size() > convolve_direct_threshold) {
+            convolver.reset(new algebra_detail::fft_convolver<T>(taps.data(), taps.size(),
+                                                                 algebra_detail::fft_length(4 * taps.size())));
+        }
+    }
+
+    /**
+     *  Filters the next count samples of the stream.
+     *
+     *  @param in the input samples.
+     *  @param count the number of samples.
+     *  @param out receives count output samples, y[t] = sum of h[j] * x[t - j]; may be in.
+     */
+
+    inline void process(const T *in, size_t count, T *out) {
+        const size_t m = taps.size();
+        const size_t block = convolver ? convolver->block() : std::max<size_t>(m, 256);
+
+        for(size_t s = 0; s < count; s += block) {
+            const size_t l = std::min(block, count - s);
+            const T *y;
+
+            if(convolver) {
+                y = convolver->apply(in + s, l);
+            } else {
+                direct.assign(l + m - 1, T(0));
+                algebra_detail::convolve_direct(taps.data(), m, in + s, l, direct.data());
+                y = direct.data();
+            }
+
+            for(size_t i = 0; i < l; ++ i)
+                out[s + i] = y[i] + (i < m - 1 ? tail[i] : T(0));
+            for(size_t i = 0; i + 1 < m; ++ i)
+                tail[i] = (i + l < m - 1 ? tail[i + l] : T(0)) + y[l + i];
+        }
+    }
+
+    /**
+     *  Filters a chunk of the stream.
+     *
+     *  @param in the input samples.
+     *  @return the same number of output samples.
+     */
+
+    inline std::vector<T> process(const std::vector<T> &in) {
+        std::vector<T> out(in.size());
+        process(in.data(), in.size(), out.data());
+        return out;
+    }
+
+    /**
+     *  Forgets all past input, as if the stream started again.
+     */
+
+    inline void reset() {
+        std::fill(tail.begin(), tail.end(), T(0));
+    }
+};
+
+#endif
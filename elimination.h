@@ -0,0 +1,442 @@
+/**
+ *  elimination.h
+ *  Purpose: pivoted Gaussian elimination and symmetric factorization kernels on row-major buffers
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef ELIMINATION_H
+
+#define ELIMINATION_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "allocator.h"
+#include "blas.h"
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+/**
+ *  The width of the column panels lu_factor factors before updating the trailing matrix.
+ */
+
+constexpr size_t lu_block_size = 64;
+
+/**
+ *  The width of the column panels cholesky_factor and ldlt_factor factor before updating the
+ *  trailing matrix.
+ */
+
+constexpr size_t cholesky_block_size = 64;
+
+namespace algebra_detail {
+
+/**
+ *  The magnitude used to choose pivots.
+ */
+
+template <typename T>
+inline auto pivot_magnitude(const T &t) {
+    using std::abs;
+    return abs(t);
+}
+
+/**
+ *  Factors the columns [k0, k1) of the rows [k0, rows) in place, choosing the largest entry
+ *  of each column as its pivot. Rows are exchanged across their full width.
+ *
+ *  @return the first column whose pivot is zero, or width if there is none.
+ */
+
+template <typename T>
+size_t lu_factor_panel(size_t rows, size_t width, size_t k0, size_t k1, T *A, size_t lda, size_t *pivots) {
+    size_t singular = width;
+
+    for(size_t j = k0; j < k1; ++ j) {
+        size_t p = j;
+        auto best = pivot_magnitude(A[j * lda + j]);
+        for(size_t i = j + 1; i < rows; ++ i) {
+            const auto m = pivot_magnitude(A[i * lda + j]);
+            if(best < m) {
+                best = m;
+                p = i;
+            }
+        }
+
+        pivots[j] = p;
+        if(p != j) {
+            std::swap_ranges(A + j * lda, A + j * lda + width, A + p * lda);
+        }
+
+        if(A[j * lda + j] == T(0)) {
+            singular = std::min(singular, j);
+            continue;
+        }
+
+        const T reciprocal = T(1) / A[j * lda + j];
+        const T *pivot_row = A + j * lda + j + 1;
+        for(size_t i = j + 1; i < rows; ++ i) {
+            T *row = A + i * lda;
+            row[j] = row[j] * reciprocal;
+            const T l = row[j];
+            for(size_t c = 0; c + j + 1 < k1; ++ c)
+                row[j + 1 + c] = row[j + 1 + c] - l * pivot_row[c];
+        }
+    }
+
+    return singular;
+}
+
+/**
+ *  Subtracts L diag(D) L^T from the lower triangle of the m x m matrix C, where L is m x b.
+ *  Without D the right operand is L itself, read transposed; with D, L scaled by D is copied
+ *  once first.
+ */
+
+template <typename T>
+void symmetric_update(size_t m, size_t b, const T *L, size_t ldl, const T *D, T *C, size_t ldc) {
+    if(!D) {
+        syrk_blocked(m, b, T(-1), gemm_transpose::none, L, ldl, gemm_transpose::transpose, L, ldl, C, ldc);
+        return;
+    }
+
+    std::vector<T, aligned_allocator<T>> scaled(m * b);
+    for(size_t i = 0; i < m; ++ i)
+        for(size_t k = 0; k < b; ++ k)
+            scaled[i * b + k] = L[i * ldl + k] * D[k];
+
+    syrk_blocked(m, b, T(-1), gemm_transpose::none, L, ldl, gemm_transpose::transpose, scaled.data(), b, C, ldc);
+}
+
+/**
+ *  Solves L L^T X = B (unit == false) or L D L^T X = B (unit == true, with D stored on the
+ *  diagonal of L) in place for m right-hand sides.
+ */
+
+template <typename T>
+void symmetric_solve(size_t n, const T *L, size_t ldl, bool unit, size_t m, T *B, size_t ldb) {
+
+    // A single contiguous right-hand side is solved with dot products and axpys along the
+    // rows of L, so neither sweep walks down a column.
+
+    if(m == 1 && ldb == 1) {
+        for(size_t i = 0; i < n; ++ i) {
+            B[i] = B[i] - simd_dot(i, L + i * ldl, B);
+            if(!unit) {
+                B[i] = B[i] / L[i * ldl + i];
+            }
+        }
+        if(unit) {
+            for(size_t i = 0; i < n; ++ i)
+                B[i] = B[i] / L[i * ldl + i];
+        }
+        for(size_t i = n; i -- > 0;) {
+            if(!unit) {
+                B[i] = B[i] / L[i * ldl + i];
+            }
+            simd_axpy(i, T(0) - B[i], L + i * ldl, B);
+        }
+        return;
+    }
+
+    parallel_for(0, m, std::max<size_t>(16, 65536 / std::max<size_t>(1, n * n)), [&](size_t c0, size_t c1) {
+        const size_t w = c1 - c0;
+        for(size_t i = 0; i < n; ++ i) {
+            T *row = B + i * ldb + c0;
+            for(size_t k = 0; k < i; ++ k)
+                simd_axpy(w, T(0) - L[i * ldl + k], B + k * ldb + c0, row);
+            if(!unit) {
+                simd_scale(w, row, T(1) / L[i * ldl + i], row);
+            }
+        }
+        if(unit) {
+            for(size_t i = 0; i < n; ++ i)
+                simd_scale(w, B + i * ldb + c0, T(1) / L[i * ldl + i], B + i * ldb + c0);
+        }
+        for(size_t i = n; i -- > 0;) {
+            T *row = B + i * ldb + c0;
+            if(!unit) {
+                simd_scale(w, row, T(1) / L[i * ldl + i], row);
+            }
+            for(size_t k = 0; k < i; ++ k)
+                simd_axpy(w, T(0) - L[i * ldl + k], row, B + k * ldb + c0);
+        }
+    });
+}
+
+}
+
+/**
+ *  Factors the rows x width row-major matrix A (rows >= width) in place as P A = L U, with
+ *  partial pivoting, the way lu_factor does. L is rows x width and U is width x width; the
+ *  pivots only exchange rows within A.
+ *
+ *  @param rows the number of rows of A.
+ *  @param width the number of columns of A.
+ *  @param A the matrix to factor, with a row stride of lda.
+ *  @param pivots receives width row indices: row i was exchanged with row pivots[i] at step i.
+ *  @return the first step with a zero pivot, or width if there is none.
+ */
+
+template <typename T>
+size_t lu_factor_tall(size_t rows, size_t width, T *A, size_t lda, size_t *pivots) {
+    assert(rows >= width);
+    size_t singular = width;
+
+    for(size_t k0 = 0; k0 < width; k0 += lu_block_size) {
+        const size_t k1 = std::min(width, k0 + lu_block_size);
+
+        singular = std::min(singular, algebra_detail::lu_factor_panel(rows, width, k0, k1, A, lda, pivots));
+
+        if(k1 == width) {
+            break;
+        }
+
+        // U12 = L11^-1 A12, a unit lower triangular solve on the rows of the panel.
+
+        const size_t rest = width - k1;
+        for(size_t j = k0; j < k1; ++ j) {
+            const T *source = A + j * lda + k1;
+            for(size_t i = j + 1; i < k1; ++ i)
+                simd_axpy(rest, T(0) - A[i * lda + j], source, A + i * lda + k1);
+        }
+
+        // A22 = A22 - L21 U12
+
+        gemm(rows - k1, rest, k1 - k0, T(-1), A + k1 * lda + k0, lda,
+             A + k0 * lda + k1, lda, T(1), A + k1 * lda + k1, lda);
+    }
+
+    return singular;
+}
+
+/**
+ *  Factors the n x n row-major matrix A in place as P A = L U, with partial pivoting.
+ *
+ *  Right-looking and blocked: each panel of lu_block_size columns is factored, the matching
+ *  rows of U are solved against it, and the trailing matrix is updated with one gemm call
+ *  (which runs in parallel for large n). On return the strictly lower part of A holds L (its
+ *  unit diagonal is implied) and the upper part holds U. Built with ALGEBRA_USE_BLAS, large
+ *  float and double matrices are factored by LAPACK instead (see blas.h), with the same result.
+ *
+ *  @param n the order of A.
+ *  @param A the matrix to factor, with a row stride of lda.
+ *  @param pivots receives n row indices: row i was exchanged with row pivots[i] at step i.
+ *  @return the first step with a zero pivot, or n if A is nonsingular.
+ */
+
+template <typename T>
+size_t lu_factor(size_t n, T *A, size_t lda, size_t *pivots) {
+    size_t singular;
+    if(algebra_detail::blas_lu_factor(n, A, lda, pivots, singular)) {
+        return singular;
+    }
+    return lu_factor_tall(n, n, A, lda, pivots);
+}
+
+/**
+ *  Solves A X = B in place for m right-hand sides, given the factors from lu_factor.
+ *
+ *  @param n the order of A.
+ *  @param LU the factors, with a row stride of ldlu.
+ *  @param pivots the row exchanges from lu_factor.
+ *  @param m the number of right-hand sides (columns of B).
+ *  @param B the n x m right-hand sides, with a row stride of ldb; overwritten by X.
+ */
+
+template <typename T>
+void lu_solve(size_t n, const T *LU, size_t ldlu, const size_t *pivots, size_t m, T *B, size_t ldb) {
+    for(size_t i = 0; i < n; ++ i) {
+        if(pivots[i] != i) {
+            std::swap_ranges(B + i * ldb, B + i * ldb + m, B + pivots[i] * ldb);
+        }
+    }
+
+    // A single contiguous right-hand side is solved with dot products along the rows of LU.
+
+    if(m == 1 && ldb == 1) {
+        for(size_t i = 0; i < n; ++ i)
+            B[i] = B[i] - simd_dot(i, LU + i * ldlu, B);
+        for(size_t i = n; i -- > 0;) {
+            const size_t k = i + 1;
+            B[i] = (B[i] - simd_dot(n - k, LU + i * ldlu + k, B + k)) / LU[i * ldlu + i];
+        }
+        return;
+    }
+
+    if(algebra_detail::blas_triangular_solve(n, LU, ldlu, m, B, ldb)) {
+        return;
+    }
+
+    // Each right-hand side column is independent, so wide B is split across threads.
+
+    parallel_for(0, m, std::max<size_t>(16, 65536 / std::max<size_t>(1, n * n)), [&](size_t c0, size_t c1) {
+        const size_t w = c1 - c0;
+        for(size_t i = 0; i < n; ++ i) {
+            T *row = B + i * ldb + c0;
+            for(size_t k = 0; k < i; ++ k)
+                simd_axpy(w, T(0) - LU[i * ldlu + k], B + k * ldb + c0, row);
+        }
+        for(size_t i = n; i -- > 0;) {
+            T *row = B + i * ldb + c0;
+            for(size_t k = i + 1; k < n; ++ k)
+                simd_axpy(w, T(0) - LU[i * ldlu + k], B + k * ldb + c0, row);
+            simd_scale(w, row, T(1) / LU[i * ldlu + i], row);
+        }
+    });
+}
+
+/**
+ *  Factors the symmetric positive definite n x n row-major matrix A in place as A = L L^T,
+ *  reading and writing only its lower triangle.
+ *
+ *  Right-looking and blocked like lu_factor: each panel of cholesky_block_size columns is
+ *  factored, the rows below it are solved against its diagonal block, and the lower triangle
+ *  of the trailing matrix is updated through syrk_blocked, which shares the gemm kernels and
+ *  threading. On return the lower triangle of A, diagonal included, holds L.
+ *
+ *  @param n the order of A.
+ *  @param A the matrix to factor, with a row stride of lda.
+ *  @return the first step whose pivot is not positive (A is not positive definite, and the
+ *  factorization stops there), or n if A is positive definite.
+ */
+
+template <typename T>
+size_t cholesky_factor(size_t n, T *A, size_t lda) {
+    using std::sqrt;
+
+    for(size_t k0 = 0; k0 < n; k0 += cholesky_block_size) {
+        const size_t k1 = std::min(n, k0 + cholesky_block_size);
+
+        for(size_t j = k0; j < k1; ++ j) {
+            T *row_j = A + j * lda;
+            const T d = row_j[j] - simd_dot(j - k0, row_j + k0, row_j + k0);
+            if(!(T(0) < d)) {
+                return j;
+            }
+            row_j[j] = sqrt(d);
+            for(size_t i = j + 1; i < k1; ++ i) {
+                T *row = A + i * lda;
+                row[j] = (row[j] - simd_dot(j - k0, row + k0, row_j + k0)) / row_j[j];
+            }
+        }
+
+        if(k1 == n) {
+            break;
+        }
+
+        // L21 = A21 L11^-T, one independent triangular solve per row.
+
+        parallel_for(k1, n, 16, [&](size_t i0, size_t i1) {
+            for(size_t i = i0; i < i1; ++ i) {
+                T *row = A + i * lda;
+                for(size_t j = k0; j < k1; ++ j)
+                    row[j] = (row[j] - simd_dot(j - k0, row + k0, A + j * lda + k0)) / A[j * lda + j];
+            }
+        });
+
+        // A22 = A22 - L21 L21^T, lower triangle only.
+
+        algebra_detail::symmetric_update(n - k1, k1 - k0, A + k1 * lda + k0, lda, static_cast<const T *>(nullptr),
+                                         A + k1 * lda + k1, lda);
+    }
+
+    return n;
+}
+
+/**
+ *  Factors the symmetric n x n row-major matrix A in place as A = L D L^T, with L unit lower
+ *  triangular and D diagonal, reading and writing only its lower triangle. No pivoting is
+ *  done, so this suits matrices that are definite (of either sign) or otherwise known to
+ *  factor stably; unlike cholesky_factor it takes no square roots.
+ *
+ *  Blocked the same way as cholesky_factor. On return the strictly lower part of A holds L
+ *  (its unit diagonal is implied) and the diagonal holds D.
+ *
+ *  @param n the order of A.
+ *  @param A the matrix to factor, with a row stride of lda.
+ *  @return the first step with a zero pivot (the factorization stops there), or n if there
+ *  is none.
+ */
+
+template <typename T>
+size_t ldlt_factor(size_t n, T *A, size_t lda) {
+    std::vector<T> scaled(cholesky_block_size * cholesky_block_size), d(cholesky_block_size);
+
+    for(size_t k0 = 0; k0 < n; k0 += cholesky_block_size) {
+        const size_t k1 = std::min(n, k0 + cholesky_block_size), b = k1 - k0;
+
+        // Row j of scaled holds L(j, k0:j) D(k0:j), reused by every row below the pivot.
+
+        for(size_t j = k0; j < k1; ++ j) {
+            T *row_j = A + j * lda, *w = scaled.data() + (j - k0) * b;
+            for(size_t p = k0; p < j; ++ p)
+                w[p - k0] = row_j[p] * d[p - k0];
+
+            d[j - k0] = row_j[j] - simd_dot(j - k0, row_j + k0, w);
+            if(d[j - k0] == T(0)) {
+                return j;
+            }
+            row_j[j] = d[j - k0];
+            for(size_t i = j + 1; i < k1; ++ i) {
+                T *row = A + i * lda;
+                row[j] = (row[j] - simd_dot(j - k0, row + k0, w)) / d[j - k0];
+            }
+        }
+
+        if(k1 == n) {
+            break;
+        }
+
+        parallel_for(k1, n, 16, [&](size_t i0, size_t i1) {
+            for(size_t i = i0; i < i1; ++ i) {
+                T *row = A + i * lda;
+                for(size_t j = k0; j < k1; ++ j)
+                    row[j] = (row[j] - simd_dot(j - k0, row + k0, scaled.data() + (j - k0) * b)) / d[j - k0];
+            }
+        });
+
+        // A22 = A22 - L21 D1 L21^T, lower triangle only.
+
+        algebra_detail::symmetric_update(n - k1, b, A + k1 * lda + k0, lda, d.data(), A + k1 * lda + k1, lda);
+    }
+
+    return n;
+}
+
+/**
+ *  Solves A X = B in place for m right-hand sides, given the factor from cholesky_factor.
+ *
+ *  @param n the order of A.
+ *  @param L the factor, with a row stride of ldl; only its lower triangle is read.
+ *  @param m the number of right-hand sides (columns of B).
+ *  @param B the n x m right-hand sides, with a row stride of ldb; overwritten by X.
+ */
+
+template <typename T>
+void cholesky_solve(size_t n, const T *L, size_t ldl, size_t m, T *B, size_t ldb) {
+    algebra_detail::symmetric_solve(n, L, ldl, false, m, B, ldb);
+}
+
+/**
+ *  Solves A X = B in place for m right-hand sides, given the factors from ldlt_factor.
+ *
+ *  @param n the order of A.
+ *  @param LD the factors, with a row stride of ldld; only its lower triangle is read.
+ *  @param m the number of right-hand sides (columns of B).
+ *  @param B the n x m right-hand sides, with a row stride of ldb; overwritten by X.
+ */
+
+template <typename T>
+void ldlt_solve(size_t n, const T *LD, size_t ldld, size_t m, T *B, size_t ldb) {
+    algebra_detail::symmetric_solve(n, LD, ldld, true, m, B, ldb);
+}
+
+#endif
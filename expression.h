@@ -0,0 +1,488 @@
+/**
+ *  expression.h
+ *  Purpose: lazy elementwise matrix expressions, evaluated in one pass on assignment
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef EXPRESSION_H
+
+#define EXPRESSION_H
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.h"
+
+template <typename T = int, typename Allocator = aligned_allocator<T>>
+class matrix;
+
+template <typename T>
+class matrix_transposed;
+
+template <typename T>
+class matrix_view;
+
+template <typename T>
+class matrix_ref;
+
+/**
+ *  matrix_expression class, the base of every matrix and every lazy matrix expression.
+ *
+ *  A sum such as a + b * 2 - c builds a tree of expression nodes instead of intermediate
+ *  matrices; the tree is evaluated entry by entry, in a single loop, when it is assigned to a
+ *  matrix. Operand matrices are referenced, not copied, so an expression must not outlive
+ *  them. Temporary matrices (e.g. the result of a product) are moved into the tree.
+ *
+ *  @param E the concrete expression type.
+ */
+
+template <typename E>
+class matrix_expression {
+
+    public:
+
+    /**
+     *  Retrieves the concrete expression.
+     *
+     *  @return a reference to the expression as its derived type.
+     */
+
+    inline const E &self() const {
+        return static_cast<const E &>(*this);
+    }
+
+    /**
+     *  Retrieves the number of rows of the expression's result.
+     *
+     *  @return the number of rows.
+     */
+
+    inline size_t rows() const {
+        return self().rows();
+    }
+
+    /**
+     *  Retrieves the number of columns of the expression's result.
+     *
+     *  @return the number of columns.
+     */
+
+    inline size_t columns() const {
+        return self().columns();
+    }
+
+    /**
+     *  Evaluates the expression into a new matrix.
+     *
+     *  @return a matrix holding the result.
+     */
+
+    inline auto eval() const {
+        return matrix<typename E::value_type>(self());
+    }
+
+    /**
+     *  The members below evaluate the expression once, then call the matrix member of the
+     *  same name, so (a * 2).inverse() reads as it did when a * 2 was a matrix. matrix has its
+     *  own versions, which hide these.
+     */
+
+    inline auto transpose() const {
+        return eval().transpose();
+    }
+
+    template <typename T1 = long double>
+    inline auto inverse() const {
+        return eval().template inverse<T1>();
+    }
+
+    template <typename T1 = long double>
+    inline auto determinant() const {
+        return eval().template determinant<T1>();
+    }
+
+    template <typename T1 = long double>
+    inline auto log_determinant() const {
+        return eval().template log_determinant<T1>();
+    }
+};
+
+namespace algebra_detail {
+
+template <typename E>
+struct is_expression : std::is_base_of<matrix_expression<E>, E> {};
+
+template <typename T>
+struct is_matrix : std::false_type {};
+
+template <typename T, typename A>
+struct is_matrix<matrix<T, A>> : std::true_type {};
+
+/**
+ *  Matrices of T, whatever allocator holds their entries.
+ */
+
+template <typename M, typename T>
+struct is_matrix_of : std::false_type {};
+
+template <typename T, typename A>
+struct is_matrix_of<matrix<T, A>, T> : std::true_type {};
+
+/**
+ *  Operands gemm reads in place: plain matrices, transposed views of them, and strided views
+ *  and references.
+ */
+
+template <typename T>
+struct is_gemm_operand : is_matrix<T> {};
+
+template <typename T>
+struct is_gemm_operand<matrix_transposed<T>> : std::true_type {};
+
+template <typename T>
+struct is_gemm_operand<matrix_view<T>> : std::true_type {};
+
+template <typename T>
+struct is_gemm_operand<matrix_ref<T>> : std::true_type {};
+
+/**
+ *  How an operand of type E (as forwarded) is held inside an expression node: matrices that
+ *  outlive the expression by const reference, temporary matrices and nested nodes by value.
+ */
+
+template <typename E>
+struct expression_operand {
+    typedef typename std::decay<E>::type decayed;
+    typedef typename std::conditional<is_matrix<decayed>::value && std::is_lvalue_reference<E>::value,
+                                      const decayed &, decayed>::type type;
+};
+
+template <typename E>
+using operand_t = typename expression_operand<E>::type;
+
+template <typename L, typename R>
+using enable_if_expressions = typename std::enable_if<
+    is_expression<typename std::decay<L>::type>::value &&
+    is_expression<typename std::decay<R>::type>::value>::type;
+
+template <typename E>
+using enable_if_expression = typename std::enable_if<is_expression<typename std::decay<E>::type>::value>::type;
+
+/**
+ *  Comparisons where at least one side is not a plain matrix; two matrices use the members.
+ */
+
+template <typename L, typename R>
+using enable_if_expression_comparison = typename std::enable_if<
+    is_expression<L>::value && is_expression<R>::value && !(is_matrix<L>::value && is_matrix<R>::value)>::type;
+
+struct add_op {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) {
+        return a + b;
+    }
+};
+
+struct subtract_op {
+    template <typename A, typename B>
+    static inline auto apply(const A &a, const B &b) {
+        return a - b;
+    }
+};
+
+}
+
+/**
+ *  matrix_binary class, the lazy entrywise combination of two expressions of equal shape.
+ *
+ *  @param L the left operand, as held by the node.
+ *  @param R the right operand, as held by the node.
+ *  @param Op the entrywise operation.
+ */
+
+template <typename L, typename R, typename Op>
+class matrix_binary : public matrix_expression<matrix_binary<L, R, Op>> {
+
+    public:
+
+    typedef typename std::decay<L>::type left_type;
+    typedef typename std::decay<R>::type right_type;
+    typedef typename left_type::value_type value_type;
+
+    L left;
+    R right;
+
+    template <typename A, typename B>
+    inline matrix_binary(A &&a, B &&b) : left(std::forward<A>(a)), right(std::forward<B>(b)) {
+        assert(left.rows() == right.rows() && left.columns() == right.columns());
+    }
+
+    inline size_t rows() const {
+        return left.rows();
+    }
+
+    inline size_t columns() const {
+        return left.columns();
+    }
+
+    inline value_type operator () (size_t row, size_t column) const {
+        return Op::apply(left(row, column), right(row, column));
+    }
+};
+
+/**
+ *  matrix_negate class, the lazy negation of an expression.
+ *
+ *  @param E the operand, as held by the node.
+ */
+
+template <typename E>
+class matrix_negate : public matrix_expression<matrix_negate<E>> {
+
+    public:
+
+    typedef typename std::decay<E>::type operand_type;
+    typedef typename operand_type::value_type value_type;
+
+    E operand;
+
+    template <typename A>
+    inline explicit matrix_negate(A &&a) : operand(std::forward<A>(a)) {}
+
+    inline size_t rows() const {
+        return operand.rows();
+    }
+
+    inline size_t columns() const {
+        return operand.columns();
+    }
+
+    inline value_type operator () (size_t row, size_t column) const {
+        return -operand(row, column);
+    }
+};
+
+/**
+ *  matrix_scaled class, the lazy product of an expression and a constant.
+ *
+ *  @param E the operand, as held by the node.
+ */
+
+template <typename E>
+class matrix_scaled : public matrix_expression<matrix_scaled<E>> {
+
+    public:
+
+    typedef typename std::decay<E>::type operand_type;
+    typedef typename operand_type::value_type value_type;
+
+    E operand;
+    value_type scale;
+
+    template <typename A>
+    inline matrix_scaled(A &&a, const value_type &t) : operand(std::forward<A>(a)), scale(t) {}
+
+    inline size_t rows() const {
+        return operand.rows();
+    }
+
+    inline size_t columns() const {
+        return operand.columns();
+    }
+
+    inline value_type operator () (size_t row, size_t column) const {
+        return operand(row, column) * scale;
+    }
+};
+
+/**
+ *  matrix_transposed class, a zero-copy view of the transpose of a matrix. Entry (i,j) reads
+ *  entry (j,i) of the matrix; products with a view hand the matrix's storage to gemm as a
+ *  transposed operand, and assigning a view to a matrix runs the blocked transpose.
+ *
+ *  @param T the data type of the matrix.
+ */
+
+template <typename T>
+class matrix_transposed : public matrix_expression<matrix_transposed<T>> {
+
+    public:
+
+    typedef T value_type;
+
+    const matrix<T> &operand;
+
+    inline explicit matrix_transposed(const matrix<T> &m) : operand(m) {}
+
+    inline size_t rows() const {
+        return operand.columns();
+    }
+
+    inline size_t columns() const {
+        return operand.rows();
+    }
+
+    inline value_type operator () (size_t row, size_t column) const {
+        return operand(column, row);
+    }
+};
+
+/**
+ *  Views a matrix as its transpose, without copying it. The view refers to m, so it must not
+ *  outlive it.
+ *
+ *  @param m the matrix to view.
+ *  @return a lazy expression for m^T.
+ */
+
+template <typename T>
+inline matrix_transposed<T> transposed(const matrix<T> &m) {
+    return matrix_transposed<T>(m);
+}
+
+template <typename T>
+void transposed(const matrix<T> &&m) = delete;
+
+namespace algebra_detail {
+
+/**
+ *  Checks if evaluating an expression entry by entry into the storage [begin, end) could
+ *  read an entry after it has been written. Every other node reads entry (i,j) of its
+ *  operands for entry (i,j) of the result, so only transposed views of a matrix overlapping
+ *  that storage can; the whole tree is searched for one.
+ *
+ *  @param e the expression to evaluate.
+ *  @param begin the first entry written.
+ *  @param end one past the last entry written.
+ *  @return true if e must be evaluated into a temporary first, and false otherwise.
+ */
+
+template <typename E, typename T>
+inline bool reads_transposed(const E &, const T *, const T *) {
+    return false;
+}
+
+template <typename L, typename R, typename Op, typename T>
+inline bool reads_transposed(const matrix_binary<L, R, Op> &e, const T *begin, const T *end);
+
+template <typename E, typename T>
+inline bool reads_transposed(const matrix_negate<E> &e, const T *begin, const T *end);
+
+template <typename E, typename T>
+inline bool reads_transposed(const matrix_scaled<E> &e, const T *begin, const T *end);
+
+template <typename T>
+inline bool reads_transposed(const matrix_transposed<T> &e, const T *begin, const T *end) {
+    const T *first = e.operand.data();
+    return first < end && begin < first + e.operand.rows() * e.operand.stride();
+}
+
+template <typename L, typename R, typename Op, typename T>
+inline bool reads_transposed(const matrix_binary<L, R, Op> &e, const T *begin, const T *end) {
+    return reads_transposed(e.left, begin, end) || reads_transposed(e.right, begin, end);
+}
+
+template <typename E, typename T>
+inline bool reads_transposed(const matrix_negate<E> &e, const T *begin, const T *end) {
+    return reads_transposed(e.operand, begin, end);
+}
+
+template <typename E, typename T>
+inline bool reads_transposed(const matrix_scaled<E> &e, const T *begin, const T *end) {
+    return reads_transposed(e.operand, begin, end);
+}
+
+}
+
+/**
+ *  Adds two matrix expressions.
+ *
+ *  @param l the left operand.
+ *  @param r the right operand.
+ *  @return a lazy expression for the entrywise sum.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_expressions<L, R>>
+inline auto operator + (L &&l, R &&r) {
+    using namespace algebra_detail;
+    return matrix_binary<operand_t<L>, operand_t<R>, add_op>(std::forward<L>(l), std::forward<R>(r));
+}
+
+/**
+ *  Subtracts two matrix expressions.
+ *
+ *  @param l the left operand.
+ *  @param r the right operand.
+ *  @return a lazy expression for the entrywise difference.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_expressions<L, R>>
+inline auto operator - (L &&l, R &&r) {
+    using namespace algebra_detail;
+    return matrix_binary<operand_t<L>, operand_t<R>, subtract_op>(std::forward<L>(l), std::forward<R>(r));
+}
+
+/**
+ *  Negates a matrix expression.
+ *
+ *  @param e the operand.
+ *  @return a lazy expression for the expression scaled by -1.
+ */
+
+template <typename E, typename = algebra_detail::enable_if_expression<E>>
+inline auto operator - (E &&e) {
+    using namespace algebra_detail;
+    return matrix_negate<operand_t<E>>(std::forward<E>(e));
+}
+
+/**
+ *  Scales a matrix expression by a constant factor.
+ *
+ *  @param e the operand.
+ *  @param t the constant to scale by.
+ *  @return a lazy expression for the expression scaled by t.
+ */
+
+template <typename E, typename = algebra_detail::enable_if_expression<E>>
+inline auto operator * (E &&e, const typename std::decay<E>::type::value_type &t) {
+    using namespace algebra_detail;
+    return matrix_scaled<operand_t<E>>(std::forward<E>(e), t);
+}
+
+/**
+ *  Checks if two matrix expressions are not equal to each other, entry by entry, without
+ *  evaluating either one.
+ *
+ *  @param l the left operand.
+ *  @param r the right operand.
+ *  @return true if the two differ in shape or in any entry, and false otherwise.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_expression_comparison<L, R>>
+inline bool operator != (const L &l, const R &r) {
+    if(l.rows() != r.rows() || l.columns() != r.columns()) return true;
+    for(size_t i = 0; i < l.rows(); ++ i)
+        for(size_t j = 0; j < l.columns(); ++ j)
+            if(l(i,j) != r(i,j))
+                return true;
+    return false;
+}
+
+/**
+ *  Checks if two matrix expressions are equal to each other, entry by entry.
+ *
+ *  @param l the left operand.
+ *  @param r the right operand.
+ *  @return true if the two are equal, and false otherwise.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_expression_comparison<L, R>>
+inline bool operator == (const L &l, const R &r) {
+    return !(l != r);
+}
+
+#endif
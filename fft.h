@@ -11,61 +11,1173 @@
 #define FFT_H
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <complex>
+#include <memory>
+#include <utility>
 #include <vector>
 
+#include "allocator.h"
+#include "instrument.h"
+#include "simd.h"
+#include "thread_pool.h"
+
 /**
- * An iterative implementation of the Fast Fourier Transform.
+ * The power-of-two length from which fft_plan switches to the six-step method, which keeps
+ * every pass over the data in cache and runs the sub-transforms in parallel.
+ */
+
+constexpr size_t fft_six_step_threshold = size_t(1) << 18;
+
+/**
+ * The longest transform that fft_plan::execute_batch runs across the batch, one signal per
+ * vector lane, rather than one signal at a time.
+ */
+
+constexpr size_t fft_batch_lane_threshold = 256;
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/**
+ * Loads the twiddles of a butterfly into v. With S = 1 a vector V holds consecutive points of one
+ * transform, so it loads consecutive twiddles; with S > 1 it holds the same point of S
+ * transforms (the batched layout, each point's S lanes contiguous), so one twiddle is
+ * broadcast.
+ */
+
+template <size_t S, typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void fft_twiddle(V &v, const T *w) {
+    if constexpr (S == 1) {
+        v = simd_load<V>(w);
+    } else {
+        v = V{} + *w;
+    }
+}
+
+/**
+ * One radix-4 butterfly, i.e. two fused radix-2 stages, on split real and imaginary arrays.
+ * Combines the four length-h blocks at re, re + h, re + 2h and re + 3h (scaled by S in the
+ * batched layout). w1 holds the twiddles of the first stage and w2 those of the second; the
+ * second stage's twiddles for the odd half are w2 times sign * i, so they are not loaded.
+ */
+
+template <typename V, typename T, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_radix4(T *re, T *im, size_t h, const T *w1r, const T *w1i,
+                                      const T *w2r, const T *w2i, T sign) {
+    const size_t d = h * S;
+    const V a0r = simd_load<V>(re), a0i = simd_load<V>(im);
+    const V a1r = simd_load<V>(re + d), a1i = simd_load<V>(im + d);
+    const V a2r = simd_load<V>(re + 2 * d), a2i = simd_load<V>(im + 2 * d);
+    const V a3r = simd_load<V>(re + 3 * d), a3i = simd_load<V>(im + 3 * d);
+    V xr, xi, yr, yi;
+    fft_twiddle<S>(xr, w1r);
+    fft_twiddle<S>(xi, w1i);
+    fft_twiddle<S>(yr, w2r);
+    fft_twiddle<S>(yi, w2i);
+
+    const V t1r = xr * a1r - xi * a1i, t1i = xr * a1i + xi * a1r;
+    const V t3r = xr * a3r - xi * a3i, t3i = xr * a3i + xi * a3r;
+    const V b0r = a0r + t1r, b0i = a0i + t1i, b1r = a0r - t1r, b1i = a0i - t1i;
+    const V b2r = a2r + t3r, b2i = a2i + t3i, b3r = a2r - t3r, b3i = a2i - t3i;
+
+    const V ur = yr * b2r - yi * b2i, ui = yr * b2i + yi * b2r;
+    const V vr = yr * b3r - yi * b3i, vi = yr * b3i + yi * b3r;
+    const V sr = vi * sign, si = vr * sign;
+
+    simd_store(re, b0r + ur);
+    simd_store(im, b0i + ui);
+    simd_store(re + 2 * d, b0r - ur);
+    simd_store(im + 2 * d, b0i - ui);
+    simd_store(re + d, b1r - sr);
+    simd_store(im + d, b1i + si);
+    simd_store(re + 3 * d, b1r + sr);
+    simd_store(im + 3 * d, b1i - si);
+}
+
+/**
+ * One radix-2 butterfly on split arrays, combining the blocks at re and re + h.
+ */
+
+template <typename V, typename T, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_radix2(T *re, T *im, size_t h, const T *wr, const T *wi) {
+    const size_t d = h * S;
+    const V ar = simd_load<V>(re), ai = simd_load<V>(im);
+    const V br = simd_load<V>(re + d), bi = simd_load<V>(im + d);
+    V xr, xi;
+    fft_twiddle<S>(xr, wr);
+    fft_twiddle<S>(xi, wi);
+
+    const V tr = xr * br - xi * bi, ti = xr * bi + xi * br;
+
+    simd_store(re, ar + tr);
+    simd_store(im, ai + ti);
+    simd_store(re + d, ar - tr);
+    simd_store(im + d, ai - ti);
+}
+
+/**
+ * Runs every butterfly stage of a bit-reversed length-n transform, two stages per pass,
+ * with L lanes of type V at a time wherever a stage's blocks are at least L long. With
+ * S > 1, runs S transforms held in the batched layout instead, one V per point.
+ */
+
+template <typename V, typename T, size_t L, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_stages(size_t n, T *re, T *im, const T *wr, const T *wi, T sign) {
+    size_t h = 1;
+
+    if constexpr (S > 1) {
+        for(; 4 * h <= n; h *= 4)
+            for(size_t j = 0; j < n; j += 4 * h)
+                for(size_t k = 0; k < h; ++ k)
+                    fft_radix4<V, T, S>(re + (j + k) * S, im + (j + k) * S, h, wr + h + k, wi + h + k,
+                                        wr + 2 * h + k, wi + 2 * h + k, sign);
+        if(h < n) {
+            for(size_t k = 0; k < h; ++ k)
+                fft_radix2<V, T, S>(re + k * S, im + k * S, h, wr + h + k, wi + h + k);
+        }
+        return;
+    }
+
+    for(; 4 * h <= n; h *= 4) {
+        for(size_t j = 0; j < n; j += 4 * h) {
+            size_t k = 0;
+            if constexpr (L > 1) {
+                for(; k + L <= h; k += L)
+                    fft_radix4<V>(re + j + k, im + j + k, h, wr + h + k, wi + h + k,
+                                  wr + 2 * h + k, wi + 2 * h + k, sign);
+            }
+            for(; k < h; ++ k)
+                fft_radix4<T>(re + j + k, im + j + k, h, wr + h + k, wi + h + k,
+                              wr + 2 * h + k, wi + 2 * h + k, sign);
+        }
+    }
+
+    if(h < n) {
+        size_t k = 0;
+        if constexpr (L > 1) {
+            for(; k + L <= h; k += L)
+                fft_radix2<V>(re + k, im + k, h, wr + h + k, wi + h + k);
+        }
+        for(; k < h; ++ k)
+            fft_radix2<T>(re + k, im + k, h, wr + h + k, wi + h + k);
+    }
+}
+
+/**
+ * One radix-P butterfly of a mixed-radix stage on split arrays: the P blocks of length h at
+ * re, re + h, ... are multiplied by their twiddles (tw[(q - 1) * h] for block q > 0) and
+ * combined with a length-P DFT. Odd P pairs blocks q and P - q, so the DFT costs about half
+ * its P^2 multiplies; c[k] and s[k] hold cos and sign * sin of 2 pi k / P.
+ */
+
+template <typename V, typename T, size_t P, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_radix(T *re, T *im, size_t h, const T *twr, const T *twi,
+                                     const T *c, const T *s, T sign) {
+    const size_t d = h * S;
+    V ar[P], ai[P];
+
+    ar[0] = simd_load<V>(re);
+    ai[0] = simd_load<V>(im);
+    for(size_t q = 1; q < P; ++ q) {
+        const V xr = simd_load<V>(re + q * d), xi = simd_load<V>(im + q * d);
+        V wr, wi;
+        fft_twiddle<S>(wr, twr + (q - 1) * h);
+        fft_twiddle<S>(wi, twi + (q - 1) * h);
+        ar[q] = wr * xr - wi * xi;
+        ai[q] = wr * xi + wi * xr;
+    }
+
+    if constexpr (P == 2) {
+        simd_store(re, ar[0] + ar[1]);
+        simd_store(im, ai[0] + ai[1]);
+        simd_store(re + d, ar[0] - ar[1]);
+        simd_store(im + d, ai[0] - ai[1]);
+    } else if constexpr (P == 4) {
+        const V t0r = ar[0] + ar[2], t0i = ai[0] + ai[2], t1r = ar[0] - ar[2], t1i = ai[0] - ai[2];
+        const V t2r = ar[1] + ar[3], t2i = ai[1] + ai[3];
+        const V t3r = (ai[3] - ai[1]) * sign, t3i = (ar[1] - ar[3]) * sign;
+        simd_store(re, t0r + t2r);
+        simd_store(im, t0i + t2i);
+        simd_store(re + 2 * d, t0r - t2r);
+        simd_store(im + 2 * d, t0i - t2i);
+        simd_store(re + d, t1r + t3r);
+        simd_store(im + d, t1i + t3i);
+        simd_store(re + 3 * d, t1r - t3r);
+        simd_store(im + 3 * d, t1i - t3i);
+    } else {
+        constexpr size_t H = P / 2;
+        V sr[H], si[H], dr[H], di[H];
+        V yr = ar[0], yi = ai[0];
+        for(size_t q = 0; q < H; ++ q) {
+            sr[q] = ar[q + 1] + ar[P - 1 - q];
+            si[q] = ai[q + 1] + ai[P - 1 - q];
+            dr[q] = ar[q + 1] - ar[P - 1 - q];
+            di[q] = ai[q + 1] - ai[P - 1 - q];
+            yr += sr[q];
+            yi += si[q];
+        }
+        simd_store(re, yr);
+        simd_store(im, yi);
+
+        for(size_t r = 1; r <= H; ++ r) {
+            V pr = ar[0], pi = ai[0], qr = dr[0] * T(0), qi = qr;
+            for(size_t q = 0; q < H; ++ q) {
+                const size_t k = (q + 1) * r % P;
+                pr += sr[q] * c[k];
+                pi += si[q] * c[k];
+                qr += dr[q] * s[k];
+                qi += di[q] * s[k];
+            }
+            simd_store(re + r * d, pr - qi);
+            simd_store(im + r * d, pi + qr);
+            simd_store(re + (P - r) * d, pr + qi);
+            simd_store(im + (P - r) * d, pi - qr);
+        }
+    }
+}
+
+template <typename V, typename T, size_t L, size_t P, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_radix_pass(size_t n, T *re, T *im, size_t h, const T *twr, const T *twi,
+                                          const T *c, const T *s, T sign) {
+    for(size_t j = 0; j < n; j += P * h) {
+        if constexpr (S > 1) {
+            for(size_t k = 0; k < h; ++ k)
+                fft_radix<V, T, P, S>(re + (j + k) * S, im + (j + k) * S, h, twr + k, twi + k, c, s, sign);
+            continue;
+        }
+        size_t k = 0;
+        if constexpr (L > 1) {
+            for(; k + L <= h; k += L)
+                fft_radix<V, T, P>(re + j + k, im + j + k, h, twr + k, twi + k, c, s, sign);
+        }
+        for(; k < h; ++ k)
+            fft_radix<T, T, P>(re + j + k, im + j + k, h, twr + k, twi + k, c, s, sign);
+    }
+}
+
+/**
+ * Runs the stages of a digit-reversed mixed-radix transform. Stage i has radix radices[i]
+ * and reads its twiddles from offsets[i], and its DFT constants from c and s + 8 * i. S is
+ * as for fft_stages.
+ */
+
+template <typename V, typename T, size_t L, size_t S = 1>
+ALGEBRA_ALWAYS_INLINE void fft_mixed_stages(size_t n, T *re, T *im, size_t stages, const size_t *radices,
+                                            const size_t *offsets, const T *twr, const T *twi,
+                                            const T *c, const T *s, T sign) {
+    size_t h = 1;
+
+    for(size_t i = 0; i < stages; ++ i) {
+        const T *wr = twr + offsets[i], *wi = twi + offsets[i], *ci = c + 8 * i, *si = s + 8 * i;
+        switch(radices[i]) {
+            case 2:
+                fft_radix_pass<V, T, L, 2, S>(n, re, im, h, wr, wi, ci, si, sign);
+                break;
+            case 3:
+                fft_radix_pass<V, T, L, 3, S>(n, re, im, h, wr, wi, ci, si, sign);
+                break;
+            case 4:
+                fft_radix_pass<V, T, L, 4, S>(n, re, im, h, wr, wi, ci, si, sign);
+                break;
+            case 5:
+                fft_radix_pass<V, T, L, 5, S>(n, re, im, h, wr, wi, ci, si, sign);
+                break;
+            default:
+                fft_radix_pass<V, T, L, 7, S>(n, re, im, h, wr, wi, ci, si, sign);
+                break;
+        }
+        h *= radices[i];
+    }
+}
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+
+struct fft_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, T *re, T *im, const T *wr, const T *wi, T sign) {
+        typedef T vec __attribute__((vector_size(W)));
+        fft_stages<vec, T, W / sizeof(T)>(n, re, im, wr, wi, sign);
+    }
+};
+
+struct fft_mixed_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, T *re, T *im, size_t stages, const size_t *radices,
+                                          const size_t *offsets, const T *twr, const T *twi,
+                                          const T *c, const T *s, T sign) {
+        typedef T vec __attribute__((vector_size(W)));
+        fft_mixed_stages<vec, T, W / sizeof(T)>(n, re, im, stages, radices, offsets, twr, twi, c, s, sign);
+    }
+};
+
+/**
+ * The tables of a plan that the batched kernel reads.
+ */
+
+template <typename T>
+struct fft_batch_tables {
+    size_t n;
+    const size_t *reversal;
+    const T *twr, *twi;
+    size_t stages;
+    const size_t *radices, *offsets;
+    const T *c, *s;
+    T sign, scale;
+};
+
+/**
+ * Transforms groups of as many signals as a vector has lanes, gathered into the batched
+ * layout, and returns how many signals it transformed (count rounded down to a whole group).
+ */
+
+struct fft_batch_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE size_t run(const fft_batch_tables<T> *t, std::complex<T> *P, size_t count,
+                                            size_t stride, size_t distance) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        const size_t n = t->n;
+
+        const nesting_guard nesting;
+        T *re = scratch_buffer<T, 7>(2 * n * L, nesting.level), *im = re + n * L;
+
+        size_t k = 0;
+        for(; k + L <= count; k += L) {
+            for(size_t l = 0; l < L; ++ l) {
+                const std::complex<T> *x = P + (k + l) * distance;
+                for(size_t j = 0; j < n; ++ j) {
+                    re[t->reversal[j] * L + l] = x[j * stride].real();
+                    im[t->reversal[j] * L + l] = x[j * stride].imag();
+                }
+            }
+
+            if(t->stages == 0) {
+                fft_stages<vec, T, 1, L>(n, re, im, t->twr, t->twi, t->sign);
+            } else {
+                fft_mixed_stages<vec, T, 1, L>(n, re, im, t->stages, t->radices, t->offsets, t->twr,
+                                               t->twi, t->c, t->s, t->sign);
+            }
+
+            for(size_t l = 0; l < L; ++ l) {
+                std::complex<T> *x = P + (k + l) * distance;
+                for(size_t j = 0; j < n; ++ j)
+                    x[j * stride] = std::complex<T>(re[j * L + l] * t->scale, im[j * L + l] * t->scale);
+            }
+        }
+        return k;
+    }
+};
+
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ * The customary operation count of a length n complex transform, 5 n log2(n), which the
+ * instrumentation reports whatever algorithm the plan uses.
+ */
+
+inline double fft_flop_count(size_t n) {
+    return n > 1 ? 5.0 * double(n) * std::log2(double(n)) : 0.0;
+}
+
+}
+
+/**
+ * fft_plan class, the precomputed permutation and twiddle factors for transforms of one
+ * length in one direction.
  *
- * @param P an std::vector of std::complex<long double> representing the values to compute the FFT of. Note that this vector will be overwritten with the values returned by the FFT.
- * @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse Fast Fourier Transform.
+ * Powers of two run radix-4 butterflies (two radix-2 stages per pass). Other lengths whose
+ * prime factors are 2, 3, 5 and 7 run one mixed-radix stage per factor, and all remaining
+ * lengths use Bluestein's algorithm: a chirp-weighted circular convolution computed with
+ * power-of-two transforms. Every length is transformed as is, without padding. The
+ * butterflies work on split real and imaginary arrays and run on the widest vector
+ * instruction set available for float and double.
+ *
+ * Powers of two from fft_six_step_threshold on, whose data no longer fits in cache, run the
+ * six-step method instead: two passes of shorter row transforms separated by blocked
+ * transposes, with the rows spread over the thread pool.
+ *
+ * A plan is immutable once built, so one plan may be executed from many threads at once.
+ *
+ * @param T the real data type of the transform: float, double or long double.
  */
 
-void FFT(std::vector<std::complex<long double>> &P, int inv = 1) {
-    static std::vector<std::complex<long double>> roots;
+template <typename T = long double>
+class fft_plan {
+
+    private:
+
+    size_t length;
+    int direction;
+
+    /**
+     * The digit-reversed position of every index, for the radix-4 and mixed-radix methods.
+     */
+
+    std::vector<size_t> reversal;
+
+    /**
+     * Twiddles, split into real and imaginary parts. For powers of two, the stage combining
+     * blocks of size 2h reads w^k, k < h, from index h + k, where w = exp(direction * 2 pi i
+     * / 2h). For mixed radices, each stage's table starts at offsets[stage].
+     */
+
+    std::vector<T, aligned_allocator<T>> roots_re, roots_im;
+
+    /**
+     * The mixed-radix stages, in order, and the cos and sign * sin of 2 pi k / radix for each.
+     */
 
-    size_t length = 1;
+    std::vector<size_t> radices, offsets;
+    std::vector<T> radix_cos, radix_sin;
 
-    while(length < P.size()) length <<= 1;
+    /**
+     * Bluestein's method: the chirp exp(direction * pi i k^2 / n), the transform of the
+     * convolution kernel, and the power-of-two plans that compute the convolution.
+     */
 
-    P.resize(length);
+    std::vector<T, aligned_allocator<T>> chirp_re, chirp_im, kernel_re, kernel_im;
+    std::shared_ptr<const fft_plan<T>> chirp_forward, chirp_inverse;
 
-    for(size_t i = 1, j = 0; i < P.size(); ++ i) {
-        int b = P.size() >> 1;
-        while(j >= b) {
-            j -= b;
-            b >>= 1;
+    /**
+     * The six-step method for large powers of two, n = n1 * n2: the plans of the n2
+     * transforms of length n1 and the n1 of length n2, and the twiddles exp(direction * 2 pi
+     * i m / n) as fine[m % n1] * coarse[m / n1].
+     */
+
+    std::shared_ptr<const fft_plan<T>> column_plan, row_plan;
+    std::vector<T, aligned_allocator<T>> fine_re, fine_im, coarse_re, coarse_im;
+
+    inline bool power_of_two() const {
+        return (length & (length - 1)) == 0;
+    }
+
+    inline void butterflies(T *re, T *im) const {
+        if(power_of_two()) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+            if constexpr (simd_supported<T>::value) {
+                return algebra_detail::simd_dispatch<algebra_detail::fft_kernel>(
+                    length, re, im, roots_re.data(), roots_im.data(), T(direction));
+            }
+#endif
+            return algebra_detail::fft_stages<T, T, 1>(length, re, im, roots_re.data(), roots_im.data(), T(direction));
+        }
+#if ALGEBRA_VECTOR_EXTENSIONS
+        if constexpr (simd_supported<T>::value) {
+            return algebra_detail::simd_dispatch<algebra_detail::fft_mixed_kernel>(
+                length, re, im, radices.size(), radices.data(), offsets.data(), roots_re.data(),
+                roots_im.data(), radix_cos.data(), radix_sin.data(), T(direction));
         }
-        if(i < j) std::swap(P[i], P[j]);
+#endif
+        algebra_detail::fft_mixed_stages<T, T, 1>(
+            length, re, im, radices.size(), radices.data(), offsets.data(), roots_re.data(),
+            roots_im.data(), radix_cos.data(), radix_sin.data(), T(direction));
     }
 
-    long double theta = inv * 2 * M_PI / P.size();
+    inline void plan_power_of_two() {
+        const long double pi = std::acos(-1.0L);
+        roots_re.resize(std::max<size_t>(1, length));
+        roots_im.resize(std::max<size_t>(1, length));
 
-    if(roots.size() != P.size() / 2) {
-        roots.clear();
-        roots.resize(P.size());
-        for(size_t i=0; i < P.size() / 2; ++ i)
-            roots[i] = std::complex<long double> (cos(theta * i), sin(theta * i));
+        for(size_t h = 1; h < length; h <<= 1) {
+            const long double theta = direction * pi / h;
+            for(size_t k = 0; k < h; ++ k) {
+                roots_re[h + k] = T(std::cos(theta * k));
+                roots_im[h + k] = T(std::sin(theta * k));
+            }
+        }
     }
 
-    for(size_t i = 2; i <= P.size(); i <<= 1) {
-        int layer = P.size() / i;
-        for(size_t j = 0; j < P.size(); j += i) {
-            for(size_t k = 0; k < i / 2; ++ k) {
-                auto u = P[j + k];
-                auto v = P[j + k + i / 2] * roots[layer * k];
-                P[j + k] = u + v;
-                P[j + k + i / 2] = u - v;
+    inline void plan_mixed_radix() {
+        const long double pi = std::acos(-1.0L);
+        size_t h = 1;
+
+        for(size_t p : radices) {
+            offsets.push_back(roots_re.size());
+            const long double theta = direction * 2 * pi / (p * h);
+            for(size_t q = 1; q < p; ++ q) {
+                for(size_t k = 0; k < h; ++ k) {
+                    roots_re.push_back(T(std::cos(theta * (q * k))));
+                    roots_im.push_back(T(std::sin(theta * (q * k))));
+                }
+            }
+            for(size_t k = 0; k < 8; ++ k) {
+                radix_cos.push_back(T(std::cos(2 * pi * k / p)));
+                radix_sin.push_back(T(direction * std::sin(2 * pi * k / p)));
             }
+            h *= p;
         }
     }
 
-    if(inv == -1) {
-        for(auto & a: P) {
-            a /= P.size();
+    inline void plan_six_step() {
+        const long double pi = std::acos(-1.0L);
+        size_t n1 = 1;
+        while(n1 * n1 < length) n1 <<= 1;
+        const size_t n2 = length / n1;
+
+        column_plan = std::make_shared<const fft_plan<T>>(n1, direction);
+        row_plan = std::make_shared<const fft_plan<T>>(n2, direction);
+
+        fine_re.resize(n1);
+        fine_im.resize(n1);
+        for(size_t b = 0; b < n1; ++ b) {
+            const long double theta = direction * 2 * pi * b / length;
+            fine_re[b] = T(std::cos(theta));
+            fine_im[b] = T(std::sin(theta));
+        }
+        coarse_re.resize(n2);
+        coarse_im.resize(n2);
+        for(size_t a = 0; a < n2; ++ a) {
+            const long double theta = direction * 2 * pi * (a * n1) / length;
+            coarse_re[a] = T(std::cos(theta));
+            coarse_im[a] = T(std::sin(theta));
         }
     }
+
+    /**
+     * Writes the rows x cols matrix of complex values P, transposed, to split arrays.
+     */
+
+    static inline void transpose_split(const std::complex<T> *P, size_t rows, size_t cols, T *re, T *im) {
+        constexpr size_t tile = 32;
+        parallel_for(0, (cols + tile - 1) / tile, 1, [&](size_t t0, size_t t1) {
+            for(size_t c0 = t0 * tile; c0 < std::min(cols, t1 * tile); c0 += tile)
+                for(size_t r0 = 0; r0 < rows; r0 += tile)
+                    for(size_t c = c0; c < std::min(cols, c0 + tile); ++ c)
+                        for(size_t r = r0; r < std::min(rows, r0 + tile); ++ r) {
+                            re[c * rows + r] = P[r * cols + c].real();
+                            im[c * rows + r] = P[r * cols + c].imag();
+                        }
+        });
+    }
+
+    /**
+     * Writes the rows x cols matrix held in split arrays, transposed, to complex values P.
+     */
+
+    static inline void transpose_interleave(const T *re, const T *im, size_t rows, size_t cols, std::complex<T> *P) {
+        constexpr size_t tile = 32;
+        parallel_for(0, (cols + tile - 1) / tile, 1, [&](size_t t0, size_t t1) {
+            for(size_t c0 = t0 * tile; c0 < std::min(cols, t1 * tile); c0 += tile)
+                for(size_t r0 = 0; r0 < rows; r0 += tile)
+                    for(size_t c = c0; c < std::min(cols, c0 + tile); ++ c)
+                        for(size_t r = r0; r < std::min(rows, r0 + tile); ++ r)
+                            P[c * rows + r] = std::complex<T>(re[r * cols + c], im[r * cols + c]);
+        });
+    }
+
+    /**
+     * The six-step transform: with x viewed as an n1 x n2 matrix, transpose, transform the n2
+     * rows of length n1, apply the twiddles, transpose back, transform the n1 rows of length
+     * n2, and transpose again. Each row fits in cache, and rows run in parallel.
+     */
+
+    inline void six_step(std::complex<T> *P) const {
+        const size_t n1 = column_plan->size(), n2 = row_plan->size();
+        const algebra_detail::nesting_guard nesting;
+        T *re = algebra_detail::scratch_buffer<T, 13>(2 * length, nesting.level), *im = re + length;
+
+        transpose_split(P, n1, n2, re, im);
+
+        parallel_for(0, n2, 1, [&](size_t j0, size_t j1) {
+            for(size_t j2 = j0; j2 < j1; ++ j2) {
+                T *r = re + j2 * n1, *i = im + j2 * n1;
+                column_plan->transform_split(r, i);
+
+                // Row j2 is scaled by w^(j2 k1), with j2 k1 = a n1 + b tracked incrementally.
+
+                size_t a = 0, b = 0;
+                for(size_t k1 = 0; k1 < n1; ++ k1) {
+                    const T wr = coarse_re[a] * fine_re[b] - coarse_im[a] * fine_im[b];
+                    const T wi = coarse_re[a] * fine_im[b] + coarse_im[a] * fine_re[b];
+                    const T xr = r[k1];
+                    r[k1] = xr * wr - i[k1] * wi;
+                    i[k1] = xr * wi + i[k1] * wr;
+                    b += j2;
+                    if(b >= n1) {
+                        b -= n1;
+                        ++ a;
+                    }
+                }
+            }
+        });
+
+        transpose_interleave(re, im, n2, n1, P);
+
+        parallel_for(0, n1, 1, [&](size_t k0, size_t k1) {
+            for(size_t k = k0; k < k1; ++ k)
+                row_plan->transform(P + k * n2);
+        });
+
+        transpose_split(P, n1, n2, re, im);
+
+        parallel_for(0, length, 1 << 16, [&](size_t i0, size_t i1) {
+            for(size_t i = i0; i < i1; ++ i)
+                P[i] = std::complex<T>(re[i], im[i]);
+        });
+    }
+
+    inline void plan_bluestein() {
+        const long double pi = std::acos(-1.0L);
+        size_t m = 1;
+        while(m < 2 * length - 1) m <<= 1;
+
+        chirp_forward = std::make_shared<const fft_plan<T>>(m, 1);
+        chirp_inverse = std::make_shared<const fft_plan<T>>(m, -1);
+        chirp_re.resize(length);
+        chirp_im.resize(length);
+        kernel_re.assign(m, T(0));
+        kernel_im.assign(m, T(0));
+
+        // k^2 is reduced mod 2n, where the chirp repeats, so the angle stays accurate.
+
+        for(size_t k = 0; k < length; ++ k) {
+            const long double theta = direction * pi * ((k * k) % (2 * length)) / length;
+            chirp_re[k] = T(std::cos(theta));
+            chirp_im[k] = T(std::sin(theta));
+            kernel_re[k] = chirp_re[k];
+            kernel_im[k] = -chirp_im[k];
+            if(k > 0) {
+                kernel_re[m - k] = chirp_re[k];
+                kernel_im[m - k] = -chirp_im[k];
+            }
+        }
+
+        chirp_forward->transform_split(kernel_re.data(), kernel_im.data());
+    }
+
+    /**
+     * Computes X[k] = c_k * sum of (x_j c_j) conj(c_{k - j}), with c the chirp, where the sum
+     * is a circular convolution of power-of-two length.
+     */
+
+    template <typename Load, typename Store>
+    inline void bluestein(Load load, Store store) const {
+        const size_t m = chirp_forward->size();
+        const algebra_detail::nesting_guard nesting;
+        T *re = algebra_detail::scratch_buffer<T, 6>(2 * m, nesting.level), *im = re + m;
+
+        for(size_t j = 0; j < length; ++ j) {
+            T xr, xi;
+            load(j, xr, xi);
+            re[j] = xr * chirp_re[j] - xi * chirp_im[j];
+            im[j] = xr * chirp_im[j] + xi * chirp_re[j];
+        }
+        std::fill(re + length, re + m, T(0));
+        std::fill(im + length, im + m, T(0));
+
+        chirp_forward->transform_split(re, im);
+        for(size_t k = 0; k < m; ++ k) {
+            const T yr = re[k] * kernel_re[k] - im[k] * kernel_im[k];
+            im[k] = re[k] * kernel_im[k] + im[k] * kernel_re[k];
+            re[k] = yr;
+        }
+        chirp_inverse->transform_split(re, im);
+
+        const T scale = direction == -1 ? T(1) / T(length) : T(1);
+        for(size_t k = 0; k < length; ++ k)
+            store(k, (re[k] * chirp_re[k] - im[k] * chirp_im[k]) * scale,
+                     (re[k] * chirp_im[k] + im[k] * chirp_re[k]) * scale);
+    }
+
+    /**
+     * The transforms behind execute_split, execute and execute_batch. The plans call these for
+     * their own inner transforms, so each call of the public functions is counted once by the
+     * instrumentation, whichever thread the inner transforms run on.
+     */
+
+    inline void transform_split(T *re, T *im) const {
+        if(column_plan) {
+            const algebra_detail::nesting_guard nesting;
+            std::complex<T> *P = algebra_detail::scratch_buffer<std::complex<T>, 11>(length, nesting.level);
+            for(size_t i = 0; i < length; ++ i)
+                P[i] = std::complex<T>(re[i], im[i]);
+            six_step(P);
+            for(size_t i = 0; i < length; ++ i) {
+                re[i] = P[i].real();
+                im[i] = P[i].imag();
+            }
+            return;
+        }
+
+        if(chirp_forward) {
+            return bluestein([&](size_t j, T &xr, T &xi) { xr = re[j]; xi = im[j]; },
+                             [&](size_t k, T yr, T yi) { re[k] = yr; im[k] = yi; });
+        }
+
+        if(power_of_two()) {
+            for(size_t i = 1; i < length; ++ i) {
+                if(i < reversal[i]) {
+                    std::swap(re[i], re[reversal[i]]);
+                    std::swap(im[i], im[reversal[i]]);
+                }
+            }
+            butterflies(re, im);
+        } else {
+            // A mixed-radix digit reversal is not its own inverse, so it is applied out of place.
+
+            const algebra_detail::nesting_guard nesting;
+            T *sr = algebra_detail::scratch_buffer<T, 4>(2 * length, nesting.level), *si = sr + length;
+            for(size_t i = 0; i < length; ++ i) {
+                sr[reversal[i]] = re[i];
+                si[reversal[i]] = im[i];
+            }
+            butterflies(sr, si);
+            std::copy(sr, sr + length, re);
+            std::copy(si, si + length, im);
+        }
+
+        if(direction == -1) {
+            const T scale = T(1) / T(length);
+            simd_scale(length, re, scale, re);
+            simd_scale(length, im, scale, im);
+        }
+    }
+
+    inline void transform(std::complex<T> *P) const {
+        if(column_plan) {
+            return six_step(P);
+        }
+
+        if(chirp_forward) {
+            return bluestein([&](size_t j, T &xr, T &xi) { xr = P[j].real(); xi = P[j].imag(); },
+                             [&](size_t k, T yr, T yi) { P[k] = std::complex<T>(yr, yi); });
+        }
+
+        const algebra_detail::nesting_guard nesting;
+        T *re = algebra_detail::scratch_buffer<T, 4>(2 * length, nesting.level), *im = re + length;
+
+        for(size_t i = 0; i < length; ++ i) {
+            re[reversal[i]] = P[i].real();
+            im[reversal[i]] = P[i].imag();
+        }
+
+        butterflies(re, im);
+
+        const T scale = direction == -1 ? T(1) / T(length) : T(1);
+        for(size_t i = 0; i < length; ++ i)
+            P[i] = std::complex<T>(re[i] * scale, im[i] * scale);
+    }
+
+    inline void transform_batch(std::complex<T> *P, size_t count, size_t stride, size_t distance) const {
+        const bool lanes = !chirp_forward && !column_plan && length <= fft_batch_lane_threshold;
+        const size_t grain = std::max<size_t>(16, (size_t(1) << 14) / std::max<size_t>(1, length));
+
+        parallel_for(0, count, grain, [&](size_t k0, size_t k1) {
+            size_t k = k0;
+#if ALGEBRA_VECTOR_EXTENSIONS
+            if constexpr (simd_supported<T>::value) {
+                if(lanes) {
+                    const algebra_detail::fft_batch_tables<T> tables{
+                        length, reversal.data(), roots_re.data(), roots_im.data(), radices.size(),
+                        radices.data(), offsets.data(), radix_cos.data(), radix_sin.data(), T(direction),
+                        direction == -1 ? T(1) / T(length) : T(1)};
+                    k += algebra_detail::simd_dispatch<algebra_detail::fft_batch_kernel>(
+                        &tables, P + k0 * distance, k1 - k0, stride, distance);
+                }
+            }
+#endif
+            (void) lanes;
+            for(; k < k1; ++ k) {
+                std::complex<T> *x = P + k * distance;
+                if(stride == 1) {
+                    transform(x);
+                    continue;
+                }
+
+                const algebra_detail::nesting_guard nesting;
+                std::complex<T> *y = algebra_detail::scratch_buffer<std::complex<T>, 7>(length, nesting.level);
+                for(size_t j = 0; j < length; ++ j)
+                    y[j] = x[j * stride];
+                transform(y);
+                for(size_t j = 0; j < length; ++ j)
+                    x[j * stride] = y[j];
+            }
+        });
+    }
+
+    public:
+
+    /**
+     * Constructor for an fft_plan.
+     *
+     * @param n the transform length.
+     * @param inv pass 1 to plan the Fast Fourier Transform, and -1 to plan the inverse.
+     */
+
+    inline explicit fft_plan(size_t n, int inv = 1) : length(n), direction(inv) {
+        assert(inv == 1 || inv == -1);
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft_plan);
+
+        if(power_of_two() && n >= fft_six_step_threshold) {
+            plan_six_step();
+            return;
+        } else if(power_of_two()) {
+            for(size_t m = n; m > 1; m >>= 1)
+                radices.push_back(2);
+        } else {
+            size_t m = n;
+            for(size_t p : {4, 2, 3, 5, 7}) {
+                while(m % p == 0) {
+                    radices.push_back(p);
+                    m /= p;
+                }
+            }
+            if(m != 1) {
+                radices.clear();
+                plan_bluestein();
+                return;
+            }
+        }
+
+        // The input is stored digit-reversed: the last stage's radix is the least significant
+        // digit of an index and the most significant digit of its position.
+
+        reversal.resize(n);
+        for(size_t i = 0; i < n; ++ i) {
+            size_t rem = i, scale = n, pos = 0;
+            for(size_t s = radices.size(); s -- > 0;) {
+                scale /= radices[s];
+                pos += rem % radices[s] * scale;
+                rem /= radices[s];
+            }
+            reversal[i] = pos;
+        }
+
+        if(power_of_two()) {
+            radices.clear();
+            plan_power_of_two();
+        } else {
+            plan_mixed_radix();
+        }
+    }
+
+    /**
+     * Retrieves the transform length.
+     *
+     * @return the number of points the plan transforms.
+     */
+
+    inline size_t size() const {
+        return length;
+    }
+
+    /**
+     * Retrieves the direction of the transform.
+     *
+     * @return 1 for the forward transform, -1 for the inverse.
+     */
+
+    inline int sign() const {
+        return direction;
+    }
+
+    /**
+     * Transforms size() values held as separate real and imaginary arrays, in place. The
+     * inverse transform is scaled by 1 / size().
+     *
+     * @param re the real parts; overwritten with those of the result.
+     * @param im the imaginary parts; overwritten with those of the result.
+     */
+
+    inline void execute_split(T *re, T *im) const {
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                     algebra_detail::fft_flop_count(length));
+        transform_split(re, im);
+    }
+
+    /**
+     * Transforms size() interleaved complex values in place. The inverse transform is scaled
+     * by 1 / size().
+     *
+     * @param P the values to compute the FFT of; overwritten with the result.
+     */
+
+    inline void execute(std::complex<T> *P) const {
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                     algebra_detail::fft_flop_count(length));
+        transform(P);
+    }
+
+    /**
+     * Transforms a vector in place.
+     *
+     * @param P the values to compute the FFT of; must hold size() values. Any allocator, such
+     * as an arena_allocator, may hold them.
+     */
+
+    template <typename A>
+    inline void execute(std::vector<std::complex<T>, A> &P) const {
+        assert(P.size() == length);
+        execute(P.data());
+    }
+
+    /**
+     * Transforms count signals of size() values each, in place. Value j of signal k is
+     * P[k * distance + j * stride], so signals may be stored back to back (stride 1, distance
+     * size()) or interleaved (stride count, distance 1). Up to fft_batch_lane_threshold
+     * points, float and double signals are transformed side by side, one per vector lane;
+     * either way the signals are spread over the thread pool.
+     *
+     * @param P the first value of the first signal.
+     * @param count the number of signals.
+     * @param stride the distance between consecutive values of a signal.
+     * @param distance the distance between the first values of consecutive signals.
+     */
+
+    inline void execute_batch(std::complex<T> *P, size_t count, size_t stride, size_t distance) const {
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                     double(count) * algebra_detail::fft_flop_count(length));
+        transform_batch(P, count, stride, distance);
+    }
+};
+
+/**
+ * Retrieves the shared plan for a length and direction, building it on first use. Safe to
+ * call from several threads; cached plans are found under a read lock, and at most
+ * plan_cache_capacity are kept besides those still held by callers.
+ *
+ * @param T the real data type of the transform.
+ * @param n the transform length.
+ * @param inv pass 1 for the Fast Fourier Transform, and -1 for the inverse.
+ * @return the plan.
+ */
+
+template <typename T = long double>
+inline std::shared_ptr<const fft_plan<T>> cached_fft_plan(size_t n, int inv = 1) {
+    static algebra_detail::plan_cache<fft_plan<T>, std::pair<size_t, int>> plans;
+    return plans.get(std::make_pair(n, inv), n, inv);
+}
+
+/**
+ * rfft_plan class, the transform of n real values to the n / 2 + 1 coefficients that
+ * determine their (Hermitian) spectrum, and back. For even n the values are packed as n / 2
+ * complex values and transformed with a half-length fft_plan, then untangled, so each
+ * direction costs about half a complex transform of length n. Odd n uses a full-length
+ * complex transform.
+ *
+ * The forward direction uses the same sign as FFT(P, 1), and inverse(forward(x)) returns x.
+ *
+ * @param T the real data type of the transform: float, double or long double.
+ */
+
+template <typename T = long double>
+class rfft_plan {
+
+    private:
+
+    size_t length;
+    std::shared_ptr<const fft_plan<T>> inner_forward, inner_inverse;
+
+    /**
+     * exp(2 pi i k / n) for k <= n / 2, split into real and imaginary parts.
+     */
+
+    std::vector<T> twiddle_re, twiddle_im;
+
+    public:
+
+    /**
+     * Constructor for an rfft_plan.
+     *
+     * @param n the number of real values; must be at least 1.
+     */
+
+    inline explicit rfft_plan(size_t n)
+        : length(n), inner_forward(cached_fft_plan<T>(n % 2 ? n : n / 2, 1)),
+          inner_inverse(cached_fft_plan<T>(n % 2 ? n : n / 2, -1)), twiddle_re(n / 2 + 1), twiddle_im(n / 2 + 1) {
+        assert(n >= 1);
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft_plan);
+
+        const long double theta = 2 * std::acos(-1.0L) / n;
+        for(size_t k = 0; k <= n / 2; ++ k) {
+            twiddle_re[k] = T(std::cos(theta * k));
+            twiddle_im[k] = T(std::sin(theta * k));
+        }
+    }
+
+    /**
+     * Retrieves the transform length.
+     *
+     * @return the number of real values the plan transforms.
+     */
+
+    inline size_t size() const {
+        return length;
+    }
+
+    /**
+     * Computes the spectrum of size() real values.
+     *
+     * @param x the size() real values.
+     * @param X receives the size() / 2 + 1 coefficients X[0] ... X[size() / 2]; the rest
+     * follow from X[n - k] = conj(X[k]).
+     */
+
+    inline void forward(const T *x, std::complex<T> *X) const {
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                     algebra_detail::fft_flop_count(length) / 2);
+        const size_t h = inner_forward->size();
+        const algebra_detail::nesting_guard nesting;
+        T *re = algebra_detail::scratch_buffer<T, 5>(2 * h, nesting.level), *im = re + h;
+
+        if(length % 2) {
+            std::copy(x, x + h, re);
+            std::fill(im, im + h, T(0));
+            inner_forward->execute_split(re, im);
+            for(size_t k = 0; k <= length / 2; ++ k)
+                X[k] = std::complex<T>(re[k], im[k]);
+            return;
+        }
+
+        for(size_t k = 0; k < h; ++ k) {
+            re[k] = x[2 * k];
+            im[k] = x[2 * k + 1];
+        }
+
+        inner_forward->execute_split(re, im);
+
+        // With Z the half-length transform, the even and odd samples transform to
+        // E[k] = (Z[k] + conj(Z[h - k])) / 2 and O[k] = (Z[k] - conj(Z[h - k])) / 2i.
+
+        const T half = T(1) / T(2);
+        for(size_t k = 0; k <= h; ++ k) {
+            const size_t a = k == h ? 0 : k, b = k == 0 ? 0 : h - k;
+            const T er = (re[a] + re[b]) * half, ei = (im[a] - im[b]) * half;
+            const T orr = (im[a] + im[b]) * half, oi = (re[b] - re[a]) * half;
+            X[k] = std::complex<T>(er + twiddle_re[k] * orr - twiddle_im[k] * oi,
+                                   ei + twiddle_re[k] * oi + twiddle_im[k] * orr);
+        }
+    }
+
+    /**
+     * Recovers size() real values from the first size() / 2 + 1 coefficients of their
+     * spectrum, scaled by 1 / size() like FFT(P, -1).
+     *
+     * @param X the coefficients X[0] ... X[size() / 2].
+     * @param x receives the size() real values.
+     */
+
+    inline void inverse(const std::complex<T> *X, T *x) const {
+        const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                     algebra_detail::fft_flop_count(length) / 2);
+        const size_t h = inner_inverse->size();
+        const algebra_detail::nesting_guard nesting;
+        T *re = algebra_detail::scratch_buffer<T, 5>(2 * h, nesting.level), *im = re + h;
+
+        if(length % 2) {
+            for(size_t k = 0; k < h; ++ k) {
+                const std::complex<T> c = 2 * k <= length ? X[k] : std::conj(X[length - k]);
+                re[k] = c.real();
+                im[k] = c.imag();
+            }
+            inner_inverse->execute_split(re, im);
+            std::copy(re, re + h, x);
+            return;
+        }
+
+        const T half = T(1) / T(2);
+        for(size_t k = 0; k < h; ++ k) {
+            const std::complex<T> a = X[k], b = std::conj(X[h - k]);
+            const T er = (a.real() + b.real()) * half, ei = (a.imag() + b.imag()) * half;
+            const T dr = (a.real() - b.real()) * half, di = (a.imag() - b.imag()) * half;
+            const T orr = dr * twiddle_re[k] + di * twiddle_im[k];
+            const T oi = di * twiddle_re[k] - dr * twiddle_im[k];
+            re[k] = er - oi;
+            im[k] = ei + orr;
+        }
+
+        inner_inverse->execute_split(re, im);
+
+        for(size_t k = 0; k < h; ++ k) {
+            x[2 * k] = re[k];
+            x[2 * k + 1] = im[k];
+        }
+    }
+};
+
+/**
+ * Retrieves the shared real-input plan for a length, building it on first use. Safe to call
+ * from several threads, and cached as cached_fft_plan does.
+ *
+ * @param T the real data type of the transform.
+ * @param n the number of real values; must be at least 1.
+ * @return the plan.
+ */
+
+template <typename T = long double>
+inline std::shared_ptr<const rfft_plan<T>> cached_rfft_plan(size_t n) {
+    static algebra_detail::plan_cache<rfft_plan<T>, size_t> plans;
+    return plans.get(n, n);
+}
+
+/**
+ * An iterative implementation of the Fast Fourier Transform.
+ *
+ * @param P an std::vector of std::complex<T> representing the values to compute the FFT of. Note that this vector will be overwritten with the values returned by the FFT. Any length is transformed as is.
+ * @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse Fast Fourier Transform.
+ */
+
+template <typename T, typename A>
+inline void FFT(std::vector<std::complex<T>, A> &P, int inv = 1) {
+    cached_fft_plan<T>(P.size(), inv)->execute(P);
+}
+
+/**
+ * Transforms many signals of the same length through one shared plan.
+ *
+ * @param P the signals, stored back to back; overwritten with their transforms.
+ * @param n the length of each signal; must divide P.size().
+ * @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse Fast Fourier Transform.
+ */
+
+template <typename T, typename A>
+inline void batch_FFT(std::vector<std::complex<T>, A> &P, size_t n, int inv = 1) {
+    assert(n > 0 && P.size() % n == 0);
+    cached_fft_plan<T>(n, inv)->execute_batch(P.data(), P.size() / n, 1, n);
+}
+
+/**
+ * The Fast Fourier Transform of real values, computed with a half-length complex transform.
+ *
+ * @param x the n values to compute the FFT of.
+ * @return the coefficients X[0] ... X[n / 2]; the rest are conj(X[n - k]).
+ */
+
+template <typename T, typename A>
+inline std::vector<std::complex<T>> RFFT(const std::vector<T, A> &x) {
+    assert(!x.empty());
+
+    std::vector<std::complex<T>> X(x.size() / 2 + 1);
+    cached_rfft_plan<T>(x.size())->forward(x.data(), X.data());
+    return X;
+}
+
+/**
+ * The inverse of RFFT: recovers real values from the first half of their spectrum.
+ *
+ * @param X the coefficients X[0] ... X[n / 2] of n real values.
+ * @param n the number of real values, 2 * X.size() - 2 or 2 * X.size() - 1; pass 0 for the
+ * former.
+ * @return the n real values.
+ */
+
+template <typename T, typename A>
+inline std::vector<T> IRFFT(const std::vector<std::complex<T>, A> &X, size_t n = 0) {
+    if(n == 0) {
+        n = 2 * (X.size() - 1);
+    }
+    assert(n / 2 + 1 == X.size());
+
+    std::vector<T> x(n);
+    cached_rfft_plan<T>(n)->inverse(X.data(), x.data());
+    return x;
 }
 
 #endif
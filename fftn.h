@@ -0,0 +1,125 @@
+/**
+ *  fftn.h
+ *  Purpose: two- and multi-dimensional FFTs on matrices and contiguous arrays
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef FFTN_H
+
+#define FFTN_H
+
+#include <algorithm>
+#include <cassert>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "allocator.h"
+#include "fft.h"
+#include "matrix.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+namespace algebra_detail {
+
+/**
+ *  Transforms the columns of the plan.size() x cols matrix P (row stride ld) in place: the
+ *  matrix is transposed into a scratch buffer owned by the calling thread, its rows are
+ *  transformed as one batch, and it is transposed back, so no transform walks memory a row
+ *  stride at a time and repeated calls do not allocate.
+ */
+
+template <typename T>
+inline void fft_columns(const fft_plan<T> &plan, std::complex<T> *P, size_t cols, size_t ld) {
+    const size_t n = plan.size();
+    const nesting_guard nesting;
+    std::complex<T> *work = scratch_buffer<std::complex<T>, 8>(n * cols, nesting.level);
+
+    transpose_copy(n, cols, P, ld, work, n);
+    plan.execute_batch(work, cols, 1, n);
+    transpose_copy(cols, n, work, n, P, ld);
+}
+
+}
+
+/**
+ *  Computes the two-dimensional FFT of a matrix in place: the FFT of every row, then of
+ *  every column. Rows are transformed as one batch through a shared plan and columns through
+ *  a cache-blocked transpose, both spread over the thread pool.
+ *
+ *  @param m the values to compute the FFT of; overwritten with the result. Any shape is
+ *  transformed as is.
+ *  @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse
+ *  (scaled by 1 / (rows * columns)).
+ */
+
+template <typename T, typename A>
+inline void FFT2(matrix<std::complex<T>, A> &m, int inv = 1) {
+    if(m.rows() == 0 || m.columns() == 0) {
+        return;
+    }
+    const algebra_detail::instrument_scope scope(instrumented_operation::fft,
+                                                 algebra_detail::fft_flop_count(m.rows() * m.columns()));
+
+    cached_fft_plan<T>(m.columns(), inv)->execute_batch(m.data(), m.rows(), 1, m.stride());
+    algebra_detail::fft_columns(*cached_fft_plan<T>(m.rows(), inv), m.data(), m.columns(), m.stride());
+}
+
+/**
+ *  Computes the multi-dimensional FFT of a contiguous row-major array in place, one axis at
+ *  a time. The last axis is transformed as one batch of rows; every other axis through a
+ *  cache-blocked transpose of each slab.
+ *
+ *  @param P the values to compute the FFT of; overwritten with the result.
+ *  @param shape the extent of each axis, slowest first; P holds their product values.
+ *  @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse
+ *  (scaled by one over the number of values).
+ */
+
+template <typename T>
+inline void FFTN(std::complex<T> *P, const std::vector<size_t> &shape, int inv = 1) {
+    size_t total = 1;
+    for(size_t n : shape)
+        total *= n;
+    if(total == 0) {
+        return;
+    }
+    const algebra_detail::instrument_scope scope(instrumented_operation::fft, algebra_detail::fft_flop_count(total));
+
+    size_t inner = 1;
+    for(size_t d = shape.size(); d -- > 0;) {
+        const size_t n = shape[d], outer = total / (n * inner);
+        if(n > 1) {
+            const auto plan = cached_fft_plan<T>(n, inv);
+            if(inner == 1) {
+                plan->execute_batch(P, outer, 1, n);
+            } else {
+                for(size_t o = 0; o < outer; ++ o)
+                    algebra_detail::fft_columns(*plan, P + o * n * inner, inner, inner);
+            }
+        }
+        inner *= n;
+    }
+}
+
+/**
+ *  Computes the multi-dimensional FFT of a row-major array held in a vector.
+ *
+ *  @param P the values to compute the FFT of; overwritten with the result.
+ *  @param shape the extent of each axis, slowest first; their product must be P.size().
+ *  @param inv pass 1 to compute the Fast Fourier Transform, and -1 to compute the inverse.
+ */
+
+template <typename T, typename A>
+inline void FFTN(std::vector<std::complex<T>, A> &P, const std::vector<size_t> &shape, int inv = 1) {
+    size_t total = 1;
+    for(size_t n : shape)
+        total *= n;
+    assert(total == P.size());
+
+    FFTN(P.data(), shape, inv);
+}
+
+#endif
@@ -0,0 +1,438 @@
+/**
+ *  fixed_matrix.h
+ *  Purpose: matrices whose shape is known at compile time, stored inline
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef FIXED_MATRIX_H
+
+#define FIXED_MATRIX_H
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include <type_traits>
+#include <utility>
+
+#include "matrix.h"
+
+namespace algebra_detail {
+
+/**
+ *  Calls f(std::integral_constant<size_t, I>()) for every I in [0, N), expanded at compile
+ *  time so the loop body is repeated rather than looped.
+ */
+
+template <typename F, size_t... I>
+constexpr void unroll(F &&f, std::index_sequence<I...>) {
+    (f(std::integral_constant<size_t, I>()), ...);
+}
+
+template <size_t N, typename F>
+constexpr void unroll(F &&f) {
+    unroll(f, std::make_index_sequence<N>());
+}
+
+}
+
+/**
+ *  fixed_matrix class, an R x C matrix with the entries stored inline, row-major. The shape
+ *  is part of the type, so mismatched shapes fail to compile, and every operation is
+ *  unrolled into straight-line code.
+ *
+ *  @param T the data type being stored.
+ *  @param R the number of rows.
+ *  @param C the number of columns.
+ */
+
+template <typename T, size_t R, size_t C>
+class fixed_matrix {
+
+    static_assert(R > 0 && C > 0, "fixed_matrix needs at least one row and one column");
+
+    private:
+
+    T values[R * C];
+
+    public:
+
+    typedef T value_type;
+
+    /**
+     *  Default fixed_matrix constructor. All entries are set to their default.
+     */
+
+    constexpr fixed_matrix() : values() {}
+
+    /**
+     *  Alternate fixed_matrix constructor. All entries are set to t.
+     *
+     *  @param t the value to set all entries equal to.
+     */
+
+    constexpr explicit fixed_matrix(const T &t) : values() {
+        algebra_detail::unroll<R * C>([&](auto i) { values[i] = t; });
+    }
+
+    /**
+     *  List constructor, e.g. fixed_matrix<int, 2, 2>{1, 2, 3, 4}.
+     *
+     *  @param list the entries in row-major order; missing entries are set to their default.
+     */
+
+    constexpr fixed_matrix(std::initializer_list<T> list) : values() {
+        assert(list.size() <= R * C);
+        size_t i = 0;
+        for(const T &t : list)
+            values[i ++] = t;
+    }
+
+    /**
+     *  Converting constructor, copies a matrix of the same shape.
+     *
+     *  @param m the matrix to copy; must be R x C.
+     */
+
+    inline explicit fixed_matrix(const matrix<T> &m) : values() {
+        assert(m.rows() == R && m.columns() == C);
+        for(size_t i = 0; i < R; ++ i)
+            for(size_t j = 0; j < C; ++ j)
+                (*this)(i,j) = m(i,j);
+    }
+
+    /**
+     *  Returns the identity matrix.
+     *
+     *  @return the R x R identity matrix.
+     */
+
+    static constexpr fixed_matrix identity() {
+        static_assert(R == C, "only square matrices have an identity");
+        fixed_matrix ret;
+        algebra_detail::unroll<R>([&](auto i) { ret(i,i) = T(1); });
+        return ret;
+    }
+
+    /**
+     *  Retrieves the number of rows in the matrix.
+     *
+     *  @return R.
+     */
+
+    static constexpr size_t rows() {
+        return R;
+    }
+
+    /**
+     *  Retrieves the number of columns in the matrix.
+     *
+     *  @return C.
+     */
+
+    static constexpr size_t columns() {
+        return C;
+    }
+
+    /**
+     *  Retrieves the entries, row-major with no padding.
+     *
+     *  @return a pointer to the R * C entries.
+     */
+
+    constexpr T *data() {
+        return values;
+    }
+
+    constexpr const T *data() const {
+        return values;
+    }
+
+    /**
+     *  Allows access to the matrix entries.
+     *
+     *  @param row the row the entry is in.
+     *  @param column the column the entry is in.
+     *  @return a reference to the [row][column]-th element of the matrix.
+     */
+
+    constexpr T &operator () (size_t row, size_t column) {
+        return values[row * C + column];
+    }
+
+    constexpr const T &operator () (size_t row, size_t column) const {
+        return values[row * C + column];
+    }
+
+    /**
+     *  Copies the entries into a general matrix.
+     *
+     *  @return an R x C matrix with the same entries.
+     */
+
+    inline matrix<T> to_matrix() const {
+        matrix<T> ret(R, C);
+        for(size_t i = 0; i < R; ++ i)
+            for(size_t j = 0; j < C; ++ j)
+                ret(i,j) = (*this)(i,j);
+        return ret;
+    }
+
+    inline operator matrix<T>() const {
+        return to_matrix();
+    }
+
+    /**
+     *  Adds two matrices.
+     *
+     *  @param m the matrix to add.
+     *  @return the entrywise sum.
+     */
+
+    constexpr fixed_matrix operator + (const fixed_matrix &m) const {
+        fixed_matrix ret;
+        algebra_detail::unroll<R * C>([&](auto i) { ret.values[i] = values[i] + m.values[i]; });
+        return ret;
+    }
+
+    /**
+     *  Negates the matrix.
+     *
+     *  @return the matrix scaled by -1.
+     */
+
+    constexpr fixed_matrix operator - () const {
+        fixed_matrix ret;
+        algebra_detail::unroll<R * C>([&](auto i) { ret.values[i] = -values[i]; });
+        return ret;
+    }
+
+    /**
+     *  Subtracts two matrices.
+     *
+     *  @param m the matrix to subtract.
+     *  @return the entrywise difference.
+     */
+
+    constexpr fixed_matrix operator - (const fixed_matrix &m) const {
+        fixed_matrix ret;
+        algebra_detail::unroll<R * C>([&](auto i) { ret.values[i] = values[i] - m.values[i]; });
+        return ret;
+    }
+
+    /**
+     *  Scales the matrix by a constant factor.
+     *
+     *  @param t the constant to scale by.
+     *  @return the scaled matrix.
+     */
+
+    constexpr fixed_matrix operator * (const T &t) const {
+        fixed_matrix ret;
+        algebra_detail::unroll<R * C>([&](auto i) { ret.values[i] = values[i] * t; });
+        return ret;
+    }
+
+    constexpr fixed_matrix &operator += (const fixed_matrix &m) {
+        algebra_detail::unroll<R * C>([&](auto i) { values[i] = values[i] + m.values[i]; });
+        return *this;
+    }
+
+    constexpr fixed_matrix &operator -= (const fixed_matrix &m) {
+        algebra_detail::unroll<R * C>([&](auto i) { values[i] = values[i] - m.values[i]; });
+        return *this;
+    }
+
+    constexpr fixed_matrix &operator *= (const T &t) {
+        algebra_detail::unroll<R * C>([&](auto i) { values[i] = values[i] * t; });
+        return *this;
+    }
+
+    /**
+     *  Multiplies two matrices. The inner dimensions must agree at compile time.
+     *
+     *  @param m the right operand, C x K.
+     *  @return the R x K product.
+     */
+
+    template <size_t K>
+    constexpr fixed_matrix<T, R, K> operator * (const fixed_matrix<T, C, K> &m) const {
+        fixed_matrix<T, R, K> ret;
+        algebra_detail::unroll<R * K>([&](auto e) {
+            constexpr size_t i = e / K, j = e % K;
+            T s = (*this)(i,0) * m(0,j);
+            algebra_detail::unroll<C - 1>([&](auto k) { s = s + (*this)(i,k + 1) * m(k + 1,j); });
+            ret(i,j) = s;
+        });
+        return ret;
+    }
+
+    /**
+     *  Computes the transpose of the matrix.
+     *
+     *  @return the C x R transpose.
+     */
+
+    constexpr fixed_matrix<T, C, R> transpose() const {
+        fixed_matrix<T, C, R> ret;
+        algebra_detail::unroll<R * C>([&](auto e) { ret(e % C,e / C) = values[e]; });
+        return ret;
+    }
+
+    /**
+     *  Computes the matrix determinant, in closed form up to 4 x 4 and through an LU
+     *  factorization above that.
+     *
+     *  @param T1 the data type of the determinant.
+     *  @return the determinant.
+     */
+
+    template <typename T1 = long double>
+    constexpr T1 determinant() const {
+        static_assert(R == C, "only square matrices have a determinant");
+        const fixed_matrix &a = *this;
+
+        if constexpr (R == 1) {
+            return T1(a(0,0));
+        } else if constexpr (R == 2) {
+            return T1(a(0,0)) * T1(a(1,1)) - T1(a(0,1)) * T1(a(1,0));
+        } else if constexpr (R == 3) {
+            const fixed_matrix<T1, R, R> b = a.template cast<T1>();
+            return b(0,0) * (b(1,1) * b(2,2) - b(1,2) * b(2,1))
+                 - b(0,1) * (b(1,0) * b(2,2) - b(1,2) * b(2,0))
+                 + b(0,2) * (b(1,0) * b(2,1) - b(1,1) * b(2,0));
+        } else if constexpr (R == 4) {
+            const fixed_matrix<T1, R, R> b = a.template cast<T1>();
+            const T1 s0 = b(0,0) * b(1,1) - b(1,0) * b(0,1), s1 = b(0,0) * b(1,2) - b(1,0) * b(0,2);
+            const T1 s2 = b(0,0) * b(1,3) - b(1,0) * b(0,3), s3 = b(0,1) * b(1,2) - b(1,1) * b(0,2);
+            const T1 s4 = b(0,1) * b(1,3) - b(1,1) * b(0,3), s5 = b(0,2) * b(1,3) - b(1,2) * b(0,3);
+            const T1 c5 = b(2,2) * b(3,3) - b(3,2) * b(2,3), c4 = b(2,1) * b(3,3) - b(3,1) * b(2,3);
+            const T1 c3 = b(2,1) * b(3,2) - b(3,1) * b(2,2), c2 = b(2,0) * b(3,3) - b(3,0) * b(2,3);
+            const T1 c1 = b(2,0) * b(3,2) - b(3,0) * b(2,2), c0 = b(2,0) * b(3,1) - b(3,0) * b(2,1);
+            return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        } else {
+            return a.to_matrix().template determinant<T1>();
+        }
+    }
+
+    /**
+     *  Computes the inverse of the matrix, from the adjugate up to 4 x 4 and through an LU
+     *  factorization above that.
+     *
+     *  @param T1 the data type of the inverted matrix.
+     *  @return the inverse matrix.
+     *  @throws degenerate_matrix_error if the matrix is degenerate
+     */
+
+    template <typename T1 = long double>
+    inline fixed_matrix<T1, R, R> inverse() const {
+        static_assert(R == C, "only square matrices have an inverse");
+
+        if constexpr (R > 4) {
+            return fixed_matrix<T1, R, R>(to_matrix().template inverse<T1>());
+        } else {
+            const fixed_matrix<T1, R, R> b = cast<T1>();
+            fixed_matrix<T1, R, R> ret;
+            T1 det;
+
+            if constexpr (R == 1) {
+                det = b(0,0);
+                ret(0,0) = T1(1);
+            } else if constexpr (R == 2) {
+                det = b(0,0) * b(1,1) - b(0,1) * b(1,0);
+                ret = {b(1,1), -b(0,1), -b(1,0), b(0,0)};
+            } else if constexpr (R == 3) {
+                ret(0,0) = b(1,1) * b(2,2) - b(1,2) * b(2,1);
+                ret(0,1) = b(0,2) * b(2,1) - b(0,1) * b(2,2);
+                ret(0,2) = b(0,1) * b(1,2) - b(0,2) * b(1,1);
+                ret(1,0) = b(1,2) * b(2,0) - b(1,0) * b(2,2);
+                ret(1,1) = b(0,0) * b(2,2) - b(0,2) * b(2,0);
+                ret(1,2) = b(0,2) * b(1,0) - b(0,0) * b(1,2);
+                ret(2,0) = b(1,0) * b(2,1) - b(1,1) * b(2,0);
+                ret(2,1) = b(0,1) * b(2,0) - b(0,0) * b(2,1);
+                ret(2,2) = b(0,0) * b(1,1) - b(0,1) * b(1,0);
+                det = b(0,0) * ret(0,0) + b(0,1) * ret(1,0) + b(0,2) * ret(2,0);
+            } else {
+                const T1 s0 = b(0,0) * b(1,1) - b(1,0) * b(0,1), s1 = b(0,0) * b(1,2) - b(1,0) * b(0,2);
+                const T1 s2 = b(0,0) * b(1,3) - b(1,0) * b(0,3), s3 = b(0,1) * b(1,2) - b(1,1) * b(0,2);
+                const T1 s4 = b(0,1) * b(1,3) - b(1,1) * b(0,3), s5 = b(0,2) * b(1,3) - b(1,2) * b(0,3);
+                const T1 c5 = b(2,2) * b(3,3) - b(3,2) * b(2,3), c4 = b(2,1) * b(3,3) - b(3,1) * b(2,3);
+                const T1 c3 = b(2,1) * b(3,2) - b(3,1) * b(2,2), c2 = b(2,0) * b(3,3) - b(3,0) * b(2,3);
+                const T1 c1 = b(2,0) * b(3,2) - b(3,0) * b(2,2), c0 = b(2,0) * b(3,1) - b(3,0) * b(2,1);
+                det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+
+                ret(0,0) =  b(1,1) * c5 - b(1,2) * c4 + b(1,3) * c3;
+                ret(0,1) = -b(0,1) * c5 + b(0,2) * c4 - b(0,3) * c3;
+                ret(0,2) =  b(3,1) * s5 - b(3,2) * s4 + b(3,3) * s3;
+                ret(0,3) = -b(2,1) * s5 + b(2,2) * s4 - b(2,3) * s3;
+                ret(1,0) = -b(1,0) * c5 + b(1,2) * c2 - b(1,3) * c1;
+                ret(1,1) =  b(0,0) * c5 - b(0,2) * c2 + b(0,3) * c1;
+                ret(1,2) = -b(3,0) * s5 + b(3,2) * s2 - b(3,3) * s1;
+                ret(1,3) =  b(2,0) * s5 - b(2,2) * s2 + b(2,3) * s1;
+                ret(2,0) =  b(1,0) * c4 - b(1,1) * c2 + b(1,3) * c0;
+                ret(2,1) = -b(0,0) * c4 + b(0,1) * c2 - b(0,3) * c0;
+                ret(2,2) =  b(3,0) * s4 - b(3,1) * s2 + b(3,3) * s0;
+                ret(2,3) = -b(2,0) * s4 + b(2,1) * s2 - b(2,3) * s0;
+                ret(3,0) = -b(1,0) * c3 + b(1,1) * c1 - b(1,2) * c0;
+                ret(3,1) =  b(0,0) * c3 - b(0,1) * c1 + b(0,2) * c0;
+                ret(3,2) = -b(3,0) * s3 + b(3,1) * s1 - b(3,2) * s0;
+                ret(3,3) =  b(2,0) * s3 - b(2,1) * s1 + b(2,2) * s0;
+            }
+
+            if(det == T1(0)) {
+                throw degenerate_matrix_error();
+            }
+
+            return ret * (T1(1) / det);
+        }
+    }
+
+    /**
+     *  Converts the entries to another data type.
+     *
+     *  @param T1 the data type to convert to.
+     *  @return the converted matrix.
+     */
+
+    template <typename T1>
+    constexpr fixed_matrix<T1, R, C> cast() const {
+        fixed_matrix<T1, R, C> ret;
+        algebra_detail::unroll<R * C>([&](auto i) { ret.data()[i] = T1(values[i]); });
+        return ret;
+    }
+
+    /**
+     *  Checks if two matrices are equal to each other.
+     *
+     *  @param m the matrix to compare to.
+     *  @return true if the two are equal, and false otherwise.
+     */
+
+    constexpr bool operator == (const fixed_matrix &m) const {
+        for(size_t i = 0; i < R * C; ++ i)
+            if(values[i] != m.values[i])
+                return false;
+        return true;
+    }
+
+    constexpr bool operator != (const fixed_matrix &m) const {
+        return !((*this) == m);
+    }
+};
+
+/**
+ *  Prints a fixed_matrix in the same layout as a matrix.
+ *
+ *  @param os the stream to print to.
+ *  @param m the matrix to print.
+ *  @return the stream.
+ */
+
+template <typename T, size_t R, size_t C>
+std::ostream &operator << (std::ostream &os, const fixed_matrix<T, R, C> &m) {
+    return os << m.to_matrix();
+}
+
+#endif
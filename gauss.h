@@ -10,35 +10,49 @@
 
 #define GAUSS_H
 
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+#include <vector>
+
+#include "instrument.h"
+#include "lu.h"
 #include "matrix.h"
 
 /**
  *  Preforms Gaussian elimination to solve a system of linear equations.
  *
- *  @param A the matrix representing the linear equations
+ *  The system is solved through an LU factorization with partial pivoting rather than an
+ *  explicit inverse. Integer systems are solved in long double. To solve repeatedly against
+ *  the same A, use lu_decomposition directly.
+ *
+ *  @param A the matrix representing the linear equations. Rows shorter than A.size() are
+ *  padded with zeros.
  *  @param Y the column vector representing the resultant.
  *  @return an std::vector representing the values
+ *  @throws degenerate_matrix_error if the system has no unique solution
  */
 template<typename T>
 std::vector<T> gauss(std::vector<std::vector<T>> A, std::vector<T> Y) {
+    typedef typename std::conditional<std::is_integral<T>::value, long double, T>::type T1;
+    const double n = double(A.size());
+    const algebra_detail::instrument_scope scope(instrumented_operation::gauss, 2.0 / 3.0 * n * n * n + 2.0 * n * n);
+
     assert(A.size() == Y.size());
-    for(auto &a : A) {
-        assert(a.size() <= A.size());
-    }
+    assert(std::all_of(A.begin(), A.end(), [&](const std::vector<T> &a) { return a.size() <= A.size(); }));
 
-    matrix<T> m = matrix<T>(A.size(), A.size());
+    matrix<T1> m = matrix<T1>(A.size(), A.size());
     for(size_t i = 0; i < A.size(); ++ i) {
         for(size_t j = 0; j < A[i].size(); ++ j) {
             m(i,j) = A[i][j];
         }
     }
 
-    matrix<T> y = matrix<T>(1, A.size());
-    for(size_t i = 0; i < Y.size(); ++ i) {
-        m(0,i) = Y[i];
-    }
+    std::vector<T1> y(Y.begin(), Y.end());
+
+    std::vector<T1> x = lu_decomposition<T1>(m).solve(y);
 
-    return m.inverse() * y;
+    return std::vector<T>(x.begin(), x.end());
 }
 
 #endif
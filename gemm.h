@@ -0,0 +1,495 @@
+/**
+ *  gemm.h
+ *  Purpose: cache-blocked general matrix multiply kernels
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef GEMM_H
+
+#define GEMM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "allocator.h"
+#include "blas.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+/**
+ *  Block sizes used by the cache-blocked multiply. A kc x nc panel of B is packed to stay in
+ *  L3, an mc x kc block of A to stay in L2, and multiplies smaller than threshold (measured as
+ *  rows * columns * inner dimension) use the plain loop instead. Multiplies of at least
+ *  parallel_threshold split their blocks of A across current_executor(). Adjust these before
+ *  any multiply runs; they are read without synchronisation.
+ */
+
+struct gemm_blocking {
+    size_t mc;
+    size_t kc;
+    size_t nc;
+    size_t threshold;
+    size_t parallel_threshold;
+};
+
+/**
+ *  Retrieves the block sizes used by gemm. The defaults are tuned for the instruction set
+ *  chosen by simd_level() on first use.
+ *
+ *  @return a reference to the process-wide block sizes.
+ */
+
+inline gemm_blocking &gemm_tuning() {
+    static gemm_blocking blocking = [] {
+        switch(simd_level()) {
+            case simd_isa::avx512:
+                return gemm_blocking{144, 384, 4080, 64 * 64 * 64, 192 * 192 * 192};
+            case simd_isa::avx2:
+            case simd_isa::neon:
+                return gemm_blocking{96, 256, 4080, 64 * 64 * 64, 192 * 192 * 192};
+            default:
+                return gemm_blocking{64, 256, 2048, 64 * 64 * 64, 192 * 192 * 192};
+        }
+    }();
+    return blocking;
+}
+
+/**
+ *  Whether gemm has a packed register-tiled kernel for the data type T.
+ */
+
+template <typename T>
+struct gemm_has_kernel {
+    static constexpr bool value = simd_supported<T>::value;
+};
+
+/**
+ *  How gemm reads an operand: as stored, or as the transpose of what is stored. A transposed
+ *  operand is packed straight from its storage, so it is never materialized.
+ */
+
+enum class gemm_transpose {
+    none,
+    transpose
+};
+
+namespace algebra_detail {
+
+/**
+ *  The offset of entry (row, column) of an operand read as stored (Transposed false) or as
+ *  the transpose of what is stored, with a row stride of ld.
+ */
+
+template <bool Transposed>
+inline size_t operand_offset(size_t row, size_t column, size_t ld) {
+    return Transposed ? column * ld + row : row * ld + column;
+}
+
+/**
+ *  Packs an mc x kc block of A into panels of MR rows, each stored column by column. Rows
+ *  past the end of the block are zero filled. A points at the block, read per Transposed.
+ */
+
+template <bool Transposed, typename T>
+inline void pack_a(size_t mc, size_t kc, const T *A, size_t lda, size_t MR, T *out) {
+    if(Transposed) {
+
+        // Each stored row holds one column of the block, so it is read once, left to right,
+        // and scattered across the panels.
+
+        for(size_t k = 0; k < kc; ++ k) {
+            const T *column = A + k * lda;
+            for(size_t i = 0; i < mc; i += MR) {
+                T *panel = out + i * kc + k * MR;
+                for(size_t r = 0; r < MR; ++ r)
+                    panel[r] = i + r < mc ? column[i + r] : T(0);
+            }
+        }
+        return;
+    }
+    for(size_t i = 0; i < mc; i += MR) {
+        const size_t m = std::min(MR, mc - i);
+        for(size_t k = 0; k < kc; ++ k) {
+            size_t r = 0;
+            for(; r < m; ++ r)
+                *out++ = A[(i + r) * lda + k];
+            for(; r < MR; ++ r)
+                *out++ = T(0);
+        }
+    }
+}
+
+/**
+ *  Packs a kc x nc block of B into panels of NR columns, each stored row by row. Columns
+ *  past the end of the block are zero filled. B points at the block, read per Transposed;
+ *  a transposed B is gathered one stored row (one column of the block) at a time.
+ */
+
+template <bool Transposed, typename T>
+inline void pack_b(size_t kc, size_t nc, const T *B, size_t ldb, size_t NR, T *out) {
+    for(size_t j = 0; j < nc; j += NR) {
+        const size_t n = std::min(NR, nc - j);
+        if(Transposed) {
+            for(size_t c = 0; c < NR; ++ c) {
+                const T *column = B + (j + c) * ldb;
+                for(size_t k = 0; k < kc; ++ k)
+                    out[k * NR + c] = c < n ? column[k] : T(0);
+            }
+            out += kc * NR;
+            continue;
+        }
+        for(size_t k = 0; k < kc; ++ k) {
+            const T *row = B + k * ldb + j;
+            size_t c = 0;
+            for(; c < n; ++ c)
+                *out++ = row[c];
+            for(; c < NR; ++ c)
+                *out++ = T(0);
+        }
+    }
+}
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+
+/**
+ *  Register-tiled micro-kernel. Computes C += alpha * A * B for one MR x NR tile, where A and
+ *  B are packed panels of depth kc. Accumulators are held in W-byte vector registers.
+ *
+ *  @param m the number of valid rows in the tile (at most MR).
+ *  @param n the number of valid columns in the tile (at most NR).
+ */
+
+template <typename T, size_t W>
+ALGEBRA_ALWAYS_INLINE void gemm_micro_kernel(size_t kc, T alpha, const T *a, const T *b,
+                                             T *C, size_t ldc, size_t m, size_t n) {
+    typedef T vec __attribute__((vector_size(W)));
+    constexpr size_t L = W / sizeof(T);
+    constexpr size_t MR = 6;
+    constexpr size_t NV = 2;
+    constexpr size_t NR = NV * L;
+
+    vec acc[MR][NV];
+    for(size_t i = 0; i < MR; ++ i)
+        for(size_t v = 0; v < NV; ++ v)
+            acc[i][v] = vec{};
+
+    for(size_t k = 0; k < kc; ++ k) {
+        vec bv[NV];
+        std::memcpy(bv, b, sizeof(bv));
+        for(size_t i = 0; i < MR; ++ i) {
+            const T ai = a[i];
+            for(size_t v = 0; v < NV; ++ v)
+                acc[i][v] += bv[v] * ai;
+        }
+        a += MR;
+        b += NR;
+    }
+
+    if(m == MR && n == NR) {
+        for(size_t i = 0; i < MR; ++ i) {
+            for(size_t v = 0; v < NV; ++ v) {
+                vec c;
+                std::memcpy(&c, C + i * ldc + v * L, sizeof(c));
+                c += acc[i][v] * alpha;
+                std::memcpy(C + i * ldc + v * L, &c, sizeof(c));
+            }
+        }
+    } else {
+        T tile[MR][NR];
+        std::memcpy(tile, acc, sizeof(tile));
+        for(size_t i = 0; i < m; ++ i)
+            for(size_t j = 0; j < n; ++ j)
+                C[i * ldc + j] += alpha * tile[i][j];
+    }
+}
+
+/**
+ *  A micro-kernel compiled for one instruction set, with its register tile shape.
+ */
+
+template <typename T>
+struct gemm_kernel {
+    typedef void (*function)(size_t, T, const T *, const T *, T *, size_t, size_t, size_t);
+
+    size_t mr;
+    size_t nr;
+    function run;
+};
+
+template <typename T>
+inline void gemm_micro_kernel_baseline(size_t kc, T alpha, const T *a, const T *b,
+                                       T *C, size_t ldc, size_t m, size_t n) {
+    gemm_micro_kernel<T, ALGEBRA_VECTOR_BYTES>(kc, alpha, a, b, C, ldc, m, n);
+}
+
+#if ALGEBRA_X86_DISPATCH
+
+template <typename T>
+ALGEBRA_TARGET_AVX2 void gemm_micro_kernel_avx2(size_t kc, T alpha, const T *a, const T *b,
+                                                T *C, size_t ldc, size_t m, size_t n) {
+    gemm_micro_kernel<T, 32>(kc, alpha, a, b, C, ldc, m, n);
+}
+
+template <typename T>
+ALGEBRA_TARGET_AVX512 void gemm_micro_kernel_avx512(size_t kc, T alpha, const T *a, const T *b,
+                                                    T *C, size_t ldc, size_t m, size_t n) {
+    gemm_micro_kernel<T, 64>(kc, alpha, a, b, C, ldc, m, n);
+}
+
+#endif
+
+/**
+ *  Picks the micro-kernel for the instruction set chosen by simd_level().
+ */
+
+template <typename T>
+inline gemm_kernel<T> select_gemm_kernel() {
+#if ALGEBRA_X86_DISPATCH
+    switch(simd_level()) {
+        case simd_isa::avx512:
+            return {6, 2 * 64 / sizeof(T), &gemm_micro_kernel_avx512<T>};
+        case simd_isa::avx2:
+            return {6, 2 * 32 / sizeof(T), &gemm_micro_kernel_avx2<T>};
+        default:
+            break;
+    }
+#endif
+    return {6, 2 * ALGEBRA_VECTOR_BYTES / sizeof(T), &gemm_micro_kernel_baseline<T>};
+}
+
+/**
+ *  Goto-style blocked driver: loops over nc-wide panels of B and mc-tall blocks of A, packs
+ *  both, then sweeps the register tiles. Large multiplies run the blocks of A in parallel;
+ *  each thread packs its own block of A against the shared packed panel of B.
+ */
+
+template <bool TA, bool TB, typename T>
+void gemm_blocked(size_t M, size_t N, size_t K, T alpha, const T *A, size_t lda,
+                  const T *B, size_t ldb, T *C, size_t ldc) {
+    const gemm_kernel<T> kernel = select_gemm_kernel<T>();
+    const gemm_blocking &blocking = gemm_tuning();
+    const size_t mr = kernel.mr, nr = kernel.nr;
+    const size_t kc = std::max<size_t>(1, blocking.kc);
+    const size_t nc = std::max(nr, blocking.nc / nr * nr);
+    size_t mc = std::max(mr, blocking.mc / mr * mr);
+
+    const bool parallel = M * N * K >= blocking.parallel_threshold;
+    if(parallel) {
+        const size_t threads = current_executor().concurrency();
+        const size_t share = (M + threads - 1) / threads;
+        mc = std::max(mr, std::min(mc, (share + mr - 1) / mr * mr));
+    }
+    const size_t blocks = (M + mc - 1) / mc;
+
+    const nesting_guard nesting;
+    T *packed_b = scratch_buffer<T, 1>(std::min(nc, (N + nr - 1) / nr * nr) * kc, nesting.level);
+
+    for(size_t jc = 0; jc < N; jc += nc) {
+        const size_t nb = std::min(nc, N - jc);
+        for(size_t pc = 0; pc < K; pc += kc) {
+            const size_t kb = std::min(kc, K - pc);
+            pack_b<TB>(kb, nb, B + operand_offset<TB>(pc, jc, ldb), ldb, nr, packed_b);
+
+            auto sweep = [&](size_t first, size_t last) {
+                T *packed_a = scratch_buffer<T, 0>(mc * kc);
+                for(size_t block = first; block < last; ++ block) {
+                    const size_t ic = block * mc;
+                    const size_t mb = std::min(mc, M - ic);
+                    pack_a<TA>(mb, kb, A + operand_offset<TA>(ic, pc, lda), lda, mr, packed_a);
+                    for(size_t jr = 0; jr < nb; jr += nr) {
+                        const T *b = packed_b + jr * kb;
+                        for(size_t ir = 0; ir < mb; ir += mr) {
+                            const T *a = packed_a + ir * kb;
+                            kernel.run(kb, alpha, a, b, C + (ic + ir) * ldc + jc + jr, ldc,
+                                       std::min(mr, mb - ir), std::min(nr, nb - jr));
+                        }
+                    }
+                }
+            };
+
+            if(parallel) {
+                parallel_for(0, blocks, 1, sweep);
+            } else {
+                sweep(0, blocks);
+            }
+        }
+    }
+}
+
+#endif
+
+/**
+ *  The height of the row blocks syrk computes at a time.
+ */
+
+constexpr size_t syrk_block_size = 64;
+
+/**
+ *  Adds alpha * op(A) * op(B) to the lower triangle of the N x N matrix C, where op(A) is
+ *  N x K and op(B) is K x N, for products known to be symmetric. Each block of syrk_block_size rows is one gemm
+ *  for the part left of the diagonal block, which runs through the packed kernels, plus one
+ *  small gemm into scratch for the diagonal block itself, of which only the lower triangle is
+ *  added; blocks are spread over the thread pool. Entries above the diagonal are neither read
+ *  nor written.
+ */
+
+template <typename T>
+void syrk_blocked(size_t N, size_t K, T alpha, gemm_transpose ta, const T *A, size_t lda,
+                  gemm_transpose tb, const T *B, size_t ldb, T *C, size_t ldc);
+
+}
+
+/**
+ *  General matrix multiply, C = alpha * op(A) * op(B) + beta * C, on row-major buffers, where
+ *  op(X) is X or its transpose. A transposed operand is read in place by the packing step,
+ *  so it costs no more than a plain one. Built with ALGEBRA_USE_BLAS, large float and double
+ *  products go to the vendor gemm instead (see blas.h).
+ *
+ *  @param ta whether op(A) is A or A^T.
+ *  @param tb whether op(B) is B or B^T.
+ *  @param M the number of rows of op(A) and C.
+ *  @param N the number of columns of op(B) and C.
+ *  @param K the number of columns of op(A) and rows of op(B).
+ *  @param alpha the scale applied to op(A) * op(B).
+ *  @param A the left operand as stored (M x K, or K x M when transposed), with a row stride
+ *  of lda.
+ *  @param B the right operand as stored (K x N, or N x K when transposed), with a row stride
+ *  of ldb.
+ *  @param beta the scale applied to C before accumulating. When 0, C is not read.
+ *  @param C the result, with a row stride of ldc.
+ */
+
+template <typename T>
+void gemm(gemm_transpose ta, gemm_transpose tb, size_t M, size_t N, size_t K, T alpha,
+          const T *A, size_t lda, const T *B, size_t ldb, T beta, T *C, size_t ldc) {
+    if(algebra_detail::blas_gemm(ta == gemm_transpose::transpose, tb == gemm_transpose::transpose, M, N, K, alpha,
+                                 A, lda, B, ldb, beta, C, ldc)) {
+        return;
+    }
+
+    for(size_t i = 0; i < M; ++ i) {
+        T *c = C + i * ldc;
+        if(beta == T(0)) {
+            std::fill(c, c + N, T(0));
+        } else if(beta != T(1)) {
+            for(size_t j = 0; j < N; ++ j)
+                c[j] = c[j] * beta;
+        }
+    }
+
+    if(M == 0 || N == 0 || K == 0 || alpha == T(0)) {
+        return;
+    }
+
+    const bool trans_a = ta == gemm_transpose::transpose, trans_b = tb == gemm_transpose::transpose;
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (gemm_has_kernel<T>::value) {
+        using algebra_detail::gemm_blocked;
+        if(trans_a) {
+            (trans_b ? gemm_blocked<true, true, T> : gemm_blocked<true, false, T>)(M, N, K, alpha, A, lda, B, ldb, C, ldc);
+        } else {
+            (trans_b ? gemm_blocked<false, true, T> : gemm_blocked<false, false, T>)(M, N, K, alpha, A, lda, B, ldb, C, ldc);
+        }
+        return;
+    }
+#endif
+
+    for(size_t i = 0; i < M; ++ i) {
+        T *c = C + i * ldc;
+        for(size_t k = 0; k < K; ++ k) {
+            const T a = alpha * (trans_a ? A[k * lda + i] : A[i * lda + k]);
+            if(trans_b) {
+                for(size_t j = 0; j < N; ++ j)
+                    c[j] = c[j] + a * B[j * ldb + k];
+            } else {
+                const T *b = B + k * ldb;
+                for(size_t j = 0; j < N; ++ j)
+                    c[j] = c[j] + a * b[j];
+            }
+        }
+    }
+}
+
+/**
+ *  General matrix multiply, C = alpha * A * B + beta * C, on row-major buffers.
+ *
+ *  @param M the number of rows of A and C.
+ *  @param N the number of columns of B and C.
+ *  @param K the number of columns of A and rows of B.
+ *  @param alpha the scale applied to A * B.
+ *  @param A the left operand, with a row stride of lda.
+ *  @param B the right operand, with a row stride of ldb.
+ *  @param beta the scale applied to C before accumulating. When 0, C is not read.
+ *  @param C the result, with a row stride of ldc.
+ */
+
+template <typename T>
+void gemm(size_t M, size_t N, size_t K, T alpha, const T *A, size_t lda,
+          const T *B, size_t ldb, T beta, T *C, size_t ldc) {
+    gemm(gemm_transpose::none, gemm_transpose::none, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+template <typename T>
+void algebra_detail::syrk_blocked(size_t N, size_t K, T alpha, gemm_transpose ta, const T *A, size_t lda,
+                                  gemm_transpose tb, const T *B, size_t ldb, T *C, size_t ldc) {
+    const size_t blocks = (N + syrk_block_size - 1) / syrk_block_size;
+    const bool trans_a = ta == gemm_transpose::transpose, trans_b = tb == gemm_transpose::transpose;
+
+    parallel_for(0, blocks, 1, [&](size_t b0, size_t b1) {
+        const nesting_guard nesting;
+        T *diagonal = scratch_buffer<T, 10>(syrk_block_size * syrk_block_size, nesting.level);
+
+        for(size_t block = b0; block < b1; ++ block) {
+            const size_t i0 = block * syrk_block_size, ib = std::min(syrk_block_size, N - i0);
+
+            const T *left = A + (trans_a ? i0 : i0 * lda), *right = B + (trans_b ? i0 * ldb : i0);
+
+            gemm(ta, tb, ib, i0, K, alpha, left, lda, B, ldb, T(1), C + i0 * ldc, ldc);
+
+            gemm(ta, tb, ib, ib, K, alpha, left, lda, right, ldb, T(0), diagonal, ib);
+            for(size_t i = 0; i < ib; ++ i)
+                for(size_t j = 0; j <= i; ++ j)
+                    C[(i0 + i) * ldc + i0 + j] += diagonal[i * ib + j];
+        }
+    });
+}
+
+/**
+ *  Symmetric rank-k update, C = alpha * A^T * A + beta * C, computing only the lower triangle.
+ *  Costs about half the flops of the equivalent gemm.
+ *
+ *  @param N the order of C, and the number of columns of A.
+ *  @param K the number of rows of A.
+ *  @param alpha the scale applied to A^T * A.
+ *  @param A the K x N operand, with a row stride of lda.
+ *  @param beta the scale applied to C before accumulating. When 0, C is not read.
+ *  @param C the result, with a row stride of ldc; only entries on and below the diagonal are
+ *  read or written.
+ */
+
+template <typename T>
+void syrk(size_t N, size_t K, T alpha, const T *A, size_t lda, T beta, T *C, size_t ldc) {
+    for(size_t i = 0; i < N; ++ i) {
+        T *c = C + i * ldc;
+        if(beta == T(0)) {
+            std::fill(c, c + i + 1, T(0));
+        } else if(beta != T(1)) {
+            for(size_t j = 0; j <= i; ++ j)
+                c[j] = c[j] * beta;
+        }
+    }
+
+    if(N == 0 || K == 0 || alpha == T(0)) {
+        return;
+    }
+
+    algebra_detail::syrk_blocked(N, K, alpha, gemm_transpose::transpose, A, lda, gemm_transpose::none, A, lda, C, ldc);
+}
+
+#endif
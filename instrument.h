@@ -0,0 +1,252 @@
+/**
+ *  instrument.h
+ *  Purpose: opt-in call, allocation, flop and time counters for the hot paths, with trace hooks
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef INSTRUMENT_H
+
+#define INSTRUMENT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *  Define ALGEBRA_INSTRUMENT to 1 to have the operations below count their calls, the bytes
+ *  they allocate, the floating point operations they perform and the time they take, and
+ *  report each call to the trace hooks. Otherwise the counters and hooks compile away, and
+ *  instrumentation_stats always reports zeros. Every translation unit of a program must
+ *  agree on the setting.
+ */
+
+#ifndef ALGEBRA_INSTRUMENT
+#define ALGEBRA_INSTRUMENT 0
+#endif
+
+/**
+ *  The instrumented operations.
+ *
+ *  multiply: multiply_into and multiply_accumulate, and so matrix products.
+ *  inverse: inverse_into, and so matrix::inverse.
+ *  determinant: matrix::determinant and matrix::log_determinant.
+ *  gauss: gauss.
+ *  fft: every execution of an fft_plan or rfft_plan, FFT2 and FFTN.
+ *  fft_plan: every fft_plan or rfft_plan built, which is how often cached_fft_plan misses.
+ *  transpose: transpose_into and matrix::transpose_in_place.
+ */
+
+enum class instrumented_operation {
+    multiply,
+    inverse,
+    determinant,
+    gauss,
+    fft,
+    fft_plan,
+    transpose
+};
+
+constexpr size_t instrumented_operation_count = 7;
+
+/**
+ *  Retrieves the name of an operation, as passed to the trace hooks.
+ *
+ *  @param op the operation.
+ *  @return its name, a string literal.
+ */
+
+inline const char *operation_name(instrumented_operation op) {
+    static const char *const names[instrumented_operation_count] = {
+        "multiply", "inverse", "determinant", "gauss", "fft", "fft_plan", "transpose"};
+    return names[size_t(op)];
+}
+
+/**
+ *  What one operation has done since the program started, or since reset_instrumentation.
+ *  An operation that runs inside another of the same kind (the inner transforms of a six-step
+ *  FFT, say) is part of the outer call and is not counted again. Bytes and time are
+ *  inclusive: the allocations and time of an inverse include those of any products it runs.
+ *  Only allocations made on the calling thread, through aligned_allocator or by the arenas
+ *  and pools of allocator.h, are counted.
+ */
+
+struct operation_stats {
+    uint64_t calls;
+    uint64_t bytes_allocated;
+    uint64_t flops;
+    uint64_t nanoseconds;
+};
+
+/**
+ *  Callbacks for trace spans, to forward the instrumented operations to a profiler such as
+ *  Tracy or Perfetto. begin is called as an operation starts and end as it returns, on the
+ *  calling thread, with the operation's name and context. Either may be null. Set these
+ *  before any kernel runs; they are read without synchronisation.
+ */
+
+struct trace_hooks {
+    void (*begin)(const char *name, void *context);
+    void (*end)(const char *name, void *context);
+    void *context;
+};
+
+/**
+ *  Retrieves the trace hooks called around every instrumented operation.
+ *
+ *  @return a reference to the process-wide hooks, initially null.
+ */
+
+inline trace_hooks &instrumentation_hooks() {
+    static trace_hooks hooks = {nullptr, nullptr, nullptr};
+    return hooks;
+}
+
+/**
+ *  Whether the library was built with the instrumentation.
+ *
+ *  @return true if ALGEBRA_INSTRUMENT is set.
+ */
+
+constexpr bool instrumentation_available() {
+    return ALGEBRA_INSTRUMENT != 0;
+}
+
+namespace algebra_detail {
+
+struct operation_counters {
+    std::atomic<uint64_t> calls{0}, bytes_allocated{0}, flops{0}, nanoseconds{0};
+};
+
+inline operation_counters &counters_of(instrumented_operation op) {
+    static operation_counters table[instrumented_operation_count];
+    return table[size_t(op)];
+}
+
+/**
+ *  Instruments one call of an operation while in scope: counts it and its flops on entry,
+ *  and its allocations and time on exit. Compiles to nothing without ALGEBRA_INSTRUMENT.
+ */
+
+class instrument_scope {
+
+#if ALGEBRA_INSTRUMENT
+
+    private:
+
+    instrumented_operation op;
+    bool outermost;
+    instrument_scope *parent;
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start;
+
+    static inline instrument_scope *&innermost() {
+        thread_local instrument_scope *scope = nullptr;
+        return scope;
+    }
+
+    static inline unsigned &depth(instrumented_operation op) {
+        thread_local unsigned depths[instrumented_operation_count] = {};
+        return depths[size_t(op)];
+    }
+
+    public:
+
+    /**
+     *  @param Op the operation being called.
+     *  @param flops the floating point operations the call performs.
+     */
+
+    inline explicit instrument_scope(instrumented_operation Op, double flops = 0)
+        : op(Op), outermost(depth(Op)++ == 0), parent(innermost()) {
+        innermost() = this;
+        if(outermost) {
+            operation_counters &counters = counters_of(op);
+            counters.calls.fetch_add(1, std::memory_order_relaxed);
+            counters.flops.fetch_add(uint64_t(flops), std::memory_order_relaxed);
+            const trace_hooks &hooks = instrumentation_hooks();
+            if(hooks.begin) {
+                hooks.begin(operation_name(op), hooks.context);
+            }
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    inline ~instrument_scope() {
+        if(outermost) {
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            operation_counters &counters = counters_of(op);
+            counters.nanoseconds.fetch_add(uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()),
+                                           std::memory_order_relaxed);
+            counters.bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+            const trace_hooks &hooks = instrumentation_hooks();
+            if(hooks.end) {
+                hooks.end(operation_name(op), hooks.context);
+            }
+        }
+        -- depth(op);
+        innermost() = parent;
+        if(parent) {
+            parent->bytes += bytes;
+        }
+    }
+
+    /**
+     *  Charges an allocation to the innermost operation in progress on the calling thread.
+     *
+     *  @param n the number of bytes allocated.
+     */
+
+    static inline void allocated(size_t n) {
+        if(instrument_scope *scope = innermost()) {
+            scope->bytes += n;
+        }
+    }
+
+#else
+
+    public:
+
+    inline explicit instrument_scope(instrumented_operation, double = 0) {}
+
+    static inline void allocated(size_t) {}
+
+#endif
+
+    instrument_scope(const instrument_scope &) = delete;
+    instrument_scope &operator = (const instrument_scope &) = delete;
+};
+
+}
+
+/**
+ *  Retrieves what an operation has done so far.
+ *
+ *  @param op the operation.
+ *  @return its counters; all zero unless ALGEBRA_INSTRUMENT is set.
+ */
+
+inline operation_stats instrumentation_stats(instrumented_operation op) {
+    const algebra_detail::operation_counters &counters = algebra_detail::counters_of(op);
+    return {counters.calls.load(std::memory_order_relaxed), counters.bytes_allocated.load(std::memory_order_relaxed),
+            counters.flops.load(std::memory_order_relaxed), counters.nanoseconds.load(std::memory_order_relaxed)};
+}
+
+/**
+ *  Sets every counter back to zero. Calls in progress still add what they do to the counters
+ *  when they return.
+ */
+
+inline void reset_instrumentation() {
+    for(size_t i = 0; i < instrumented_operation_count; ++ i) {
+        algebra_detail::operation_counters &counters = algebra_detail::counters_of(instrumented_operation(i));
+        counters.calls.store(0, std::memory_order_relaxed);
+        counters.bytes_allocated.store(0, std::memory_order_relaxed);
+        counters.flops.store(0, std::memory_order_relaxed);
+        counters.nanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
+
+#endif
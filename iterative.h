@@ -0,0 +1,539 @@
+/**
+ *  iterative.h
+ *  Purpose: Krylov solvers (CG, BiCGSTAB, GMRES) for large, sparse linear systems
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef ITERATIVE_H
+
+#define ITERATIVE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "matrix.h"
+#include "simd.h"
+#include "sparse.h"
+#include "thread_pool.h"
+
+/**
+ *  The stopping rules of an iterative solve.
+ */
+
+template <typename T = double>
+struct iterative_options {
+
+    /**
+     *  The solve stops once ||b - A x|| <= tolerance * ||b||.
+     */
+
+    T tolerance = T(1e-10);
+
+    /**
+     *  The most iterations (matrix-vector products, for GMRES) to run.
+     */
+
+    size_t max_iterations = 1000;
+
+    /**
+     *  The number of GMRES iterations between restarts.
+     */
+
+    size_t restart = 30;
+};
+
+/**
+ *  The outcome of an iterative solve.
+ */
+
+template <typename T = double>
+struct iterative_result {
+    size_t iterations = 0;
+
+    /**
+     *  The final relative residual, ||b - A x|| / ||b||.
+     */
+
+    T residual = T(0);
+    bool converged = false;
+};
+
+namespace algebra_detail {
+
+/**
+ *  Computes y = A x for a dense matrix, with the rows spread over the thread pool.
+ */
+
+template <typename T>
+inline void apply_operator(const matrix<T> &A, const T *x, T *y) {
+    const size_t grain = std::max<size_t>(1, 4096 / std::max<size_t>(1, A.columns()));
+    parallel_for(0, A.rows(), grain, [&](size_t i0, size_t i1) {
+        for(size_t i = i0; i < i1; ++ i)
+            y[i] = simd_dot(A.columns(), A.data() + i * A.stride(), x);
+    });
+}
+
+template <typename T>
+inline void apply_operator(const sparse_matrix<T> &A, const T *x, T *y) {
+    A.multiply(x, y);
+}
+
+template <typename T>
+inline std::vector<T> diagonal_of(const matrix<T> &A) {
+    std::vector<T> d(std::min(A.rows(), A.columns()));
+    for(size_t i = 0; i < d.size(); ++ i)
+        d[i] = A(i,i);
+    return d;
+}
+
+template <typename T>
+inline std::vector<T> diagonal_of(const sparse_matrix<T> &A) {
+    std::vector<T> d(std::min(A.rows(), A.columns()));
+    for(size_t i = 0; i < d.size(); ++ i)
+        d[i] = A(i,i);
+    return d;
+}
+
+template <typename T>
+inline T norm(const std::vector<T> &v) {
+    return std::sqrt(simd_dot(v.size(), v.data(), v.data()));
+}
+
+}
+
+/**
+ *  identity_preconditioner class, the absence of preconditioning: z = r.
+ */
+
+struct identity_preconditioner {
+    template <typename T>
+    inline void apply(const T *r, T *z, size_t n) const {
+        std::copy(r, r + n, z);
+    }
+};
+
+/**
+ *  jacobi_preconditioner class, scaling by the inverse of the diagonal of A. Cheap, and
+ *  effective when A is diagonally dominant.
+ *
+ *  @param T the data type of the system.
+ */
+
+template <typename T = double>
+class jacobi_preconditioner {
+
+    private:
+
+    std::vector<T> inverse_diagonal;
+
+    public:
+
+    /**
+     *  Constructor for a jacobi_preconditioner.
+     *
+     *  @param A the system matrix, dense or sparse.
+     *  @throws degenerate_matrix_error if a diagonal entry is zero
+     */
+
+    template <typename M>
+    inline explicit jacobi_preconditioner(const M &A) : inverse_diagonal(algebra_detail::diagonal_of(A)) {
+        for(T &d : inverse_diagonal) {
+            if(d == T(0)) {
+                throw degenerate_matrix_error();
+            }
+            d = T(1) / d;
+        }
+    }
+
+    inline void apply(const T *r, T *z, size_t n) const {
+        assert(n == inverse_diagonal.size());
+        for(size_t i = 0; i < n; ++ i)
+            z[i] = r[i] * inverse_diagonal[i];
+    }
+};
+
+/**
+ *  ilu0_preconditioner class, the incomplete LU factorization with no fill: L and U keep the
+ *  sparsity pattern of A, and applying the preconditioner is one forward and one backward
+ *  substitution over it.
+ *
+ *  @param T the data type of the system.
+ */
+
+template <typename T = double>
+class ilu0_preconditioner {
+
+    private:
+
+    sparse_matrix<T> factors;
+
+    /**
+     *  The position of each diagonal entry in the factors' values.
+     */
+
+    std::vector<size_t> diagonal;
+
+    public:
+
+    /**
+     *  Constructor for an ilu0_preconditioner.
+     *
+     *  @param A the square system matrix; every diagonal entry must be stored.
+     *  @throws degenerate_matrix_error if a pivot is zero
+     */
+
+    inline explicit ilu0_preconditioner(const sparse_matrix<T> &A) : factors(A), diagonal(A.rows()) {
+        assert(A.rows() == A.columns());
+
+        const size_t n = A.rows();
+        const size_t *offsets = factors.row_offsets(), *indices = factors.column_indices();
+        T *values = factors.values();
+
+        // position[j] is the index of entry (i, j) of the current row, or npos.
+
+        const size_t npos = size_t(-1);
+        std::vector<size_t> position(n, npos);
+
+        for(size_t i = 0; i < n; ++ i) {
+            for(size_t p = offsets[i]; p < offsets[i + 1]; ++ p)
+                position[indices[p]] = p;
+            if(position[i] == npos) {
+                throw degenerate_matrix_error();
+            }
+            diagonal[i] = position[i];
+
+            for(size_t p = offsets[i]; p < offsets[i + 1] && indices[p] < i; ++ p) {
+                const size_t k = indices[p];
+                values[p] /= values[diagonal[k]];
+                for(size_t q = diagonal[k] + 1; q < offsets[k + 1]; ++ q) {
+                    if(position[indices[q]] != npos) {
+                        values[position[indices[q]]] -= values[p] * values[q];
+                    }
+                }
+            }
+
+            if(values[diagonal[i]] == T(0)) {
+                throw degenerate_matrix_error();
+            }
+            for(size_t p = offsets[i]; p < offsets[i + 1]; ++ p)
+                position[indices[p]] = npos;
+        }
+    }
+
+    /**
+     *  Constructor for an ilu0_preconditioner of a dense matrix, over its nonzeros.
+     *
+     *  @param A the square system matrix.
+     */
+
+    inline explicit ilu0_preconditioner(const matrix<T> &A) : ilu0_preconditioner(sparse_matrix<T>(A)) {}
+
+    /**
+     *  Solves L U z = r.
+     */
+
+    inline void apply(const T *r, T *z, size_t n) const {
+        assert(n == factors.rows());
+        const size_t *offsets = factors.row_offsets(), *indices = factors.column_indices();
+        const T *values = factors.values();
+
+        for(size_t i = 0; i < n; ++ i) {
+            T s = r[i];
+            for(size_t p = offsets[i]; p < diagonal[i]; ++ p)
+                s -= values[p] * z[indices[p]];
+            z[i] = s;
+        }
+        for(size_t i = n; i -- > 0;) {
+            T s = z[i];
+            for(size_t p = diagonal[i] + 1; p < offsets[i + 1]; ++ p)
+                s -= values[p] * z[indices[p]];
+            z[i] = s / values[diagonal[i]];
+        }
+    }
+};
+
+/**
+ *  Solves A x = b by the (preconditioned) conjugate gradient method, for symmetric positive
+ *  definite A. Each iteration costs one product with A and one application of the
+ *  preconditioner, which must be symmetric positive definite too.
+ *
+ *  @param A the system matrix, a matrix<T> or sparse_matrix<T>.
+ *  @param b the right-hand side.
+ *  @param x the initial guess (a warm start); overwritten with the solution. Resized to
+ *  b.size(), with zeros, if its size differs.
+ *  @param options the tolerance and iteration limit.
+ *  @param preconditioner the preconditioner: identity_preconditioner, jacobi_preconditioner,
+ *  ilu0_preconditioner, or any type with apply(r, z, n) computing z = M^-1 r.
+ *  @return the number of iterations, the final relative residual and whether it converged.
+ */
+
+template <typename M, typename T, typename P = identity_preconditioner>
+iterative_result<T> conjugate_gradient(const M &A, const std::vector<T> &b, std::vector<T> &x,
+                                       const iterative_options<T> &options = iterative_options<T>(),
+                                       const P &preconditioner = P()) {
+    const size_t n = b.size();
+    assert(A.rows() == n && A.columns() == n);
+    if(x.size() != n) {
+        x.assign(n, T(0));
+    }
+
+    iterative_result<T> result;
+    const T scale = algebra_detail::norm(b);
+    if(scale == T(0)) {
+        std::fill(x.begin(), x.end(), T(0));
+        result.converged = true;
+        return result;
+    }
+
+    std::vector<T> r(n), z(n), p(n), q(n);
+    algebra_detail::apply_operator(A, x.data(), q.data());
+    for(size_t i = 0; i < n; ++ i)
+        r[i] = b[i] - q[i];
+
+    result.residual = algebra_detail::norm(r) / scale;
+    if(result.residual <= options.tolerance) {
+        result.converged = true;
+        return result;
+    }
+
+    preconditioner.apply(r.data(), z.data(), n);
+    p = z;
+    T rho = simd_dot(n, r.data(), z.data());
+
+    while(result.iterations < options.max_iterations) {
+        ++ result.iterations;
+
+        algebra_detail::apply_operator(A, p.data(), q.data());
+        const T alpha = rho / simd_dot(n, p.data(), q.data());
+        simd_axpy(n, alpha, p.data(), x.data());
+        simd_axpy(n, -alpha, q.data(), r.data());
+
+        result.residual = algebra_detail::norm(r) / scale;
+        if(result.residual <= options.tolerance) {
+            result.converged = true;
+            break;
+        }
+
+        preconditioner.apply(r.data(), z.data(), n);
+        const T rho_next = simd_dot(n, r.data(), z.data());
+        const T beta = rho_next / rho;
+        rho = rho_next;
+        for(size_t i = 0; i < n; ++ i)
+            p[i] = z[i] + beta * p[i];
+    }
+
+    return result;
+}
+
+/**
+ *  Solves A x = b by the (right-preconditioned) BiCGSTAB method, for general square A. Each
+ *  iteration costs two products with A and two applications of the preconditioner.
+ *
+ *  @param A the system matrix, a matrix<T> or sparse_matrix<T>.
+ *  @param b the right-hand side.
+ *  @param x the initial guess (a warm start); overwritten with the solution. Resized to
+ *  b.size(), with zeros, if its size differs.
+ *  @param options the tolerance and iteration limit.
+ *  @param preconditioner the preconditioner: identity_preconditioner, jacobi_preconditioner,
+ *  ilu0_preconditioner, or any type with apply(r, z, n) computing z = M^-1 r.
+ *  @return the number of iterations, the final relative residual and whether it converged;
+ *  a breakdown of the recurrence ends the solve unconverged.
+ */
+
+template <typename M, typename T, typename P = identity_preconditioner>
+iterative_result<T> bicgstab(const M &A, const std::vector<T> &b, std::vector<T> &x,
+                             const iterative_options<T> &options = iterative_options<T>(),
+                             const P &preconditioner = P()) {
+    const size_t n = b.size();
+    assert(A.rows() == n && A.columns() == n);
+    if(x.size() != n) {
+        x.assign(n, T(0));
+    }
+
+    iterative_result<T> result;
+    const T scale = algebra_detail::norm(b);
+    if(scale == T(0)) {
+        std::fill(x.begin(), x.end(), T(0));
+        result.converged = true;
+        return result;
+    }
+
+    std::vector<T> r(n), shadow(n), p(n, T(0)), v(n, T(0)), y(n), s(n), z(n), t(n);
+    algebra_detail::apply_operator(A, x.data(), t.data());
+    for(size_t i = 0; i < n; ++ i)
+        r[i] = b[i] - t[i];
+    shadow = r;
+
+    result.residual = algebra_detail::norm(r) / scale;
+    if(result.residual <= options.tolerance) {
+        result.converged = true;
+        return result;
+    }
+
+    T rho = T(1), alpha = T(1), omega = T(1);
+
+    while(result.iterations < options.max_iterations) {
+        ++ result.iterations;
+
+        const T rho_next = simd_dot(n, shadow.data(), r.data());
+        if(rho_next == T(0) || omega == T(0)) {
+            break;
+        }
+        const T beta = rho_next / rho * (alpha / omega);
+        rho = rho_next;
+        for(size_t i = 0; i < n; ++ i)
+            p[i] = r[i] + beta * (p[i] - omega * v[i]);
+
+        preconditioner.apply(p.data(), y.data(), n);
+        algebra_detail::apply_operator(A, y.data(), v.data());
+        alpha = rho / simd_dot(n, shadow.data(), v.data());
+        for(size_t i = 0; i < n; ++ i)
+            s[i] = r[i] - alpha * v[i];
+
+        if(algebra_detail::norm(s) / scale <= options.tolerance) {
+            simd_axpy(n, alpha, y.data(), x.data());
+            result.residual = algebra_detail::norm(s) / scale;
+            result.converged = true;
+            break;
+        }
+
+        preconditioner.apply(s.data(), z.data(), n);
+        algebra_detail::apply_operator(A, z.data(), t.data());
+        const T tt = simd_dot(n, t.data(), t.data());
+        omega = tt == T(0) ? T(0) : simd_dot(n, t.data(), s.data()) / tt;
+
+        simd_axpy(n, alpha, y.data(), x.data());
+        simd_axpy(n, omega, z.data(), x.data());
+        for(size_t i = 0; i < n; ++ i)
+            r[i] = s[i] - omega * t[i];
+
+        result.residual = algebra_detail::norm(r) / scale;
+        if(result.residual <= options.tolerance) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    return result;
+}
+
+/**
+ *  Solves A x = b by restarted, right-preconditioned GMRES, for general square A. Each
+ *  iteration costs one product with A and one application of the preconditioner, and keeps
+ *  one more basis vector, up to options.restart of them; the residual it tracks is that of
+ *  the unpreconditioned system.
+ *
+ *  @param A the system matrix, a matrix<T> or sparse_matrix<T>.
+ *  @param b the right-hand side.
+ *  @param x the initial guess (a warm start); overwritten with the solution. Resized to
+ *  b.size(), with zeros, if its size differs.
+ *  @param options the tolerance, iteration limit and restart length.
+ *  @param preconditioner the preconditioner: identity_preconditioner, jacobi_preconditioner,
+ *  ilu0_preconditioner, or any type with apply(r, z, n) computing z = M^-1 r.
+ *  @return the number of iterations, the final relative residual and whether it converged.
+ */
+
+template <typename M, typename T, typename P = identity_preconditioner>
+iterative_result<T> gmres(const M &A, const std::vector<T> &b, std::vector<T> &x,
+                          const iterative_options<T> &options = iterative_options<T>(),
+                          const P &preconditioner = P()) {
+    const size_t n = b.size();
+    assert(A.rows() == n && A.columns() == n);
+    if(x.size() != n) {
+        x.assign(n, T(0));
+    }
+
+    iterative_result<T> result;
+    const T scale = algebra_detail::norm(b);
+    if(scale == T(0)) {
+        std::fill(x.begin(), x.end(), T(0));
+        result.converged = true;
+        return result;
+    }
+
+    const size_t m = std::max<size_t>(1, options.restart);
+
+    // basis holds the m + 1 Arnoldi vectors, h the Hessenberg matrix (column j at h[j * (m + 1)]),
+    // and the Givens rotations cs, sn reduce it to triangular form as it grows.
+
+    std::vector<T> basis((m + 1) * n), h(m * (m + 1)), cs(m), sn(m), g(m + 1), w(n), z(n);
+
+    for(;;) {
+        algebra_detail::apply_operator(A, x.data(), w.data());
+        for(size_t i = 0; i < n; ++ i)
+            w[i] = b[i] - w[i];
+        T beta = algebra_detail::norm(w);
+        result.residual = beta / scale;
+        if(result.residual <= options.tolerance) {
+            result.converged = true;
+            return result;
+        }
+        if(result.iterations >= options.max_iterations) {
+            return result;
+        }
+
+        for(size_t i = 0; i < n; ++ i)
+            basis[i] = w[i] / beta;
+        std::fill(g.begin(), g.end(), T(0));
+        g[0] = beta;
+
+        size_t k = 0;
+        while(k < m && result.iterations < options.max_iterations) {
+            ++ result.iterations;
+
+            preconditioner.apply(basis.data() + k * n, z.data(), n);
+            algebra_detail::apply_operator(A, z.data(), w.data());
+
+            T *hk = h.data() + k * (m + 1);
+            for(size_t j = 0; j <= k; ++ j) {
+                hk[j] = simd_dot(n, w.data(), basis.data() + j * n);
+                simd_axpy(n, -hk[j], basis.data() + j * n, w.data());
+            }
+            hk[k + 1] = algebra_detail::norm(w);
+            if(hk[k + 1] != T(0)) {
+                for(size_t i = 0; i < n; ++ i)
+                    basis[(k + 1) * n + i] = w[i] / hk[k + 1];
+            }
+
+            for(size_t j = 0; j < k; ++ j) {
+                const T a = hk[j], c = hk[j + 1];
+                hk[j] = cs[j] * a + sn[j] * c;
+                hk[j + 1] = -sn[j] * a + cs[j] * c;
+            }
+            const T d = std::hypot(hk[k], hk[k + 1]);
+            cs[k] = d == T(0) ? T(1) : hk[k] / d;
+            sn[k] = d == T(0) ? T(0) : hk[k + 1] / d;
+            hk[k] = d;
+            hk[k + 1] = T(0);
+            g[k + 1] = -sn[k] * g[k];
+            g[k] = cs[k] * g[k];
+            ++ k;
+
+            if(std::abs(g[k]) / scale <= options.tolerance || d == T(0)) {
+                break;
+            }
+        }
+
+        // Back-substitute for the coefficients of the basis, then apply the preconditioner once
+        // to their combination.
+
+        for(size_t j = k; j -- > 0;) {
+            T s = g[j];
+            for(size_t l = j + 1; l < k; ++ l)
+                s -= h[l * (m + 1) + j] * g[l];
+            g[j] = h[j * (m + 1) + j] == T(0) ? T(0) : s / h[j * (m + 1) + j];
+        }
+        std::fill(w.begin(), w.end(), T(0));
+        for(size_t j = 0; j < k; ++ j)
+            simd_axpy(n, g[j], basis.data() + j * n, w.data());
+        preconditioner.apply(w.data(), z.data(), n);
+        simd_axpy(n, T(1), z.data(), x.data());
+    }
+}
+
+#endif
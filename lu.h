@@ -0,0 +1,220 @@
+/**
+ *  lu.h
+ *  Purpose: LU factorization with partial pivoting, for repeated solves against one matrix
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef LU_H
+
+#define LU_H
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "elimination.h"
+#include "matrix.h"
+
+/**
+ *  lu_decomposition class, factors a square matrix once as P A = L U and reuses the factors
+ *  for solves, the determinant and the inverse.
+ *
+ *  @param T the data type the factorization is computed in.
+ */
+
+template <typename T = long double>
+class lu_decomposition {
+
+    private:
+
+    matrix<T> lu;
+    std::vector<size_t> pivots;
+    size_t first_zero_pivot = 0;
+
+    inline void require_nonsingular() const {
+        if(singular()) {
+            throw degenerate_matrix_error();
+        }
+    }
+
+    public:
+
+    /**
+     *  Constructor for an lu_decomposition. Factors a.
+     *
+     *  @param a the square matrix to factor.
+     */
+
+    template <typename U, typename A>
+    inline explicit lu_decomposition(const matrix<U, A> &a) : lu(a), pivots(a.rows()) {
+        assert(a.rows() == a.columns());
+        first_zero_pivot = lu_factor(lu.rows(), lu.data(), lu.stride(), pivots.data());
+    }
+
+    /**
+     *  Constructor for an lu_decomposition of a block or an external buffer. Its entries are
+     *  copied once, into the factors.
+     *
+     *  @param a the square view to factor.
+     */
+
+    template <typename U>
+    inline explicit lu_decomposition(const matrix_view<U> &a) : lu(a), pivots(a.rows()) {
+        assert(a.rows() == a.columns());
+        first_zero_pivot = lu_factor(lu.rows(), lu.data(), lu.stride(), pivots.data());
+    }
+
+    template <typename U>
+    inline explicit lu_decomposition(const matrix_ref<U> &a) : lu_decomposition(matrix_view<U>(a)) {}
+
+    /**
+     *  Retrieves the order of the factored matrix.
+     *
+     *  @return the number of rows (and columns) of the factored matrix.
+     */
+
+    inline size_t size() const {
+        return lu.rows();
+    }
+
+    /**
+     *  Checks whether the factored matrix is singular.
+     *
+     *  @return true if U has a zero on its diagonal.
+     */
+
+    inline bool singular() const {
+        return first_zero_pivot < size();
+    }
+
+    /**
+     *  Retrieves the packed factors: L below the diagonal (with an implied unit diagonal) and U
+     *  on and above it.
+     *
+     *  @return the combined L and U factors.
+     */
+
+    inline const matrix<T> &factors() const {
+        return lu;
+    }
+
+    /**
+     *  Retrieves the row exchanges: row i was swapped with row permutation()[i] at step i.
+     *
+     *  @return the pivot indices.
+     */
+
+    inline const std::vector<size_t> &permutation() const {
+        return pivots;
+    }
+
+    /**
+     *  Solves A x = b for one right-hand side.
+     *
+     *  @param b the right-hand side.
+     *  @return the solution x.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    inline std::vector<T> solve(std::vector<T> b) const {
+        assert(b.size() == size());
+        require_nonsingular();
+
+        lu_solve(size(), lu.data(), lu.stride(), pivots.data(), 1, b.data(), 1);
+
+        return b;
+    }
+
+    /**
+     *  Solves A X = B for every column of B.
+     *
+     *  @param B the right-hand sides, one per column.
+     *  @return the solutions X, one per column.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    template <typename A>
+    inline matrix<T, A> solve(const matrix<T, A> &B) const {
+        matrix<T, A> X(B);
+
+        solve_in_place(X);
+
+        return X;
+    }
+
+    /**
+     *  Solves A X = B for every column of B, overwriting B with X.
+     *
+     *  @param B the right-hand sides, one per column; replaced by the solutions.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    template <typename A>
+    inline void solve_in_place(matrix<T, A> &B) const {
+        assert(B.rows() == size());
+        require_nonsingular();
+
+        lu_solve(size(), lu.data(), lu.stride(), pivots.data(), B.columns(), B.data(), B.stride());
+    }
+
+    /**
+     *  Computes the determinant from the diagonal of U and the parity of the row exchanges.
+     *
+     *  @return the determinant of the factored matrix.
+     */
+
+    inline T determinant() const {
+        T res = T(1);
+        bool negate = false;
+
+        for(size_t i = 0; i < size(); ++ i) {
+            res = res * lu(i,i);
+            negate ^= pivots[i] != i;
+        }
+
+        return negate ? -res : res;
+    }
+
+    /**
+     *  Computes the sign and log|det| from the diagonal of U, without overflow.
+     *
+     *  @return the sign (-1, 0 or 1) and the natural logarithm of |det|.
+     */
+
+    inline log_det<T> log_determinant() const {
+        if(singular()) {
+            return {T(0), -std::numeric_limits<T>::infinity()};
+        }
+
+        log_det<T> ret = {T(1), T(0)};
+
+        for(size_t i = 0; i < size(); ++ i) {
+            if((lu(i,i) < T(0)) != (pivots[i] != i)) {
+                ret.sign = -ret.sign;
+            }
+            ret.log_abs = ret.log_abs + std::log(std::abs(lu(i,i)));
+        }
+
+        return ret;
+    }
+
+    /**
+     *  Computes the inverse by solving against the identity.
+     *
+     *  @return the inverse of the factored matrix.
+     *  @throws degenerate_matrix_error if the matrix is singular
+     */
+
+    inline matrix<T> inverse() const {
+        matrix<T> ret = matrix<T>::identity(size());
+
+        solve_in_place(ret);
+
+        return ret;
+    }
+};
+
+#endif
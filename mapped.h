@@ -0,0 +1,605 @@
+/**
+ *  mapped.h
+ *  Purpose: a binary file format for matrices, memory-mapped loading, stores and out-of-core
+ *  products and factorizations
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef MAPPED_H
+
+#define MAPPED_H
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "allocator.h"
+#include "elimination.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "view.h"
+
+/**
+ *  The memory, in bytes, the out-of-core routines keep in use by default: the panels they
+ *  copy into memory plus the pages of the files they are working through.
+ */
+
+constexpr size_t out_of_core_budget = size_t(1) << 30;
+
+/**
+ *  The element types a matrix file can hold, as stored in its header.
+ */
+
+enum class matrix_file_type : uint32_t {
+    int32 = 1,
+    int64 = 2,
+    uint32 = 3,
+    uint64 = 4,
+    float32 = 5,
+    float64 = 6,
+    complex64 = 7,
+    complex128 = 8
+};
+
+/**
+ *  The order entries are stored in. Only row-major files are written so far; the field lets
+ *  readers reject layouts they do not know.
+ */
+
+enum class matrix_file_layout : uint32_t {
+    row_major = 0
+};
+
+/**
+ *  matrix_file_header struct, the first 64 bytes of a matrix file. The entries follow at
+ *  data_offset, row after row, each row starting stride entries after the previous one, so
+ *  that a mapped file can be used in place with the same alignment as a matrix. Fields are
+ *  in the byte order of the machine that wrote the file, which byte_order records.
+ */
+
+struct matrix_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t type;
+    uint32_t layout;
+    uint64_t rows;
+    uint64_t columns;
+    uint64_t stride;
+    uint64_t alignment;
+    uint64_t data_offset;
+};
+
+static_assert(sizeof(matrix_file_header) == 64, "matrix_file_header must take 64 bytes");
+
+/**
+ *  matrix_file_error class, thrown when a matrix file cannot be opened, created or mapped, or
+ *  does not hold what the reader asked for.
+ */
+
+class matrix_file_error : public std::runtime_error {
+
+    public:
+
+    inline explicit matrix_file_error(const std::string &message) : std::runtime_error(message) {}
+};
+
+namespace algebra_detail {
+
+constexpr char matrix_file_magic[8] = {'A', 'L', 'G', 'M', 'A', 'T', 'R', 'X'};
+constexpr uint32_t matrix_file_version = 1;
+constexpr uint32_t matrix_file_byte_order = 0x01020304;
+
+template <typename T>
+struct matrix_file_type_of;
+
+template <>
+struct matrix_file_type_of<int32_t> : std::integral_constant<matrix_file_type, matrix_file_type::int32> {};
+
+template <>
+struct matrix_file_type_of<int64_t> : std::integral_constant<matrix_file_type, matrix_file_type::int64> {};
+
+template <>
+struct matrix_file_type_of<uint32_t> : std::integral_constant<matrix_file_type, matrix_file_type::uint32> {};
+
+template <>
+struct matrix_file_type_of<uint64_t> : std::integral_constant<matrix_file_type, matrix_file_type::uint64> {};
+
+template <>
+struct matrix_file_type_of<float> : std::integral_constant<matrix_file_type, matrix_file_type::float32> {};
+
+template <>
+struct matrix_file_type_of<double> : std::integral_constant<matrix_file_type, matrix_file_type::float64> {};
+
+template <>
+struct matrix_file_type_of<std::complex<float>>
+    : std::integral_constant<matrix_file_type, matrix_file_type::complex64> {};
+
+template <>
+struct matrix_file_type_of<std::complex<double>>
+    : std::integral_constant<matrix_file_type, matrix_file_type::complex128> {};
+
+inline matrix_file_error file_error(const std::string &path, const std::string &what) {
+    return matrix_file_error(path + ": " + what);
+}
+
+inline matrix_file_error os_error(const std::string &path, const char *call) {
+    return file_error(path, std::string(call) + " failed: " + std::strerror(errno));
+}
+
+/**
+ *  Rounds [begin, end) out to whole pages, the granularity madvise works in.
+ */
+
+inline std::pair<char *, size_t> page_range(const void *begin, const void *end) {
+    const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t first = uintptr_t(begin) / page * page;
+    const uintptr_t last = (uintptr_t(end) + page - 1) / page * page;
+    return {reinterpret_cast<char *>(first), size_t(last - first)};
+}
+
+}
+
+/**
+ *  mapped_matrix class, a matrix file mapped into memory. Opening a file reads and checks its
+ *  header and nothing else: the entries are paged in from the file as they are touched, so a
+ *  matrix of any size is ready at once and can be larger than memory. view() (and, for
+ *  writable mappings, ref()) hand the entries to any routine that takes a matrix_view or a
+ *  matrix_ref, with rows aligned like those of a matrix. Uses the POSIX mmap interface.
+ *
+ *  @param T the data type of the entries; must match the type recorded in the file.
+ */
+
+template <typename T>
+class mapped_matrix {
+
+    private:
+
+    void *base = nullptr;
+    size_t length = 0;
+    T *pointer = nullptr;
+    size_t n_rows = 0;
+    size_t n_columns = 0;
+    size_t row_stride = 0;
+    bool can_write = false;
+
+    inline mapped_matrix(const std::string &path, int fd, size_t bytes, bool writable) : length(bytes), can_write(writable) {
+        base = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        const int error = errno;
+        close(fd);
+        if(base == MAP_FAILED) {
+            base = nullptr;
+            errno = error;
+            throw algebra_detail::os_error(path, "mmap");
+        }
+    }
+
+    inline void attach(const matrix_file_header &h) {
+        pointer = reinterpret_cast<T *>(static_cast<char *>(base) + h.data_offset);
+        n_rows = size_t(h.rows);
+        n_columns = size_t(h.columns);
+        row_stride = size_t(h.stride);
+    }
+
+    /**
+     *  Checks that a header describes entries of type T that fit in a file of the given size.
+     */
+
+    static inline void check(const std::string &path, const matrix_file_header &h, size_t bytes) {
+        using namespace algebra_detail;
+        if(std::memcmp(h.magic, matrix_file_magic, sizeof(h.magic)) != 0) {
+            throw file_error(path, "not a matrix file");
+        }
+        if(h.byte_order != matrix_file_byte_order) {
+            throw file_error(path, "written with a different byte order");
+        }
+        if(h.version != matrix_file_version) {
+            throw file_error(path, "unsupported version " + std::to_string(h.version));
+        }
+        if(h.type != uint32_t(matrix_file_type_of<T>::value)) {
+            throw file_error(path, "holds entries of another type");
+        }
+        if(h.layout != uint32_t(matrix_file_layout::row_major)) {
+            throw file_error(path, "unsupported layout " + std::to_string(h.layout));
+        }
+        if(h.alignment == 0 || h.data_offset % h.alignment != 0 || h.data_offset < sizeof(matrix_file_header) ||
+           h.data_offset % alignof(T) != 0 || (h.rows > 1 && h.stride < h.columns)) {
+            throw file_error(path, "corrupt header");
+        }
+        if(h.data_offset > bytes) {
+            throw file_error(path, "truncated");
+        }
+        const uint64_t available = (bytes - h.data_offset) / sizeof(T);
+        if(h.rows > 0 && (h.columns > available || (h.stride > 0 && h.rows - 1 > (available - h.columns) / h.stride))) {
+            throw file_error(path, "truncated");
+        }
+    }
+
+    public:
+
+    typedef T value_type;
+
+    /**
+     *  Empty constructor, maps nothing.
+     */
+
+    inline mapped_matrix() = default;
+
+    /**
+     *  Constructor for a mapping of an existing matrix file. Only the header is read.
+     *
+     *  @param path the file to map.
+     *  @param writable whether entries may be changed through ref(); changes go to the file.
+     *  @throws matrix_file_error if the file cannot be mapped or does not hold a matrix of T.
+     */
+
+    inline explicit mapped_matrix(const std::string &path, bool writable = false) {
+        const int fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if(fd < 0) {
+            throw algebra_detail::os_error(path, "open");
+        }
+        struct stat st;
+        if(fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(matrix_file_header)) {
+            close(fd);
+            throw algebra_detail::file_error(path, "not a matrix file");
+        }
+
+        // The mapping is only moved into this once checked: a constructor that throws never
+        // runs its destructor, so this would keep the file mapped.
+
+        mapped_matrix mapping(path, fd, size_t(st.st_size), writable);
+
+        matrix_file_header h;
+        std::memcpy(&h, mapping.base, sizeof(h));
+        check(path, h, mapping.length);
+        mapping.attach(h);
+        *this = std::move(mapping);
+    }
+
+    /**
+     *  Creates (or truncates) a matrix file of the given shape and maps it writable. Entries
+     *  start as zero and take no disk space until they are written.
+     *
+     *  @param path the file to create.
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @return the writable mapping.
+     *  @throws matrix_file_error if the file cannot be created or mapped.
+     */
+
+    static inline mapped_matrix create(const std::string &path, size_t Rows, size_t Columns) {
+        using namespace algebra_detail;
+        matrix_file_header h = {};
+        std::memcpy(h.magic, matrix_file_magic, sizeof(h.magic));
+        h.version = matrix_file_version;
+        h.byte_order = matrix_file_byte_order;
+        h.type = uint32_t(matrix_file_type_of<T>::value);
+        h.layout = uint32_t(matrix_file_layout::row_major);
+        h.rows = Rows;
+        h.columns = Columns;
+        h.stride = padded_stride<T>(Columns);
+        h.alignment = buffer_alignment;
+        h.data_offset = std::max<size_t>(sizeof(matrix_file_header), buffer_alignment);
+
+        const size_t bytes = size_t(h.data_offset) + Rows * size_t(h.stride) * sizeof(T);
+        const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            throw os_error(path, "open");
+        }
+        if(ftruncate(fd, off_t(bytes)) != 0) {
+            const int error = errno;
+            close(fd);
+            errno = error;
+            throw os_error(path, "ftruncate");
+        }
+
+        mapped_matrix ret(path, fd, bytes, true);
+        std::memcpy(ret.base, &h, sizeof(h));
+        ret.attach(h);
+        return ret;
+    }
+
+    mapped_matrix(const mapped_matrix &) = delete;
+    mapped_matrix &operator = (const mapped_matrix &) = delete;
+
+    inline mapped_matrix(mapped_matrix &&m) noexcept
+        : base(std::exchange(m.base, nullptr)), length(std::exchange(m.length, 0)),
+          pointer(std::exchange(m.pointer, nullptr)), n_rows(std::exchange(m.n_rows, 0)),
+          n_columns(std::exchange(m.n_columns, 0)), row_stride(std::exchange(m.row_stride, 0)),
+          can_write(std::exchange(m.can_write, false)) {}
+
+    inline mapped_matrix &operator = (mapped_matrix &&m) noexcept {
+        std::swap(base, m.base);
+        std::swap(length, m.length);
+        std::swap(pointer, m.pointer);
+        std::swap(n_rows, m.n_rows);
+        std::swap(n_columns, m.n_columns);
+        std::swap(row_stride, m.row_stride);
+        std::swap(can_write, m.can_write);
+        return *this;
+    }
+
+    /**
+     *  Unmaps the file. Changes made through a writable mapping are written back by the
+     *  system; call flush() first to wait for them.
+     */
+
+    inline ~mapped_matrix() {
+        if(base != nullptr) {
+            munmap(base, length);
+        }
+    }
+
+    inline size_t rows() const {
+        return n_rows;
+    }
+
+    inline size_t columns() const {
+        return n_columns;
+    }
+
+    inline size_t stride() const {
+        return row_stride;
+    }
+
+    inline bool writable() const {
+        return can_write;
+    }
+
+    inline const T *data() const {
+        return pointer;
+    }
+
+    /**
+     *  Views the mapped entries. The view is valid while the mapping is.
+     *
+     *  @return a read-only view of every entry.
+     */
+
+    inline matrix_view<T> view() const {
+        return matrix_view<T>(pointer, n_rows, n_columns, row_stride);
+    }
+
+    /**
+     *  Refers to the mapped entries of a writable mapping; assigning to the result writes to
+     *  the file.
+     *
+     *  @return a writable reference to every entry.
+     */
+
+    inline matrix_ref<T> ref() {
+        assert(can_write);
+        return matrix_ref<T>(pointer, n_rows, n_columns, row_stride);
+    }
+
+    inline operator matrix_view<T>() const {
+        return view();
+    }
+
+    /**
+     *  Writes the changes made through a writable mapping to the file, and waits for them.
+     *
+     *  @throws matrix_file_error if the write fails.
+     */
+
+    inline void flush() const {
+        if(can_write && base != nullptr && msync(base, length, MS_SYNC) != 0) {
+            throw matrix_file_error(std::string("msync failed: ") + std::strerror(errno));
+        }
+    }
+
+    /**
+     *  Asks for the rows [r0, r1) to be read ahead of use.
+     */
+
+    inline void prefetch_rows(size_t r0, size_t r1) const {
+        if(r0 < r1) {
+            const auto range = algebra_detail::page_range(pointer + r0 * row_stride, pointer + (r1 - 1) * row_stride + n_columns);
+            madvise(range.first, range.second, MADV_WILLNEED);
+        }
+    }
+
+    /**
+     *  Lets the system reclaim the memory holding the rows [r0, r1), starting to write back any
+     *  changes to them. Their entries are unchanged, and are read back from the file (or the
+     *  page cache) when next touched.
+     */
+
+    inline void evict_rows(size_t r0, size_t r1) const {
+        if(r0 < r1) {
+            const auto range = algebra_detail::page_range(pointer + r0 * row_stride, pointer + (r1 - 1) * row_stride + n_columns);
+            if(can_write) {
+                msync(range.first, range.second, MS_ASYNC);
+            }
+            madvise(range.first, range.second, MADV_DONTNEED);
+        }
+    }
+};
+
+/**
+ *  Writes a matrix, a view or a block to a matrix file.
+ *
+ *  @param path the file to write; replaced if it exists.
+ *  @param m the entries to write.
+ *  @throws matrix_file_error if the file cannot be written.
+ */
+
+template <typename T>
+void write_matrix(const std::string &path, const matrix_view<T> &m) {
+    mapped_matrix<T> out = mapped_matrix<T>::create(path, m.rows(), m.columns());
+    out.ref() = m;
+    out.flush();
+}
+
+template <typename T>
+void write_matrix(const std::string &path, const matrix_ref<T> &m) {
+    write_matrix(path, matrix_view<T>(m));
+}
+
+template <typename T, typename A>
+void write_matrix(const std::string &path, const matrix<T, A> &m) {
+    write_matrix(path, m.view());
+}
+
+/**
+ *  Reads a matrix file into memory, through a mapping: rows are copied straight out of the
+ *  file with no parsing. Use mapped_matrix to work on the file without copying it.
+ *
+ *  @param path the file to read.
+ *  @return the matrix stored in the file.
+ *  @throws matrix_file_error if the file cannot be read or does not hold a matrix of T.
+ */
+
+template <typename T>
+matrix<T> read_matrix(const std::string &path) {
+    const mapped_matrix<T> in(path);
+    return matrix<T>(in.view());
+}
+
+/**
+ *  Multiplies matrices stored in files, out = a * b, when they do not fit in memory. The
+ *  rows of out are produced a panel at a time: each panel of a is read once, b is streamed
+ *  through in row panels (contiguous in the file) for each of them, and finished panels are
+ *  written back and evicted, so roughly budget bytes are in use whatever the sizes.
+ *
+ *  @param out a writable mapping of shape a.rows() x b.columns(); must not be a or b.
+ *  @param a the left operand.
+ *  @param b the right operand.
+ *  @param budget the memory to work in, in bytes.
+ */
+
+template <typename T>
+void multiply_out_of_core(mapped_matrix<T> &out, const mapped_matrix<T> &a, const mapped_matrix<T> &b,
+                          size_t budget = out_of_core_budget) {
+    assert(a.columns() == b.rows());
+    assert(out.rows() == a.rows() && out.columns() == b.columns());
+
+    const size_t M = a.rows(), N = b.columns(), K = a.columns();
+    if(M == 0 || N == 0) {
+        return;
+    }
+    if(K == 0) {
+        out.ref().fill(T(0));
+        return;
+    }
+
+    const size_t kb = std::min(K, std::max<size_t>(1, budget / (4 * N * sizeof(T))));
+    const size_t mb = std::min(M, std::max<size_t>(1, budget / (2 * (N + K) * sizeof(T))));
+    T *C = out.ref().data();
+
+    for(size_t i0 = 0; i0 < M; i0 += mb) {
+        const size_t ib = std::min(mb, M - i0);
+        a.prefetch_rows(i0, i0 + ib);
+        for(size_t k0 = 0; k0 < K; k0 += kb) {
+            const size_t kk = std::min(kb, K - k0);
+            b.prefetch_rows(k0 + kk, std::min(K, k0 + kk + kb));
+            gemm(ib, N, kk, T(1), a.data() + i0 * a.stride() + k0, a.stride(), b.data() + k0 * b.stride(),
+                 b.stride(), k0 == 0 ? T(0) : T(1), C + i0 * out.stride(), out.stride());
+            if(mb < M) {
+                b.evict_rows(k0, k0 + kk);
+            }
+        }
+        a.evict_rows(i0, i0 + ib);
+        out.evict_rows(i0, i0 + ib);
+    }
+}
+
+/**
+ *  Factors a square matrix stored in a file in place as P A = L U, with partial pivoting,
+ *  when it does not fit in memory. The matrix is worked through in column slabs as wide as
+ *  the budget allows: each slab is copied into memory and factored there, its row
+ *  exchanges are applied to the rest of the file, the matching rows of U are solved, and
+ *  the trailing matrix is updated a panel of rows at a time. Every slab takes one pass over
+ *  the trailing matrix, so a larger budget means fewer passes. The factors and pivots are
+ *  laid out as lu_factor leaves them, so lu_solve can use them.
+ *
+ *  @param a a writable mapping of the matrix to factor; overwritten with L and U.
+ *  @param pivots receives a.rows() row indices: row i was exchanged with row pivots[i].
+ *  @param budget the memory to work in, in bytes.
+ *  @return the first step with a zero pivot, or a.rows() if the matrix is nonsingular.
+ */
+
+template <typename T>
+size_t lu_factor_out_of_core(mapped_matrix<T> &a, size_t *pivots, size_t budget = out_of_core_budget) {
+    assert(a.rows() == a.columns());
+
+    const size_t n = a.rows(), lda = a.stride();
+    if(n == 0) {
+        return 0;
+    }
+
+    T *A = a.ref().data();
+    const size_t slab = std::min(n, std::max(lu_block_size, budget / (4 * n * sizeof(T)) / lu_block_size * lu_block_size));
+    const size_t mb = std::max<size_t>(1, budget / (4 * n * sizeof(T)));
+    std::vector<T, aligned_allocator<T>> panel(n * slab);
+    size_t singular = n;
+
+    for(size_t k0 = 0; k0 < n; k0 += slab) {
+        const size_t k1 = std::min(n, k0 + slab), w = k1 - k0, m = n - k0;
+
+        // Factor the slab in memory.
+
+        for(size_t i = 0; i < m; ++ i)
+            std::copy(A + (k0 + i) * lda + k0, A + (k0 + i) * lda + k1, panel.data() + i * w);
+        const size_t zero = lu_factor_tall(m, w, panel.data(), w, pivots + k0);
+        if(zero < w) {
+            singular = std::min(singular, k0 + zero);
+        }
+        for(size_t i = 0; i < m; ++ i)
+            std::copy(panel.data() + i * w, panel.data() + (i + 1) * w, A + (k0 + i) * lda + k0);
+
+        // Apply its row exchanges to the columns on either side.
+
+        for(size_t j = k0; j < k1; ++ j) {
+            const size_t p = (pivots[j] += k0);
+            if(p != j) {
+                std::swap_ranges(A + j * lda, A + j * lda + k0, A + p * lda);
+                std::swap_ranges(A + j * lda + k1, A + j * lda + n, A + p * lda + k1);
+            }
+        }
+
+        if(k1 == n) {
+            break;
+        }
+
+        // U12 = L11^-1 A12
+
+        const size_t width = n - k1;
+        for(size_t j = 0; j < w; ++ j) {
+            const T *source = A + (k0 + j) * lda + k1;
+            for(size_t i = j + 1; i < w; ++ i)
+                simd_axpy(width, T(0) - panel[i * w + j], source, A + (k0 + i) * lda + k1);
+        }
+
+        // A22 = A22 - L21 U12, a panel of rows at a time.
+
+        for(size_t r0 = k1; r0 < n; r0 += mb) {
+            const size_t rb = std::min(mb, n - r0);
+            a.prefetch_rows(r0 + rb, std::min(n, r0 + rb + mb));
+            gemm(rb, width, w, T(-1), panel.data() + (r0 - k0) * w, w, A + k0 * lda + k1, lda, T(1),
+                 A + r0 * lda + k1, lda);
+            a.evict_rows(r0, r0 + rb);
+        }
+        a.evict_rows(k0, k1);
+    }
+
+    return singular;
+}
+
+#endif
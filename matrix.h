@@ -13,11 +13,24 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <limits>
+#include <utility>
 #include <vector>
 
+#include "allocator.h"
+#include "elimination.h"
+#include "expression.h"
+#include "gemm.h"
+#include "instrument.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "transpose.h"
+#include "view.h"
+
 /**
  *  degenerate_matrix_error class, thrown whenever one tries to invert a degenerate matrix
  */
@@ -31,21 +44,181 @@ class degenerate_matrix_error : public std::exception {
     }
 };
 
+/**
+ *  log_det class, the determinant of a matrix in a form that cannot overflow: det = sign *
+ *  exp(log_abs).
+ *
+ *  @param T the data type of the result.
+ */
+
+template <typename T>
+struct log_det {
+    T sign;
+    T log_abs;
+};
+
 /**
  *  matrix class, for representation and manipulation of matrices
  *
  *  @param T the data type being stored in the matrix.
+ *  @param Allocator the allocator of the entries, such as arena_allocator<T> to build
+ *  short-lived matrices in a monotonic_arena. Every constructor that allocates takes an
+ *  instance; copies keep the allocator of the matrix they are assigned to.
  */
 
-template <typename T = int>
-class matrix {
+template <typename T, typename Allocator>
+class matrix : public matrix_expression<matrix<T, Allocator>> {
 
     private:
 
-    std::vector<std::vector<T>> data;
+    size_t n_rows = 0;
+    size_t n_columns = 0;
+    size_t row_stride = 0;
+
+    std::vector<T, Allocator> buffer;
+
+    template <typename E>
+    using is_same_matrix = algebra_detail::is_matrix_of<typename std::decay<E>::type, T>;
+
+    template <typename E>
+    struct is_scaled_matrix : std::false_type {};
+
+    template <typename E>
+    struct is_scaled_matrix<matrix_scaled<E>> : is_same_matrix<E> {};
+
+    /**
+     *  Checks if an expression reads this matrix through a transposed view, in which case
+     *  evaluating it in place would read entries that are already overwritten.
+     *
+     *  @param e the expression to evaluate.
+     *  @return true if e must be evaluated into a temporary first, and false otherwise.
+     */
+
+    template <typename E>
+    inline bool transposes_self(const E &e) const {
+        return algebra_detail::reads_transposed(e, data(), data() + rows() * stride());
+    }
+
+    /**
+     *  Writes every entry of an expression of the same shape into this matrix, one row at a
+     *  time. Entry (i,j) of every node but matrix_transposed only depends on entry (i,j) of
+     *  its operands, so e may refer to this matrix, except through a transposed view: callers
+     *  check transposes_self first.
+     *
+     *  @param e the expression to evaluate.
+     */
+
+    template <typename E>
+    inline void assign(const E &e) {
+        for(size_t i = 0; i < rows(); ++ i) {
+            T *out = data() + i * stride();
+            for(size_t j = 0; j < columns(); ++ j)
+                out[j] = e(i,j);
+        }
+    }
+
+    /**
+     *  Sums, differences, negations and scalings of plain matrices skip the entrywise loop and
+     *  run the SIMD kernels over the whole buffer.
+     */
+
+    template <typename L, typename R>
+    inline void assign(const matrix_binary<L, R, algebra_detail::add_op> &e) {
+        if constexpr (is_same_matrix<L>::value && is_same_matrix<R>::value) {
+            simd_add(buffer.size(), e.left.data(), e.right.data(), data());
+        } else {
+            assign<matrix_binary<L, R, algebra_detail::add_op>>(e);
+        }
+    }
+
+    template <typename L, typename R>
+    inline void assign(const matrix_binary<L, R, algebra_detail::subtract_op> &e) {
+        if constexpr (is_same_matrix<L>::value && is_same_matrix<R>::value) {
+            simd_subtract(buffer.size(), e.left.data(), e.right.data(), data());
+        } else {
+            assign<matrix_binary<L, R, algebra_detail::subtract_op>>(e);
+        }
+    }
+
+    template <typename E>
+    inline void assign(const matrix_negate<E> &e) {
+        if constexpr (is_same_matrix<E>::value) {
+            simd_negate(buffer.size(), e.operand.data(), data());
+        } else {
+            assign<matrix_negate<E>>(e);
+        }
+    }
+
+    inline void assign(const matrix_view<T> &e) {
+        for(size_t i = 0; i < rows(); ++ i)
+            std::copy(e.data() + i * e.stride(), e.data() + i * e.stride() + columns(), data() + i * stride());
+    }
+
+    inline void assign(const matrix_transposed<T> &e) {
+        if(static_cast<const void *>(&e.operand) == this) {
+            transpose_square(rows(), data(), stride());
+        } else {
+            transpose_copy(e.operand.rows(), e.operand.columns(), e.operand.data(), e.operand.stride(), data(), stride());
+        }
+    }
+
+    template <typename E>
+    inline void assign(const matrix_scaled<E> &e) {
+        if constexpr (is_same_matrix<E>::value) {
+            simd_scale(buffer.size(), e.operand.data(), e.scale, data());
+        } else {
+            assign<matrix_scaled<E>>(e);
+        }
+    }
+
+    /**
+     *  Factors a copy of the matrix with lu_factor. The copy and the pivots live in scratch
+     *  buffers owned by the calling thread, so repeated calls do not allocate.
+     *
+     *  @param level the nesting level of the caller, which keeps the buffers apart from those
+     *  of a factorization run by this thread while it waits for workers.
+     *  @param pivots receives the row exchanges.
+     *  @param singular receives whether a zero pivot was found.
+     *  @return the factors, with a row stride of max(1, rows()).
+     */
+
+    template<typename T1>
+    inline const T1 *factor_copy(size_t level, const size_t *&pivots, bool &singular) const {
+        assert(rows() == columns());
+
+        const size_t n = rows();
+        const size_t ld = std::max<size_t>(1, n);
+        T1 *tmp = algebra_detail::scratch_buffer<T1, 3>(n * ld, level);
+        size_t *p = algebra_detail::scratch_buffer<size_t, 2>(n, level);
+
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j < n; ++ j)
+                tmp[i * ld + j] = T1((*this)(i,j));
+
+        singular = lu_factor(n, tmp, ld, p) < n;
+        pivots = p;
+
+        return tmp;
+    }
 
     public:
 
+    typedef T value_type;
+
+    /**
+     *  Empty matrix constructor. The matrix has no rows and no columns.
+     */
+
+    inline matrix () = default;
+
+    /**
+     *  Empty matrix constructor with an allocator, which every later resize draws from.
+     *
+     *  @param alloc the allocator of the entries.
+     */
+
+    inline explicit matrix (const Allocator &alloc) : buffer(alloc) {}
+
     /**
      *  Default matrix constructor. All entries are set to their default.
      *
@@ -53,11 +226,7 @@ class matrix {
      *  @param Columns the number of columns in the matrix.
      */
 
-    inline matrix (size_t Rows, size_t Columns) {
-        for(size_t i = 0; i < Rows; ++ i) {
-            data.push_back(std::vector<T>(Columns, T()));
-        }
-    }
+    inline matrix (size_t Rows, size_t Columns) : matrix(Rows, Columns, T()) {}
 
     /**
      *  Alternate matrix constructor. All entries are set to t.
@@ -65,12 +234,27 @@ class matrix {
      *  @param Rows the number of rows in the matrix.
      *  @param Columns the number of columns in the matrix.
      *  @param t the value to set all entries equal to.
+     *  @param alloc the allocator of the entries.
      */
 
-    inline matrix (size_t Rows, size_t Columns, T t) {
-        for(size_t i = 0; i < Rows; ++ i) {
-            data.emplace_back(Columns, t);
-        }
+    inline matrix (size_t Rows, size_t Columns, T t, const Allocator &alloc = Allocator())
+        : n_rows(Rows), n_columns(Columns), row_stride(algebra_detail::padded_stride<T>(Columns)),
+          buffer(Rows * algebra_detail::padded_stride<T>(Columns), t, alloc) {}
+
+    /**
+     *  Converting constructor, copies a matrix of another data type or allocator entry by
+     *  entry.
+     *
+     *  @param m the matrix to copy.
+     *  @param alloc the allocator of the entries.
+     */
+
+    template <typename U, typename A>
+    inline explicit matrix (const matrix<U, A> &m, const Allocator &alloc = Allocator())
+        : matrix(m.rows(), m.columns(), T(), alloc) {
+        for(size_t i = 0; i < rows(); ++ i)
+            for(size_t j = 0; j < columns(); ++ j)
+                (*this)(i,j) = T(m(i,j));
     }
 
     /**
@@ -78,24 +262,76 @@ class matrix {
      *
      *  @param m the matrix to copy.
      */
-        
-    inline matrix (const matrix<T> &m) {
-        for(size_t i = 0; i < m.rows(); ++ i) {
-            data.push_back(std::vector<T>());
-            for(size_t j = 0; j < m.columns(); ++ j) {
-                data[i].push_back(m(i,j));
-            }
-        }
+
+    inline matrix (const matrix &m) = default;
+
+    /**
+     *  Move constructor. Takes over the entries of m, leaving m empty.
+     *
+     *  @param m the matrix to move from.
+     */
+
+    inline matrix (matrix &&m) noexcept
+        : n_rows(std::exchange(m.n_rows, 0)), n_columns(std::exchange(m.n_columns, 0)),
+          row_stride(std::exchange(m.row_stride, 0)), buffer(std::move(m.buffer)) {}
+
+    /**
+     *  Copy assignment. Reuses the existing storage when it is large enough.
+     *
+     *  @param m the matrix to copy.
+     *  @return a reference to this matrix.
+     */
+
+    inline matrix &operator = (const matrix &m) = default;
+
+    /**
+     *  Move assignment. Takes over the entries of m, leaving m empty.
+     *
+     *  @param m the matrix to move from.
+     *  @return a reference to this matrix.
+     */
+
+    inline matrix &operator = (matrix &&m) noexcept {
+        n_rows = std::exchange(m.n_rows, 0);
+        n_columns = std::exchange(m.n_columns, 0);
+        row_stride = std::exchange(m.row_stride, 0);
+        buffer = std::move(m.buffer);
+        return *this;
+    }
+
+    /**
+     *  Expression constructor, evaluates a matrix expression such as a + b * 2 - c in one pass
+     *  with no intermediate matrices.
+     *
+     *  @param e the expression to evaluate.
+     */
+
+    template <typename E>
+    inline matrix (const matrix_expression<E> &e) : matrix(e.rows(), e.columns()) {
+        assign(e.self());
+    }
+
+    /**
+     *  Expression constructor with an allocator, which the result is evaluated into.
+     *
+     *  @param e the expression to evaluate.
+     *  @param alloc the allocator of the entries.
+     */
+
+    template <typename E>
+    inline matrix (const matrix_expression<E> &e, const Allocator &alloc) : matrix(e.rows(), e.columns(), T(), alloc) {
+        assign(e.self());
     }
 
     /**
      *  Returns the identity matrix of size N x N.
      *
+     *  @param alloc the allocator of the entries.
      *  @return a N x N identity matrix, if such a matrix is valid.
      */
 
-    static inline matrix<T> identity(size_t N) {
-        matrix<T>ret = matrix(N, N, T(0));
+    static inline matrix identity(size_t N, const Allocator &alloc = Allocator()) {
+        matrix ret(N, N, T(0), alloc);
 
         for(size_t i = 0; i < N; ++ i)
             ret(i,i) = 1;
@@ -103,6 +339,16 @@ class matrix {
         return ret;
     }
 
+    /**
+     *  Retrieves the allocator the entries are held by.
+     *
+     *  @return a copy of the allocator.
+     */
+
+    inline Allocator get_allocator() const {
+        return buffer.get_allocator();
+    }
+
     /**
      *  Retrieves the number of rows in the matrix.
      *
@@ -110,10 +356,7 @@ class matrix {
      */
 
     inline size_t rows() const {
-        if(data.empty()) {
-            return 0;
-        }
-        return data.size();
+        return n_rows;
     }
 
 
@@ -124,78 +367,273 @@ class matrix {
      */
 
     inline size_t columns() const {
-        if(data.empty()) {
-            return 0;
+        return n_columns;
+    }
+
+    /**
+     *  Retrieves the distance, in elements, between the starts of consecutive rows.
+     *
+     *  @return the row stride of the underlying buffer.
+     */
+
+    inline size_t stride() const {
+        return row_stride;
+    }
+
+    /**
+     *  Retrieves the underlying row-major buffer. Entry (i,j) is at data()[i * stride() + j].
+     *
+     *  @return a pointer to the first entry of the matrix.
+     */
+
+    inline T *data() {
+        return buffer.data();
+    }
+
+    /**
+     *  Retrieves the underlying row-major buffer. Entry (i,j) is at data()[i * stride() + j].
+     *
+     *  @return a const pointer to the first entry of the matrix.
+     */
+
+    inline const T *data() const {
+        return buffer.data();
+    }
+
+    /**
+     *  Views the whole matrix without copying it. The view is invalidated by resize().
+     *
+     *  @return a read-only view of every entry.
+     */
+
+    inline matrix_view<T> view() const {
+        return matrix_view<T>(data(), rows(), columns(), stride());
+    }
+
+    /**
+     *  Refers to the whole matrix without copying it, so that kernels taking a matrix_ref can
+     *  write straight into it. The reference is invalidated by resize().
+     *
+     *  @return a writable reference to every entry.
+     */
+
+    inline matrix_ref<T> ref() {
+        return matrix_ref<T>(data(), rows(), columns(), stride());
+    }
+
+    inline operator matrix_view<T>() const {
+        return view();
+    }
+
+    inline operator matrix_ref<T>() {
+        return ref();
+    }
+
+    /**
+     *  Views a block of the matrix without copying it.
+     *
+     *  @param row the first row of the block.
+     *  @param column the first column of the block.
+     *  @param Rows the number of rows in the block.
+     *  @param Columns the number of columns in the block.
+     *  @return a read-only view of the block.
+     */
+
+    inline matrix_view<T> block(size_t row, size_t column, size_t Rows, size_t Columns) const {
+        return view().block(row, column, Rows, Columns);
+    }
+
+    /**
+     *  Refers to a block of the matrix without copying it; assigning to the result writes
+     *  into the matrix.
+     *
+     *  @param row the first row of the block.
+     *  @param column the first column of the block.
+     *  @param Rows the number of rows in the block.
+     *  @param Columns the number of columns in the block.
+     *  @return a writable reference to the block.
+     */
+
+    inline matrix_ref<T> block(size_t row, size_t column, size_t Rows, size_t Columns) {
+        return ref().block(row, column, Rows, Columns);
+    }
+
+    /**
+     *  Views one row, as a 1 x columns() block.
+     *
+     *  @param i the row to view.
+     *  @return a view of the row; writable when the matrix is.
+     */
+
+    inline matrix_view<T> row(size_t i) const {
+        return view().row(i);
+    }
+
+    inline matrix_ref<T> row(size_t i) {
+        return ref().row(i);
+    }
+
+    /**
+     *  Views one column, as a rows() x 1 block with a stride of stride().
+     *
+     *  @param j the column to view.
+     *  @return a view of the column; writable when the matrix is.
+     */
+
+    inline matrix_view<T> column(size_t j) const {
+        return view().column(j);
+    }
+
+    inline matrix_ref<T> column(size_t j) {
+        return ref().column(j);
+    }
+
+    /**
+     *  Changes the shape of the matrix, reusing the existing storage when it is large enough.
+     *  Does nothing if the shape is unchanged; otherwise every entry is reset to its default.
+     *
+     *  @param Rows the new number of rows.
+     *  @param Columns the new number of columns.
+     */
+
+    inline void resize(size_t Rows, size_t Columns) {
+        if(Rows == n_rows && Columns == n_columns) {
+            return;
         }
-        return data[0].size();
+        n_rows = Rows;
+        n_columns = Columns;
+        row_stride = algebra_detail::padded_stride<T>(Columns);
+        buffer.assign(Rows * row_stride, T());
     }
 
 
     /**
-     *  Adds two matrices together and returns their result
+     *  Evaluates a matrix expression, such as a + b * 2 - c, into its elements in one pass.
+     *
+     *  @param e the expression to evaluate.
+     *  @return a reference to this matrix, now equal to e.
+     */
+
+    template <typename E>
+    inline matrix &operator = (const matrix_expression<E> &e) {
+        // A transposed view of this matrix is transposed in place on its own, but anywhere
+        // deeper in the tree it needs a temporary.
+
+        if(rows() != e.rows() || columns() != e.columns() ||
+           (!std::is_same<E, matrix_transposed<T>>::value && transposes_self(e.self()))) {
+            return *this = matrix(e, get_allocator());
+        }
+
+        assign(e.self());
+
+        return *this;
+    }
+
+    /**
+     *  Adds a scaled matrix to this one in place, in a single fused pass.
      *
+     *  @param alpha the constant to scale m by.
      *  @param m the matrix to add.
-     *  @return the sum of the two matrices.
+     *  @return a reference to this matrix, now equal to this + alpha * m.
      */
 
-    inline matrix<T> operator + (const matrix<T> &m) const {
+    template <typename A>
+    inline matrix &axpy(const T alpha, const matrix<T, A> &m) {
         assert(rows() == m.rows() && columns() == m.columns());
 
-        matrix<T> ret;
+        simd_axpy(buffer.size(), alpha, m.data(), data());
 
-        for(size_t i = 0; i < rows(); ++ i) {
-            for(size_t j = 0; j < columns(); ++ j) {
-                ret[i][j] = data[i][j] + m[i][j];
+        return *this;
+    }
+
+    /**
+     *  Adds a matrix expression to this matrix in place.
+     *
+     *  @param e the expression to add.
+     *  @return a reference to this matrix.
+     */
+
+    template <typename E>
+    inline matrix &operator += (const matrix_expression<E> &e) {
+        assert(rows() == e.rows() && columns() == e.columns());
+
+        if(transposes_self(e.self())) {
+            return *this += matrix(e, get_allocator());
+        }
+
+        if constexpr (is_same_matrix<E>::value) {
+            simd_add(buffer.size(), data(), e.self().data(), data());
+        } else if constexpr (is_scaled_matrix<E>::value) {
+            simd_axpy(buffer.size(), e.self().scale, e.self().operand.data(), data());
+        } else {
+            for(size_t i = 0; i < rows(); ++ i) {
+                T *out = data() + i * stride();
+                for(size_t j = 0; j < columns(); ++ j)
+                    out[j] = out[j] + e.self()(i,j);
             }
         }
 
-        return ret;
+        return *this;
     }
 
     /**
-     *  Negates all entries in the matrix.
+     *  Subtracts a matrix expression from this matrix in place.
      *
-     *  @return the matrix scaled by -1.
+     *  @param e the expression to subtract.
+     *  @return a reference to this matrix.
      */
 
-    inline matrix<T> operator - () const {
-        matrix<T> ret;
+    template <typename E>
+    inline matrix &operator -= (const matrix_expression<E> &e) {
+        assert(rows() == e.rows() && columns() == e.columns());
 
-        for(size_t i = 0; i < rows(); ++ i) {
-            for(size_t j = 0; j < columns(); ++ j) {
-                ret(i,j) = -data[i][j];
+        if(transposes_self(e.self())) {
+            return *this -= matrix(e, get_allocator());
+        }
+
+        if constexpr (is_same_matrix<E>::value) {
+            simd_subtract(buffer.size(), data(), e.self().data(), data());
+        } else if constexpr (is_scaled_matrix<E>::value) {
+            simd_axpy(buffer.size(), -e.self().scale, e.self().operand.data(), data());
+        } else {
+            for(size_t i = 0; i < rows(); ++ i) {
+                T *out = data() + i * stride();
+                for(size_t j = 0; j < columns(); ++ j)
+                    out[j] = out[j] - e.self()(i,j);
             }
         }
 
-        return ret;
+        return *this;
     }
 
     /**
-     *  Subtracts two matrices and returns their result.
+     *  Scales this matrix by a constant factor in place.
      *
-     *  @param m the matrix to subtract.
-     *  @return the difference of the two matrices.
+     *  @param t the constant to scale by.
+     *  @return a reference to this matrix.
      */
 
-    inline matrix<T> operator - (const matrix<T> &m) const {
-        return (*this) + -m;
+    inline matrix &operator *= (const T t) {
+        simd_scale(buffer.size(), data(), t, data());
+
+        return *this;
     }
 
     /**
-     *  Scales a matrix by a constant factor.
+     *  Multiplies this matrix by another in place. The product goes through a scratch matrix
+     *  owned by the calling thread, so repeated updates of the same shape do not allocate.
      *
-     *  @param t the constant to scale the matrix by.
-     *  @return the matrix scaled by t.
+     *  @param m the matrix to multiply by.
+     *  @return a reference to this matrix, now equal to this * m.
      */
 
-    inline matrix<T> operator * (const T t) const {
-        matrix<T> ret(*this);
+    template <typename A>
+    inline matrix &operator *= (const matrix<T, A> &m) {
+        thread_local matrix product;
 
-        for(size_t i = 0; i < rows(); ++ i)
-            for(size_t j = 0; j < columns(); ++ j)
-                ret(i,j) = ret(i,j) * t;
+        multiply_into(product, *this, m);
 
-        return ret;
+        return *this = product;
     }
 
     /**
@@ -205,20 +643,11 @@ class matrix {
      *  @return the result of multiplying the two matrices.
      */
 
-    inline matrix<T> operator * (const matrix<T> & m) const {
-        assert(columns() == m.rows());
+    template <typename A>
+    inline matrix operator * (const matrix<T, A> & m) const {
+        matrix ret(get_allocator());
 
-        matrix<T> ret = matrix(rows(), m.columns(), T(0));
-
-        // The unusual order of loops is an optimization
-
-        for(size_t i = 0; i < rows(); ++ i) {
-            for(size_t k = 0; k < columns(); ++ k) {
-                for(size_t j = 0; j < m.columns(); ++ j) {
-                    ret(i,j) = ret(i, j) + data[i][k] * m(k,j);
-                }
-            }
-        }
+        multiply_into(ret, *this, m);
 
         return ret;
     }
@@ -233,40 +662,9 @@ class matrix {
 
     template<typename T1 = long double>
     inline matrix<T1> inverse() const {
-        assert(rows() == columns());
+        matrix<T1> ret, work;
 
-        matrix<T1> tmp = matrix(*this);
-        matrix<T1> ret = matrix<T1>::identity(rows());
-
-        // This is where the fun starts...
-
-        for(size_t i = 0, j; i < rows(); ++ i) {
-            for(j = i; j < rows() && tmp(j,i) == T1(0); ++ j);
-            if(j == rows()) {
-                throw degenerate_matrix_error();
-            }
-            if(i != j) {
-                for(size_t k = i; k < columns(); ++ k) {
-                    std::swap(tmp(i,k), tmp(j,k));
-                    std::swap(ret(i,k), ret(j,k));
-                }
-            }
-            for(int j = 0; j < columns(); ++ j) {
-                if(j == i) continue;
-                tmp(i,j) = tmp(i,j) / tmp(i,i);
-                ret(i,j) = ret(i,j) / tmp(i,i);
-            }
-            ret(i,i) = ret(i,i) / tmp(i,i);
-            tmp(i,i) = 1.0;
-            for(j = 0; j < rows(); ++ j) {
-                if(j == i) continue;
-                T1 entry = tmp(j,i);
-                for(size_t k = 0; k < columns(); ++k) {
-                    tmp(j,k) = tmp(j,k) - (tmp(i,k) / tmp(i,i)) * entry;
-                    ret(j,k) = ret(j,k) - (ret(i,k) / tmp(i,i)) * entry;
-                }
-            }
-        }
+        inverse_into(ret, *this, work);
 
         return ret;
     }
@@ -280,39 +678,64 @@ class matrix {
 
     template<typename T1 = long double>
     inline T1 determinant() const {
-        assert(rows() == columns());
-
-        matrix<T1> tmp = matrix(*this);
+        const size_t n = rows(), ld = std::max<size_t>(1, n);
+        const algebra_detail::instrument_scope scope(instrumented_operation::determinant, 2.0 / 3.0 * n * n * n);
+        const algebra_detail::nesting_guard nesting;
+        const size_t *pivots;
+        bool singular;
+        const T1 *tmp = factor_copy<T1>(nesting.level, pivots, singular);
+
+        if(singular) {
+            return T1(0);
+        }
 
         T1 res = T1(1);
 
         bool b = 0;
 
-        for(size_t i = 0, j; i < rows() - 1; ++ i) {
-            for(j = i; j < rows() && tmp(j,i) == T1(0); ++ j);
-            if(j == rows()) {
-                return T1(0);
-            }
-            if(i != j) {
-                for(size_t k = i; k < columns(); ++ k) {
-                    std::swap(tmp(i,k), tmp(j,k));
-                }
-                b ^= 1;
-            }
-            for(j = i + 1; j < rows(); ++ j) {
-                T entry = tmp(j,i);
-                for(size_t k = i; k < columns(); ++ k) {
-                    tmp(j,k) = tmp(j,k) - (tmp(i,k) / tmp(i,i)) * entry;
-                }
-            }
+        for(size_t i = 0; i < n; ++ i) {
+            res = res * tmp[i * ld + i];
+            b ^= pivots[i] != i;
         }
 
-        for(size_t i = 0; i < rows(); ++ i)
-            res = res * tmp(i,i);
-
         return b ? -res : res;
     }
 
+    /**
+     *  Computes the sign and the natural logarithm of the absolute value of the determinant.
+     *  Unlike determinant(), this does not overflow or underflow for large matrices.
+     *
+     *  @param T1 the (real) data type of the result.
+     *  @return the sign (-1, 0 or 1) and log|det|. A singular matrix has sign 0 and log|det|
+     *  of -infinity.
+     */
+
+    template<typename T1 = long double>
+    inline log_det<T1> log_determinant() const {
+        const size_t n = rows(), ld = std::max<size_t>(1, n);
+        const algebra_detail::instrument_scope scope(instrumented_operation::determinant, 2.0 / 3.0 * n * n * n);
+        const algebra_detail::nesting_guard nesting;
+        const size_t *pivots;
+        bool singular;
+        const T1 *tmp = factor_copy<T1>(nesting.level, pivots, singular);
+
+        if(singular) {
+            return {T1(0), -std::numeric_limits<T1>::infinity()};
+        }
+
+        log_det<T1> ret = {T1(1), T1(0)};
+
+        for(size_t i = 0; i < n; ++ i) {
+            const T1 u = tmp[i * ld + i];
+            if((u < T1(0)) != (pivots[i] != i)) {
+                ret.sign = -ret.sign;
+            }
+            ret.log_abs = ret.log_abs + std::log(std::abs(u));
+        }
+
+        return ret;
+    }
+
     /**
      *  Allows access to the matrix entries.
      *
@@ -322,7 +745,7 @@ class matrix {
      */
 
     inline T &operator () (size_t row, size_t column) {
-        return data[row][column];
+        return buffer[row * row_stride + column];
     }
 
     /**
@@ -334,7 +757,7 @@ class matrix {
      */
 
     inline const T &operator () (size_t row, size_t column) const {
-        return data[row][column];
+        return buffer[row * row_stride + column];
     }
 
     /**
@@ -344,11 +767,12 @@ class matrix {
      *  @return true if the two are not equal, and false otherwise.
      */
 
-    inline bool operator != (const matrix<T> &m) const {
+    template <typename A>
+    inline bool operator != (const matrix<T, A> &m) const {
         if(rows() != m.rows() || columns() != m.columns()) return true;
         for(size_t i = 0; i < rows(); ++ i)
             for(size_t j = 0; j < columns(); ++ j)
-                if(data[i][j] != m[i][j])
+                if((*this)(i,j) != m(i,j))
                     return true;
         return false;
     }
@@ -360,7 +784,8 @@ class matrix {
      *  @return true if the two are equal, and false otherwise.
     */
 
-    inline bool operator == (const matrix<T> &m) const {
+    template <typename A>
+    inline bool operator == (const matrix<T, A> &m) const {
         return !((*this) != m);
     }
 
@@ -371,16 +796,310 @@ class matrix {
      */
 
     inline matrix transpose() const {
-        matrix ret = matrix(columns(), rows());
+        matrix ret(get_allocator());
 
-        for(size_t i = 0; i < rows(); ++ i)
-            for(size_t j = 0; j < columns(); ++ j)
-                ret(j,i) = data[i][j];
+        transpose_into(ret, *this);
 
         return ret;
     }
+
+    /**
+     *  Transposes the matrix in place. Square matrices are transposed without allocating;
+     *  any other shape goes through a transposed copy.
+     *
+     *  @return a reference to this matrix, now equal to its transpose.
+     */
+
+    inline matrix &transpose_in_place() {
+        const algebra_detail::instrument_scope scope(instrumented_operation::transpose);
+
+        if(rows() == columns()) {
+            transpose_square(rows(), data(), stride());
+        } else {
+            *this = transpose();
+        }
+        return *this;
+    }
 };
 
+namespace algebra_detail {
+
+/**
+ *  Evaluates an expression into a matrix; plain matrices are passed through uncopied.
+ */
+
+template <typename T, typename A>
+inline const matrix<T, A> &evaluate(const matrix<T, A> &m) {
+    return m;
+}
+
+template <typename E>
+inline matrix<typename E::value_type> evaluate(const matrix_expression<E> &e) {
+    return matrix<typename E::value_type>(e);
+}
+
+template <typename L, typename R>
+using enable_if_expression_product = typename std::enable_if<
+    is_expression<typename std::decay<L>::type>::value &&
+    is_expression<typename std::decay<R>::type>::value &&
+    !(is_gemm_operand<typename std::decay<L>::type>::value &&
+      is_gemm_operand<typename std::decay<R>::type>::value)>::type;
+
+template <typename L, typename R>
+using enable_if_strided_product = typename std::enable_if<
+    is_gemm_operand<typename std::decay<L>::type>::value && is_gemm_operand<typename std::decay<R>::type>::value &&
+    !(is_matrix<typename std::decay<L>::type>::value && is_matrix<typename std::decay<R>::type>::value)>::type;
+
+/**
+ *  The storage gemm reads for an operand, and whether it reads it transposed.
+ */
+
+template <typename M>
+inline const M &gemm_storage(const M &m) {
+    return m;
+}
+
+template <typename T>
+inline const matrix<T> &gemm_storage(const matrix_transposed<T> &m) {
+    return m.operand;
+}
+
+template <typename M>
+inline constexpr gemm_transpose gemm_layout(const M &) {
+    return gemm_transpose::none;
+}
+
+template <typename T>
+inline constexpr gemm_transpose gemm_layout(const matrix_transposed<T> &) {
+    return gemm_transpose::transpose;
+}
+
+}
+
+/**
+ *  Multiplies two matrix expressions, such as (a + b) * c. Each operand that is not already a
+ *  matrix is evaluated once, then the two are multiplied.
+ *
+ *  @param l the left operand.
+ *  @param r the right operand.
+ *  @return the result of multiplying the two matrices.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_expression_product<L, R>>
+inline auto operator * (L &&l, R &&r) {
+    return algebra_detail::evaluate(l) * algebra_detail::evaluate(r);
+}
+
+/**
+ *  Multiplies two matrices into a preallocated result, out = a * b. out is resized only if
+ *  its shape differs, so repeated products of the same shape do not allocate.
+ *
+ *  @param out the matrix to store the product in; must not be a or b.
+ *  @param a the left operand.
+ *  @param b the right operand.
+ */
+
+template <typename T, typename A, typename B, typename C>
+void multiply_into(matrix<T, A> &out, const matrix<T, B> &a, const matrix<T, C> &b) {
+    assert(a.columns() == b.rows());
+    assert(static_cast<const void *>(&out) != &a && static_cast<const void *>(&out) != &b);
+    const algebra_detail::instrument_scope scope(instrumented_operation::multiply,
+                                                 2.0 * a.rows() * a.columns() * b.columns());
+
+    out.resize(a.rows(), b.columns());
+
+    if constexpr (gemm_has_kernel<T>::value) {
+        if(a.rows() * a.columns() * b.columns() >= gemm_tuning().threshold) {
+            gemm(a.rows(), b.columns(), a.columns(), T(1), a.data(), a.stride(),
+                 b.data(), b.stride(), T(0), out.data(), out.stride());
+            return;
+        }
+    }
+
+    // The unusual order of loops is an optimization: the innermost loop walks
+    // contiguous rows of b and out.
+
+    for(size_t i = 0; i < a.rows(); ++ i) {
+        T *row = out.data() + i * out.stride();
+        std::fill(row, row + b.columns(), T(0));
+        for(size_t k = 0; k < a.columns(); ++ k) {
+            const T t = a(i,k);
+            const T *in = b.data() + k * b.stride();
+            for(size_t j = 0; j < b.columns(); ++ j) {
+                row[j] = row[j] + t * in[j];
+            }
+        }
+    }
+}
+
+/**
+ *  Computes out = alpha * a * b + beta * out on strided operands: matrices, views, blocks of
+ *  either and transposed views. The operands' storage is handed to gemm as is, so nothing is
+ *  copied or materialized.
+ *
+ *  @param out where the product goes, of shape a.rows() x b.columns(); must not overlap a or
+ *  b.
+ *  @param a the left operand.
+ *  @param b the right operand.
+ *  @param alpha the scale applied to a * b.
+ *  @param beta the scale applied to out before accumulating. When 0, out is not read.
+ */
+
+template <typename T, typename L, typename R>
+void multiply_accumulate(const matrix_ref<T> &out, const L &a, const R &b, T alpha = T(1), T beta = T(1)) {
+    using namespace algebra_detail;
+    assert(a.columns() == b.rows());
+    assert(out.rows() == a.rows() && out.columns() == b.columns());
+    const instrument_scope scope(instrumented_operation::multiply, 2.0 * a.rows() * a.columns() * b.columns());
+
+    if constexpr (gemm_has_kernel<T>::value) {
+        if(a.rows() * a.columns() * b.columns() >= gemm_tuning().threshold) {
+            const auto &x = gemm_storage(a);
+            const auto &y = gemm_storage(b);
+            gemm(gemm_layout(a), gemm_layout(b), a.rows(), b.columns(), a.columns(), alpha,
+                 x.data(), x.stride(), y.data(), y.stride(), beta, out.data(), out.stride());
+            return;
+        }
+    }
+
+    for(size_t i = 0; i < a.rows(); ++ i) {
+        T *row = out.data() + i * out.stride();
+        for(size_t j = 0; j < b.columns(); ++ j)
+            row[j] = beta == T(0) ? T(0) : row[j] * beta;
+        for(size_t k = 0; k < a.columns(); ++ k) {
+            const T t = alpha * a(i,k);
+            for(size_t j = 0; j < b.columns(); ++ j)
+                row[j] = row[j] + t * b(k,j);
+        }
+    }
+}
+
+/**
+ *  Multiplies strided operands into a preallocated result, out = a * b, where either
+ *  operand is a view, a block or a transposed view rather than a plain matrix. out is
+ *  resized only if its shape differs.
+ *
+ *  @param out the matrix to store the product in; must not overlap either operand.
+ *  @param a the left operand.
+ *  @param b the right operand.
+ */
+
+template <typename T, typename A, typename L, typename R, typename = algebra_detail::enable_if_strided_product<L, R>>
+void multiply_into(matrix<T, A> &out, const L &a, const R &b) {
+    const algebra_detail::instrument_scope scope(instrumented_operation::multiply,
+                                                 2.0 * a.rows() * a.columns() * b.columns());
+
+    out.resize(a.rows(), b.columns());
+    multiply_accumulate(out.ref(), a, b, T(1), T(0));
+}
+
+/**
+ *  Multiplies strided operands into the entries a reference points at, out = a * b, such as
+ *  a block of a larger matrix.
+ *
+ *  @param out where the product goes, of shape a.rows() x b.columns(); must not overlap a or
+ *  b.
+ *  @param a the left operand.
+ *  @param b the right operand.
+ */
+
+template <typename T, typename L, typename R, typename = algebra_detail::enable_if_strided_product<L, R>>
+void multiply_into(const matrix_ref<T> &out, const L &a, const R &b) {
+    multiply_accumulate(out, a, b, T(1), T(0));
+}
+
+/**
+ *  Multiplies strided operands, such as transposed(a) * b or a.block(...) * b, without
+ *  copying or materializing either one.
+ *
+ *  @param a the left operand.
+ *  @param b the right operand.
+ *  @return the product.
+ */
+
+template <typename L, typename R, typename = algebra_detail::enable_if_strided_product<L, R>>
+inline auto operator * (const L &a, const R &b) {
+    matrix<typename L::value_type> ret;
+    multiply_into(ret, a, b);
+    return ret;
+}
+
+/**
+ *  Transposes a matrix into a preallocated result, through the tiled transpose_copy. out is
+ *  resized only if its shape differs.
+ *
+ *  @param out the matrix to store the transpose in; must not be a.
+ *  @param a the matrix to transpose.
+ */
+
+template <typename T, typename A, typename B>
+void transpose_into(matrix<T, A> &out, const matrix<T, B> &a) {
+    assert(static_cast<const void *>(&out) != &a);
+    const algebra_detail::instrument_scope scope(instrumented_operation::transpose);
+
+    out.resize(a.columns(), a.rows());
+
+    transpose_copy(a.rows(), a.columns(), a.data(), a.stride(), out.data(), out.stride());
+}
+
+/**
+ *  Transposes a view into the entries a reference points at, such as one block of a matrix
+ *  into another.
+ *
+ *  @param out where the transpose goes, of shape a.columns() x a.rows(); must not overlap a.
+ *  @param a the entries to transpose.
+ */
+
+template <typename T>
+void transpose_into(const matrix_ref<T> &out, const matrix_view<T> &a) {
+    assert(out.rows() == a.columns() && out.columns() == a.rows());
+    const algebra_detail::instrument_scope scope(instrumented_operation::transpose);
+
+    transpose_copy(a.rows(), a.columns(), a.data(), a.stride(), out.data(), out.stride());
+}
+
+template <typename T>
+void transpose_into(const matrix_ref<T> &out, const matrix_ref<T> &a) {
+    transpose_into(out, matrix_view<T>(a));
+}
+
+/**
+ *  Inverts a matrix into a preallocated result. Both out and work are resized only if their
+ *  shape differs, so repeated inversions of the same size do not allocate.
+ *
+ *  @param T1 the data type of the inverted matrix.
+ *  @param out the matrix to store the inverse in.
+ *  @param a the matrix to invert.
+ *  @param work scratch space; receives the LU factors of a.
+ *  @throws degenerate_matrix_error if the matrix is degenerate
+ */
+
+template <typename T1, typename T, typename A, typename B, typename C>
+void inverse_into(matrix<T1, A> &out, const matrix<T, B> &a, matrix<T1, C> &work) {
+    assert(a.rows() == a.columns());
+
+    const size_t n = a.rows();
+    const algebra_detail::instrument_scope scope(instrumented_operation::inverse, 2.0 * n * n * n);
+
+    work.resize(n, n);
+    out.resize(n, n);
+    for(size_t i = 0; i < n; ++ i) {
+        for(size_t j = 0; j < n; ++ j) {
+            work(i,j) = T1(a(i,j));
+            out(i,j) = T1(i == j ? 1 : 0);
+        }
+    }
+
+    const algebra_detail::nesting_guard nesting;
+    size_t *pivots = algebra_detail::scratch_buffer<size_t, 2>(n, nesting.level);
+
+    if(lu_factor(n, work.data(), work.stride(), pivots) < n) {
+        throw degenerate_matrix_error();
+    }
+
+    lu_solve(n, work.data(), work.stride(), pivots, n, out.data(), out.stride());
+}
+
 /**
  *  Override to print a matrix with an std::ostream.
  *
@@ -389,8 +1108,8 @@ class matrix {
  *  @return out.
  */
 
-template <typename T>
-std::ostream& operator <<(std::ostream &out, const matrix<T> &m){
+template <typename T, typename A>
+std::ostream& operator <<(std::ostream &out, const matrix<T, A> &m){
     for(size_t i = 0; i < m.rows(); ++ i){
         for(size_t j = 0; j < m.columns(); ++ j) {
             out << m(i,j);
@@ -403,4 +1122,18 @@ std::ostream& operator <<(std::ostream &out, const matrix<T> &m){
     return out;
 }
 
+/**
+ *  Override to print a matrix expression, such as a * 2, with an std::ostream. The
+ *  expression is evaluated once, then printed as a matrix.
+ *
+ *  @param out the ostream to print on.
+ *  @param e the expression to print.
+ *  @return out.
+ */
+
+template <typename E>
+std::ostream& operator <<(std::ostream &out, const matrix_expression<E> &e){
+    return out << algebra_detail::evaluate(e.self());
+}
+
 #endif
@@ -0,0 +1,614 @@
+/**
+ *  ntt.h
+ *  Purpose: number-theoretic transforms and exact integer convolution
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef NTT_H
+
+#define NTT_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "allocator.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+/**
+ *  montgomery class, arithmetic modulo an odd prime Mod < 2^30 in Montgomery form: x is
+ *  held as x * 2^32 mod Mod, so a product is reduced with two multiplies and a shift instead
+ *  of a division.
+ *
+ *  @param Mod the modulus.
+ */
+
+template <uint32_t Mod>
+struct montgomery {
+    static_assert(Mod % 2 == 1 && Mod < (uint32_t(1) << 30), "montgomery needs an odd modulus below 2^30");
+
+    /**
+     *  -1 / Mod modulo 2^32, by Newton's iteration (each step doubles the correct bits).
+     */
+
+    static constexpr uint32_t negative_inverse() {
+        uint32_t inv = Mod;
+        for(int i = 0; i < 4; ++ i)
+            inv *= 2 - Mod * inv;
+        return -inv;
+    }
+
+    static constexpr uint32_t modulus = Mod;
+    static constexpr uint32_t pinv = negative_inverse();
+
+    /**
+     *  2^64 modulo Mod, which takes a value into Montgomery form in one reduction.
+     */
+
+    static constexpr uint32_t r2 = uint32_t((~uint64_t(0) % Mod + 1) % Mod);
+
+    /**
+     *  Computes t / 2^32 modulo Mod, for t < Mod * 2^32.
+     *
+     *  @return the reduced value, in [0, Mod).
+     */
+
+    static constexpr uint32_t reduce(uint64_t t) {
+        const uint64_t m = uint32_t(t) * uint64_t(pinv) & 0xffffffffu;
+        const uint32_t u = uint32_t((t + m * Mod) >> 32);
+        return u >= Mod ? u - Mod : u;
+    }
+
+    static constexpr uint32_t to_form(uint32_t x) {
+        return reduce(uint64_t(x) * r2);
+    }
+
+    static constexpr uint32_t from_form(uint32_t x) {
+        return reduce(x);
+    }
+
+    /**
+     *  Multiplies two values, both in normal form or one in each.
+     *
+     *  @return a * b / 2^32 modulo Mod; the plain product when one operand is in Montgomery form.
+     */
+
+    static constexpr uint32_t multiply(uint32_t a, uint32_t b) {
+        return reduce(uint64_t(a) * b);
+    }
+
+    /**
+     *  Multiplies two values in normal form.
+     *
+     *  @return a * b modulo Mod, in normal form.
+     */
+
+    static constexpr uint32_t product(uint32_t a, uint32_t b) {
+        return multiply(multiply(a, b), r2);
+    }
+
+    static constexpr uint32_t power(uint32_t a, uint64_t e) {
+        uint32_t result = 1;
+        for(; e > 0; e >>= 1) {
+            if(e & 1) {
+                result = product(result, a);
+            }
+            a = product(a, a);
+        }
+        return result;
+    }
+
+    static constexpr uint32_t inverse(uint32_t a) {
+        return power(a, Mod - 2);
+    }
+
+    /**
+     *  Finds the smallest generator of the multiplicative group modulo Mod.
+     *
+     *  @return a primitive root of Mod.
+     */
+
+    static constexpr uint32_t primitive_root() {
+        uint32_t factors[32] = {};
+        size_t count = 0;
+        uint32_t m = Mod - 1;
+        for(uint32_t q = 2; q * q <= m; ++ q) {
+            if(m % q == 0) {
+                factors[count ++] = q;
+                while(m % q == 0) m /= q;
+            }
+        }
+        if(m > 1) {
+            factors[count ++] = m;
+        }
+
+        for(uint32_t g = 2;; ++ g) {
+            bool generator = true;
+            for(size_t i = 0; i < count && generator; ++ i)
+                generator = power(g, (Mod - 1) / factors[i]) != 1;
+            if(generator) {
+                return g;
+            }
+        }
+    }
+};
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/**
+ *  Loads and stores residues: each 32-bit value occupies one 64-bit lane of V, so the
+ *  products of the Montgomery reduction fit in a lane. V may also be uint64_t itself.
+ */
+
+template <typename V>
+ALGEBRA_ALWAYS_INLINE void ntt_load(V &v, const uint32_t *p) {
+    if constexpr (std::is_same<V, uint64_t>::value) {
+        v = *p;
+    } else {
+        typedef uint32_t half __attribute__((vector_size(sizeof(V) / 2)));
+        half h;
+        std::memcpy(&h, p, sizeof(h));
+        v = __builtin_convertvector(h, V);
+    }
+}
+
+template <typename V>
+ALGEBRA_ALWAYS_INLINE void ntt_store(uint32_t *p, const V &v) {
+    if constexpr (std::is_same<V, uint64_t>::value) {
+        *p = uint32_t(v);
+    } else {
+        typedef uint32_t half __attribute__((vector_size(sizeof(V) / 2)));
+        const half h = __builtin_convertvector(v, half);
+        std::memcpy(p, &h, sizeof(h));
+    }
+}
+
+#else
+
+template <typename V>
+inline void ntt_load(V &v, const uint32_t *p) {
+    v = *p;
+}
+
+template <typename V>
+inline void ntt_store(uint32_t *p, const V &v) {
+    *p = uint32_t(v);
+}
+
+#endif
+
+/**
+ *  One radix-2 butterfly modulo p on the blocks at a and a + h: the odd value is multiplied
+ *  by its twiddle (in Montgomery form) with a Montgomery reduction, and all results are
+ *  brought back into [0, p) with branch-free conditional subtractions.
+ */
+
+template <typename V>
+ALGEBRA_ALWAYS_INLINE void ntt_radix2(uint32_t *a, size_t h, const uint32_t *w, uint64_t p, uint64_t pinv) {
+    V u, v, x;
+    ntt_load(u, a);
+    ntt_load(v, a + h);
+    ntt_load(x, w);
+
+    // Every factor is masked to 32 bits, which lets the compiler use 32 x 32 -> 64-bit
+    // multiplies.
+
+    const uint64_t low = 0xffffffffu;
+    const V t = (v & low) * (x & low);
+    v = (t + (((t & low) * pinv) & low) * p) >> 32;
+    v -= p;
+    v += -(v >> 63) & p;
+
+    V s = u + v - p, d = u - v;
+    s += -(s >> 63) & p;
+    d += -(d >> 63) & p;
+
+    ntt_store(a, s);
+    ntt_store(a + h, d);
+}
+
+/**
+ *  Runs every butterfly stage of a bit-reversed length-n transform, L lanes of type V at a
+ *  time wherever a stage's blocks are at least L long. The stage combining blocks of size 2h
+ *  reads its twiddles from w + h.
+ */
+
+template <typename V, size_t L>
+ALGEBRA_ALWAYS_INLINE void ntt_stages(size_t n, uint32_t *a, const uint32_t *w, uint64_t p, uint64_t pinv) {
+    for(size_t h = 1; h < n; h *= 2) {
+        for(size_t j = 0; j < n; j += 2 * h) {
+            size_t k = 0;
+            if constexpr (L > 1) {
+                for(; k + L <= h; k += L)
+                    ntt_radix2<V>(a + j + k, h, w + h + k, p, pinv);
+            }
+            for(; k < h; ++ k)
+                ntt_radix2<uint64_t>(a + j + k, h, w + h + k, p, pinv);
+        }
+    }
+}
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+
+struct ntt_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, T *a, const T *w, uint64_t p, uint64_t pinv) {
+        typedef uint64_t vec __attribute__((vector_size(W)));
+        ntt_stages<vec, W / sizeof(uint64_t)>(n, a, w, p, pinv);
+    }
+};
+
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+/**
+ *  ntt_plan class, the precomputed permutation and roots of unity for number-theoretic
+ *  transforms of one power-of-two length in one direction, modulo the prime Mod. The
+ *  transform is the DFT with exp(2 pi i / n) replaced by an n-th root of unity modulo Mod,
+ *  so it is exact: convolutions of residues come out exactly, with no rounding.
+ *
+ *  Values are residues in [0, Mod). The twiddles are kept in Montgomery form, so the data
+ *  itself never needs converting, and the butterflies run on the widest vector instruction
+ *  set available.
+ *
+ *  A plan is immutable once built, so one plan may be executed from many threads at once.
+ *
+ *  @param Mod a prime modulus below 2^30 with Mod - 1 divisible by the transform length,
+ *  e.g. 998244353 = 119 * 2^23 + 1.
+ */
+
+template <uint32_t Mod = 998244353>
+class ntt_plan {
+
+    typedef montgomery<Mod> arith;
+
+    private:
+
+    size_t length;
+    int direction;
+    std::vector<size_t> reversal;
+
+    /**
+     *  The stage combining blocks of size 2h reads w^k, k < h, from index h + k, where w is a
+     *  primitive 2h-th root of unity (its inverse for the inverse transform), in Montgomery form.
+     */
+
+    std::vector<uint32_t, aligned_allocator<uint32_t>> roots;
+
+    /**
+     *  1 / n in Montgomery form for the inverse transform, 1 in Montgomery form otherwise.
+     */
+
+    uint32_t scale;
+
+    inline void butterflies(uint32_t *a) const {
+#if ALGEBRA_VECTOR_EXTENSIONS
+        return algebra_detail::simd_dispatch<algebra_detail::ntt_kernel>(
+            length, a, roots.data(), uint64_t(Mod), uint64_t(arith::pinv));
+#else
+        algebra_detail::ntt_stages<uint64_t, 1>(length, a, roots.data(), Mod, arith::pinv);
+#endif
+    }
+
+    public:
+
+    /**
+     *  Constructor for an ntt_plan.
+     *
+     *  @param n the transform length; a power of two dividing Mod - 1.
+     *  @param inv pass 1 to plan the transform, and -1 to plan the inverse.
+     */
+
+    inline explicit ntt_plan(size_t n, int inv = 1) : length(n), direction(inv), reversal(n), roots(std::max<size_t>(1, n)) {
+        assert(inv == 1 || inv == -1);
+        assert(n > 0 && (n & (n - 1)) == 0 && (Mod - 1) % n == 0);
+
+        size_t bits = 0;
+        while((size_t(1) << bits) < n) ++ bits;
+        for(size_t i = 0; i < n; ++ i) {
+            size_t r = 0;
+            for(size_t b = 0; b < bits; ++ b)
+                r |= (i >> b & 1) << (bits - 1 - b);
+            reversal[i] = r;
+        }
+
+        const uint32_t g = arith::primitive_root(), root = inv == 1 ? g : arith::inverse(g);
+        for(size_t h = 1; h < n; h <<= 1) {
+            const uint32_t w = arith::power(root, (Mod - 1) / (2 * h));
+            uint32_t x = 1;
+            for(size_t k = 0; k < h; ++ k) {
+                roots[h + k] = arith::to_form(x);
+                x = arith::product(x, w);
+            }
+        }
+
+        scale = arith::to_form(inv == 1 ? 1 : arith::inverse(uint32_t(n % Mod)));
+    }
+
+    /**
+     *  Retrieves the transform length.
+     *
+     *  @return the number of values the plan transforms.
+     */
+
+    inline size_t size() const {
+        return length;
+    }
+
+    /**
+     *  Retrieves the direction of the transform.
+     *
+     *  @return 1 for the forward transform, -1 for the inverse.
+     */
+
+    inline int sign() const {
+        return direction;
+    }
+
+    /**
+     *  Transforms size() residues in place. The inverse transform is scaled by 1 / size().
+     *
+     *  @param a the residues, in [0, Mod); overwritten with the result.
+     */
+
+    inline void execute(uint32_t *a) const {
+        for(size_t i = 1; i < length; ++ i) {
+            if(i < reversal[i]) {
+                std::swap(a[i], a[reversal[i]]);
+            }
+        }
+
+        butterflies(a);
+
+        if(direction == -1) {
+            for(size_t i = 0; i < length; ++ i)
+                a[i] = arith::multiply(a[i], scale);
+        }
+    }
+
+    /**
+     *  Transforms a vector in place.
+     *
+     *  @param a the residues; must hold size() values.
+     */
+
+    inline void execute(std::vector<uint32_t> &a) const {
+        assert(a.size() == length);
+        execute(a.data());
+    }
+
+    /**
+     *  Transforms count signals of size() residues each, in place. Value j of signal k is
+     *  a[k * distance + j * stride]. The signals are spread over the thread pool.
+     *
+     *  @param a the first value of the first signal.
+     *  @param count the number of signals.
+     *  @param stride the distance between consecutive values of a signal.
+     *  @param distance the distance between the first values of consecutive signals.
+     */
+
+    inline void execute_batch(uint32_t *a, size_t count, size_t stride, size_t distance) const {
+        const size_t grain = std::max<size_t>(1, (size_t(1) << 14) / length);
+
+        parallel_for(0, count, grain, [&](size_t k0, size_t k1) {
+            for(size_t k = k0; k < k1; ++ k) {
+                uint32_t *x = a + k * distance;
+                if(stride == 1) {
+                    execute(x);
+                    continue;
+                }
+
+                const algebra_detail::nesting_guard nesting;
+                uint32_t *y = algebra_detail::scratch_buffer<uint32_t, 9>(length, nesting.level);
+                for(size_t j = 0; j < length; ++ j)
+                    y[j] = x[j * stride];
+                execute(y);
+                for(size_t j = 0; j < length; ++ j)
+                    x[j * stride] = y[j];
+            }
+        });
+    }
+};
+
+/**
+ *  Retrieves the shared plan for a modulus, length and direction, building it on first use.
+ *  Safe to call from several threads, and cached as cached_fft_plan does.
+ *
+ *  @param n the transform length.
+ *  @param inv pass 1 for the transform, and -1 for the inverse.
+ *  @return the plan.
+ */
+
+template <uint32_t Mod = 998244353>
+inline std::shared_ptr<const ntt_plan<Mod>> cached_ntt_plan(size_t n, int inv = 1) {
+    static algebra_detail::plan_cache<ntt_plan<Mod>, std::pair<size_t, int>> plans;
+    return plans.get(std::make_pair(n, inv), n, inv);
+}
+
+/**
+ *  The number-theoretic transform of a vector of residues modulo Mod.
+ *
+ *  @param a the residues; overwritten with the result. Its length must be a power of two
+ *  dividing Mod - 1, or zero, which leaves it empty.
+ *  @param inv pass 1 to compute the transform, and -1 to compute the inverse.
+ */
+
+template <uint32_t Mod = 998244353>
+inline void NTT(std::vector<uint32_t> &a, int inv = 1) {
+    if(a.empty()) {
+        return;
+    }
+    cached_ntt_plan<Mod>(a.size(), inv)->execute(a);
+}
+
+/**
+ *  Transforms many signals of the same length through one shared plan.
+ *
+ *  @param a the signals, stored back to back; overwritten with their transforms.
+ *  @param n the length of each signal; must divide a.size().
+ *  @param inv pass 1 to compute the transform, and -1 to compute the inverse.
+ */
+
+template <uint32_t Mod = 998244353>
+inline void batch_NTT(std::vector<uint32_t> &a, size_t n, int inv = 1) {
+    assert(n > 0 && a.size() % n == 0);
+    cached_ntt_plan<Mod>(n, inv)->execute_batch(a.data(), a.size() / n, 1, n);
+}
+
+/**
+ *  Computes the linear convolution of two sequences modulo Mod exactly, through the NTT.
+ *
+ *  @param a the first sequence.
+ *  @param b the second sequence.
+ *  @return the a.size() + b.size() - 1 values of the convolution modulo Mod, or nothing if
+ *  either is empty.
+ */
+
+template <uint32_t Mod = 998244353>
+std::vector<uint32_t> convolve_mod(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    typedef montgomery<Mod> arith;
+
+    if(a.empty() || b.empty()) {
+        return {};
+    }
+
+    const size_t m = a.size() + b.size() - 1;
+    size_t n = 1;
+    while(n < m) n <<= 1;
+
+    std::vector<uint32_t> x(n, 0), y(n, 0);
+    for(size_t i = 0; i < a.size(); ++ i)
+        x[i] = a[i] % Mod;
+    for(size_t i = 0; i < b.size(); ++ i)
+        y[i] = b[i] % Mod;
+
+    const auto forward = cached_ntt_plan<Mod>(n, 1);
+    forward->execute(x);
+    forward->execute(y);
+    for(size_t i = 0; i < n; ++ i)
+        x[i] = arith::product(x[i], y[i]);
+    cached_ntt_plan<Mod>(n, -1)->execute(x);
+
+    x.resize(m);
+    return x;
+}
+
+namespace algebra_detail {
+
+/**
+ *  The three primes whose NTT convolutions are recombined by the Chinese remainder theorem.
+ *  Each is c * 2^k + 1 with k >= 24, and their product exceeds 2^85.
+ */
+
+constexpr uint32_t crt_p1 = 167772161, crt_p2 = 469762049, crt_p3 = 754974721;
+
+/**
+ *  An unsigned integer of three 32-bit limbs, least significant first, for carrying
+ *  recombined coefficients.
+ */
+
+struct crt_accumulator {
+    uint64_t limb[3] = {0, 0, 0};
+
+    /**
+     *  Adds lo + hi * 2^32, where lo and hi may exceed 32 bits.
+     */
+
+    inline void add(uint64_t lo, uint64_t hi) {
+        limb[0] += lo;
+        limb[1] += hi + (limb[0] >> 32);
+        limb[0] &= 0xffffffffu;
+        limb[2] += limb[1] >> 32;
+        limb[1] &= 0xffffffffu;
+    }
+
+    /**
+     *  Removes and returns the lowest 16 bits.
+     */
+
+    inline uint32_t shift16() {
+        const uint32_t low = uint32_t(limb[0] & 0xffffu);
+        limb[0] = limb[0] >> 16 | (limb[1] & 0xffffu) << 16;
+        limb[1] = limb[1] >> 16 | (limb[2] & 0xffffu) << 16;
+        limb[2] >>= 16;
+        return low;
+    }
+};
+
+}
+
+/**
+ *  Multiplies two non-negative integers exactly. The operands are split into 16-bit digits
+ *  and convolved modulo three primes with the NTT; each coefficient is recombined with the
+ *  Chinese remainder theorem (Garner's method) while the carries are propagated, so the
+ *  result is exact for operands of any size the transforms allow (2^24 digits in total).
+ *
+ *  @param a the first integer, as 32-bit limbs, least significant first.
+ *  @param b the second integer, laid out like a.
+ *  @return the product, laid out like a, with a.size() + b.size() limbs.
+ */
+
+inline std::vector<uint32_t> multiply_integers(const std::vector<uint32_t> &a, const std::vector<uint32_t> &b) {
+    constexpr uint32_t p1 = algebra_detail::crt_p1, p2 = algebra_detail::crt_p2, p3 = algebra_detail::crt_p3;
+    typedef montgomery<p2> m2;
+    typedef montgomery<p3> m3;
+
+    if(a.empty() || b.empty()) {
+        return std::vector<uint32_t>(a.size() + b.size(), 0);
+    }
+
+    std::vector<uint32_t> x(2 * a.size()), y(2 * b.size());
+    for(size_t i = 0; i < a.size(); ++ i) {
+        x[2 * i] = a[i] & 0xffffu;
+        x[2 * i + 1] = a[i] >> 16;
+    }
+    for(size_t i = 0; i < b.size(); ++ i) {
+        y[2 * i] = b[i] & 0xffffu;
+        y[2 * i + 1] = b[i] >> 16;
+    }
+
+    const std::vector<uint32_t> r1 = convolve_mod<p1>(x, y), r2 = convolve_mod<p2>(x, y), r3 = convolve_mod<p3>(x, y);
+
+    // Garner: c = r1 + p1 * (t2 + p2 * t3) with t2 < p2 and t3 < p3.
+
+    const uint32_t inv12 = m2::inverse(p1 % p2), inv123 = m3::inverse(m3::product(p1 % p3, p2 % p3));
+
+    std::vector<uint32_t> out(a.size() + b.size(), 0);
+    algebra_detail::crt_accumulator carry;
+    uint32_t half = 0;
+
+    for(size_t k = 0; k < 2 * out.size(); ++ k) {
+        if(k < r1.size()) {
+            const uint32_t t2 = m2::product((r2[k] + p2 - r1[k]) % p2, inv12);
+            const uint32_t partial = (r1[k] % p3 + m3::product(p1 % p3, t2)) % p3;
+            const uint32_t t3 = m3::product((r3[k] + p3 - partial) % p3, inv123);
+            const uint64_t c = t2 + uint64_t(p2) * t3;
+            carry.add(r1[k] + uint64_t(p1) * (c & 0xffffffffu), uint64_t(p1) * (c >> 32));
+        }
+
+        const uint32_t digit = carry.shift16();
+        if(k % 2 == 0) {
+            half = digit;
+        } else {
+            out[k / 2] = half | digit << 16;
+        }
+    }
+
+    return out;
+}
+
+#endif
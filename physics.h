@@ -10,10 +10,27 @@
 
 #define PHYSICS_H
 
+#include "batch.h"
+#include "blas.h"
+#include "cholesky.h"
+#include "convolution.h"
 #include "fft.h"
+#include "fftn.h"
+#include "fixed_matrix.h"
 #include "gauss.h"
+#include "instrument.h"
+#include "iterative.h"
+#include "lu.h"
+#include "mapped.h"
 #include "matrix.h"
+#include "ntt.h"
+#include "quaternion.h"
 #include "rot.h"
+#include "sparse.h"
+#include "symmetric.h"
+#include "transpose.h"
 #include "vector.h"
+#include "vector_batch.h"
+#include "view.h"
 
 #endif
@@ -0,0 +1,666 @@
+/**
+ *  quaternion.h
+ *  Purpose: unit quaternion rotations, their composition and interpolation, and batched forms
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef QUATERNION_H
+
+#define QUATERNION_H
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "allocator.h"
+#include "batch.h"
+#include "fixed_matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "vector.h"
+#include "vector_batch.h"
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/**
+ *  The Hamilton product (aw, ax, ay, az) (bw, bx, by, bz) in every lane of V, which may also
+ *  be T itself; the results are only written once every operand has been read.
+ */
+
+template <typename V>
+ALGEBRA_ALWAYS_INLINE void quaternion_product(const V &aw, const V &ax, const V &ay, const V &az, const V &bw,
+                                              const V &bx, const V &by, const V &bz, V &cw, V &cx, V &cy, V &cz) {
+    const V w = aw * bw - ax * bx - ay * by - az * bz;
+    const V x = aw * bx + ax * bw + ay * bz - az * by;
+    const V y = aw * by - ax * bz + ay * bw + az * bx;
+    const V z = aw * bz + ax * by - ay * bx + az * bw;
+    cw = w;
+    cx = x;
+    cy = y;
+    cz = z;
+}
+
+/**
+ *  The rotation matrix of the unit quaternion (w, x, y, z) in every lane, r[row * 3 + column].
+ */
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void quaternion_matrix(const V &w, const V &x, const V &y, const V &z, V r[9]) {
+    const V x2 = x * T(2), y2 = y * T(2), z2 = z * T(2);
+    const V xx = x * x2, yy = y * y2, zz = z * z2;
+    const V xy = x * y2, xz = x * z2, yz = y * z2;
+    const V wx = w * x2, wy = w * y2, wz = w * z2;
+
+    r[0] = T(1) - (yy + zz);    r[1] = xy - wz;             r[2] = xz + wy;
+    r[3] = xy + wz;             r[4] = T(1) - (xx + zz);    r[5] = yz - wx;
+    r[6] = xz - wy;             r[7] = yz + wx;             r[8] = T(1) - (xx + yy);
+}
+
+/**
+ *  Rotates (vx, vy, vz) by the unit quaternion (w, x, y, z) in every lane, as
+ *  v + w t + u ^ t with u = (x, y, z) and t = 2 u ^ v: two cross products, no matrix.
+ */
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void quaternion_rotate(const V &w, const V &x, const V &y, const V &z, V &vx, V &vy, V &vz) {
+    const V tx = (y * vz - z * vy) * T(2), ty = (z * vx - x * vz) * T(2), tz = (x * vy - y * vx) * T(2);
+    const V rx = vx + w * tx + (y * tz - z * ty);
+    const V ry = vy + w * ty + (z * tx - x * tz);
+    const V rz = vz + w * tz + (x * ty - y * tx);
+    vx = rx;
+    vy = ry;
+    vz = rz;
+}
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+/**
+ *  quaternion class, a rotation in 3D stored as w + xi + yj + zk. Four values take the place of
+ *  the nine of a rotation matrix, two rotations compose in 16 multiplications rather than 27,
+ *  and rotations can be interpolated smoothly with slerp and nlerp. Every operation except
+ *  magnitude and normalize expects a unit quaternion.
+ *
+ *  @param T the data type being stored.
+ */
+
+template <typename T = double>
+class quaternion {
+
+    public:
+
+    /**
+     *  The scalar part w and the vector part (x, y, z).
+     */
+
+    T w, x, y, z;
+
+    /**
+     *  Default quaternion constructor, the identity rotation.
+     */
+
+    constexpr quaternion() : w(1), x(0), y(0), z(0) {}
+
+    /**
+     *  Constructor for a quaternion from its components.
+     *
+     *  @param W the scalar part.
+     *  @param X the i component.
+     *  @param Y the j component.
+     *  @param Z the k component.
+     */
+
+    constexpr quaternion(T W, T X, T Y, T Z) : w(W), x(X), y(Y), z(Z) {}
+
+    /**
+     *  Returns the rotation about x, then y, then z, the same rotation as euler_angle. Each
+     *  half angle's sine and cosine are computed once and combined in closed form.
+     *
+     *  @param theta_x the rotation about the x axis, in radians.
+     *  @param theta_y the rotation about the y axis, in radians.
+     *  @param theta_z the rotation about the z axis, in radians.
+     *  @return the unit quaternion of the rotation.
+     */
+
+    static inline quaternion from_euler(T theta_x, T theta_y, T theta_z) {
+        using std::cos;
+        using std::sin;
+
+        const T cx = cos(theta_x / 2), sx = sin(theta_x / 2);
+        const T cy = cos(theta_y / 2), sy = sin(theta_y / 2);
+        const T cz = cos(theta_z / 2), sz = sin(theta_z / 2);
+
+        return quaternion(cz * cy * cx + sz * sy * sx, cz * cy * sx - sz * sy * cx, cz * sy * cx + sz * cy * sx,
+                          sz * cy * cx - cz * sy * sx);
+    }
+
+    /**
+     *  Returns the rotation by an angle about an axis.
+     *
+     *  @param axis the axis of rotation; need not be of unit length, but must not be zero.
+     *  @param theta the angle, in radians, counterclockwise when looking down the axis.
+     *  @return the unit quaternion of the rotation.
+     */
+
+    static inline quaternion from_axis_angle(const vector<T> &axis, T theta) {
+        using std::cos;
+        using std::sin;
+        using std::sqrt;
+
+        const T s = sin(theta / 2) / sqrt(axis.magnitude());
+        return quaternion(cos(theta / 2), axis.x * s, axis.y * s, axis.z * s);
+    }
+
+    /**
+     *  Composes two rotations (the Hamilton product).
+     *
+     *  @param q the rotation to apply first.
+     *  @return the rotation applying q, then this one.
+     */
+
+    inline quaternion operator * (const quaternion &q) const {
+        quaternion ret;
+        algebra_detail::quaternion_product(w, x, y, z, q.w, q.x, q.y, q.z, ret.w, ret.x, ret.y, ret.z);
+        return ret;
+    }
+
+    /**
+     *  Negates every component. The result is the same rotation.
+     *
+     *  @return the quaternion with every component negated.
+     */
+
+    inline quaternion operator - () const {
+        return quaternion(-w, -x, -y, -z);
+    }
+
+    /**
+     *  Returns the conjugate, which for a unit quaternion is the inverse rotation.
+     *
+     *  @return the quaternion with its vector part negated.
+     */
+
+    inline quaternion conjugate() const {
+        return quaternion(w, -x, -y, -z);
+    }
+
+    /**
+     *  Computes the four dimensional dot product of two quaternions, the cosine of half the
+     *  angle between the rotations when both are unit quaternions.
+     *
+     *  @param q the quaternion to take the dot product with.
+     *  @return the dot product.
+     */
+
+    inline T dot(const quaternion &q) const {
+        return w * q.w + x * q.x + y * q.y + z * q.z;
+    }
+
+    /**
+     *  Returns the magnitude squared of the quaternion, as vector::magnitude does.
+     *
+     *  @return the magnitude of the quaternion, squared.
+     */
+
+    inline T magnitude() const {
+        return dot(*this);
+    }
+
+    /**
+     *  Scales the quaternion to unit length, correcting the drift of a long chain of products.
+     *
+     *  @return the unit quaternion in the same direction.
+     */
+
+    inline quaternion normalize() const {
+        using std::sqrt;
+
+        const T s = T(1) / sqrt(magnitude());
+        return quaternion(w * s, x * s, y * s, z * s);
+    }
+
+    /**
+     *  Rotates a vector.
+     *
+     *  @param v the vector to rotate.
+     *  @return the rotated vector, equal to to_matrix() times v.
+     */
+
+    inline vector<T> rotate(const vector<T> &v) const {
+        T vx = v.x, vy = v.y, vz = v.z;
+        algebra_detail::quaternion_rotate<T, T>(w, x, y, z, vx, vy, vz);
+        return vector<T>(vx, vy, vz);
+    }
+
+    /**
+     *  Returns the rotational matrix.
+     *
+     *  @return a 3x3 matrix representing the rotation.
+     */
+
+    inline fixed_matrix<T, 3, 3> to_matrix() const {
+        fixed_matrix<T, 3, 3> ret;
+        algebra_detail::quaternion_matrix<T, T>(w, x, y, z, ret.data());
+        return ret;
+    }
+};
+
+/**
+ *  Interpolates between two rotations by normalizing their linear blend, along the shorter of
+ *  the two arcs. Cheaper than slerp, but the rotation does not advance at a constant rate: it
+ *  is fastest at t = 1/2.
+ *
+ *  @param a the rotation at t = 0.
+ *  @param b the rotation at t = 1.
+ *  @param t the interpolation parameter, in [0, 1].
+ *  @return the interpolated unit quaternion.
+ */
+
+template <typename T>
+inline quaternion<T> nlerp(const quaternion<T> &a, const quaternion<T> &b, T t) {
+    const T s = a.dot(b) < 0 ? -t : t, r = T(1) - t;
+    return quaternion<T>(a.w * r + b.w * s, a.x * r + b.x * s, a.y * r + b.y * s, a.z * r + b.z * s).normalize();
+}
+
+/**
+ *  Interpolates between two rotations at a constant angular rate, along the shorter of the two
+ *  arcs. Rotations within about 2 degrees of each other are blended with nlerp, which is then
+ *  as accurate and avoids dividing by the sine of a tiny angle.
+ *
+ *  @param a the rotation at t = 0.
+ *  @param b the rotation at t = 1.
+ *  @param t the interpolation parameter, in [0, 1].
+ *  @return the interpolated unit quaternion.
+ */
+
+template <typename T>
+inline quaternion<T> slerp(const quaternion<T> &a, const quaternion<T> &b, T t) {
+    using std::acos;
+    using std::sin;
+
+    T d = a.dot(b), sign = 1;
+    if(d < 0) {
+        d = -d;
+        sign = -1;
+    }
+    if(d > T(0.9995)) {
+        return nlerp(a, b, t);
+    }
+
+    const T theta = acos(d), s = T(1) / sin(theta);
+    const T r = sin((T(1) - t) * theta) * s, u = sin(t * theta) * s * sign;
+    return quaternion<T>(a.w * r + b.w * u, a.x * r + b.x * u, a.y * r + b.y * u, a.z * r + b.z * u);
+}
+
+/**
+ *  quaternion_batch class, count rotations stored as a structure of arrays: each component of
+ *  every quaternion is contiguous, so batched kernels load the same component of many
+ *  rotations in one vector register.
+ *
+ *  @param T the data type being stored.
+ */
+
+template <typename T = double>
+class quaternion_batch {
+
+    private:
+
+    size_t count = 0;
+    std::vector<T, aligned_allocator<T>> lanes[4];
+
+    public:
+
+    /**
+     *  Constructor for a quaternion_batch. Every rotation is set to the identity.
+     *
+     *  @param Count the number of rotations.
+     */
+
+    inline explicit quaternion_batch(size_t Count = 0) : count(Count) {
+        lanes[0].assign(Count, T(1));
+        for(size_t i = 1; i < 4; ++ i)
+            lanes[i].assign(Count, T(0));
+    }
+
+    /**
+     *  Constructor for a quaternion_batch holding copies of some rotations.
+     *
+     *  @param q the rotations to copy.
+     */
+
+    inline explicit quaternion_batch(const std::vector<quaternion<T>> &q) : quaternion_batch(q.size()) {
+        for(size_t k = 0; k < count; ++ k)
+            set(k, q[k]);
+    }
+
+    /**
+     *  Retrieves the number of rotations in the batch.
+     *
+     *  @return the number of rotations.
+     */
+
+    inline size_t size() const {
+        return count;
+    }
+
+    /**
+     *  Retrieves one component of every rotation.
+     *
+     *  @param i the component: 0 for w, 1 for x, 2 for y, 3 for z.
+     *  @return a contiguous array of size() values.
+     */
+
+    inline T *component(size_t i) {
+        assert(i < 4);
+        return lanes[i].data();
+    }
+
+    inline const T *component(size_t i) const {
+        assert(i < 4);
+        return lanes[i].data();
+    }
+
+    /**
+     *  Copies one rotation out of the batch.
+     *
+     *  @param k the index of the rotation.
+     *  @return the rotation.
+     */
+
+    inline quaternion<T> get(size_t k) const {
+        assert(k < count);
+        return quaternion<T>(lanes[0][k], lanes[1][k], lanes[2][k], lanes[3][k]);
+    }
+
+    /**
+     *  Stores one rotation into the batch.
+     *
+     *  @param k the index of the rotation.
+     *  @param q the rotation to store.
+     */
+
+    inline void set(size_t k, const quaternion<T> &q) {
+        assert(k < count);
+        lanes[0][k] = q.w;
+        lanes[1][k] = q.x;
+        lanes[2][k] = q.y;
+        lanes[3][k] = q.z;
+    }
+
+    /**
+     *  Retrieves the component pointers expected by the batched kernels.
+     *
+     *  @param out receives component(i) at out[i].
+     */
+
+    inline void pointers(T *out[4]) {
+        for(size_t i = 0; i < 4; ++ i)
+            out[i] = lanes[i].data();
+    }
+
+    inline void pointers(const T *out[4]) const {
+        for(size_t i = 0; i < 4; ++ i)
+            out[i] = lanes[i].data();
+    }
+};
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+struct quaternion_compose_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *a, const T *const *b, T *const *c) {
+        const V aw = simd_load<V>(a[0] + k), ax = simd_load<V>(a[1] + k), ay = simd_load<V>(a[2] + k),
+                az = simd_load<V>(a[3] + k);
+        const V bw = simd_load<V>(b[0] + k), bx = simd_load<V>(b[1] + k), by = simd_load<V>(b[2] + k),
+                bz = simd_load<V>(b[3] + k);
+        V cw, cx, cy, cz;
+        quaternion_product(aw, ax, ay, az, bw, bx, by, bz, cw, cx, cy, cz);
+        simd_store(c[0] + k, cw);
+        simd_store(c[1] + k, cx);
+        simd_store(c[2] + k, cy);
+        simd_store(c[3] + k, cz);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *a, const T *const *b,
+                                          T *const *c) {
+        vector_batch_loop<quaternion_compose_kernel, W, T>(begin, end, a, b, c);
+    }
+};
+
+/**
+ *  Rotates vector k by quaternion k.
+ */
+
+struct quaternion_rotate_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *q, const T *const *x, T *const *y) {
+        const V w = simd_load<V>(q[0] + k), qx = simd_load<V>(q[1] + k), qy = simd_load<V>(q[2] + k),
+                qz = simd_load<V>(q[3] + k);
+        V vx = simd_load<V>(x[0] + k), vy = simd_load<V>(x[1] + k), vz = simd_load<V>(x[2] + k);
+        quaternion_rotate<V, T>(w, qx, qy, qz, vx, vy, vz);
+        simd_store(y[0] + k, vx);
+        simd_store(y[1] + k, vy);
+        simd_store(y[2] + k, vz);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *q, const T *const *x,
+                                          T *const *y) {
+        vector_batch_loop<quaternion_rotate_kernel, W, T>(begin, end, q, x, y);
+    }
+};
+
+/**
+ *  Rotates every vector by one rotation, given as its nine matrix entries r[row * 3 + column]:
+ *  nine multiply-adds per vector, which is cheaper than the 15 of quaternion_rotate.
+ */
+
+struct fixed_rotate_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *r, const T *const *x, T *const *y) {
+        const V vx = simd_load<V>(x[0] + k), vy = simd_load<V>(x[1] + k), vz = simd_load<V>(x[2] + k);
+        simd_store(y[0] + k, V(vx * r[0] + vy * r[1] + vz * r[2]));
+        simd_store(y[1] + k, V(vx * r[3] + vy * r[4] + vz * r[5]));
+        simd_store(y[2] + k, V(vx * r[6] + vy * r[7] + vz * r[8]));
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *r, const T *const *x, T *const *y) {
+        vector_batch_loop<fixed_rotate_kernel, W, T>(begin, end, r, x, y);
+    }
+};
+
+struct quaternion_matrix_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *q, T *const *m) {
+        const V w = simd_load<V>(q[0] + k), x = simd_load<V>(q[1] + k), y = simd_load<V>(q[2] + k),
+                z = simd_load<V>(q[3] + k);
+        V r[9];
+        quaternion_matrix<V, T>(w, x, y, z, r);
+        for(size_t i = 0; i < 9; ++ i)
+            simd_store(m[i] + k, r[i]);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *q, T *const *m) {
+        vector_batch_loop<quaternion_matrix_kernel, W, T>(begin, end, q, m);
+    }
+};
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+/**
+ *  Builds count rotations from per-item Euler angles, as quaternion::from_euler does, split
+ *  over the thread pool in chunks of vector_batch_grain.
+ *
+ *  @param theta_x the rotations about the x axis, in radians.
+ *  @param theta_y the rotations about the y axis, in radians.
+ *  @param theta_z the rotations about the z axis, in radians.
+ *  @param out receives the rotations; resized to count if needed.
+ */
+
+template <typename T>
+inline void batch_euler_quaternion(size_t count, const T *theta_x, const T *theta_y, const T *theta_z,
+                                   quaternion_batch<T> &out) {
+    if(out.size() != count) {
+        out = quaternion_batch<T>(count);
+    }
+
+    T *q[4];
+    out.pointers(q);
+
+    parallel_for(0, count, vector_batch_grain, [&](size_t k0, size_t k1) {
+        for(size_t k = k0; k < k1; ++ k) {
+            const quaternion<T> r = quaternion<T>::from_euler(theta_x[k], theta_y[k], theta_z[k]);
+            q[0][k] = r.w;
+            q[1][k] = r.x;
+            q[2][k] = r.y;
+            q[3][k] = r.z;
+        }
+    });
+}
+
+/**
+ *  Composes count pairs of rotations, c[k] = a[k] * b[k], in one vectorised pass.
+ *
+ *  @param count the number of rotations.
+ *  @param a component pointers (w, x, y, z) of the rotations applied second.
+ *  @param b component pointers of the rotations applied first.
+ *  @param c component pointers of the results; may be a or b.
+ */
+
+template <typename T>
+inline void batch_compose(size_t count, const T *const a[4], const T *const b[4], T *const c[4]) {
+    algebra_detail::vector_batch_for<algebra_detail::quaternion_compose_kernel, T>(count, a, b, c);
+}
+
+/**
+ *  Composes two batches of rotations, c[k] = a[k] * b[k].
+ *
+ *  @param a the rotations applied second.
+ *  @param b the rotations applied first.
+ *  @param c receives the compositions; resized if needed, and may be a or b.
+ */
+
+template <typename T>
+inline void batch_compose(const quaternion_batch<T> &a, const quaternion_batch<T> &b, quaternion_batch<T> &c) {
+    assert(a.size() == b.size());
+
+    if(c.size() != a.size()) {
+        c = quaternion_batch<T>(a.size());
+    }
+
+    const T *pa[4], *pb[4];
+    T *pc[4];
+    a.pointers(pa);
+    b.pointers(pb);
+    c.pointers(pc);
+
+    batch_compose<T>(a.size(), pa, pb, pc);
+}
+
+/**
+ *  Rotates count vectors, each by its own rotation, y[k] = q[k].rotate(x[k]), in one
+ *  vectorised pass.
+ *
+ *  @param count the number of vectors.
+ *  @param q component pointers (w, x, y, z) of the rotations.
+ *  @param x component pointers of the input vectors.
+ *  @param y component pointers of the output vectors; may be x.
+ */
+
+template <typename T>
+inline void batch_rotate(size_t count, const T *const q[4], const T *const x[3], T *const y[3]) {
+    algebra_detail::vector_batch_for<algebra_detail::quaternion_rotate_kernel, T>(count, q, x, y);
+}
+
+template <typename T>
+inline void batch_rotate(const quaternion_batch<T> &q, const vector_batch<T> &x, vector_batch<T> &y) {
+    assert(q.size() == x.size());
+
+    if(y.size() != x.size()) {
+        y = vector_batch<T>(x.size());
+    }
+
+    const T *pq[4], *px[3];
+    T *py[3];
+    q.pointers(pq);
+    x.pointers(px);
+    y.pointers(py);
+
+    batch_rotate<T>(x.size(), pq, px, py);
+}
+
+/**
+ *  Rotates count vectors by the same rotation, y[k] = q.rotate(x[k]). The rotation is turned
+ *  into a matrix once, so each vector costs nine multiply-adds.
+ *
+ *  @param q the rotation.
+ *  @param count the number of vectors.
+ *  @param x component pointers of the input vectors.
+ *  @param y component pointers of the output vectors; may be x.
+ */
+
+template <typename T>
+inline void batch_rotate(const quaternion<T> &q, size_t count, const T *const x[3], T *const y[3]) {
+    const fixed_matrix<T, 3, 3> r = q.to_matrix();
+    algebra_detail::vector_batch_for<algebra_detail::fixed_rotate_kernel, T>(count, r.data(), x, y);
+}
+
+template <typename T>
+inline void batch_rotate(const quaternion<T> &q, const vector_batch<T> &x, vector_batch<T> &y) {
+    if(y.size() != x.size()) {
+        y = vector_batch<T>(x.size());
+    }
+
+    const T *px[3];
+    T *py[3];
+    x.pointers(px);
+    y.pointers(py);
+
+    batch_rotate<T>(q, x.size(), px, py);
+}
+
+/**
+ *  Converts a batch of rotations to matrices, for batch_apply or batch_multiply.
+ *
+ *  @param q the rotations.
+ *  @param out receives the rotation matrices; resized to q.size() if needed.
+ */
+
+template <typename T>
+inline void batch_to_matrix(const quaternion_batch<T> &q, matrix_batch<3, T> &out) {
+    if(out.size() != q.size()) {
+        out = matrix_batch<3, T>(q.size());
+    }
+
+    const T *pq[4];
+    T *pm[9];
+    q.pointers(pq);
+    out.pointers(pm);
+
+    algebra_detail::vector_batch_for<algebra_detail::quaternion_matrix_kernel, T>(q.size(), pq, pm);
+}
+
+#endif
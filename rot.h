@@ -8,16 +8,46 @@
 
 #ifndef ROT_H
 
+#define ROT_H
+
 #include <cmath>
 
-#include "matrix.h"
+#include "batch.h"
+#include "fixed_matrix.h"
+
+/**
+ * Writes the entries of R = Rz * Ry * Rx, the rotation about x, then y, then z, to out.
+ * Each angle's sine and cosine are computed once and combined in closed form.
+ *
+ * @param out receives the nine entries, row-major, each at out[r * 3 + c][k].
+ * @param k the index to write at.
+ */
+
+template <typename T>
+inline void euler_rotation(T theta_x, T theta_y, T theta_z, T *const out[9], size_t k) {
+    using std::cos;
+    using std::sin;
+
+    const T cx = cos(theta_x), sx = sin(theta_x);
+    const T cy = cos(theta_y), sy = sin(theta_y);
+    const T cz = cos(theta_z), sz = sin(theta_z);
+
+    out[0][k] = cz * cy;    out[1][k] = cz * sy * sx - sz * cx;     out[2][k] = cz * sy * cx + sz * sx;
+    out[3][k] = sz * cy;    out[4][k] = sz * sy * sx + cz * cx;     out[5][k] = sz * sy * cx - cz * sx;
+    out[6][k] = -sy;        out[7][k] = cy * sx;                    out[8][k] = cy * cx;
+}
 
 /**
  * Euler Angle class, for computing rotations in 3D
  */
 
 class euler_angle {
-    matrix<long double>m;
+
+    private:
+
+    fixed_matrix<long double, 3, 3> m;
+
+    public:
 
     /**
      * Constructor for an euler_angle
@@ -28,21 +58,11 @@ class euler_angle {
      */
 
     euler_angle(long double theta_x, long double theta_y, long double theta_z) {
-        m = matrix<long double>(3, 3);
-        matrix<long double> x = matrix<long double>(3, 3);
-        x(0, 0) = 1.0;              x(0, 1) = 0.0;              x(0, 2) = 0.0;
-        x(1, 0) = 0.0;              x(1, 1) = cos(theta_x);     x(0, 2) = -sin(theta_x);
-        x(2, 0) = 0.0;              x(2, 1) = sin(theta_x);     x(2, 2) = cos(theta_x);
-        matrix<long double> y = matrix<long double>(3, 3);
-        y(0, 0) = cos(theta_y);     y(0, 1) = 0.0;              y(0, 2) = sin(theta_y);
-        y(1, 0) = 0.0;              y(1, 1) = 1.0;              y(1, 2) = 0.0;
-        y(2, 0) = -sin(theta_y);    y(2, 1) = 0.0;              y(2, 2) = cos(theta_y);
-        matrix<long double> z = matrix<long double>(3, 3);
-        z(0, 0) = cos(theta_z);     z(0, 1) = -sin(theta_z);    z(0, 2) = 0.0;
-        z(1, 0) = sin(theta_z);     z(1, 1) = cos(theta_z);     z(1, 2) = 0.0;
-        z(2, 0) = 0.0;             z(2, 1) = 0.0;              z(2, 2) = 1.0;
-
-        m = z * y * x;
+        long double *out[9];
+        for(size_t i = 0; i < 9; ++ i)
+            out[i] = m.data() + i;
+
+        euler_rotation(theta_x, theta_y, theta_z, out, 0);
     }
 
     /**
@@ -50,9 +70,33 @@ class euler_angle {
      *
      * @return a 3x3 matrix representing the Euler Angle.
      */
-    inline matrix<long double> to_matrix() const {
+    inline fixed_matrix<long double, 3, 3> to_matrix() const {
         return m;
     }
+};
+
+/**
+ * Builds count rotation matrices from per-item Euler angles, as euler_angle does, without
+ * allocating per item. Apply them with batch_apply or compose them with batch_multiply.
+ *
+ * @param theta_x the rotations about the x axis, in radians
+ * @param theta_y the rotations about the y axis, in radians
+ * @param theta_z the rotations about the z axis, in radians
+ * @param out receives the rotations; resized to count if needed
+ */
+
+template <typename T>
+inline void batch_euler_angle(size_t count, const T *theta_x, const T *theta_y, const T *theta_z,
+                              matrix_batch<3, T> &out) {
+    if(out.size() != count) {
+        out = matrix_batch<3, T>(count);
+    }
+
+    T *entries[9];
+    out.pointers(entries);
+
+    for(size_t k = 0; k < count; ++ k)
+        euler_rotation(theta_x[k], theta_y[k], theta_z[k], entries, k);
 }
 
 #endif
@@ -0,0 +1,426 @@
+/**
+ *  simd.h
+ *  Purpose: vectorised elementwise and reduction kernels with runtime CPU dispatch
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef SIMD_H
+
+#define SIMD_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__GNUC__)
+#define ALGEBRA_VECTOR_EXTENSIONS 1
+#define ALGEBRA_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALGEBRA_VECTOR_EXTENSIONS 0
+#define ALGEBRA_ALWAYS_INLINE inline
+#endif
+
+#if ALGEBRA_VECTOR_EXTENSIONS && (defined(__x86_64__) || defined(__i386__))
+#define ALGEBRA_X86_DISPATCH 1
+#define ALGEBRA_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define ALGEBRA_TARGET_AVX512 __attribute__((target("avx512f,fma")))
+#else
+#define ALGEBRA_X86_DISPATCH 0
+#endif
+
+/**
+ *  The width, in bytes, of the vectors the compiler may use without runtime dispatch.
+ */
+
+#if defined(__AVX512F__)
+#define ALGEBRA_VECTOR_BYTES 64
+#elif defined(__AVX__)
+#define ALGEBRA_VECTOR_BYTES 32
+#else
+#define ALGEBRA_VECTOR_BYTES 16
+#endif
+
+/**
+ *  The vector instruction sets the kernels are compiled for, in increasing order of width.
+ */
+
+enum class simd_isa {
+    scalar,
+    neon,
+    avx2,
+    avx512
+};
+
+/**
+ *  Detects the widest instruction set supported by the running CPU.
+ *
+ *  @return the best simd_isa available.
+ */
+
+inline simd_isa simd_detect() {
+#if ALGEBRA_X86_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")) {
+        return simd_isa::avx512;
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return simd_isa::avx2;
+    }
+    return simd_isa::scalar;
+#elif ALGEBRA_VECTOR_EXTENSIONS && (defined(__ARM_NEON) || defined(__aarch64__))
+    return simd_isa::neon;
+#else
+    return simd_isa::scalar;
+#endif
+}
+
+/**
+ *  Retrieves the instruction set the kernels dispatch to. Defaults to simd_detect(); it may
+ *  be lowered (never raised) to compare code paths.
+ *
+ *  @return a reference to the active simd_isa.
+ */
+
+inline simd_isa &simd_level() {
+    static simd_isa level = simd_detect();
+    return level;
+}
+
+/**
+ *  Whether the vectorised kernels exist for the data type T.
+ */
+
+template <typename T>
+struct simd_supported {
+    static constexpr bool value = ALGEBRA_VECTOR_EXTENSIONS &&
+        (std::is_same<T, float>::value || std::is_same<T, double>::value);
+};
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+
+// The kernels pass wide vectors by value only between always-inline functions, so the
+// ABI of those vectors never crosses a real call.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/**
+ *  Runs Kernel with W-byte vectors in a function compiled for the matching instruction set,
+ *  so the always-inline kernel body is generated with that instruction set.
+ */
+
+template <typename Kernel, typename... Args>
+inline auto simd_run_baseline(Args... args) {
+    return Kernel::template run<ALGEBRA_VECTOR_BYTES>(args...);
+}
+
+#if ALGEBRA_X86_DISPATCH
+
+template <typename Kernel, typename... Args>
+ALGEBRA_TARGET_AVX2 auto simd_run_avx2(Args... args) {
+    return Kernel::template run<32>(args...);
+}
+
+template <typename Kernel, typename... Args>
+ALGEBRA_TARGET_AVX512 auto simd_run_avx512(Args... args) {
+    return Kernel::template run<64>(args...);
+}
+
+#endif
+
+/**
+ *  Calls Kernel on the widest instruction set allowed by simd_level().
+ */
+
+template <typename Kernel, typename... Args>
+inline auto simd_dispatch(Args... args) {
+#if ALGEBRA_X86_DISPATCH
+    switch(simd_level()) {
+        case simd_isa::avx512:
+            return simd_run_avx512<Kernel>(args...);
+        case simd_isa::avx2:
+            return simd_run_avx2<Kernel>(args...);
+        default:
+            break;
+    }
+#endif
+    return simd_run_baseline<Kernel>(args...);
+}
+
+/**
+ *  Loads and stores of W-byte vectors from arbitrarily aligned memory. V may also be T
+ *  itself, so one kernel body can serve both a vector loop and its scalar remainder.
+ */
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE V simd_load(const T *p) {
+    V v;
+    std::memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void simd_store(T *p, const V &v) {
+    std::memcpy(p, &v, sizeof(V));
+}
+
+struct add_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, const T *a, const T *b, T *out) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        size_t i = 0;
+        for(; i < n / L * L; i += L)
+            simd_store(out + i, simd_load<vec>(a + i) + simd_load<vec>(b + i));
+        for(; i < n; ++ i)
+            out[i] = a[i] + b[i];
+    }
+};
+
+struct subtract_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, const T *a, const T *b, T *out) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        size_t i = 0;
+        for(; i < n / L * L; i += L)
+            simd_store(out + i, simd_load<vec>(a + i) - simd_load<vec>(b + i));
+        for(; i < n; ++ i)
+            out[i] = a[i] - b[i];
+    }
+};
+
+struct negate_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, const T *a, T *out) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        size_t i = 0;
+        for(; i < n / L * L; i += L)
+            simd_store(out + i, -simd_load<vec>(a + i));
+        for(; i < n; ++ i)
+            out[i] = -a[i];
+    }
+};
+
+struct scale_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, const T *a, T t, T *out) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        size_t i = 0;
+        for(; i < n / L * L; i += L)
+            simd_store(out + i, simd_load<vec>(a + i) * t);
+        for(; i < n; ++ i)
+            out[i] = a[i] * t;
+    }
+};
+
+struct axpy_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t n, T alpha, const T *x, T *y) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        size_t i = 0;
+        for(; i < n / L * L; i += L)
+            simd_store(y + i, simd_load<vec>(y + i) + simd_load<vec>(x + i) * alpha);
+        for(; i < n; ++ i)
+            y[i] = y[i] + alpha * x[i];
+    }
+};
+
+/**
+ *  Reductions keep four independent accumulators to hide the latency of the vector adds.
+ */
+
+struct sum_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE T run(size_t n, const T *a) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        vec acc[4] = {};
+        size_t i = 0;
+        for(; i + 4 * L <= n; i += 4 * L)
+            for(size_t u = 0; u < 4; ++ u)
+                acc[u] += simd_load<vec>(a + i + u * L);
+        for(; i < n / L * L; i += L)
+            acc[0] += simd_load<vec>(a + i);
+        const vec total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        T ret = T(0);
+        for(size_t l = 0; l < L; ++ l)
+            ret += total[l];
+        for(; i < n; ++ i)
+            ret += a[i];
+        return ret;
+    }
+};
+
+struct dot_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE T run(size_t n, const T *a, const T *b) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        vec acc[4] = {};
+        size_t i = 0;
+        for(; i + 4 * L <= n; i += 4 * L)
+            for(size_t u = 0; u < 4; ++ u)
+                acc[u] += simd_load<vec>(a + i + u * L) * simd_load<vec>(b + i + u * L);
+        for(; i < n / L * L; i += L)
+            acc[0] += simd_load<vec>(a + i) * simd_load<vec>(b + i);
+        const vec total = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        T ret = T(0);
+        for(size_t l = 0; l < L; ++ l)
+            ret += total[l];
+        for(; i < n; ++ i)
+            ret += a[i] * b[i];
+        return ret;
+    }
+};
+
+#pragma GCC diagnostic pop
+
+#else
+
+template <typename V, typename T>
+inline V simd_load(const T *p) {
+    return *p;
+}
+
+template <typename V, typename T>
+inline void simd_store(T *p, const V &v) {
+    *p = v;
+}
+
+#endif
+
+}
+
+/**
+ *  Computes out[i] = a[i] + b[i]. out may alias a or b.
+ *
+ *  @param n the number of elements.
+ */
+
+template <typename T>
+inline void simd_add(size_t n, const T *a, const T *b, T *out) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::add_kernel>(n, a, b, out);
+    }
+#endif
+    for(size_t i = 0; i < n; ++ i)
+        out[i] = a[i] + b[i];
+}
+
+/**
+ *  Computes out[i] = a[i] - b[i]. out may alias a or b.
+ *
+ *  @param n the number of elements.
+ */
+
+template <typename T>
+inline void simd_subtract(size_t n, const T *a, const T *b, T *out) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::subtract_kernel>(n, a, b, out);
+    }
+#endif
+    for(size_t i = 0; i < n; ++ i)
+        out[i] = a[i] - b[i];
+}
+
+/**
+ *  Computes out[i] = -a[i]. out may alias a.
+ *
+ *  @param n the number of elements.
+ */
+
+template <typename T>
+inline void simd_negate(size_t n, const T *a, T *out) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::negate_kernel>(n, a, out);
+    }
+#endif
+    for(size_t i = 0; i < n; ++ i)
+        out[i] = -a[i];
+}
+
+/**
+ *  Computes out[i] = a[i] * t. out may alias a.
+ *
+ *  @param n the number of elements.
+ */
+
+template <typename T>
+inline void simd_scale(size_t n, const T *a, T t, T *out) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::scale_kernel>(n, a, t, out);
+    }
+#endif
+    for(size_t i = 0; i < n; ++ i)
+        out[i] = a[i] * t;
+}
+
+/**
+ *  Computes y[i] = y[i] + alpha * x[i].
+ *
+ *  @param n the number of elements.
+ */
+
+template <typename T>
+inline void simd_axpy(size_t n, T alpha, const T *x, T *y) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::axpy_kernel>(n, alpha, x, y);
+    }
+#endif
+    for(size_t i = 0; i < n; ++ i)
+        y[i] = y[i] + alpha * x[i];
+}
+
+/**
+ *  Sums the elements of a.
+ *
+ *  @param n the number of elements.
+ *  @return the sum of the n elements.
+ */
+
+template <typename T>
+inline T simd_sum(size_t n, const T *a) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::sum_kernel>(n, a);
+    }
+#endif
+    T ret = T(0);
+    for(size_t i = 0; i < n; ++ i)
+        ret = ret + a[i];
+    return ret;
+}
+
+/**
+ *  Computes the dot product of a and b.
+ *
+ *  @param n the number of elements.
+ *  @return the sum of a[i] * b[i].
+ */
+
+template <typename T>
+inline T simd_dot(size_t n, const T *a, const T *b) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return algebra_detail::simd_dispatch<algebra_detail::dot_kernel>(n, a, b);
+    }
+#endif
+    T ret = T(0);
+    for(size_t i = 0; i < n; ++ i)
+        ret = ret + a[i] * b[i];
+    return ret;
+}
+
+#endif
@@ -0,0 +1,442 @@
+/**
+ *  sparse.h
+ *  Purpose: sparse matrices in compressed row storage, and their products with dense data
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef SPARSE_H
+
+#define SPARSE_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+/**
+ *  One nonzero of a sparse matrix, for building it from (row, column, value) triplets.
+ */
+
+template <typename T>
+struct sparse_entry {
+    size_t row;
+    size_t column;
+    T value;
+};
+
+/**
+ *  sparse_matrix class, a matrix stored in compressed sparse row (CSR) form: the nonzeros of
+ *  row i are values()[row_offsets()[i] .. row_offsets()[i + 1]], at columns
+ *  column_indices()[...] in increasing order. Storage grows with the number of nonzeros, not
+ *  with rows() * columns().
+ *
+ *  The compressed sparse column (CSC) form of a matrix is the CSR form of its transpose, so
+ *  from_csc() and transpose() convert between the two.
+ *
+ *  @param T the data type being stored.
+ */
+
+template <typename T = double>
+class sparse_matrix {
+
+    private:
+
+    size_t n_rows = 0, n_columns = 0;
+    std::vector<size_t> offsets = std::vector<size_t>(1, 0);
+    std::vector<size_t> indices;
+    std::vector<T> entries;
+
+    /**
+     *  The number of rows whose products are worth handing to one task: enough of them to
+     *  cover a few thousand nonzeros.
+     */
+
+    inline size_t grain() const {
+        return std::max<size_t>(1, 4096 * n_rows / std::max<size_t>(1, nonzeros()));
+    }
+
+    public:
+
+    /**
+     *  Constructor for an empty 0 x 0 sparse_matrix.
+     */
+
+    inline sparse_matrix() = default;
+
+    /**
+     *  Constructor for a sparse_matrix with no nonzeros.
+     *
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     */
+
+    inline sparse_matrix(size_t Rows, size_t Columns)
+        : n_rows(Rows), n_columns(Columns), offsets(Rows + 1, 0) {}
+
+    /**
+     *  Constructor for a sparse_matrix from triplets, in any order. Entries at the same
+     *  position are summed. Runs in O(rows + nonzeros) time, plus the sort of each row.
+     *
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @param triplets the nonzeros.
+     */
+
+    inline sparse_matrix(size_t Rows, size_t Columns, const std::vector<sparse_entry<T>> &triplets)
+        : n_rows(Rows), n_columns(Columns), offsets(Rows + 1, 0) {
+        for(const auto &e : triplets) {
+            assert(e.row < Rows && e.column < Columns);
+            ++ offsets[e.row + 1];
+        }
+        for(size_t i = 0; i < Rows; ++ i)
+            offsets[i + 1] += offsets[i];
+
+        std::vector<std::pair<size_t, T>> sorted(triplets.size());
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for(const auto &e : triplets)
+            sorted[next[e.row] ++] = std::make_pair(e.column, e.value);
+
+        // Sort each row by column and merge duplicates, compacting in place. The sort is stable,
+        // so duplicates are summed in the order given.
+
+        size_t out = 0;
+        for(size_t i = 0; i < Rows; ++ i) {
+            const auto begin = sorted.begin() + offsets[i], end = sorted.begin() + offsets[i + 1];
+            std::stable_sort(begin, end, [](const std::pair<size_t, T> &a, const std::pair<size_t, T> &b) {
+                return a.first < b.first;
+            });
+            offsets[i] = out;
+            for(auto it = begin; it != end; ++ it) {
+                if(out > offsets[i] && sorted[out - 1].first == it->first) {
+                    sorted[out - 1].second += it->second;
+                } else {
+                    sorted[out ++] = *it;
+                }
+            }
+        }
+        offsets[Rows] = out;
+
+        indices.resize(out);
+        entries.resize(out);
+        for(size_t k = 0; k < out; ++ k) {
+            indices[k] = sorted[k].first;
+            entries[k] = sorted[k].second;
+        }
+    }
+
+    /**
+     *  Constructor for a sparse_matrix that adopts existing CSR arrays.
+     *
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @param Offsets Rows + 1 increasing offsets, starting at 0.
+     *  @param Indices the column of each nonzero, increasing within each row.
+     *  @param Values the value of each nonzero.
+     */
+
+    inline sparse_matrix(size_t Rows, size_t Columns, std::vector<size_t> Offsets,
+                         std::vector<size_t> Indices, std::vector<T> Values)
+        : n_rows(Rows), n_columns(Columns), offsets(std::move(Offsets)), indices(std::move(Indices)),
+          entries(std::move(Values)) {
+        assert(offsets.size() == Rows + 1 && offsets[0] == 0 && offsets[Rows] == indices.size());
+        assert(indices.size() == entries.size());
+    }
+
+    /**
+     *  Constructor for a sparse_matrix holding the nonzeros of a dense matrix.
+     *
+     *  @param m the dense matrix.
+     *  @param tolerance entries no larger than this in magnitude are dropped.
+     */
+
+    inline explicit sparse_matrix(const matrix<T> &m, T tolerance = T(0))
+        : n_rows(m.rows()), n_columns(m.columns()), offsets(m.rows() + 1, 0) {
+        for(size_t i = 0; i < n_rows; ++ i) {
+            for(size_t j = 0; j < n_columns; ++ j) {
+                if(std::abs(m(i,j)) > tolerance) {
+                    indices.push_back(j);
+                    entries.push_back(m(i,j));
+                }
+            }
+            offsets[i + 1] = indices.size();
+        }
+    }
+
+    /**
+     *  Builds a sparse_matrix from compressed sparse column arrays.
+     *
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @param Offsets Columns + 1 increasing offsets, starting at 0.
+     *  @param Indices the row of each nonzero, increasing within each column.
+     *  @param Values the value of each nonzero.
+     *  @return the matrix.
+     */
+
+    static inline sparse_matrix<T> from_csc(size_t Rows, size_t Columns, std::vector<size_t> Offsets,
+                                            std::vector<size_t> Indices, std::vector<T> Values) {
+        return sparse_matrix<T>(Columns, Rows, std::move(Offsets), std::move(Indices), std::move(Values)).transpose();
+    }
+
+    /**
+     *  Retrieves the number of rows.
+     *
+     *  @return the number of rows in the matrix.
+     */
+
+    inline size_t rows() const {
+        return n_rows;
+    }
+
+    /**
+     *  Retrieves the number of columns.
+     *
+     *  @return the number of columns in the matrix.
+     */
+
+    inline size_t columns() const {
+        return n_columns;
+    }
+
+    /**
+     *  Retrieves the number of stored nonzeros.
+     *
+     *  @return the number of nonzeros.
+     */
+
+    inline size_t nonzeros() const {
+        return entries.size();
+    }
+
+    /**
+     *  Retrieves the CSR arrays.
+     *
+     *  @return a pointer to the rows() + 1 row offsets, the nonzeros() column indices, or the
+     *  nonzeros() values.
+     */
+
+    inline const size_t *row_offsets() const {
+        return offsets.data();
+    }
+
+    inline const size_t *column_indices() const {
+        return indices.data();
+    }
+
+    inline const T *values() const {
+        return entries.data();
+    }
+
+    inline T *values() {
+        return entries.data();
+    }
+
+    /**
+     *  Retrieves entry (row, column), by binary search within the row.
+     *
+     *  @return the entry, or zero if it is not stored.
+     */
+
+    inline T operator () (size_t row, size_t column) const {
+        assert(row < n_rows && column < n_columns);
+        const auto begin = indices.begin() + offsets[row], end = indices.begin() + offsets[row + 1];
+        const auto it = std::lower_bound(begin, end, column);
+        return it != end && *it == column ? entries[it - indices.begin()] : T(0);
+    }
+
+    /**
+     *  Computes y = A x, with the rows spread over the thread pool.
+     *
+     *  @param x columns() values.
+     *  @param y receives rows() values; must not overlap x.
+     */
+
+    inline void multiply(const T *x, T *y) const {
+        parallel_for(0, n_rows, grain(), [&](size_t i0, size_t i1) {
+            for(size_t i = i0; i < i1; ++ i) {
+                T s = T(0);
+                for(size_t k = offsets[i]; k < offsets[i + 1]; ++ k)
+                    s += entries[k] * x[indices[k]];
+                y[i] = s;
+            }
+        });
+    }
+
+    /**
+     *  Computes the product with a vector.
+     *
+     *  @param x the vector; must hold columns() values.
+     *  @return the rows() values of A x.
+     */
+
+    inline std::vector<T> operator * (const std::vector<T> &x) const {
+        assert(x.size() == n_columns);
+        std::vector<T> y(n_rows);
+        multiply(x.data(), y.data());
+        return y;
+    }
+
+    /**
+     *  Computes the product with a dense matrix.
+     *
+     *  @param m the dense right operand.
+     *  @return the dense product.
+     */
+
+    inline matrix<T> operator * (const matrix<T> &m) const {
+        matrix<T> out;
+        multiply_into(out, *this, m);
+        return out;
+    }
+
+    /**
+     *  Computes the transpose, with a counting sort over the columns in O(rows + columns +
+     *  nonzeros) time. Its CSR arrays are the CSC arrays of this matrix.
+     *
+     *  @return the transposed matrix.
+     */
+
+    inline sparse_matrix<T> transpose() const {
+        std::vector<size_t> t_offsets(n_columns + 1, 0), t_indices(nonzeros());
+        std::vector<T> t_entries(nonzeros());
+
+        for(size_t k = 0; k < nonzeros(); ++ k)
+            ++ t_offsets[indices[k] + 1];
+        for(size_t j = 0; j < n_columns; ++ j)
+            t_offsets[j + 1] += t_offsets[j];
+
+        std::vector<size_t> next(t_offsets.begin(), t_offsets.end() - 1);
+        for(size_t i = 0; i < n_rows; ++ i) {
+            for(size_t k = offsets[i]; k < offsets[i + 1]; ++ k) {
+                const size_t p = next[indices[k]] ++;
+                t_indices[p] = i;
+                t_entries[p] = entries[k];
+            }
+        }
+
+        return sparse_matrix<T>(n_columns, n_rows, std::move(t_offsets), std::move(t_indices), std::move(t_entries));
+    }
+
+    /**
+     *  Expands the matrix into dense storage.
+     *
+     *  @return the dense matrix.
+     */
+
+    inline matrix<T> to_dense() const {
+        matrix<T> m(n_rows, n_columns);
+        for(size_t i = 0; i < n_rows; ++ i)
+            for(size_t k = offsets[i]; k < offsets[i + 1]; ++ k)
+                m(i, indices[k]) = entries[k];
+        return m;
+    }
+};
+
+/**
+ *  Multiplies a sparse matrix by a dense one into a preallocated result: each row of out
+ *  accumulates the rows of b picked out by the nonzeros of a, with the rows of out spread
+ *  over the thread pool. out is resized only if its shape differs.
+ *
+ *  @param out the matrix to store the product in; must not be b.
+ *  @param a the sparse left operand.
+ *  @param b the dense right operand.
+ */
+
+template <typename T>
+void multiply_into(matrix<T> &out, const sparse_matrix<T> &a, const matrix<T> &b) {
+    assert(a.columns() == b.rows());
+    assert(&out != &b);
+
+    out.resize(a.rows(), b.columns());
+
+    const size_t *offsets = a.row_offsets(), *indices = a.column_indices();
+    const T *values = a.values();
+    const size_t grain = std::max<size_t>(1, 4096 / std::max<size_t>(1, b.columns()));
+
+    parallel_for(0, a.rows(), grain, [&](size_t i0, size_t i1) {
+        for(size_t i = i0; i < i1; ++ i) {
+            T *row = out.data() + i * out.stride();
+            std::fill(row, row + b.columns(), T(0));
+            for(size_t k = offsets[i]; k < offsets[i + 1]; ++ k)
+                simd_axpy(b.columns(), values[k], b.data() + indices[k] * b.stride(), row);
+        }
+    });
+}
+
+/**
+ *  Multiplies a dense matrix by a sparse one into a preallocated result: row i of out
+ *  accumulates the rows of b scaled by row i of a. Rows of out are spread over the thread
+ *  pool. out is resized only if its shape differs.
+ *
+ *  @param out the matrix to store the product in; must not be a.
+ *  @param a the dense left operand.
+ *  @param b the sparse right operand.
+ */
+
+template <typename T>
+void multiply_into(matrix<T> &out, const matrix<T> &a, const sparse_matrix<T> &b) {
+    assert(a.columns() == b.rows());
+    assert(&out != &a);
+
+    out.resize(a.rows(), b.columns());
+
+    const size_t *offsets = b.row_offsets(), *indices = b.column_indices();
+    const T *values = b.values();
+    const size_t grain = std::max<size_t>(1, 4096 / std::max<size_t>(1, b.nonzeros() / std::max<size_t>(1, b.rows())));
+
+    parallel_for(0, a.rows(), grain, [&](size_t i0, size_t i1) {
+        for(size_t i = i0; i < i1; ++ i) {
+            T *row = out.data() + i * out.stride();
+            std::fill(row, row + b.columns(), T(0));
+            for(size_t k = 0; k < a.columns(); ++ k) {
+                const T t = a(i,k);
+                if(t == T(0)) continue;
+                for(size_t p = offsets[k]; p < offsets[k + 1]; ++ p)
+                    row[indices[p]] += t * values[p];
+            }
+        }
+    });
+}
+
+/**
+ *  Computes the product of a dense and a sparse matrix.
+ *
+ *  @param a the dense left operand.
+ *  @param b the sparse right operand.
+ *  @return the dense product.
+ */
+
+template <typename T>
+inline matrix<T> operator * (const matrix<T> &a, const sparse_matrix<T> &b) {
+    matrix<T> out;
+    multiply_into(out, a, b);
+    return out;
+}
+
+/**
+ *  Override to print the nonzeros of a sparse matrix with an std::ostream, one
+ *  "row column value" triplet per line.
+ *
+ *  @param out the ostream to print on.
+ *  @param m the matrix to print.
+ *  @return out.
+ */
+
+template <typename T>
+std::ostream& operator <<(std::ostream &out, const sparse_matrix<T> &m){
+    for(size_t i = 0; i < m.rows(); ++ i)
+        for(size_t k = m.row_offsets()[i]; k < m.row_offsets()[i + 1]; ++ k)
+            out << i << " " << m.column_indices()[k] << " " << m.values()[k] << "\n";
+    return out;
+}
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ *  symmetric.h
+ *  Purpose: packed storage for symmetric matrices, and Gram products that compute one triangle
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef SYMMETRIC_H
+
+#define SYMMETRIC_H
+
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "gemm.h"
+#include "matrix.h"
+
+/**
+ *  symmetric_matrix class, a symmetric matrix stored as its packed lower triangle: row i holds
+ *  entries (i,0) through (i,i), and starts at offset i (i + 1) / 2. Takes n (n + 1) / 2 entries
+ *  instead of n * n, and entry (i,j) is the same storage as entry (j,i).
+ *
+ *  @param T the data type being stored in the matrix.
+ */
+
+template <typename T = int>
+class symmetric_matrix {
+
+    private:
+
+    size_t n = 0;
+    std::vector<T> buffer;
+
+    static inline size_t offset(size_t row, size_t column) {
+        if(row < column) {
+            std::swap(row, column);
+        }
+        return row * (row + 1) / 2 + column;
+    }
+
+    public:
+
+    /**
+     *  Default constructor, an empty matrix.
+     */
+
+    inline symmetric_matrix() = default;
+
+    /**
+     *  Constructor for a symmetric_matrix of a given order.
+     *
+     *  @param N the number of rows (and columns).
+     *  @param value the value every entry starts as.
+     */
+
+    inline explicit symmetric_matrix(size_t N, const T &value = T()) : n(N), buffer(N * (N + 1) / 2, value) {}
+
+    /**
+     *  Constructor from a dense square matrix. Only its lower triangle is read; the matrix is
+     *  assumed to be symmetric.
+     *
+     *  @param m the matrix to pack.
+     */
+
+    template <typename U, typename A>
+    inline explicit symmetric_matrix(const matrix<U, A> &m) : symmetric_matrix(m.rows()) {
+        assert(m.rows() == m.columns());
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j <= i; ++ j)
+                buffer[offset(i, j)] = T(m(i,j));
+    }
+
+    /**
+     *  Retrieves the order of the matrix.
+     *
+     *  @return the number of rows (and columns).
+     */
+
+    inline size_t size() const {
+        return n;
+    }
+
+    /**
+     *  Retrieves the packed lower triangle, row after row.
+     *
+     *  @return a pointer to the n (n + 1) / 2 stored entries.
+     */
+
+    inline T *data() {
+        return buffer.data();
+    }
+
+    inline const T *data() const {
+        return buffer.data();
+    }
+
+    /**
+     *  Retrieves the entry at (row, column), which is also the entry at (column, row).
+     *
+     *  @param row the row the entry is in.
+     *  @param column the column the entry is in.
+     *  @return a reference to the entry.
+     */
+
+    inline T &operator () (size_t row, size_t column) {
+        return buffer[offset(row, column)];
+    }
+
+    inline const T &operator () (size_t row, size_t column) const {
+        return buffer[offset(row, column)];
+    }
+
+    /**
+     *  Expands the packed triangle into a dense matrix with both triangles filled in.
+     *
+     *  @return the dense n x n matrix.
+     */
+
+    inline matrix<T> to_matrix() const {
+        matrix<T> ret(n, n);
+
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j <= i; ++ j)
+                ret(i,j) = ret(j,i) = buffer[offset(i, j)];
+
+        return ret;
+    }
+
+    /**
+     *  Multiplies the matrix by a vector, reading each stored entry once for both of the
+     *  positions it stands for.
+     *
+     *  @param x the vector to multiply, of size n.
+     *  @return the product.
+     */
+
+    inline std::vector<T> operator *(const std::vector<T> &x) const {
+        assert(x.size() == n);
+        std::vector<T> y(n, T(0));
+
+        for(size_t i = 0; i < n; ++ i) {
+            const T *row = buffer.data() + offset(i, 0);
+            y[i] = y[i] + simd_dot(i, row, x.data()) + row[i] * x[i];
+            simd_axpy(i, x[i], row, y.data());
+        }
+
+        return y;
+    }
+};
+
+/**
+ *  Computes the Gram matrix a^T a into a preallocated dense result, through syrk so that only
+ *  one triangle is multiplied; the other is mirrored from it. out is resized only if its shape
+ *  differs.
+ *
+ *  @param out the matrix receiving a^T a; must not alias a.
+ *  @param a the matrix whose columns are multiplied pairwise.
+ */
+
+template <typename T>
+inline void gram_into(matrix<T> &out, const matrix<T> &a) {
+    const size_t n = a.columns();
+    out.resize(n, n);
+
+    syrk(n, a.rows(), T(1), a.data(), a.stride(), T(0), out.data(), out.stride());
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < i; ++ j)
+            out(j,i) = out(i,j);
+}
+
+/**
+ *  Computes the Gram matrix a^T a in packed form, through syrk so that only one triangle is
+ *  multiplied.
+ *
+ *  @param a the matrix whose columns are multiplied pairwise.
+ *  @return a^T a, a symmetric matrix of order a.columns().
+ */
+
+template <typename T>
+inline symmetric_matrix<T> gram(const matrix<T> &a) {
+    const size_t n = a.columns();
+    matrix<T> lower(n, n);
+    symmetric_matrix<T> ret(n);
+
+    syrk(n, a.rows(), T(1), a.data(), a.stride(), T(0), lower.data(), lower.stride());
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j <= i; ++ j)
+            ret(i,j) = lower(i,j);
+
+    return ret;
+}
+
+/**
+ *  Override to print a symmetric_matrix with an std::ostream, as its full square.
+ *
+ *  @param out the ostream to print on.
+ *  @param m the matrix to print.
+ *  @return out.
+ */
+
+template <typename T>
+std::ostream& operator <<(std::ostream &out, const symmetric_matrix<T> &m){
+    for(size_t i = 0; i < m.size(); ++ i){
+        for(size_t j = 0; j < m.size(); ++ j) {
+            out << m(i,j);
+            if(j < m.size() - 1){
+                out << " ";
+            }
+        }
+        out << "\n";
+    }
+    return out;
+}
+
+#endif
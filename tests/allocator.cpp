@@ -0,0 +1,203 @@
+/**
+ *  allocator.cpp
+ *  Purpose: tests of the aligned, arena and pool allocators, and of matrices and transforms
+ *  built on them
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "check.h"
+#include "dft.h"
+#include "random.h"
+
+#include "allocator.h"
+#include "fft.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+/**
+ *  Every allocation from the global heap is counted, so the tests can check that warmed-up
+ *  arenas, pools and scratch buffers stop reaching it.
+ */
+
+static std::atomic<size_t> heap_allocations(0);
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(size_t bytes) {
+    ++ heap_allocations;
+    if(void *p = std::malloc(bytes ? bytes : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t bytes, std::align_val_t alignment) {
+    ++ heap_allocations;
+    const size_t a = static_cast<size_t>(alignment);
+    if(void *p = std::aligned_alloc(a, (bytes + a - 1) / a * a)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+#pragma GCC diagnostic pop
+
+static bool aligned(const void *p) {
+    return reinterpret_cast<uintptr_t>(p) % buffer_alignment == 0;
+}
+
+static void test_arena() {
+    monotonic_arena arena(1024);
+    CHECK(arena.capacity() == 0);
+
+    void *first = arena.allocate(10);
+    void *second = arena.allocate(100);
+    CHECK(aligned(first) && aligned(second));
+    CHECK(static_cast<char *>(second) - static_cast<char *>(first) == ptrdiff_t(buffer_alignment));
+
+    // Requests beyond the current block start a larger one; release keeps only the largest.
+
+    void *large = arena.allocate(5000);
+    CHECK(aligned(large));
+    std::fill(static_cast<char *>(large), static_cast<char *>(large) + 5000, char(1));
+    const size_t grown = arena.capacity();
+    CHECK(grown >= 1024 + 5000);
+    arena.release();
+    CHECK(arena.capacity() < grown && arena.capacity() >= 5000);
+
+    const size_t before = heap_allocations;
+    void *again = arena.allocate(4000);
+    CHECK(aligned(again) && heap_allocations == before);
+}
+
+static void test_pool() {
+    pool_resource pool(1 << 12);
+
+    void *a = pool.allocate(100), *b = pool.allocate(128), *c = pool.allocate(129);
+    CHECK(aligned(a) && aligned(b) && aligned(c));
+    CHECK(a != b && b != c);
+
+    // A freed buffer is handed out again to the next request of its size class.
+
+    pool.deallocate(b, 128);
+    CHECK(pool.allocate(97) == b);
+    pool.deallocate(c, 129);
+    CHECK(pool.allocate(256) == c);
+
+    void *huge = pool.allocate(1 << 13);
+    CHECK(aligned(huge));
+    pool.deallocate(huge, 1 << 13);
+
+    const size_t before = heap_allocations;
+    for(int i = 0; i < 100; ++ i)
+        pool.deallocate(pool.allocate(200), 200);
+    CHECK(heap_allocations == before);
+}
+
+/**
+ *  Matrices on a resource give the same results as on the heap, and results computed from
+ *  them stay on the same resource.
+ */
+
+template <typename Alloc, typename Resource>
+static void test_matrix(Resource &resource) {
+    typedef matrix<double, Alloc> arena_matrix;
+    const Alloc alloc(resource);
+
+    const matrix<double> a = random_matrix<double>(40, 40), b = random_matrix<double>(40, 40);
+    arena_matrix x(a, alloc), y(b, alloc);
+    CHECK(x.get_allocator().resource() == &resource && aligned(x.data()));
+    CHECK(x == a && y == b);
+
+    // An expression assigned to a matrix of the same shape is evaluated into its buffer.
+
+    arena_matrix sum(40, 40, 0.0, alloc);
+    const double *storage = sum.data();
+    sum = x + y * 2.0;
+    CHECK(sum.data() == storage);
+    CHECK(sum == matrix<double>(a + b * 2.0));
+    CHECK(sum.get_allocator().resource() == &resource);
+
+    const arena_matrix product = x * y, transpose = x.transpose();
+    CHECK(product == a * b && transpose == a.transpose());
+    CHECK(product.get_allocator().resource() == &resource);
+    CHECK(transpose.get_allocator().resource() == &resource);
+    CHECK(matrix<double>(x.template inverse<double>()) == a.inverse<double>());
+    CHECK(x.template determinant<double>() == a.determinant<double>());
+
+    arena_matrix out(40, 40, 0.0, alloc);
+    multiply_into(out, x, y);
+    CHECK(out == a * b);
+}
+
+/**
+ *  Warmed-up plans, including the six-step path, run without touching the heap.
+ */
+
+static void test_transforms() {
+    for(size_t n : {size_t(1000), size_t(4096), fft_six_step_threshold}) {
+        const fft_plan<double> plan(n, 1);
+        monotonic_arena arena;
+        std::vector<std::complex<double>, arena_allocator<std::complex<double>>> x(
+            n, std::complex<double>(), arena_allocator<std::complex<double>>(arena));
+        const std::vector<std::complex<double>> signal = random_signal<double>(n);
+        std::copy(signal.begin(), signal.end(), x.begin());
+
+        plan.execute(x);
+        std::vector<std::complex<double>> y = signal;
+        plan.execute(y);
+        CHECK(std::equal(x.begin(), x.end(), y.begin()));
+
+        const size_t before = heap_allocations;
+        plan.execute(x);
+        plan.execute(y);
+        CHECK(heap_allocations == before);
+    }
+
+    monotonic_arena arena;
+    std::vector<std::complex<float>, arena_allocator<std::complex<float>>> x(
+        64, std::complex<float>(1), arena_allocator<std::complex<float>>(arena));
+    FFT(x, 1);
+    FFT(x, -1);
+    CHECK(std::abs(x[3] - std::complex<float>(1)) <= 1e-6f);
+}
+
+int main() {
+    test_arena();
+    test_pool();
+
+    monotonic_arena arena;
+    test_matrix<arena_allocator<double>>(arena);
+    pool_resource pool;
+    test_matrix<pool_allocator<double>>(pool);
+
+    test_transforms();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,107 @@
+/**
+ *  batch.cpp
+ *  Purpose: tests of the batched small-matrix products and applications against one
+ *  matrix product per item
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "batch.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+template <size_t N, typename T>
+static matrix_batch<N, T> random_batch(size_t count) {
+    matrix_batch<N, T> ret(count);
+    for(size_t k = 0; k < count; ++ k)
+        for(size_t i = 0; i < N; ++ i)
+            for(size_t j = 0; j < N; ++ j)
+                ret(k, i, j) = random_value<T>();
+    return ret;
+}
+
+template <size_t N, typename T>
+static matrix<T> item(const matrix_batch<N, T> &b, size_t k) {
+    matrix<T> ret(N, N);
+    for(size_t i = 0; i < N; ++ i)
+        for(size_t j = 0; j < N; ++ j)
+            ret(i,j) = b(k, i, j);
+    return ret;
+}
+
+/**
+ *  Counts on both sides of every vector width, so the vector loop and its remainder both run.
+ */
+
+template <size_t N, typename T>
+static void test_batch() {
+    const long double bound = tolerance<T>(N);
+
+    for(size_t count : {0, 1, 3, 17, 1000}) {
+        const matrix_batch<N, T> a = random_batch<N, T>(count), b = random_batch<N, T>(count);
+        matrix_batch<N, T> c;
+        batch_multiply(a, b, c);
+        CHECK(c.size() == count);
+
+        long double error = 0;
+        for(size_t k = 0; k < count; ++ k) {
+            const matrix<T> expected = item(a, k) * item(b, k);
+            for(size_t i = 0; i < N; ++ i)
+                for(size_t j = 0; j < N; ++ j)
+                    error = std::max(error, std::fabs((long double) c(k, i, j) - expected(i,j)));
+        }
+        CHECK(error <= bound);
+
+        // The result may be an operand.
+
+        matrix_batch<N, T> in_place = a;
+        batch_multiply(in_place, b, in_place);
+        bool same = true;
+        for(size_t k = 0; k < count; ++ k)
+            for(size_t i = 0; i < N; ++ i)
+                for(size_t j = 0; j < N; ++ j)
+                    same = same && in_place(k, i, j) == c(k, i, j);
+        CHECK(same);
+
+        std::vector<T> components[N], results[N];
+        const T *x[N];
+        T *y[N];
+        for(size_t i = 0; i < N; ++ i) {
+            for(size_t k = 0; k < count; ++ k)
+                components[i].push_back(random_value<T>());
+            results[i].resize(count);
+            x[i] = components[i].data();
+            y[i] = results[i].data();
+        }
+        batch_apply(a, x, y);
+
+        error = 0;
+        for(size_t k = 0; k < count; ++ k)
+            for(size_t i = 0; i < N; ++ i) {
+                long double s = 0;
+                for(size_t j = 0; j < N; ++ j)
+                    s += (long double) a(k, i, j) * components[j][k];
+                error = std::max(error, std::fabs(s - results[i][k]));
+            }
+        CHECK(error <= bound);
+    }
+}
+
+int main() {
+    test_batch<3, float>();
+    test_batch<3, double>();
+    test_batch<3, long double>();
+    test_batch<4, float>();
+    test_batch<4, double>();
+    test_batch<2, int>();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,126 @@
+/**
+ *  blas.cpp
+ *  Purpose: tests that the vendor backend, when built in, gives the results of the native
+ *  kernels, and that the switch and thresholds route work as documented
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "blas.h"
+#include "elimination.h"
+#include "gemm.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static long double max_error(const matrix<T> &a, const matrix<T> &b) {
+    long double error = 0;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            error = std::max(error, (long double) std::fabs((long double) a(i,j) - (long double) b(i,j)));
+    return error;
+}
+
+/**
+ *  Runs body once on the native kernels and once with the backend forced on for every
+ *  size, and returns both results.
+ */
+
+template <typename F>
+static auto both_paths(const F &body) {
+    const blas_settings defaults = blas_tuning();
+    blas_tuning() = {false, defaults.gemm_threshold, defaults.factor_threshold};
+    auto native = body();
+    blas_tuning() = {blas_available(), 0, 0};
+    auto vendor = body();
+    blas_tuning() = defaults;
+    return std::make_pair(native, vendor);
+}
+
+template <typename T>
+static void test_gemm() {
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 13, 5}, {130, 70, 201}};
+
+    for(const auto &shape : shapes) {
+        const size_t M = shape[0], K = shape[1], N = shape[2];
+        const matrix<T> a = random_matrix<T>(M, K), b = random_matrix<T>(K, N), at = a.transpose();
+        const matrix<T> c0 = random_matrix<T>(M, N);
+
+        const auto products = both_paths([&] {
+            matrix<T> c = c0;
+            gemm(gemm_transpose::none, gemm_transpose::none, M, N, K, T(2), a.data(), a.stride(), b.data(),
+                 b.stride(), T(-1), c.data(), c.stride());
+            matrix<T> d = c0;
+            gemm(gemm_transpose::transpose, gemm_transpose::none, M, N, K, T(1), at.data(), at.stride(), b.data(),
+                 b.stride(), T(0), d.data(), d.stride());
+            return std::make_pair(c, d);
+        });
+        CHECK(max_error(products.first.first, products.second.first) <= 3 * tolerance<T>(K));
+        CHECK(max_error(products.first.second, products.second.second) <= tolerance<T>(K));
+        CHECK(max_error(products.first.second, matrix<T>(a * b)) <= tolerance<T>(K));
+    }
+}
+
+/**
+ *  The backend leaves the factors and pivots laid out as lu_factor does, so it can be
+ *  swapped in under every caller.
+ */
+
+template <typename T>
+static void test_lu() {
+    for(size_t n : {size_t(1), size_t(5), size_t(300)}) {
+        matrix<T> a = random_matrix<T>(n, n);
+        for(size_t i = 0; i < n; ++ i)
+            a(i,i) += T(2);
+        const matrix<T> b = random_matrix<T>(n, 40);
+
+        const auto factors = both_paths([&] {
+            matrix<T> lu = a, x = b;
+            std::vector<size_t> pivots(n);
+            const size_t singular = lu_factor(n, lu.data(), lu.stride(), pivots.data());
+            lu_solve(n, lu.data(), lu.stride(), pivots.data(), x.columns(), x.data(), x.stride());
+            return std::make_tuple(lu, pivots, singular, x);
+        });
+        CHECK(std::get<1>(factors.first) == std::get<1>(factors.second));
+        CHECK(std::get<2>(factors.first) == n && std::get<2>(factors.second) == n);
+        CHECK(max_error(std::get<0>(factors.first), std::get<0>(factors.second)) <= n * tolerance<T>(n));
+        CHECK(max_error(std::get<3>(factors.first), std::get<3>(factors.second)) <= n * n * tolerance<T>(n));
+
+        const auto determinants = both_paths([&] { return a.template log_determinant<T>(); });
+        CHECK(determinants.first.sign == determinants.second.sign);
+        CHECK(std::fabs(determinants.first.log_abs - determinants.second.log_abs) <= n * tolerance<T>(n));
+    }
+
+    // A singular matrix reports the same first zero pivot either way.
+
+    matrix<T> s = random_matrix<T>(6, 6);
+    for(size_t i = 0; i < 6; ++ i)
+        s(i,3) = T(0);
+    const auto singular = both_paths([&] {
+        matrix<T> lu = s;
+        std::vector<size_t> pivots(6);
+        return lu_factor(6, lu.data(), lu.stride(), pivots.data());
+    });
+    CHECK(singular.first == 3 && singular.second == 3);
+}
+
+int main() {
+    CHECK(blas_tuning().enabled == blas_available());
+
+    test_gemm<float>();
+    test_gemm<double>();
+    test_lu<float>();
+    test_lu<double>();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,37 @@
+/**
+ *  check.h
+ *  Purpose: a minimal check macro for the tests, counting failures instead of aborting
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef CHECK_H
+
+#define CHECK_H
+
+#include <cstdio>
+
+namespace algebra_test {
+
+/**
+ *  The number of checks that have failed so far; main returns it, so ctest sees any failure.
+ */
+
+inline int &failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const char *what, const char *file, int line) {
+    if(!condition) {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+        ++ failures();
+    }
+}
+
+}
+
+#define CHECK(condition) algebra_test::check((condition), #condition, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,216 @@
+/**
+ *  cholesky.cpp
+ *  Purpose: tests of the Cholesky and LDL^T factorizations, syrk and symmetric_matrix
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "cholesky.h"
+#include "elimination.h"
+#include "gemm.h"
+#include "lu.h"
+#include "matrix.h"
+#include "symmetric.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static long double max_error(const matrix<T> &a, const matrix<T> &b) {
+    long double error = 0;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            error = std::max(error, (long double) std::fabs((long double) a(i,j) - (long double) b(i,j)));
+    return error;
+}
+
+/**
+ *  A well-conditioned symmetric positive definite matrix, g^T g + n I.
+ */
+
+template <typename T>
+static matrix<T> random_spd(size_t n) {
+    const matrix<T> g = random_matrix<T>(n, n);
+    matrix<T> a = g.transpose() * g;
+    for(size_t i = 0; i < n; ++ i)
+        a(i,i) += T(n);
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < i; ++ j)
+            a(j,i) = a(i,j);
+    return a;
+}
+
+static const size_t orders[] = {1, 5, cholesky_block_size - 1, cholesky_block_size, cholesky_block_size + 1, 200};
+
+template <typename T>
+static void test_syrk() {
+    const size_t shapes[][2] = {{1, 1}, {5, 3}, {64, 64}, {100, 7}, {130, 300}};
+
+    for(const auto &shape : shapes) {
+        const size_t n = shape[0], k = shape[1];
+        const matrix<T> a = random_matrix<T>(k, n);
+        const matrix<T> expected = a.transpose() * a;
+
+        matrix<T> c = random_matrix<T>(n, n);
+        const matrix<T> before = c;
+        syrk(n, k, T(2), a.data(), a.stride(), T(-1), c.data(), c.stride());
+        bool untouched = true;
+        long double error = 0;
+        for(size_t i = 0; i < n; ++ i) {
+            for(size_t j = 0; j < n; ++ j) {
+                if(j > i) {
+                    untouched = untouched && c(i,j) == before(i,j);
+                } else {
+                    error = std::max(error, (long double) std::fabs(c(i,j) - (2 * expected(i,j) - before(i,j))));
+                }
+            }
+        }
+        CHECK(untouched);
+        CHECK(error <= 3 * tolerance<T>(k));
+
+        matrix<T> g;
+        gram_into(g, a);
+        CHECK(max_error(g, expected) <= tolerance<T>(k));
+        CHECK(max_error(gram(a).to_matrix(), expected) <= tolerance<T>(k));
+    }
+}
+
+template <typename T>
+static void test_symmetric_matrix() {
+    const matrix<T> a = random_spd<T>(37);
+    const symmetric_matrix<T> s(a);
+    CHECK(s.size() == 37);
+    CHECK(s.to_matrix() == a);
+    CHECK(s(3, 30) == a(30,3) && &s(3, 30) == &s(30, 3));
+    CHECK(s.data()[0] == a(0,0) && s.data()[1] == a(1,0) && s.data()[2] == a(1,1));
+
+    std::vector<T> x(37);
+    for(T &v : x) v = random_value<T>();
+    const std::vector<T> y = s * x;
+    long double error = 0;
+    for(size_t i = 0; i < 37; ++ i) {
+        long double e = 0;
+        for(size_t j = 0; j < 37; ++ j)
+            e += (long double) a(i,j) * x[j];
+        error = std::max(error, std::fabs(e - y[i]));
+    }
+    CHECK(error <= 37 * tolerance<T>(37));
+}
+
+template <typename T>
+static void test_cholesky() {
+    for(size_t n : orders) {
+        const matrix<T> a = random_spd<T>(n);
+        const cholesky_decomposition<T> c(a);
+        CHECK(c.size() == n && c.positive_definite());
+
+        const matrix<T> &l = c.factor();
+        bool lower = true;
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = i + 1; j < n; ++ j)
+                lower = lower && l(i,j) == T(0);
+        CHECK(lower);
+        CHECK(max_error(l * l.transpose(), a) <= n * tolerance<T>(n));
+
+        // The packed input must give the same factor as the dense one.
+
+        CHECK(cholesky_decomposition<T>(symmetric_matrix<T>(a)).factor() == l);
+
+        const matrix<T> b = random_matrix<T>(n, 3);
+        CHECK(max_error(a * c.solve(b), b) <= n * tolerance<T>(n));
+        std::vector<T> v(n);
+        for(size_t i = 0; i < n; ++ i) v[i] = b(i,0);
+        const std::vector<T> x = c.solve(v);
+        long double residual = 0;
+        for(size_t i = 0; i < n; ++ i) {
+            long double e = -(long double) v[i];
+            for(size_t j = 0; j < n; ++ j)
+                e += (long double) a(i,j) * x[j];
+            residual = std::max(residual, std::fabs(e));
+        }
+        CHECK(residual <= n * tolerance<T>(n));
+
+        CHECK(max_error(a * c.inverse(), matrix<T>::identity(n)) <= n * tolerance<T>(n));
+
+        const log_det<T> expected = lu_decomposition<T>(a).log_determinant(), actual = c.log_determinant();
+        CHECK(actual.sign == T(1) && expected.sign == T(1));
+        CHECK(std::fabs(actual.log_abs - expected.log_abs) <= n * tolerance<T>(n));
+    }
+
+    matrix<T> indefinite = matrix<T>::identity(4);
+    indefinite(2,2) = T(-1);
+    const cholesky_decomposition<T> c(indefinite);
+    CHECK(!c.positive_definite());
+    bool thrown = false;
+    try {
+        c.solve(std::vector<T>(4, T(1)));
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+template <typename T>
+static void test_ldlt() {
+    for(size_t n : orders) {
+        const matrix<T> a = random_spd<T>(n) * T(-1);
+        const ldlt_decomposition<T> d(a);
+        CHECK(d.size() == n && !d.singular());
+
+        const std::vector<T> diagonal = d.diagonal();
+        CHECK(std::all_of(diagonal.begin(), diagonal.end(), [](T t) { return t < T(0); }));
+
+        matrix<T> l = d.factors(), dt(n, n);
+        for(size_t i = 0; i < n; ++ i) {
+            for(size_t j = i; j < n; ++ j)
+                l(i,j) = i == j ? T(1) : T(0);
+            for(size_t j = 0; j <= i; ++ j)
+                dt(j,i) = l(i,j) * diagonal[j];
+        }
+        CHECK(max_error(l * dt, a) <= n * tolerance<T>(n));
+        CHECK(ldlt_decomposition<T>(symmetric_matrix<T>(a)).factors() == d.factors());
+
+        const matrix<T> b = random_matrix<T>(n, 3);
+        CHECK(max_error(a * d.solve(b), b) <= n * tolerance<T>(n));
+        CHECK(max_error(a * d.inverse(), matrix<T>::identity(n)) <= n * tolerance<T>(n));
+
+        const log_det<T> expected = lu_decomposition<T>(a).log_determinant(), actual = d.log_determinant();
+        CHECK(actual.sign == expected.sign && actual.sign == (n % 2 ? T(-1) : T(1)));
+        CHECK(std::fabs(actual.log_abs - expected.log_abs) <= n * tolerance<T>(n));
+    }
+
+    const ldlt_decomposition<T> d(matrix<T>(3, 3));
+    CHECK(d.singular());
+    bool thrown = false;
+    try {
+        d.inverse();
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    test_syrk<float>();
+    test_syrk<double>();
+    test_symmetric_matrix<double>();
+    test_cholesky<double>();
+    test_cholesky<long double>();
+    test_ldlt<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_syrk<double>();
+    test_cholesky<double>();
+    test_ldlt<double>();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,99 @@
+/**
+ *  convolution.cpp
+ *  Purpose: tests of convolve and fir_filter against the quadratic sum
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "dft.h"
+#include "random.h"
+
+#include "convolution.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static std::vector<T> random_sequence(size_t n) {
+    std::vector<T> ret(n);
+    for(T &t : ret)
+        t = random_value<T>();
+    return ret;
+}
+
+template <typename T>
+static std::vector<long double> naive_convolution(const std::vector<T> &a, const std::vector<T> &b) {
+    std::vector<long double> ret(a.size() + b.size() - 1, 0);
+    for(size_t i = 0; i < a.size(); ++ i)
+        for(size_t j = 0; j < b.size(); ++ j)
+            ret[i + j] += (long double) a[i] * b[j];
+    return ret;
+}
+
+template <typename T>
+static long double difference(const std::vector<T> &a, const std::vector<long double> &b, size_t n) {
+    long double ret = 0;
+    for(size_t i = 0; i < n; ++ i)
+        ret = std::max(ret, std::fabs(a[i] - b[i]));
+    return ret;
+}
+
+/**
+ *  Shorter operands on both sides of convolve_direct_threshold, and longer ones many
+ *  overlap-add blocks long. Either way the error grows like that of a transform of the
+ *  shorter operand's length.
+ */
+
+template <typename T>
+static void test_convolve() {
+    const size_t lengths[][2] = {{1, 1}, {7, 3}, {64, 500}, {65, 65}, {100, 3000}, {1000, 999}, {5000, 300}};
+
+    for(const auto &length : lengths) {
+        const std::vector<T> a = random_sequence<T>(length[0]), b = random_sequence<T>(length[1]);
+        const std::vector<long double> expected = naive_convolution(a, b);
+        const std::vector<T> c = convolve(a, b);
+        CHECK(c.size() == expected.size());
+        const size_t m = std::min(a.size(), b.size());
+        CHECK(difference(c, expected, c.size()) <= fft_tolerance<T>(m));
+    }
+}
+
+/**
+ *  Streaming a signal through fir_filter in chunks of any size gives the leading outputs of
+ *  its full convolution with the taps.
+ */
+
+template <typename T>
+static void test_fir_filter() {
+    for(size_t taps : {1, 5, 64, 65, 300}) {
+        const std::vector<T> h = random_sequence<T>(taps), x = random_sequence<T>(4000);
+        const std::vector<long double> expected = naive_convolution(h, x);
+
+        fir_filter<T> filter(h);
+        std::vector<T> y;
+        for(size_t s = 0, chunk = 1; s < x.size(); s += chunk, chunk = chunk * 3 % 1021 + 1) {
+            const std::vector<T> in(x.begin() + s, x.begin() + std::min(x.size(), s + chunk));
+            const std::vector<T> out = filter.process(in);
+            CHECK(out.size() == in.size());
+            y.insert(y.end(), out.begin(), out.end());
+        }
+        CHECK(difference(y, expected, x.size()) <= fft_tolerance<T>(taps));
+
+        filter.reset();
+        const std::vector<T> restarted = filter.process(std::vector<T>(x.begin(), x.begin() + 100));
+        CHECK(difference(restarted, expected, 100) <= fft_tolerance<T>(taps));
+    }
+}
+
+int main() {
+    test_convolve<float>();
+    test_convolve<double>();
+    test_fir_filter<float>();
+    test_fir_filter<double>();
+    return algebra_test::failures() != 0;
+}
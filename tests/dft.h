@@ -0,0 +1,89 @@
+/**
+ *  dft.h
+ *  Purpose: the direct discrete Fourier transform in long double, the reference the FFT
+ *  tests compare against
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef DFT_H
+
+#define DFT_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "random.h"
+
+namespace algebra_test {
+
+template <typename T>
+inline std::vector<std::complex<T>> random_signal(size_t n) {
+    std::vector<std::complex<T>> ret(n);
+    for(auto &c : ret)
+        c = std::complex<T>(random_value<T>(), random_value<T>());
+    return ret;
+}
+
+/**
+ *  exp(2 pi i j / n) for j < n, in long double.
+ */
+
+inline std::vector<std::complex<long double>> roots_of_unity(size_t n) {
+    const long double pi = std::acos(-1.0L);
+    std::vector<std::complex<long double>> ret(n);
+    for(size_t j = 0; j < n; ++ j)
+        ret[j] = std::polar(1.0L, 2 * pi * j / n);
+    return ret;
+}
+
+/**
+ *  Bin k of the forward transform, X[k] = sum of x[j] exp(2 pi i j k / n), where n is the
+ *  number of roots; x may be shorter, as if padded with zeros.
+ */
+
+template <typename T>
+inline std::complex<long double> direct_dft(const std::vector<std::complex<T>> &x,
+                                            const std::vector<std::complex<long double>> &roots, size_t k) {
+    const size_t n = roots.size();
+    std::complex<long double> s = 0;
+    for(size_t j = 0; j < x.size(); ++ j)
+        s += std::complex<long double>(x[j]) * roots[(j * k) % n];
+    return s;
+}
+
+/**
+ *  The bins checked against the direct sum: every bin of short transforms, about limit of
+ *  them, spread evenly and including the last, for long ones.
+ */
+
+inline std::vector<size_t> checked_bins(size_t n, size_t limit) {
+    const size_t step = std::max<size_t>(1, n / limit);
+    std::vector<size_t> ret;
+    for(size_t k = 0; k < n; k += step)
+        ret.push_back(k);
+    if(ret.back() != n - 1) {
+        ret.push_back(n - 1);
+    }
+    return ret;
+}
+
+/**
+ *  The tolerance of a transform of n values of magnitude up to 1, computed in T; the error
+ *  of each output grows with log2(n) and with its magnitude, sqrt(n).
+ */
+
+template <typename T>
+inline long double fft_tolerance(size_t n) {
+    return 16 * std::log2(static_cast<long double>(n) + 1) * std::sqrt(static_cast<long double>(n)) *
+           std::numeric_limits<T>::epsilon();
+}
+
+}
+
+#endif
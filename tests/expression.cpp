@@ -0,0 +1,78 @@
+/**
+ *  expression.cpp
+ *  Purpose: baseline uses of matrix arithmetic, which must keep compiling and giving the
+ *  same results now that sums, negations and scalings are lazy expressions
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "check.h"
+
+#include "matrix.h"
+
+template <typename T>
+static std::string print(const T &t) {
+    std::ostringstream out;
+    out << t;
+    return out.str();
+}
+
+int main() {
+    matrix<int> a(2, 2), b(2, 2);
+    a(0,0) = 1; a(0,1) = 2; a(1,0) = 3; a(1,1) = 4;
+    b(0,0) = 2; b(0,1) = 4; b(1,0) = 6; b(1,1) = 8;
+
+    // Printing.
+
+    CHECK(print(a * 2) == "2 4\n6 8\n");
+    CHECK(print(a + b) == "3 6\n9 12\n");
+    CHECK(print(-a) == "-1 -2\n-3 -4\n");
+    CHECK(print(b - a) == print(a));
+
+    // Member calls on a sum or scaling.
+
+    CHECK((a * 2).transpose() == b.transpose());
+    CHECK((a + a).eval() == b);
+    CHECK((a * 2).rows() == 2 && (a * 2).columns() == 2);
+    CHECK((a * 2)(1,0) == 6);
+    CHECK(std::fabs((a * 2).determinant() - (-8.0L)) < 1e-12L);
+    CHECK(std::fabs((a - b).determinant<double>() - (-2.0)) < 1e-12);
+    CHECK((a * 2).log_determinant().sign == -1);
+
+    const matrix<long double> inverse = (a * 2).inverse(), expected = b.inverse();
+    CHECK(inverse.rows() == 2 && inverse.columns() == 2);
+    for(size_t i = 0; i < 2; ++ i)
+        for(size_t j = 0; j < 2; ++ j)
+            CHECK(std::fabs(inverse(i,j) - expected(i,j)) < 1e-12L);
+
+    // Comparisons with either side an expression.
+
+    CHECK(b == a * 2);
+    CHECK(a * 2 == b);
+    CHECK(a * 2 == a + a);
+    CHECK(a * 3 != b);
+    CHECK(!(b != a * 2));
+    CHECK(a != b);
+
+    // Products, assignment and construction from an expression.
+
+    CHECK((a * 2) * a == b * a);
+    CHECK(a * (a + a) == a * b);
+
+    matrix<int> c = a * 2;
+    CHECK(c == b);
+    c = -(a + b) * 2;
+    CHECK(c(1,1) == -24);
+    c = a;
+    c += a * 2;
+    CHECK(c == a * 3);
+    c -= a + b;
+    CHECK(c == matrix<int>(2, 2));
+
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,235 @@
+/**
+ *  fft.cpp
+ *  Purpose: tests of the complex and real-input FFTs against the direct transform
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "dft.h"
+
+#include "fft.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  Powers of two (radix 4), lengths with factors 2, 3, 5 and 7 only (mixed radix), and
+ *  lengths with larger prime factors (Bluestein).
+ */
+
+template <typename T>
+static void test_plan(const std::vector<size_t> &lengths) {
+    for(size_t n : lengths) {
+        const fft_plan<T> forward(n, 1), inverse(n, -1);
+        const std::vector<std::complex<T>> x = random_signal<T>(n);
+        std::vector<std::complex<T>> y = x;
+        forward.execute(y);
+
+        const std::vector<std::complex<long double>> roots = roots_of_unity(n);
+        long double error = 0;
+        for(size_t k : checked_bins(n, n <= 1024 ? n : n <= 65537 ? 64 : 16))
+            error = std::max(error, std::abs(direct_dft(x, roots, k) - std::complex<long double>(y[k])));
+        CHECK(error <= fft_tolerance<T>(n));
+
+        inverse.execute(y);
+        long double roundtrip = 0;
+        for(size_t j = 0; j < n; ++ j)
+            roundtrip = std::max(roundtrip, (long double) std::abs(y[j] - x[j]));
+        CHECK(roundtrip <= fft_tolerance<T>(n) / std::sqrt(static_cast<long double>(n)));
+
+        // The split layout gives the same result as the interleaved one.
+
+        std::vector<T> re(n), im(n);
+        for(size_t j = 0; j < n; ++ j) {
+            re[j] = x[j].real();
+            im[j] = x[j].imag();
+        }
+        y = x;
+        forward.execute(y);
+        forward.execute_split(re.data(), im.data());
+        long double split = 0;
+        for(size_t j = 0; j < n; ++ j)
+            split = std::max(split, (long double) std::abs(y[j] - std::complex<T>(re[j], im[j])));
+        CHECK(split <= fft_tolerance<T>(n));
+    }
+}
+
+template <typename T>
+static void test_rfft(const std::vector<size_t> &lengths) {
+    for(size_t n : lengths) {
+        std::vector<T> x(n);
+        std::vector<std::complex<T>> promoted(n);
+        for(size_t j = 0; j < n; ++ j)
+            promoted[j] = x[j] = random_value<T>();
+
+        const rfft_plan<T> plan(n);
+        std::vector<std::complex<T>> X(n / 2 + 1);
+        plan.forward(x.data(), X.data());
+
+        const std::vector<std::complex<long double>> roots = roots_of_unity(n);
+        long double error = 0;
+        for(size_t k : checked_bins(n / 2 + 1, n <= 1024 ? n : n <= 65537 ? 64 : 16))
+            error = std::max(error, std::abs(direct_dft(promoted, roots, k) - std::complex<long double>(X[k])));
+        CHECK(error <= fft_tolerance<T>(n));
+
+        std::vector<T> back(n);
+        plan.inverse(X.data(), back.data());
+        long double roundtrip = 0;
+        for(size_t j = 0; j < n; ++ j)
+            roundtrip = std::max(roundtrip, (long double) std::fabs(back[j] - x[j]));
+        CHECK(roundtrip <= fft_tolerance<T>(n) / std::sqrt(static_cast<long double>(n)));
+
+        // The wrappers share cached plans; an odd length must be passed to IRFFT.
+
+        const std::vector<std::complex<T>> Y = RFFT(x);
+        CHECK(Y.size() == X.size() && Y.back() == X.back());
+        CHECK(IRFFT(Y, n) == back);
+    }
+    CHECK(cached_rfft_plan<T>(64) == cached_rfft_plan<T>(64));
+}
+
+/**
+ *  Batches both laid out back to back and interleaved, with lengths gathered across the
+ *  batch and lengths transformed one signal at a time.
+ */
+
+template <typename T>
+static void test_batch() {
+    for(size_t n : {1, 4, 12, 60, 256, 257, 1000}) {
+        const fft_plan<T> plan(n, 1);
+        for(size_t count : {1, 3, 17}) {
+            const std::vector<std::complex<T>> x = random_signal<T>(n * count);
+            std::vector<std::complex<T>> expected = x;
+            for(size_t k = 0; k < count; ++ k)
+                plan.execute(expected.data() + k * n);
+
+            std::vector<std::complex<T>> y = x;
+            plan.execute_batch(y.data(), count, 1, n);
+            long double error = 0;
+            for(size_t i = 0; i < y.size(); ++ i)
+                error = std::max(error, (long double) std::abs(y[i] - expected[i]));
+            CHECK(error <= fft_tolerance<T>(n));
+
+            std::vector<std::complex<T>> interleaved(n * count);
+            for(size_t k = 0; k < count; ++ k)
+                for(size_t j = 0; j < n; ++ j)
+                    interleaved[j * count + k] = x[k * n + j];
+            plan.execute_batch(interleaved.data(), count, count, 1);
+            error = 0;
+            for(size_t k = 0; k < count; ++ k)
+                for(size_t j = 0; j < n; ++ j)
+                    error = std::max(error, (long double) std::abs(interleaved[j * count + k] - expected[k * n + j]));
+            CHECK(error <= fft_tolerance<T>(n));
+
+            y = x;
+            batch_FFT(y, n, 1);
+            batch_FFT(y, n, -1);
+            error = 0;
+            for(size_t i = 0; i < y.size(); ++ i)
+                error = std::max(error, (long double) std::abs(y[i] - x[i]));
+            CHECK(error <= fft_tolerance<T>(n));
+        }
+    }
+}
+
+static void test_cache() {
+    // One plan per length and direction, shared by every caller.
+
+    CHECK(cached_fft_plan<double>(256, 1) == cached_fft_plan<double>(256, 1));
+    CHECK(cached_fft_plan<double>(256, 1) != cached_fft_plan<double>(256, -1));
+    CHECK(cached_fft_plan<double>(256, -1)->sign() == -1 && cached_fft_plan<float>(512, 1)->size() == 512);
+
+    // Alternating directions and lengths through FFT round-trip, without padding.
+
+    for(size_t n : {16, 100, 16, 1000, 37}) {
+        const std::vector<std::complex<long double>> x = random_signal<long double>(n);
+        std::vector<std::complex<long double>> y = x;
+        FFT(y, 1);
+        CHECK(y.size() == n);
+
+        const std::vector<std::complex<long double>> roots = roots_of_unity(n);
+        CHECK(std::abs(direct_dft(x, roots, 3) - y[3]) <= fft_tolerance<long double>(n));
+
+        FFT(y, -1);
+        long double roundtrip = 0;
+        for(size_t j = 0; j < n; ++ j)
+            roundtrip = std::max(roundtrip, std::abs(y[j] - x[j]));
+        CHECK(roundtrip <= fft_tolerance<long double>(n));
+    }
+
+    // Threads looking up the same lengths at once get the same plans.
+
+    std::vector<std::shared_ptr<const fft_plan<double>>> seen(8);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < seen.size(); ++ t)
+        threads.emplace_back([&seen, t] {
+            for(size_t n = 1; n <= 40; ++ n) {
+                cached_fft_plan<double>(n + 200, 1);
+                cached_rfft_plan<double>(n + 200);
+            }
+            seen[t] = cached_fft_plan<double>(207, 1);
+        });
+    for(auto &thread : threads)
+        thread.join();
+    CHECK(std::all_of(seen.begin(), seen.end(), [&](const auto &plan) { return plan == seen[0]; }));
+    CHECK(cached_fft_plan<double>(207, 1) == seen[0] && cached_rfft_plan<double>(207)->size() == 207);
+
+    // Past plan_cache_capacity, plans no caller holds are dropped and held ones kept.
+
+    const auto held = cached_fft_plan<float>(3000, 1);
+    const std::weak_ptr<const fft_plan<float>> dropped = cached_fft_plan<float>(3001, 1);
+    for(size_t n = 1; n <= 2 * algebra_detail::plan_cache_capacity; ++ n)
+        cached_fft_plan<float>(n, -1);
+    CHECK(dropped.expired());
+    CHECK(cached_fft_plan<float>(3000, 1) == held);
+}
+
+int main() {
+    const std::vector<size_t> lengths = {1, 2, 3, 8, 12, 17, 60, 64, 1000, 1009, 1024, 4096, 6720, 1 << 16, 65537};
+    test_plan<float>(lengths);
+    test_plan<double>(lengths);
+    test_plan<long double>(lengths);
+
+    // Every narrower instruction set, on one length of each method.
+
+    const simd_isa detected = simd_detect();
+    const simd_isa levels[] = {simd_isa::avx2, simd_isa::neon, simd_isa::scalar};
+    for(simd_isa level : levels) {
+        if(level >= detected)
+            continue;
+        simd_level() = level;
+        test_plan<float>({1024, 6720, 1009});
+        test_plan<double>({1024, 6720, 1009});
+    }
+    simd_level() = detected;
+
+    // Powers of two from fft_six_step_threshold on run the six-step method over the pool;
+    // real transforms reach it at twice the length.
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_plan<float>({fft_six_step_threshold});
+    test_plan<double>({fft_six_step_threshold, 4 * fft_six_step_threshold});
+    test_rfft<double>({2 * fft_six_step_threshold});
+    set_executor(nullptr);
+    const std::vector<size_t> real_lengths = {1, 2, 5, 16, 100, 256, 1009, 2018, 4096, 1 << 16};
+    test_rfft<float>(real_lengths);
+    test_rfft<double>(real_lengths);
+    test_rfft<long double>(real_lengths);
+    test_batch<float>();
+    test_batch<double>();
+    test_batch<long double>();
+
+    test_cache();
+    return algebra_test::failures() != 0;
+}
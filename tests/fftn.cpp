@@ -0,0 +1,105 @@
+/**
+ *  fftn.cpp
+ *  Purpose: tests of the 2D and N-dimensional FFTs against the direct transform
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "check.h"
+#include "dft.h"
+
+#include "fftn.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+/**
+ *  Entry index of the direct N-dimensional transform of a row-major array, the sum over
+ *  every entry j of x[j] times the product over axes of exp(2 pi i j_d k_d / n_d).
+ */
+
+template <typename T>
+static std::complex<long double> direct_dftn(const std::vector<std::complex<T>> &x, const std::vector<size_t> &shape,
+                                             size_t index) {
+    const long double pi = std::acos(-1.0L);
+    std::vector<size_t> k(shape.size());
+    for(size_t d = shape.size(), rest = index; d -- > 0; rest /= shape[d])
+        k[d] = rest % shape[d];
+
+    std::complex<long double> s = 0;
+    for(size_t j = 0; j < x.size(); ++ j) {
+        long double phase = 0;
+        for(size_t d = shape.size(), rest = j; d -- > 0; rest /= shape[d])
+            phase += (long double) (rest % shape[d] * k[d] % shape[d]) / shape[d];
+        s += std::complex<long double>(x[j]) * std::polar(1.0L, 2 * pi * phase);
+    }
+    return s;
+}
+
+template <typename T>
+static void test_fft2() {
+    const size_t shapes[][2] = {{1, 1}, {1, 8}, {3, 5}, {8, 12}, {17, 64}, {20, 33}};
+
+    for(const auto &shape : shapes) {
+        const size_t rows = shape[0], columns = shape[1];
+        const std::vector<std::complex<T>> x = random_signal<T>(rows * columns);
+        matrix<std::complex<T>> m(rows, columns);
+        for(size_t i = 0; i < rows; ++ i)
+            for(size_t j = 0; j < columns; ++ j)
+                m(i,j) = x[i * columns + j];
+
+        FFT2(m, 1);
+        long double error = 0;
+        for(size_t i = 0; i < rows; ++ i)
+            for(size_t j = 0; j < columns; ++ j)
+                error = std::max(error, std::abs(direct_dftn(x, {rows, columns}, i * columns + j) -
+                                                 std::complex<long double>(m(i,j))));
+        CHECK(error <= fft_tolerance<T>(rows * columns));
+
+        FFT2(m, -1);
+        error = 0;
+        for(size_t i = 0; i < rows; ++ i)
+            for(size_t j = 0; j < columns; ++ j)
+                error = std::max(error, (long double) std::abs(m(i,j) - x[i * columns + j]));
+        CHECK(error <= fft_tolerance<T>(rows * columns));
+    }
+}
+
+template <typename T>
+static void test_fftn() {
+    const std::vector<std::vector<size_t>> shapes = {{7}, {4, 6, 5}, {2, 1, 3, 8}, {16, 16, 3}};
+
+    for(const std::vector<size_t> &shape : shapes) {
+        size_t total = 1;
+        for(size_t n : shape)
+            total *= n;
+        const std::vector<std::complex<T>> x = random_signal<T>(total);
+        std::vector<std::complex<T>> y = x;
+
+        FFTN(y, shape, 1);
+        long double error = 0;
+        for(size_t i = 0; i < total; ++ i)
+            error = std::max(error, std::abs(direct_dftn(x, shape, i) - std::complex<long double>(y[i])));
+        CHECK(error <= fft_tolerance<T>(total));
+
+        FFTN(y.data(), shape, -1);
+        error = 0;
+        for(size_t i = 0; i < total; ++ i)
+            error = std::max(error, (long double) std::abs(y[i] - x[i]));
+        CHECK(error <= fft_tolerance<T>(total));
+    }
+}
+
+int main() {
+    test_fft2<float>();
+    test_fft2<double>();
+    test_fftn<float>();
+    test_fftn<double>();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,102 @@
+/**
+ *  fixed_matrix.cpp
+ *  Purpose: tests of fixed_matrix against the same operations on matrix
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "check.h"
+#include "random.h"
+
+#include "fixed_matrix.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+// Arithmetic on constants is evaluated by the compiler.
+
+constexpr fixed_matrix<int, 2, 2> square = {1, 2, 3, 4};
+static_assert((square * square)(1,0) == 15, "products are constexpr");
+static_assert((square + square - square * 2) == fixed_matrix<int, 2, 2>(), "sums are constexpr");
+static_assert(square.transpose()(0,1) == 3, "transposes are constexpr");
+static_assert(square.determinant<int>() == -2, "determinants are constexpr");
+
+template <typename T, size_t R, size_t C>
+static fixed_matrix<T, R, C> random_fixed() {
+    fixed_matrix<T, R, C> ret;
+    for(size_t i = 0; i < R; ++ i)
+        for(size_t j = 0; j < C; ++ j)
+            ret(i,j) = random_value<T>();
+    return ret;
+}
+
+template <typename T, size_t R, size_t C>
+static long double difference(const fixed_matrix<T, R, C> &a, const matrix<T> &b) {
+    long double ret = 0;
+    for(size_t i = 0; i < R; ++ i)
+        for(size_t j = 0; j < C; ++ j)
+            ret = std::max(ret, std::fabs((long double) a(i,j) - (long double) b(i,j)));
+    return ret;
+}
+
+/**
+ *  The closed forms of orders 1 to 4, and the LU path above them, agree with matrix.
+ */
+
+template <size_t N>
+static void test_square() {
+    fixed_matrix<double, N, N> a = random_fixed<double, N, N>();
+    for(size_t i = 0; i < N; ++ i)
+        a(i,i) += 2;
+    const matrix<double> m = a;
+
+    CHECK(std::fabs(a.determinant() - m.determinant()) < 1e-14L);
+    CHECK(difference(a.inverse().template cast<double>(), matrix<double>(m.inverse())) < 1e-14L);
+    CHECK(difference(a * a.template inverse<double>(), matrix<double>::identity(N)) < 1e-14L);
+    CHECK((fixed_matrix<double, N, N>(m) == a));
+
+    bool thrown = false;
+    try {
+        fixed_matrix<double, N, N>(1.0).inverse();
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown || N == 1);
+}
+
+static void test_arithmetic() {
+    const fixed_matrix<double, 2, 3> a = random_fixed<double, 2, 3>(), b = random_fixed<double, 2, 3>();
+    const fixed_matrix<double, 3, 4> c = random_fixed<double, 3, 4>();
+    const matrix<double> ma = a, mb = b, mc = c;
+
+    CHECK(difference(a * c, ma * mc) < 1e-15L);
+    CHECK(difference(a + b, matrix<double>(ma + mb)) == 0);
+    CHECK(difference(a - b * 3.0, matrix<double>(ma - mb * 3.0)) == 0);
+    CHECK(difference(-a, matrix<double>(-ma)) == 0);
+    CHECK(difference(a.transpose(), ma.transpose()) == 0);
+    CHECK(a.to_matrix() == ma);
+
+    fixed_matrix<double, 2, 3> d = a;
+    d += b;
+    d -= a;
+    d *= 2.0;
+    CHECK(d == b * 2.0);
+    CHECK(d != b);
+    const fixed_matrix<int, 3, 1> column = {1, 2, 3};
+    CHECK((fixed_matrix<int, 3, 3>::identity() * column == column));
+}
+
+int main() {
+    test_square<1>();
+    test_square<2>();
+    test_square<3>();
+    test_square<4>();
+    test_square<5>();
+    test_square<7>();
+    test_arithmetic();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,107 @@
+/**
+ *  gemm.cpp
+ *  Purpose: tests of the blocked matrix multiply against a triple loop in long double
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "check.h"
+#include "random.h"
+
+#include "expression.h"
+#include "gemm.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  Checks c = alpha * a * b + beta * c0, entry by entry.
+ */
+
+template <typename T>
+static void check_product(const matrix<T> &a, const matrix<T> &b, const matrix<T> &c, long double alpha,
+                          long double beta, const matrix<T> &c0) {
+    const size_t M = c.rows(), N = c.columns(), K = a.columns();
+    CHECK(M == a.rows() && N == b.columns());
+    long double error = 0;
+    for(size_t i = 0; i < M; ++ i)
+        for(size_t j = 0; j < N; ++ j) {
+            long double s = 0;
+            for(size_t k = 0; k < K; ++ k)
+                s += (long double) a(i,k) * (long double) b(k,j);
+            s = alpha * s + (beta == 0 ? 0 : beta * (long double) c0(i,j));
+            error = std::max(error, std::fabs(s - (long double) c(i,j)));
+        }
+    CHECK(error <= tolerance<T>(K + 1) * (1 + std::fabs(alpha)));
+}
+
+/**
+ *  Multiplies shapes on both sides of the dispatch threshold, and of every block and
+ *  register tile edge.
+ */
+
+template <typename T>
+static void test_gemm() {
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 13, 5}, {64, 64, 64}, {65, 63, 66}, {129, 70, 201}, {300, 257, 310}};
+
+    for(const auto &shape : shapes) {
+        const size_t M = shape[0], K = shape[1], N = shape[2];
+        const matrix<T> a = random_matrix<T>(M, K), b = random_matrix<T>(K, N);
+
+        check_product(a, b, a * b, 1, 0, matrix<T>());
+
+        const matrix<T> c0 = random_matrix<T>(M, N);
+        matrix<T> c = c0;
+        gemm(M, N, K, T(2), a.data(), a.stride(), b.data(), b.stride(), T(-1), c.data(), c.stride());
+        check_product(a, b, c, 2, -1, c0);
+
+        // Transposed operands are read in place, through views or the gemm flags.
+
+        const matrix<T> at = a.transpose(), bt = b.transpose();
+        check_product(a, b, transposed(at) * b, 1, 0, matrix<T>());
+        check_product(a, b, a * transposed(bt), 1, 0, matrix<T>());
+        check_product(a, b, transposed(at) * transposed(bt), 1, 0, matrix<T>());
+
+        c = c0;
+        gemm(gemm_transpose::transpose, gemm_transpose::none, M, N, K, T(2), at.data(), at.stride(),
+             b.data(), b.stride(), T(-1), c.data(), c.stride());
+        check_product(a, b, c, 2, -1, c0);
+        c = c0;
+        gemm(gemm_transpose::transpose, gemm_transpose::transpose, M, N, K, T(2), at.data(), at.stride(),
+             bt.data(), bt.stride(), T(-1), c.data(), c.stride());
+        check_product(a, b, c, 2, -1, c0);
+    }
+}
+
+int main() {
+    test_gemm<float>();
+    test_gemm<double>();
+    test_gemm<int>();
+    test_gemm<long double>();
+
+    // Blocks far smaller than the defaults split even small products into many panels,
+    // first on one thread, then spread over a pool.
+
+    const gemm_blocking defaults = gemm_tuning();
+    gemm_tuning() = {12, 16, 40, 0, std::numeric_limits<size_t>::max()};
+    test_gemm<float>();
+    test_gemm<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    gemm_tuning().parallel_threshold = 0;
+    test_gemm<float>();
+    test_gemm<double>();
+    gemm_tuning() = defaults;
+    test_gemm<float>();
+    test_gemm<double>();
+    set_executor(nullptr);
+
+    return algebra_test::failures() != 0;
+}
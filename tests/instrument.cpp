@@ -0,0 +1,144 @@
+/**
+ *  instrument.cpp
+ *  Purpose: tests of the per-operation counters and trace hooks, built with
+ *  ALGEBRA_INSTRUMENT=1
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <complex>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "fft.h"
+#include "gauss.h"
+#include "instrument.h"
+#include "matrix.h"
+
+using namespace algebra_test;
+
+/**
+ *  Records the begin and end calls of the trace hooks, and how deeply they nest.
+ */
+
+struct trace_log {
+    std::vector<std::string> events;
+    int depth = 0;
+    int deepest = 0;
+};
+
+static void trace_begin(const char *name, void *context) {
+    trace_log &log = *static_cast<trace_log *>(context);
+    log.events.push_back(std::string("+") + name);
+    log.deepest = std::max(log.deepest, ++ log.depth);
+}
+
+static void trace_end(const char *name, void *context) {
+    trace_log &log = *static_cast<trace_log *>(context);
+    log.events.push_back(std::string("-") + name);
+    -- log.depth;
+}
+
+static void test_counters() {
+    CHECK(instrumentation_available());
+    CHECK(std::strcmp(operation_name(instrumented_operation::fft_plan), "fft_plan") == 0);
+
+    const matrix<double> a = random_matrix<double>(30, 40), b = random_matrix<double>(40, 50);
+    reset_instrumentation();
+    const matrix<double> c = a * b;
+    const operation_stats multiply = instrumentation_stats(instrumented_operation::multiply);
+    CHECK(multiply.calls == 1);
+    CHECK(multiply.flops == 2 * 30 * 40 * 50);
+    CHECK(multiply.bytes_allocated >= 30 * 50 * sizeof(double));
+
+    const matrix<double> t = c.transpose();
+    CHECK(instrumentation_stats(instrumented_operation::transpose).calls == 1);
+
+    // An operation running inside another of the same kind is counted once, as the outer one.
+
+    matrix<double> s = random_matrix<double>(20, 20);
+    for(size_t i = 0; i < 20; ++ i)
+        s(i,i) += 4;
+    reset_instrumentation();
+    const matrix<double> inverse = s.inverse<double>();
+    (void) s.determinant<double>();
+    CHECK(instrumentation_stats(instrumented_operation::inverse).calls == 1);
+    CHECK(instrumentation_stats(instrumented_operation::inverse).flops == 2 * 20 * 20 * 20);
+    CHECK(instrumentation_stats(instrumented_operation::determinant).calls == 1);
+    CHECK(instrumentation_stats(instrumented_operation::multiply).calls == 0);
+
+    std::vector<std::vector<double>> system(3, std::vector<double>(3, 0.0));
+    for(size_t i = 0; i < 3; ++ i)
+        system[i][i] = 2;
+    gauss(system, std::vector<double>(3, 1.0));
+    CHECK(instrumentation_stats(instrumented_operation::gauss).calls == 1);
+
+    // cached_fft_plan builds each plan once, so only the first transform counts a plan.
+
+    reset_instrumentation();
+    std::vector<std::complex<double>> x(4567, std::complex<double>(1));
+    FFT(x, 1);
+    const uint64_t plans = instrumentation_stats(instrumented_operation::fft_plan).calls;
+    CHECK(plans >= 1);
+    FFT(x, 1);
+    CHECK(instrumentation_stats(instrumented_operation::fft_plan).calls == plans);
+    CHECK(instrumentation_stats(instrumented_operation::fft).calls == 2);
+    CHECK(instrumentation_stats(instrumented_operation::fft).flops > 0);
+
+    reset_instrumentation();
+    for(size_t i = 0; i < instrumented_operation_count; ++ i) {
+        const operation_stats stats = instrumentation_stats(instrumented_operation(i));
+        CHECK(stats.calls == 0 && stats.bytes_allocated == 0 && stats.flops == 0 && stats.nanoseconds == 0);
+    }
+}
+
+static void test_hooks() {
+    trace_log log;
+    instrumentation_hooks() = {trace_begin, trace_end, &log};
+
+    const matrix<double> a = random_matrix<double>(10, 10);
+    const matrix<double> b = (a * a).transpose();
+
+    instrumentation_hooks() = {nullptr, nullptr, nullptr};
+    const std::vector<std::string> expected = {"+multiply", "-multiply", "+transpose", "-transpose"};
+    CHECK(log.events == expected);
+    CHECK(log.depth == 0 && log.deepest == 1);
+
+    const matrix<double> c = a * a;
+    CHECK(log.events.size() == expected.size());
+}
+
+/**
+ *  Operations on several threads at once are all counted.
+ */
+
+static void test_threads() {
+    const matrix<double> a = random_matrix<double>(16, 16);
+    reset_instrumentation();
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; ++ t)
+        threads.emplace_back([&] {
+            for(int i = 0; i < 25; ++ i) {
+                const matrix<double> p = a * a;
+            }
+        });
+    for(std::thread &thread : threads)
+        thread.join();
+
+    CHECK(instrumentation_stats(instrumented_operation::multiply).calls == 100);
+    CHECK(instrumentation_stats(instrumented_operation::multiply).flops == 100 * 2 * 16 * 16 * 16);
+}
+
+int main() {
+    test_counters();
+    test_hooks();
+    test_threads();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,192 @@
+/**
+ *  iterative.cpp
+ *  Purpose: tests of the conjugate gradient, BiCGSTAB and GMRES solvers and their
+ *  preconditioners, on sparse and dense systems
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "iterative.h"
+#include "matrix.h"
+#include "sparse.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  The five-point discretisation of -laplace(u) + c . grad(u) on a k x k grid, which is
+ *  symmetric positive definite for c = 0 and nonsymmetric otherwise.
+ */
+
+static sparse_matrix<double> convection_diffusion(size_t k, double c) {
+    std::vector<sparse_entry<double>> triplets;
+    for(size_t i = 0; i < k; ++ i) {
+        for(size_t j = 0; j < k; ++ j) {
+            const size_t p = i * k + j;
+            triplets.push_back({p, p, 4.0});
+            if(i > 0) triplets.push_back({p, p - k, -1.0 - c});
+            if(i + 1 < k) triplets.push_back({p, p + k, -1.0 + c});
+            if(j > 0) triplets.push_back({p, p - 1, -1.0 - c});
+            if(j + 1 < k) triplets.push_back({p, p + 1, -1.0 + c});
+        }
+    }
+    return sparse_matrix<double>(k * k, k * k, triplets);
+}
+
+/**
+ *  The relative residual ||b - A x|| / ||b||, computed independently of the solvers.
+ */
+
+template <typename M>
+static double residual(const M &A, const std::vector<double> &b, const std::vector<double> &x) {
+    const std::vector<double> y = sparse_matrix<double>(A) * x;
+    double r = 0, s = 0;
+    for(size_t i = 0; i < b.size(); ++ i) {
+        r += (b[i] - y[i]) * (b[i] - y[i]);
+        s += b[i] * b[i];
+    }
+    return std::sqrt(r / s);
+}
+
+static std::vector<double> random_vector(size_t n) {
+    std::vector<double> ret(n);
+    for(double &v : ret)
+        v = random_value<double>();
+    return ret;
+}
+
+/**
+ *  Each solver must reach the tolerance it was given, and report an accurate residual.
+ */
+
+template <typename M, typename Solve>
+static void check_solve(const M &A, const Solve &solve) {
+    const std::vector<double> b = random_vector(A.rows());
+    iterative_options<double> options;
+    options.tolerance = 1e-10;
+    options.max_iterations = 5000;
+
+    std::vector<double> x;
+    const iterative_result<double> result = solve(A, b, x, options);
+    CHECK(result.converged);
+    CHECK(result.iterations > 0 && result.iterations <= options.max_iterations);
+    CHECK(result.residual <= options.tolerance);
+    CHECK(x.size() == b.size());
+    CHECK(residual(A, b, x) <= 10 * options.tolerance);
+
+    // A warm start from the solution needs few iterations, and a zero right-hand side none.
+
+    const iterative_result<double> warm = solve(A, b, x, options);
+    CHECK(warm.converged && warm.iterations <= 1);
+
+    std::vector<double> zero(b.size(), 0.0);
+    const iterative_result<double> trivial = solve(A, zero, x, options);
+    CHECK(trivial.converged && trivial.iterations == 0);
+    CHECK(x == zero);
+}
+
+static void test_conjugate_gradient() {
+    const sparse_matrix<double> A = convection_diffusion(30, 0);
+    const jacobi_preconditioner<double> jacobi(A);
+    const ilu0_preconditioner<double> ilu(A);
+
+    size_t plain = 0, preconditioned = 0;
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        const auto r = conjugate_gradient(a, b, x, o);
+        if(!plain) plain = r.iterations;
+        return r;
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return conjugate_gradient(a, b, x, o, jacobi);
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        const auto r = conjugate_gradient(a, b, x, o, ilu);
+        if(!preconditioned) preconditioned = r.iterations;
+        return r;
+    });
+    CHECK(preconditioned < plain);
+
+    check_solve(A.to_dense(), [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return conjugate_gradient(a, b, x, o, jacobi);
+    });
+}
+
+static void test_nonsymmetric() {
+    const sparse_matrix<double> A = convection_diffusion(30, 0.4);
+    const jacobi_preconditioner<double> jacobi(A);
+    const ilu0_preconditioner<double> ilu(A);
+
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return bicgstab(a, b, x, o);
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return bicgstab(a, b, x, o, ilu);
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return gmres(a, b, x, o);
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return gmres(a, b, x, o, jacobi);
+    });
+    check_solve(A, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return gmres(a, b, x, o, ilu);
+    });
+
+    matrix<double> dense = random_matrix<double>(80, 80);
+    for(size_t i = 0; i < dense.rows(); ++ i)
+        dense(i,i) += 20;
+    check_solve(dense, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return bicgstab(a, b, x, o);
+    });
+    check_solve(dense, [&](const auto &a, const auto &b, auto &x, const auto &o) {
+        return gmres(a, b, x, o);
+    });
+}
+
+static void test_limits() {
+    const sparse_matrix<double> A = convection_diffusion(30, 0.4);
+    const std::vector<double> b = random_vector(A.rows());
+    iterative_options<double> options;
+    options.max_iterations = 3;
+
+    std::vector<double> x;
+    const iterative_result<double> result = gmres(A, b, x, options);
+    CHECK(!result.converged && result.iterations == 3);
+    CHECK(std::fabs(result.residual - residual(A, b, x)) <= 1e-8);
+
+    bool thrown = false;
+    try {
+        jacobi_preconditioner<double> jacobi(sparse_matrix<double>(2, 2, {{0, 0, 1.0}, {1, 0, 1.0}}));
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    thrown = false;
+    try {
+        ilu0_preconditioner<double> ilu(sparse_matrix<double>(2, 2, {{0, 0, 1.0}, {1, 0, 1.0}}));
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+int main() {
+    test_conjugate_gradient();
+    test_nonsymmetric();
+    test_limits();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_conjugate_gradient();
+    test_nonsymmetric();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
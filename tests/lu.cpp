@@ -0,0 +1,155 @@
+/**
+ *  lu.cpp
+ *  Purpose: tests of the blocked LU factorization, its solves and gauss()
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "elimination.h"
+#include "gauss.h"
+#include "lu.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  Factors orders on both sides of the panel width; the factors must reproduce the matrix
+ *  with its rows exchanged, and the solves must leave small residuals.
+ */
+
+template <typename T>
+static void test_factor() {
+    for(size_t n : {size_t(1), size_t(5), lu_block_size - 1, lu_block_size, lu_block_size + 1, size_t(200),
+                    size_t(333)}) {
+        matrix<T> a = random_matrix<T>(n, n);
+        for(size_t i = 0; i < n; ++ i)
+            a(i,i) += T(2);
+
+        matrix<T> lu = a;
+        std::vector<size_t> pivots(n);
+        CHECK(lu_factor(n, lu.data(), lu.stride(), pivots.data()) == n);
+
+        matrix<T> permuted = a;
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j < n; ++ j)
+                std::swap(permuted(i,j), permuted(pivots[i],j));
+
+        long double error = 0;
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j < n; ++ j) {
+                long double s = 0;
+                for(size_t k = 0; k <= std::min(i, j); ++ k)
+                    s += (k == i ? 1.0L : (long double) lu(i,k)) * (long double) lu(k,j);
+                error = std::max(error, std::fabs(s - (long double) permuted(i,j)));
+            }
+        CHECK(error <= 4 * tolerance<T>(n));
+
+        const size_t m = 3;
+        const matrix<T> b = random_matrix<T>(n, m);
+        matrix<T> x = b;
+        lu_solve(n, lu.data(), lu.stride(), pivots.data(), m, x.data(), x.stride());
+
+        long double residual = 0, size = 0;
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j < m; ++ j) {
+                long double s = -(long double) b(i,j);
+                for(size_t k = 0; k < n; ++ k)
+                    s += (long double) a(i,k) * (long double) x(k,j);
+                residual = std::max(residual, std::fabs(s));
+                size = std::max(size, std::fabs((long double) x(i,j)));
+            }
+        CHECK(residual <= 4 * tolerance<T>(n) * (1 + size));
+
+        // lu_decomposition agrees with the raw kernels, for many right-hand sides and for one.
+
+        const lu_decomposition<T> decomposition(a);
+        CHECK(!decomposition.singular() && decomposition.size() == n);
+        const matrix<T> y = decomposition.solve(b);
+        std::vector<T> column(n);
+        for(size_t i = 0; i < n; ++ i)
+            column[i] = b(i,1);
+        const std::vector<T> z = decomposition.solve(column);
+
+        long double difference = 0;
+        for(size_t i = 0; i < n; ++ i) {
+            for(size_t j = 0; j < m; ++ j)
+                difference = std::max(difference, std::fabs((long double) y(i,j) - (long double) x(i,j)));
+            difference = std::max(difference, std::fabs((long double) z[i] - (long double) x(i,1)));
+        }
+        CHECK(difference <= 4 * tolerance<T>(n) * (1 + size));
+    }
+
+    // A zero column stays exactly zero through every update, so its pivot is exactly zero.
+
+    matrix<T> singular = random_matrix<T>(100, 100);
+    for(size_t i = 0; i < 100; ++ i)
+        singular(i,70) = T(0);
+    std::vector<size_t> pivots(100);
+    CHECK(lu_factor(size_t(100), singular.data(), singular.stride(), pivots.data()) < 100);
+
+    const lu_decomposition<T> decomposition(singular);
+    CHECK(decomposition.singular());
+    CHECK(decomposition.determinant() == T(0));
+    bool thrown = false;
+    try {
+        decomposition.inverse();
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+/**
+ *  The determinant and inverse of a matrix whose first pivot is zero, so the factorization
+ *  must exchange rows.
+ */
+
+static void test_decomposition() {
+    matrix<double> a(3, 3);
+    const double entries[9] = {0, 2, 1, 1, 1, 1, 2, 1, 3};
+    for(size_t i = 0; i < 9; ++ i)
+        a(i / 3, i % 3) = entries[i];
+
+    const lu_decomposition<double> decomposition(a);
+    CHECK(std::fabs(decomposition.determinant() - (-3)) < 1e-14);
+    CHECK(decomposition.log_determinant().sign == -1);
+    CHECK(std::fabs(decomposition.log_determinant().log_abs - std::log(3.0)) < 1e-14);
+
+    const matrix<double> identity = a * decomposition.inverse();
+    for(size_t i = 0; i < 3; ++ i)
+        for(size_t j = 0; j < 3; ++ j)
+            CHECK(std::fabs(identity(i,j) - (i == j ? 1 : 0)) < 1e-14);
+}
+
+static void test_gauss() {
+    const std::vector<double> x = gauss<double>({{2, 1, -1}, {-3, -1, 2}, {-2, 1, 2}}, {8, -11, -3});
+    CHECK(x.size() == 3 && std::fabs(x[0] - 2) < 1e-14 && std::fabs(x[1] - 3) < 1e-14 && std::fabs(x[2] + 1) < 1e-14);
+
+    // Rows shorter than the system are padded with zeros.
+
+    const std::vector<double> y = gauss<double>({{0, 1}, {4}}, {3, 8});
+    CHECK(y.size() == 2 && std::fabs(y[0] - 2) < 1e-15 && std::fabs(y[1] - 3) < 1e-15);
+}
+
+int main() {
+    thread_pool pool(4);
+    set_executor(&pool);
+
+    test_factor<float>();
+    test_factor<double>();
+    test_factor<long double>();
+    test_decomposition();
+    test_gauss();
+
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,230 @@
+/**
+ *  mapped.cpp
+ *  Purpose: tests of the matrix file format, mapped_matrix and the out-of-core multiply and
+ *  LU factorization
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "elimination.h"
+#include "mapped.h"
+#include "matrix.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  The test files live next to the test binary, and are removed at the end.
+ */
+
+static const std::string path_a = "mapped_test_a.mat", path_b = "mapped_test_b.mat", path_c = "mapped_test_c.mat";
+
+template <typename T>
+static long double max_error(const matrix_view<T> &a, const matrix_view<T> &b) {
+    long double error = 0;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            error = std::max(error, (long double) std::abs(a(i,j) - b(i,j)));
+    return error;
+}
+
+template <typename T>
+static bool throws_file_error(const std::string &path, bool writable = false) {
+    try {
+        mapped_matrix<T> m(path, writable);
+    } catch(const matrix_file_error &) {
+        return true;
+    }
+    return false;
+}
+
+/**
+ *  Counts the mappings of a file listed in /proc/self/maps, or 0 where there is none.
+ */
+
+static size_t mappings_of(const std::string &path) {
+    std::ifstream maps("/proc/self/maps");
+    size_t count = 0;
+    for(std::string line; std::getline(maps, line); )
+        if(line.size() >= path.size() && line.compare(line.size() - path.size(), path.size(), path) == 0)
+            ++ count;
+    return count;
+}
+
+template <typename T>
+static void test_round_trip() {
+    for(size_t rows : {size_t(0), size_t(1), size_t(7), size_t(100)}) {
+        matrix<T> a(rows, 37);
+        for(size_t i = 0; i < rows; ++ i)
+            for(size_t j = 0; j < 37; ++ j)
+                a(i,j) = T(int(i * 37 + j) % 101 - 50);
+
+        write_matrix(path_a, a);
+        CHECK(read_matrix<T>(path_a) == a);
+
+        const mapped_matrix<T> m(path_a);
+        CHECK(m.rows() == rows && m.columns() == 37 && !m.writable());
+        CHECK(m.stride() == a.stride());
+        CHECK(reinterpret_cast<uintptr_t>(m.data()) % buffer_alignment == 0);
+        CHECK(matrix<T>(m.view()) == a);
+    }
+
+    // Windows of matrices are written without their parents' entries.
+
+    matrix<T> a(20, 30);
+    for(size_t i = 0; i < 20; ++ i)
+        for(size_t j = 0; j < 30; ++ j)
+            a(i,j) = T(int(i * 31 + j));
+    write_matrix(path_a, a.block(3, 4, 5, 6));
+    CHECK(read_matrix<T>(path_a) == matrix<T>(a.block(3, 4, 5, 6)));
+}
+
+static void test_mapping() {
+    mapped_matrix<double> m = mapped_matrix<double>::create(path_a, 50, 40);
+    CHECK(m.writable() && m.rows() == 50 && m.columns() == 40);
+    CHECK(matrix<double>(m.view()) == matrix<double>(50, 40));
+
+    const matrix<double> a = random_matrix<double>(50, 40);
+    m.ref() = a;
+    m.ref().block(10, 10, 2, 2).fill(7.0);
+    m.flush();
+    m.evict_rows(0, 50);
+    CHECK(m.view()(11,11) == 7.0 && m.view()(9,9) == a(9,9));
+
+    mapped_matrix<double> moved(std::move(m));
+    CHECK(m.rows() == 0 && moved.rows() == 50);
+    moved = mapped_matrix<double>();
+
+    matrix<double> expected = a;
+    expected.block(10, 10, 2, 2).fill(7.0);
+    CHECK(read_matrix<double>(path_a) == expected);
+
+    // Changes through a writable mapping of an existing file reach the file.
+
+    {
+        mapped_matrix<double> w(path_a, true);
+        w.ref().row(0).fill(-1.0);
+    }
+    expected.row(0).fill(-1.0);
+    CHECK(read_matrix<double>(path_a) == expected);
+}
+
+static void test_errors() {
+    CHECK(throws_file_error<double>("mapped_test_missing.mat"));
+
+    write_matrix(path_a, matrix<double>(3, 3, 1.0));
+    CHECK(throws_file_error<float>(path_a));
+    CHECK(throws_file_error<int64_t>(path_a));
+    CHECK(!throws_file_error<double>(path_a));
+
+    // A mapping whose header is rejected is released.
+
+    for(size_t k = 0; k < 3; ++ k)
+        CHECK(throws_file_error<float>(path_a));
+    CHECK(mappings_of(path_a) == 0);
+
+    {
+        std::ofstream out(path_b, std::ios::binary);
+        out << std::string(100, 'x');
+    }
+    CHECK(throws_file_error<double>(path_b));
+
+    {
+        std::ofstream out(path_b, std::ios::binary);
+        out << "short";
+    }
+    CHECK(throws_file_error<double>(path_b));
+
+    // A header promising more entries than the file holds is rejected.
+
+    write_matrix(path_a, matrix<double>(30, 30, 1.0));
+    std::vector<char> bytes;
+    {
+        std::ifstream in(path_a, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(path_b, std::ios::binary);
+        out.write(bytes.data(), std::streamsize(bytes.size() / 2));
+    }
+    CHECK(throws_file_error<double>(path_b));
+}
+
+/**
+ *  Budgets far below the operands' size split the work into many panels and slabs.
+ */
+
+static void test_out_of_core() {
+    const size_t shapes[][3] = {{1, 1, 1}, {70, 33, 41}, {150, 200, 90}};
+
+    for(const auto &shape : shapes) {
+        const size_t M = shape[0], K = shape[1], N = shape[2];
+        const matrix<double> a = random_matrix<double>(M, K), b = random_matrix<double>(K, N);
+        write_matrix(path_a, a);
+        write_matrix(path_b, b);
+        const mapped_matrix<double> x(path_a), y(path_b);
+
+        for(size_t budget : {size_t(1) << 12, size_t(1) << 16, out_of_core_budget}) {
+            mapped_matrix<double> out = mapped_matrix<double>::create(path_c, M, N);
+            multiply_out_of_core(out, x, y, budget);
+            const matrix<double> product = a * b;
+            CHECK(max_error(out.view(), product.view()) <= tolerance<double>(K));
+        }
+    }
+
+    for(size_t n : {size_t(1), size_t(5), size_t(130), size_t(300)}) {
+        matrix<double> a = random_matrix<double>(n, n);
+        matrix<double> lu = a;
+        std::vector<size_t> pivots(n), file_pivots(n);
+        const size_t singular = lu_factor(n, lu.data(), lu.stride(), pivots.data());
+
+        for(size_t budget : {size_t(1) << 14, size_t(1) << 18, out_of_core_budget}) {
+            write_matrix(path_a, a);
+            mapped_matrix<double> m(path_a, true);
+            CHECK(lu_factor_out_of_core(m, file_pivots.data(), budget) == singular);
+            CHECK(file_pivots == pivots);
+            CHECK(max_error(m.view(), lu.view()) <= n * tolerance<double>(n));
+
+            matrix<double> b = random_matrix<double>(n, 2), x = b;
+            lu_solve(n, m.data(), m.stride(), file_pivots.data(), 2, x.data(), x.stride());
+            CHECK(max_error((a * x).view(), b.view()) <= n * tolerance<double>(n));
+        }
+    }
+
+    write_matrix(path_a, matrix<double>(4, 4));
+    mapped_matrix<double> zero(path_a, true);
+    std::vector<size_t> pivots(4);
+    CHECK(lu_factor_out_of_core(zero, pivots.data()) == 0);
+}
+
+int main() {
+    test_round_trip<double>();
+    test_round_trip<float>();
+    test_round_trip<int32_t>();
+    test_round_trip<std::complex<double>>();
+    test_mapping();
+    test_errors();
+    test_out_of_core();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_out_of_core();
+    set_executor(nullptr);
+
+    std::remove(path_a.c_str());
+    std::remove(path_b.c_str());
+    std::remove(path_c.c_str());
+    return algebra_test::failures() != 0;
+}
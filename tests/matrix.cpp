@@ -0,0 +1,237 @@
+/**
+ *  matrix.cpp
+ *  Purpose: tests of the matrix storage layout and its arithmetic
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "check.h"
+
+#include "matrix.h"
+#include "thread_pool.h"
+
+/**
+ *  Fills an m x n matrix with small integers that differ from entry to entry.
+ */
+
+template <typename T>
+matrix<T> numbered(size_t m, size_t n) {
+    matrix<T> a(m, n);
+    for(size_t i = 0; i < m; ++ i)
+        for(size_t j = 0; j < n; ++ j)
+            a(i,j) = T(int((i * 7 + j * 3) % 11) - 5);
+    return a;
+}
+
+template <typename T>
+void check_layout(size_t m, size_t n) {
+    const matrix<T> a = numbered<T>(m, n);
+    CHECK(a.rows() == m && a.columns() == n);
+    CHECK(a.stride() >= n);
+    CHECK(reinterpret_cast<uintptr_t>(a.data()) % buffer_alignment == 0);
+    if(n * sizeof(T) > buffer_alignment)
+        CHECK(a.stride() * sizeof(T) % buffer_alignment == 0);
+    for(size_t i = 0; i < m; ++ i)
+        for(size_t j = 0; j < n; ++ j)
+            CHECK(&a(i,j) == a.data() + i * a.stride() + j);
+}
+
+void test_layout() {
+    check_layout<float>(3, 5);
+    check_layout<float>(7, 17);
+    check_layout<double>(9, 33);
+    check_layout<int>(1, 100);
+    CHECK(matrix<double>().rows() == 0 && matrix<double>().columns() == 0);
+}
+
+void test_arithmetic() {
+    const matrix<int> a = numbered<int>(4, 6), b = numbered<int>(6, 3), c = numbered<int>(4, 6).transpose().transpose();
+    CHECK(a == c);
+    CHECK(!(a != c));
+
+    const matrix<int> sum = a + c, difference = a - c, negated = -a, scaled = a * 3;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j) {
+            CHECK(sum(i,j) == 2 * a(i,j));
+            CHECK(difference(i,j) == 0);
+            CHECK(negated(i,j) == -a(i,j));
+            CHECK(scaled(i,j) == 3 * a(i,j));
+        }
+
+    const matrix<int> product = a * b;
+    CHECK(product.rows() == 4 && product.columns() == 3);
+    for(size_t i = 0; i < 4; ++ i)
+        for(size_t j = 0; j < 3; ++ j) {
+            int expected = 0;
+            for(size_t k = 0; k < 6; ++ k)
+                expected += a(i,k) * b(k,j);
+            CHECK(product(i,j) == expected);
+        }
+
+    const matrix<int> t = a.transpose();
+    CHECK(t.rows() == 6 && t.columns() == 4);
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            CHECK(t(j,i) == a(i,j));
+
+    const matrix<double> converted(a);
+    CHECK(converted(2,3) == double(a(2,3)));
+    CHECK(matrix<int>::identity(3) * b.transpose() == b.transpose());
+}
+
+void test_inverse() {
+    matrix<double> a(3, 3);
+    const double entries[9] = {2, 1, 0, 1, 3, 1, 0, 1, 4};
+    for(size_t i = 0; i < 9; ++ i)
+        a(i / 3, i % 3) = entries[i];
+    CHECK(a.determinant() == 18);
+
+    const matrix<long double> product = matrix<long double>(a) * a.inverse();
+    for(size_t i = 0; i < 3; ++ i)
+        for(size_t j = 0; j < 3; ++ j)
+            CHECK(std::abs(product(i,j) - (i == j ? 1 : 0)) < 1e-15);
+
+    bool thrown = false;
+    try {
+        matrix<double>(3, 3, 1.0).inverse();
+    } catch(const degenerate_matrix_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(matrix<double>(3, 3, 1.0).determinant() == 0);
+}
+
+void test_in_place() {
+    const matrix<double> a = numbered<double>(5, 19), b = numbered<double>(19, 5);
+    matrix<double> c = a;
+
+    c += a;
+    CHECK(c == a * 2.0);
+    c -= a * 3.0;
+    CHECK(c == -a);
+    c += a * 4.0 - a;
+    CHECK(c == a * 2.0);
+    c *= 0.5;
+    CHECK(c == a);
+
+    matrix<double> square = numbered<double>(5, 5), expected = square * square;
+    square *= numbered<double>(5, 5);
+    CHECK(square == expected);
+
+    // Moves leave the source empty; the *_into variants keep storage of an unchanged shape.
+
+    matrix<double> moved = std::move(c);
+    CHECK(moved == a && c.rows() == 0 && c.columns() == 0);
+    c = std::move(moved);
+    CHECK(c == a && moved.rows() == 0);
+
+    matrix<double> product, transpose, inverse, work;
+    multiply_into(product, a, b);
+    CHECK(product == a * b);
+    const double *storage = product.data();
+    const matrix<double> twice = a * 2.0;
+    multiply_into(product, twice, b);
+    CHECK(product == twice * b && product.data() == storage);
+
+    transpose_into(transpose, a);
+    CHECK(transpose == a.transpose());
+
+    matrix<double> m = numbered<double>(4, 4);
+    for(size_t i = 0; i < 4; ++ i)
+        m(i,i) += 10;
+    inverse_into(inverse, m, work);
+    const matrix<double> identity = m * inverse;
+    for(size_t i = 0; i < 4; ++ i)
+        for(size_t j = 0; j < 4; ++ j)
+            CHECK(std::abs(identity(i,j) - (i == j ? 1 : 0)) < 1e-14);
+    storage = inverse.data();
+    const matrix<double> doubled = m * 2.0;
+    inverse_into(inverse, doubled, work);
+    CHECK(inverse.data() == storage);
+    const matrix<double> again = doubled * inverse;
+    for(size_t i = 0; i < 4; ++ i)
+        for(size_t j = 0; j < 4; ++ j)
+            CHECK(std::abs(again(i,j) - (i == j ? 1 : 0)) < 1e-14);
+}
+
+/**
+ *  Eliminates a matrix large enough for the row updates to spread over the pool. Each row
+ *  is updated by one thread in the same order either way, so the results match exactly.
+ */
+
+void test_parallel_elimination() {
+    const size_t n = 300;
+    matrix<double> a = numbered<double>(n, n) * 0.125;
+    for(size_t i = 0; i < n; ++ i)
+        a(i,i) += 1;
+
+    serial_executor serial;
+    set_executor(&serial);
+    const long double determinant = a.determinant();
+    const matrix<long double> inverse = a.inverse();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    CHECK(a.determinant() == determinant);
+    CHECK(a.inverse() == inverse);
+    set_executor(nullptr);
+
+    const matrix<long double> identity = matrix<long double>(a) * inverse;
+    long double error = 0;
+    for(size_t i = 0; i < n; ++ i)
+        for(size_t j = 0; j < n; ++ j)
+            error = std::max(error, std::abs(identity(i,j) - (i == j ? 1 : 0)));
+    CHECK(error < 1e-12);
+}
+
+/**
+ *  Pivoting: a matrix built as L * U with its rows exchanged, whose elimination without
+ *  partial pivoting loses every digit, and whose determinant is known up to sign.
+ */
+
+void test_determinant() {
+    const size_t n = 300;
+    matrix<double> l = matrix<double>::identity(n), u(n, n, 0.0);
+    long double product = 1;
+    for(size_t i = 0; i < n; ++ i) {
+        for(size_t j = 0; j < i; ++ j)
+            l(i,j) = double(int((i * 5 + j * 3) % 7) - 3) / 8;
+        for(size_t j = i; j < n; ++ j)
+            u(i,j) = double(int((i + j * 2) % 5) - 2) / 4;
+        u(i,i) = 1 + double(i % 3) / 8;
+        product *= u(i,i);
+    }
+    const matrix<double> a = l * u;
+
+    const long double determinant = a.determinant();
+    CHECK(std::abs(std::abs(determinant) - product) <= 1e-9 * product);
+    const log_det<long double> logarithm = a.log_determinant();
+    CHECK(logarithm.sign == (determinant < 0 ? -1 : 1));
+    CHECK(std::abs(logarithm.log_abs - std::log(product)) < 1e-9);
+
+    // 1000 diagonal entries of 10 overflow a double determinant, but not its logarithm.
+
+    matrix<double> large = matrix<double>::identity(1000) * 10.0;
+    std::swap(large(0,0), large(0,1));
+    std::swap(large(1,0), large(1,1));
+    CHECK(std::isinf(large.determinant<double>()));
+    const log_det<double> finite = large.log_determinant<double>();
+    CHECK(finite.sign == -1);
+    CHECK(std::abs(finite.log_abs - 1000 * std::log(10.0)) < 1e-9);
+}
+
+int main() {
+    test_layout();
+    test_arithmetic();
+    test_inverse();
+    test_in_place();
+    test_determinant();
+    test_parallel_elimination();
+    return algebra_test::failures() != 0;
+}
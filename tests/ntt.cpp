@@ -0,0 +1,155 @@
+/**
+ *  ntt.cpp
+ *  Purpose: tests of the NTT against the direct transform, and of convolve_mod and
+ *  multiply_integers against the quadratic sum and schoolbook multiplication
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "ntt.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+template <uint32_t Mod>
+static std::vector<uint32_t> random_residues(size_t n) {
+    std::uniform_int_distribution<uint32_t> digit(0, Mod - 1);
+    std::vector<uint32_t> ret(n);
+    for(uint32_t &v : ret)
+        v = digit(engine());
+    return ret;
+}
+
+/**
+ *  Residue k of the direct transform, the sum over j of a[j] w^(j k) for the root w of
+ *  order a.size() built from the smallest primitive root of Mod.
+ */
+
+template <uint32_t Mod>
+static uint32_t direct_ntt(const std::vector<uint32_t> &a, size_t k) {
+    typedef montgomery<Mod> arith;
+    const uint64_t w = arith::power(arith::power(arith::primitive_root(), (Mod - 1) / a.size()), k);
+    uint64_t s = 0, x = 1;
+    for(size_t j = 0; j < a.size(); ++ j) {
+        s = (s + a[j] * x) % Mod;
+        x = x * w % Mod;
+    }
+    return uint32_t(s);
+}
+
+template <uint32_t Mod>
+static void test_ntt() {
+    // An empty signal has an empty transform.
+
+    std::vector<uint32_t> empty;
+    NTT<Mod>(empty, 1);
+    NTT<Mod>(empty, -1);
+    CHECK(empty.empty());
+
+    for(size_t n : {size_t(1), size_t(2), size_t(4), size_t(8), size_t(64), size_t(1024)}) {
+        const std::vector<uint32_t> a = random_residues<Mod>(n);
+        std::vector<uint32_t> y = a;
+        NTT<Mod>(y, 1);
+        bool direct = true;
+        for(size_t k = 0; k < n; ++ k)
+            direct = direct && y[k] == direct_ntt<Mod>(a, k);
+        CHECK(direct);
+        NTT<Mod>(y, -1);
+        CHECK(y == a);
+    }
+
+    for(size_t n : {size_t(1) << 16, size_t(1) << 20}) {
+        const std::vector<uint32_t> a = random_residues<Mod>(n);
+        std::vector<uint32_t> y = a;
+        NTT<Mod>(y, 1);
+        NTT<Mod>(y, -1);
+        CHECK(y == a);
+    }
+
+    for(size_t n : {size_t(1), size_t(4), size_t(256)}) {
+        const size_t count = 17;
+        const std::vector<uint32_t> a = random_residues<Mod>(n * count);
+        std::vector<uint32_t> y = a;
+        batch_NTT<Mod>(y, n, 1);
+        bool same = true;
+        for(size_t b = 0; b < count; ++ b) {
+            std::vector<uint32_t> x(a.begin() + b * n, a.begin() + (b + 1) * n);
+            NTT<Mod>(x, 1);
+            same = same && std::equal(x.begin(), x.end(), y.begin() + b * n);
+        }
+        CHECK(same);
+        batch_NTT<Mod>(y, n, -1);
+        CHECK(y == a);
+    }
+}
+
+template <uint32_t Mod>
+static void test_convolve_mod() {
+    const size_t lengths[][2] = {{1, 1}, {5, 7}, {100, 300}, {1000, 1000}, {4097, 3}};
+
+    for(const auto &length : lengths) {
+        std::vector<uint32_t> a = random_residues<Mod>(length[0]), b = random_residues<Mod>(length[1]);
+        a.back() = b.back() = Mod - 1;
+
+        std::vector<uint64_t> expected(a.size() + b.size() - 1, 0);
+        for(size_t i = 0; i < a.size(); ++ i)
+            for(size_t j = 0; j < b.size(); ++ j)
+                expected[i + j] = (expected[i + j] + uint64_t(a[i]) * b[j]) % Mod;
+
+        const std::vector<uint32_t> c = convolve_mod<Mod>(a, b);
+        CHECK(c.size() == expected.size());
+        CHECK(std::equal(c.begin(), c.end(), expected.begin()));
+    }
+
+    CHECK(convolve_mod<Mod>({}, {1, 2}).empty());
+}
+
+static void test_multiply_integers() {
+    const size_t lengths[][2] = {{1, 1}, {3, 5}, {200, 300}, {2000, 1500}};
+
+    for(const auto &length : lengths) {
+        std::vector<uint32_t> a(length[0]), b(length[1]);
+        for(uint32_t &v : a) v = uint32_t(engine()());
+        for(uint32_t &v : b) v = uint32_t(engine()());
+        a.back() = b.back() = 0xffffffffu;
+
+        std::vector<uint32_t> expected(a.size() + b.size(), 0);
+        for(size_t i = 0; i < a.size(); ++ i) {
+            uint64_t carry = 0;
+            for(size_t j = 0; j < b.size(); ++ j) {
+                const uint64_t t = uint64_t(a[i]) * b[j] + expected[i + j] + carry;
+                expected[i + j] = uint32_t(t);
+                carry = t >> 32;
+            }
+            expected[i + b.size()] = uint32_t(carry);
+        }
+
+        CHECK(multiply_integers(a, b) == expected);
+    }
+
+    CHECK((multiply_integers({}, {7, 7}) == std::vector<uint32_t>(2, 0)));
+}
+
+int main() {
+    test_ntt<998244353>();
+    test_ntt<167772161>();
+    test_convolve_mod<998244353>();
+    test_convolve_mod<167772161>();
+    test_multiply_integers();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_ntt<998244353>();
+    test_multiply_integers();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
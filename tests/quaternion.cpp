@@ -0,0 +1,187 @@
+/**
+ *  quaternion.cpp
+ *  Purpose: tests of the quaternion rotations against euler_angle and rotation matrices,
+ *  and of the batched kernels against one quaternion at a time
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "batch.h"
+#include "quaternion.h"
+#include "rot.h"
+#include "thread_pool.h"
+#include "vector_batch.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static T random_angle() {
+    return T(std::uniform_real_distribution<double>(-3, 3)(engine()));
+}
+
+template <typename T>
+static vector<T> random_vector() {
+    return vector<T>(random_value<T>(), random_value<T>(), random_value<T>());
+}
+
+template <typename T>
+static long double distance(const vector<T> &u, const vector<T> &v) {
+    return std::max({std::fabs((long double) u.x - v.x), std::fabs((long double) u.y - v.y),
+                    std::fabs((long double) u.z - v.z)});
+}
+
+template <typename T>
+static long double distance(const quaternion<T> &p, const quaternion<T> &q) {
+    return std::max({std::fabs((long double) p.w - q.w), std::fabs((long double) p.x - q.x),
+                    std::fabs((long double) p.y - q.y), std::fabs((long double) p.z - q.z)});
+}
+
+/**
+ *  Whether two unit quaternions are the same rotation; q and -q are.
+ */
+
+template <typename T>
+static bool same_rotation(const quaternion<T> &p, const quaternion<T> &q, long double bound) {
+    return std::fabs(std::fabs((long double) p.dot(q)) - 1) <= bound;
+}
+
+template <typename T>
+static void test_quaternion() {
+    const long double bound = 8 * tolerance<T>(3);
+
+    long double euler_error = 0, compose_error = 0, rotate_error = 0;
+    bool interpolated = true;
+    for(size_t it = 0; it < 200; ++ it) {
+        const T ax = random_angle<T>(), ay = random_angle<T>(), az = random_angle<T>();
+        const quaternion<T> q = quaternion<T>::from_euler(ax, ay, az);
+        const quaternion<T> p = quaternion<T>::from_euler(random_angle<T>(), random_angle<T>(), random_angle<T>());
+        CHECK(std::fabs((long double) q.magnitude() - 1) <= bound);
+
+        const fixed_matrix<T, 3, 3> m = q.to_matrix(), pm = p.to_matrix(), pq = (p * q).to_matrix();
+        const fixed_matrix<long double, 3, 3> e = euler_angle(ax, ay, az).to_matrix();
+        for(size_t i = 0; i < 3; ++ i)
+            for(size_t j = 0; j < 3; ++ j) {
+                euler_error = std::max(euler_error, std::fabs(m(i,j) - e(i,j)));
+                long double s = 0;
+                for(size_t k = 0; k < 3; ++ k)
+                    s += (long double) pm(i,k) * m(k,j);
+                compose_error = std::max(compose_error, std::fabs(s - pq(i,j)));
+            }
+
+        const vector<T> v = random_vector<T>(), r = q.rotate(v);
+        const vector<T> expected(m(0,0) * v.x + m(0,1) * v.y + m(0,2) * v.z,
+                                 m(1,0) * v.x + m(1,1) * v.y + m(1,2) * v.z,
+                                 m(2,0) * v.x + m(2,1) * v.y + m(2,2) * v.z);
+        rotate_error = std::max(rotate_error, distance(r, expected));
+        rotate_error = std::max(rotate_error, distance(q.conjugate().rotate(r), v));
+
+        interpolated = interpolated && same_rotation(slerp(q, p, T(0)), q, bound) &&
+                       same_rotation(slerp(q, p, T(1)), p, bound) && same_rotation(nlerp(q, p, T(0)), q, bound) &&
+                       same_rotation(nlerp(q, p, T(1)), p, bound) && same_rotation(slerp(q, q, T(0.3)), q, bound);
+
+        // Halfway along the shorter arc is equally far from both ends.
+
+        const quaternion<T> h = slerp(q, p, T(0.5));
+        interpolated = interpolated && std::fabs((long double) h.magnitude() - 1) <= bound &&
+                       std::fabs(std::fabs((long double) h.dot(q)) - std::fabs((long double) h.dot(p))) <= bound;
+    }
+    CHECK(euler_error <= bound);
+    CHECK(compose_error <= bound);
+    CHECK(rotate_error <= bound);
+    CHECK(interpolated);
+
+    // An axis need not be of unit length.
+
+    CHECK(same_rotation(quaternion<T>::from_axis_angle(vector<T>(0, 0, 2), T(0.7)),
+                        quaternion<T>::from_euler(0, 0, T(0.7)), bound));
+    CHECK(same_rotation(quaternion<T>::from_axis_angle(vector<T>(-3, 0, 0), T(0.4)),
+                        quaternion<T>::from_euler(T(-0.4), 0, 0), bound));
+}
+
+/**
+ *  Counts on both sides of every vector width, and past vector_batch_grain.
+ */
+
+template <typename T>
+static void test_quaternion_batch() {
+    const long double bound = 8 * tolerance<T>(3);
+
+    for(size_t count : {0, 1, 7, 17, 100, 40000}) {
+        std::vector<T> x(count), y(count), z(count);
+        std::vector<vector<T>> list;
+        for(size_t k = 0; k < count; ++ k) {
+            x[k] = random_angle<T>();
+            y[k] = random_angle<T>();
+            z[k] = random_angle<T>();
+            list.push_back(random_vector<T>());
+        }
+
+        quaternion_batch<T> a, b, c;
+        batch_euler_quaternion(count, x.data(), y.data(), z.data(), a);
+        batch_euler_quaternion(count, z.data(), x.data(), y.data(), b);
+        CHECK(a.size() == count && b.size() == count);
+        batch_compose(a, b, c);
+
+        const quaternion<T> one = count ? a.get(0) : quaternion<T>();
+        const vector_batch<T> v(list);
+        vector_batch<T> rotated, rotated_by_one;
+        batch_rotate(a, v, rotated);
+        batch_rotate(one, v, rotated_by_one);
+
+        matrix_batch<3, T> m;
+        batch_to_matrix(a, m);
+        CHECK(m.size() == count);
+
+        long double euler_error = 0, compose_error = 0, rotate_error = 0, matrix_error = 0;
+        for(size_t k = 0; k < count; ++ k) {
+            const quaternion<T> q = a.get(k);
+            euler_error = std::max(euler_error, distance(q, quaternion<T>::from_euler(x[k], y[k], z[k])));
+            compose_error = std::max(compose_error, distance(c.get(k), q * b.get(k)));
+            rotate_error = std::max(rotate_error, distance(rotated.get(k), q.rotate(list[k])));
+            rotate_error = std::max(rotate_error, distance(rotated_by_one.get(k), one.rotate(list[k])));
+            const fixed_matrix<T, 3, 3> expected = q.to_matrix();
+            for(size_t i = 0; i < 3; ++ i)
+                for(size_t j = 0; j < 3; ++ j)
+                    matrix_error = std::max(matrix_error, std::fabs((long double) m(k, i, j) - expected(i,j)));
+        }
+        CHECK(euler_error <= bound);
+        CHECK(compose_error <= bound);
+        CHECK(rotate_error <= bound);
+        CHECK(matrix_error <= bound);
+
+        // The results may be operands.
+
+        batch_compose(a, b, a);
+        vector_batch<T> in_place = v;
+        batch_rotate(b, in_place, in_place);
+        bool same = true;
+        for(size_t k = 0; k < count; ++ k)
+            same = same && distance(a.get(k), c.get(k)) == 0 && distance(in_place.get(k), b.get(k).rotate(list[k])) <= bound;
+        CHECK(same);
+    }
+}
+
+int main() {
+    test_quaternion<float>();
+    test_quaternion<double>();
+    test_quaternion<long double>();
+    test_quaternion_batch<float>();
+    test_quaternion_batch<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_quaternion_batch<float>();
+    test_quaternion_batch<double>();
+    set_executor(nullptr);
+
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,70 @@
+/**
+ *  random.h
+ *  Purpose: reproducible random operands for the tests, and the rounding error to allow
+ *  when comparing results computed from them
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef RANDOM_H
+
+#define RANDOM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+#include "matrix.h"
+
+namespace algebra_test {
+
+/**
+ *  The generator every test draws from, seeded once so failures reproduce.
+ */
+
+inline std::mt19937_64 &engine() {
+    static std::mt19937_64 e(20240917);
+    return e;
+}
+
+/**
+ *  Draws an integer in [-9, 9], or a real number in [-1, 1].
+ */
+
+template <typename T>
+inline T random_value() {
+    if constexpr (std::is_integral<T>::value) {
+        return T(std::uniform_int_distribution<int>(-9, 9)(engine()));
+    } else {
+        return T(std::uniform_real_distribution<double>(-1, 1)(engine()));
+    }
+}
+
+template <typename T>
+inline matrix<T> random_matrix(size_t rows, size_t columns) {
+    matrix<T> ret(rows, columns);
+    for(size_t i = 0; i < rows; ++ i)
+        for(size_t j = 0; j < columns; ++ j)
+            ret(i,j) = random_value<T>();
+    return ret;
+}
+
+/**
+ *  The tolerance of a sum of n products of values of magnitude up to 1, computed in T.
+ */
+
+template <typename T>
+inline long double tolerance(size_t n) {
+    if constexpr (std::is_integral<T>::value) {
+        return 0;
+    } else {
+        return 4 * static_cast<long double>(std::max<size_t>(n, 1)) * std::numeric_limits<T>::epsilon();
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ *  rot.cpp
+ *  Purpose: tests of the Euler angle rotations and the vector class
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+
+#include "batch.h"
+#include "matrix.h"
+#include "rot.h"
+#include "vector.h"
+
+/**
+ *  The rotation about one axis by theta, as a general matrix.
+ */
+
+static matrix<long double> axis_rotation(size_t axis, long double theta) {
+    matrix<long double> ret = matrix<long double>::identity(3);
+    const size_t a = (axis + 1) % 3, b = (axis + 2) % 3;
+    ret(a,a) = std::cos(theta);
+    ret(a,b) = -std::sin(theta);
+    ret(b,a) = std::sin(theta);
+    ret(b,b) = std::cos(theta);
+    return ret;
+}
+
+static void test_euler_angle() {
+    const long double angles[][3] = {{0, 0, 0}, {0.3L, -1.2L, 2.5L}, {3.1L, 0.7L, -0.4L}, {-2, 1.5L, 0.1L}};
+
+    std::vector<double> x, y, z;
+    for(const auto &angle : angles) {
+        x.push_back(double(angle[0]));
+        y.push_back(double(angle[1]));
+        z.push_back(double(angle[2]));
+    }
+    matrix_batch<3, double> batch;
+    batch_euler_angle(x.size(), x.data(), y.data(), z.data(), batch);
+    CHECK(batch.size() == x.size());
+
+    for(size_t k = 0; k < x.size(); ++ k) {
+        const long double *angle = angles[k];
+        const matrix<long double> expected = axis_rotation(2, angle[2]) * axis_rotation(1, angle[1]) *
+                                             axis_rotation(0, angle[0]);
+        const matrix<long double> actual = euler_angle(angle[0], angle[1], angle[2]).to_matrix();
+        for(size_t i = 0; i < 3; ++ i)
+            for(size_t j = 0; j < 3; ++ j) {
+                CHECK(std::fabs(actual(i,j) - expected(i,j)) < 1e-15L);
+                CHECK(std::fabs(batch(k, i, j) - expected(i,j)) < 1e-15L);
+            }
+    }
+}
+
+static void test_vector() {
+    const vector<double> a(1, 2, 3), b(-2, 0.5, 4);
+    const matrix<double> column = a.to_matrix();
+    CHECK(column.rows() == 3 && column.columns() == 1);
+    CHECK(column(0,0) == 1 && column(1,0) == 2 && column(2,0) == 3);
+
+    const vector<double> cross = a ^ b;
+    CHECK(cross * a == 0 && cross * b == 0);
+    CHECK(a * b == 11);
+    CHECK(std::fabs(a.normalize().magnitude() - 1) < 1e-15);
+}
+
+int main() {
+    test_euler_angle();
+    test_vector();
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,105 @@
+/**
+ *  simd.cpp
+ *  Purpose: tests of the vectorised elementwise and reduction kernels at every instruction
+ *  set the running CPU supports
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "check.h"
+
+#include "simd.h"
+
+template <typename T>
+static std::vector<T> random_vector(size_t n) {
+    static std::mt19937_64 engine(20240917);
+    std::uniform_real_distribution<double> value(-1, 1);
+    std::vector<T> ret(n);
+    for(T &x : ret)
+        x = T(value(engine));
+    return ret;
+}
+
+/**
+ *  Checks every kernel on n elements starting offset elements into the buffers, so the
+ *  vector loops meet both unaligned starts and every length of tail.
+ */
+
+template <typename T>
+static void check_kernels(size_t n, size_t offset) {
+    const std::vector<T> a = random_vector<T>(n + offset), b = random_vector<T>(n + offset);
+    const T *x = a.data() + offset, *y = b.data() + offset;
+    std::vector<T> out(n + offset), expected(n);
+    T *o = out.data() + offset;
+
+    simd_add(n, x, y, o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(o[i] == x[i] + y[i]);
+
+    simd_subtract(n, x, y, o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(o[i] == x[i] - y[i]);
+
+    simd_negate(n, x, o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(o[i] == -x[i]);
+
+    simd_scale(n, x, T(3), o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(o[i] == x[i] * T(3));
+
+    std::copy(y, y + n, o);
+    simd_axpy(n, T(-2), x, o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(std::fabs(o[i] - (y[i] + T(-2) * x[i])) <= 2 * std::numeric_limits<T>::epsilon() * 4);
+
+    // The reductions reorder the sum, so they agree with the sequential one to rounding.
+
+    long double sum = 0, dot = 0;
+    for(size_t i = 0; i < n; ++ i) {
+        sum += x[i];
+        dot += (long double) x[i] * y[i];
+    }
+    const long double bound = 2 * (n + 1) * std::numeric_limits<T>::epsilon();
+    CHECK(std::fabs(simd_sum(n, x) - sum) <= bound);
+    CHECK(std::fabs(simd_dot(n, x, y) - dot) <= bound);
+
+    // out may alias an input.
+
+    std::copy(x, x + n, o);
+    simd_add(n, o, y, o);
+    for(size_t i = 0; i < n; ++ i)
+        CHECK(o[i] == x[i] + y[i]);
+}
+
+template <typename T>
+static void test_kernels() {
+    for(size_t n = 0; n < 70; ++ n)
+        for(size_t offset = 0; offset < 3; ++ offset)
+            check_kernels<T>(n, offset);
+    check_kernels<T>(1000, 1);
+    check_kernels<T>(4099, 0);
+}
+
+int main() {
+    const simd_isa detected = simd_detect();
+    const simd_isa levels[] = {simd_isa::avx512, simd_isa::avx2, simd_isa::neon, simd_isa::scalar};
+
+    for(simd_isa level : levels) {
+        if(level > detected)
+            continue;
+        simd_level() = level;
+        test_kernels<float>();
+        test_kernels<double>();
+        test_kernels<long double>();
+    }
+    simd_level() = detected;
+
+    return algebra_test::failures() != 0;
+}
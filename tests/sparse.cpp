@@ -0,0 +1,123 @@
+/**
+ *  sparse.cpp
+ *  Purpose: tests of the CSR sparse matrix and its products against dense arithmetic
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "matrix.h"
+#include "sparse.h"
+#include "thread_pool.h"
+
+using namespace algebra_test;
+
+/**
+ *  A dense matrix with each entry nonzero with probability density, and some rows empty.
+ */
+
+template <typename T>
+static matrix<T> random_sparse(size_t rows, size_t columns, double density) {
+    std::bernoulli_distribution keep(density);
+    matrix<T> ret(rows, columns);
+    for(size_t i = 0; i < rows; ++ i)
+        for(size_t j = 0; j < columns; ++ j)
+            if(i % 7 != 3 && keep(engine()))
+                while(ret(i,j) == T(0))
+                    ret(i,j) = random_value<T>();
+    return ret;
+}
+
+template <typename T>
+static long double max_error(const matrix<T> &a, const matrix<T> &b) {
+    long double error = 0;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            error = std::max(error, (long double) std::fabs((long double) a(i,j) - (long double) b(i,j)));
+    return error;
+}
+
+template <typename T>
+static void test_layout() {
+    const std::vector<sparse_entry<T>> triplets = {{2, 1, T(4)}, {0, 3, T(1)}, {0, 0, T(2)}, {2, 1, T(-1)},
+                                                   {0, 3, T(5)}, {1, 2, T(0)}};
+    const sparse_matrix<T> s(3, 4, triplets);
+    CHECK(s.rows() == 3 && s.columns() == 4);
+    CHECK(s.nonzeros() == 4);
+    CHECK(s(0,0) == T(2) && s(0,3) == T(6) && s(2,1) == T(3) && s(1,2) == T(0) && s(1,1) == T(0));
+    CHECK(s.row_offsets()[0] == 0 && s.row_offsets()[1] == 2 && s.row_offsets()[3] == 4);
+    CHECK(s.column_indices()[0] == 0 && s.column_indices()[1] == 3);
+
+    const matrix<T> d = s.to_dense();
+    CHECK(sparse_matrix<T>(d).nonzeros() == 3);
+    CHECK(sparse_matrix<T>(d).to_dense() == d);
+
+    const sparse_matrix<T> t = s.transpose();
+    CHECK(t.rows() == 4 && t.columns() == 3);
+    CHECK(t.to_dense() == d.transpose());
+
+    // The CSR arrays of the transpose are the CSC arrays of the original.
+
+    const sparse_matrix<T> c = sparse_matrix<T>::from_csc(3, 4,
+        std::vector<size_t>(t.row_offsets(), t.row_offsets() + t.rows() + 1),
+        std::vector<size_t>(t.column_indices(), t.column_indices() + t.nonzeros()),
+        std::vector<T>(t.values(), t.values() + t.nonzeros()));
+    CHECK(c.to_dense() == d);
+
+    CHECK(sparse_matrix<T>().nonzeros() == 0);
+    CHECK(sparse_matrix<T>(5, 2).to_dense() == matrix<T>(5, 2));
+}
+
+template <typename T>
+static void test_products() {
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 5, 3}, {64, 64, 17}, {300, 500, 40}, {2000, 1500, 1}};
+
+    for(const auto &shape : shapes) {
+        const size_t m = shape[0], k = shape[1], n = shape[2];
+        const matrix<T> a = random_sparse<T>(m, k, 0.05), b = random_matrix<T>(k, n), c = random_matrix<T>(n, m);
+        const sparse_matrix<T> s(a);
+        CHECK(s.to_dense() == a);
+
+        std::vector<T> x(k);
+        for(T &v : x) v = random_value<T>();
+        const std::vector<T> y = s * x;
+        long double error = 0;
+        for(size_t i = 0; i < m; ++ i) {
+            long double e = 0;
+            for(size_t j = 0; j < k; ++ j)
+                e += (long double) a(i,j) * x[j];
+            error = std::max(error, std::fabs(e - y[i]));
+        }
+        CHECK(y.size() == m && error <= tolerance<T>(k));
+
+        CHECK(max_error(s * b, a * b) <= tolerance<T>(k));
+        CHECK(max_error(c * s, c * a) <= tolerance<T>(m));
+
+        matrix<T> out(2, 2);
+        multiply_into(out, s, b);
+        CHECK(max_error(out, a * b) <= tolerance<T>(k));
+        multiply_into(out, c, s);
+        CHECK(max_error(out, c * a) <= tolerance<T>(m));
+    }
+}
+
+int main() {
+    test_layout<int>();
+    test_layout<double>();
+    test_products<int>();
+    test_products<float>();
+    test_products<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_products<double>();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
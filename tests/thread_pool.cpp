@@ -0,0 +1,88 @@
+/**
+ *  thread_pool.cpp
+ *  Purpose: tests of parallel_for on the work-stealing pool and the serial executor
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "check.h"
+
+#include "thread_pool.h"
+
+/**
+ *  Runs a parallel_for over [0, n) on the current executor and checks every index ran
+ *  exactly once, in chunks no smaller than the grain (but for the last).
+ */
+
+static void check_cover(size_t n, size_t grain) {
+    std::vector<std::atomic<int>> hits(n);
+    std::atomic<bool> small_chunk{false};
+    parallel_for(0, n, grain, [&](size_t first, size_t last) {
+        if(last - first < grain && last != n)
+            small_chunk = true;
+        for(size_t i = first; i < last; ++ i)
+            ++ hits[i];
+    });
+    bool once = true;
+    for(size_t i = 0; i < n; ++ i)
+        once = once && hits[i] == 1;
+    CHECK(once);
+    CHECK(!small_chunk);
+}
+
+static void test_executor() {
+    for(size_t n : {0, 1, 7, 100, 10000})
+        for(size_t grain : {1, 3, 64})
+            check_cover(n, grain);
+
+    // Nested loops run on the same pool without deadlocking.
+
+    std::atomic<size_t> total{0};
+    parallel_for(0, 64, 1, [&](size_t first, size_t last) {
+        for(size_t i = first; i < last; ++ i)
+            parallel_for(0, 1000, 10, [&](size_t a, size_t b) {
+                total += b - a;
+            });
+    });
+    CHECK(total == 64 * 1000);
+
+    // An exception thrown by a chunk reaches the caller once every chunk has finished.
+
+    std::atomic<size_t> finished{0};
+    bool thrown = false;
+    try {
+        parallel_for(0, 100, 1, [&](size_t first, size_t last) {
+            finished += last - first;
+            if(first <= 50 && 50 < last)
+                throw std::runtime_error("chunk");
+        });
+    } catch(const std::runtime_error &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(finished == 100);
+}
+
+int main() {
+    test_executor();
+
+    thread_pool pool(4);
+    CHECK(pool.concurrency() == 4);
+    set_executor(&pool);
+    CHECK(&current_executor() == &pool);
+    test_executor();
+
+    serial_executor serial;
+    set_executor(&serial);
+    test_executor();
+
+    set_executor(nullptr);
+    CHECK(&current_executor() == &default_thread_pool());
+
+    return algebra_test::failures() != 0;
+}
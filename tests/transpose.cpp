@@ -0,0 +1,185 @@
+/**
+ *  transpose.cpp
+ *  Purpose: tests of the tiled transposes and of transposed matrix views
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <complex>
+#include <cstdint>
+#include <sstream>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "expression.h"
+#include "matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+using namespace algebra_test;
+
+/**
+ *  Transposes shapes on both sides of the tile and register block edges, between buffers
+ *  with padded strides, and checks every entry and that the padding is untouched.
+ */
+
+template <typename T>
+static void test_copy() {
+    const size_t shapes[][2] = {{1, 1}, {1, 9}, {9, 1}, {3, 5}, {8, 8}, {17, 31}, {64, 64}, {65, 130}, {300, 257}};
+
+    for(const auto &shape : shapes) {
+        const size_t rows = shape[0], cols = shape[1], lda = cols + 3, ldb = rows + 5;
+        std::vector<T> a(rows * lda), b(cols * ldb, T(-7));
+        for(size_t i = 0; i < a.size(); ++ i)
+            a[i] = T(i % 1009);
+
+        transpose_copy(rows, cols, a.data(), lda, b.data(), ldb);
+        bool same = true;
+        for(size_t j = 0; j < cols; ++ j)
+            for(size_t i = 0; i < ldb; ++ i)
+                same = same && b[j * ldb + i] == (i < rows ? a[i * lda + j] : T(-7));
+        CHECK(same);
+    }
+
+    for(size_t n : {size_t(1), size_t(2), size_t(7), size_t(64), size_t(65), size_t(200)}) {
+        const size_t lda = n + 3;
+        std::vector<T> a(n * lda);
+        for(size_t i = 0; i < a.size(); ++ i)
+            a[i] = T(i % 1009);
+        std::vector<T> t = a;
+
+        transpose_square(n, t.data(), lda);
+        bool same = true;
+        for(size_t i = 0; i < n; ++ i)
+            for(size_t j = 0; j < lda; ++ j)
+                same = same && t[i * lda + j] == (j < n ? a[j * lda + i] : a[i * lda + j]);
+        CHECK(same);
+    }
+}
+
+template <typename T>
+static void test_views() {
+    const matrix<T> a = random_matrix<T>(70, 45);
+    const matrix_transposed<T> v = transposed(a);
+    CHECK(v.rows() == 45 && v.columns() == 70);
+    CHECK(v(3, 60) == a(60,3));
+    CHECK(matrix<T>(v) == a.transpose());
+    CHECK(v == a.transpose());
+    CHECK((transposed(a) * T(2) + a.transpose() == a.transpose() * T(3)));
+
+    std::ostringstream viewed, materialized;
+    viewed << transposed(a);
+    materialized << a.transpose();
+    CHECK(viewed.str() == materialized.str());
+
+    matrix<T> out;
+    transpose_into(out, a);
+    CHECK(out == a.transpose());
+
+    // Assigning a view of a matrix to itself transposes it in place, whatever its shape.
+
+    matrix<T> b = a;
+    b = transposed(b);
+    CHECK(b == a.transpose());
+    b = transposed(b);
+    CHECK(b == a);
+
+    matrix<T> s = random_matrix<T>(130, 130);
+    const matrix<T> s0 = s;
+    s = transposed(s);
+    CHECK(s == s0.transpose());
+    s.transpose_in_place();
+    CHECK(s == s0);
+    b.transpose_in_place();
+    CHECK(b == a.transpose());
+}
+
+/**
+ *  Expressions reading the destination through a transposed view, at the root and deeper in
+ *  the tree, for a = [1..9] in row-major order.
+ */
+
+template <typename T>
+static void test_aliasing() {
+    const T sums[3][3] = {{2, 6, 10}, {6, 10, 14}, {10, 14, 18}};
+    matrix<T> a(3, 3), expected(3, 3), twice(3, 3);
+    for(size_t i = 0; i < 3; ++ i)
+        for(size_t j = 0; j < 3; ++ j) {
+            a(i,j) = T(3 * i + j + 1);
+            expected(i,j) = sums[i][j];
+            twice(i,j) = T(2 * (3 * j + i + 1));
+        }
+    const matrix<T> a0 = a;
+
+    matrix<T> b = a0;
+    b = b + transposed(b);
+    CHECK(b == expected);
+
+    b = a0;
+    b += transposed(b);
+    CHECK(b == expected);
+
+    b = a0;
+    b -= transposed(b);
+    CHECK(b == a0 - transposed(a0));
+
+    b = a0;
+    b = transposed(b) * T(2);
+    CHECK(b == twice);
+
+    b = a0;
+    b = -(transposed(b) - b);
+    CHECK(b == a0 - transposed(a0));
+
+    b = a0;
+    b = transposed(b);
+    CHECK(b == a0.transpose());
+
+    // A reference into a matrix aliases it as well.
+
+    b = a0;
+    b.block(0, 0, 3, 3) = a0 + transposed(b);
+    CHECK(b == expected);
+
+    b = a0;
+    b.block(0, 0, 3, 3) += transposed(b);
+    CHECK(b == expected);
+
+    b = a0;
+    b.block(0, 0, 3, 3) -= transposed(b);
+    CHECK(b == a0 - transposed(a0));
+}
+
+int main() {
+    test_copy<int32_t>();
+    test_copy<float>();
+    test_copy<double>();
+    test_copy<long double>();
+    test_copy<std::complex<double>>();
+    test_views<float>();
+    test_views<double>();
+    test_views<int>();
+    test_aliasing<int>();
+    test_aliasing<double>();
+
+    const simd_isa detected = simd_detect();
+    for(simd_isa level : {simd_isa::scalar, simd_isa::neon, simd_isa::avx2, simd_isa::avx512}) {
+        if(level <= detected) {
+            simd_level() = level;
+            test_copy<float>();
+            test_copy<double>();
+        }
+    }
+    simd_level() = detected;
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_copy<double>();
+    test_views<double>();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
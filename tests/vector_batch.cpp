@@ -0,0 +1,136 @@
+/**
+ *  vector_batch.cpp
+ *  Purpose: tests of the batched 3D vector kernels against the vector class, one vector at
+ *  a time
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "batch.h"
+#include "thread_pool.h"
+#include "vector_batch.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static vector_batch<T> random_vectors(size_t count) {
+    vector_batch<T> ret(count);
+    for(size_t k = 0; k < count; ++ k)
+        ret.set(k, vector<T>(random_value<T>(), random_value<T>(), random_value<T>()));
+    return ret;
+}
+
+template <typename T>
+static long double distance(const vector<T> &u, const vector<T> &v) {
+    return std::max({std::fabs((long double) u.x - v.x), std::fabs((long double) u.y - v.y),
+                    std::fabs((long double) u.z - v.z)});
+}
+
+/**
+ *  Counts on both sides of every vector width, and past vector_batch_grain so the work is
+ *  split over the pool when one is set.
+ */
+
+template <typename T>
+static void test_vector_batch() {
+    const long double bound = tolerance<T>(3);
+
+    for(size_t count : {0, 1, 3, 17, 1000, 40000}) {
+        const vector_batch<T> a = random_vectors<T>(count), b = random_vectors<T>(count);
+        CHECK(a.size() == count);
+
+        std::vector<T> dots(count), magnitudes(count);
+        batch_dot(a, b, dots.data());
+        batch_magnitude(a, magnitudes.data());
+
+        vector_batch<T> cross, exact, fast;
+        batch_cross(a, b, cross);
+        batch_normalize(a, exact);
+        batch_normalize(a, fast, normalize_mode::fast);
+        CHECK(cross.size() == count && exact.size() == count && fast.size() == count);
+
+        vector_batch<T> y = b;
+        batch_axpy(T(0.5), a, y);
+
+        long double dot_error = 0, cross_error = 0, exact_error = 0, fast_error = 0, axpy_error = 0;
+        for(size_t k = 0; k < count; ++ k) {
+            const vector<T> u = a.get(k), v = b.get(k);
+            dot_error = std::max(dot_error, std::fabs((long double) dots[k] - u * v));
+            dot_error = std::max(dot_error, std::fabs((long double) magnitudes[k] - u.magnitude()));
+            cross_error = std::max(cross_error, distance(cross.get(k), u ^ v));
+            exact_error = std::max(exact_error, distance(exact.get(k), u.normalize()));
+            fast_error = std::max(fast_error, distance(fast.get(k), u.normalize()));
+            axpy_error = std::max(axpy_error, distance(y.get(k), v + u * T(0.5)));
+        }
+        CHECK(dot_error <= bound);
+        CHECK(cross_error <= bound);
+        CHECK(exact_error <= bound);
+        CHECK(fast_error <= 1e-5);
+        CHECK(axpy_error <= bound);
+
+        // The results may be operands.
+
+        vector_batch<T> in_place = a;
+        batch_cross(in_place, b, in_place);
+        bool same = true;
+        for(size_t k = 0; k < count; ++ k)
+            same = same && distance(in_place.get(k), cross.get(k)) == 0;
+        CHECK(same);
+
+        in_place = a;
+        batch_normalize(in_place, in_place);
+        same = true;
+        for(size_t k = 0; k < count; ++ k)
+            same = same && distance(in_place.get(k), exact.get(k)) == 0;
+        CHECK(same);
+    }
+
+    // The fast path keeps the zero vector; the exact one divides by zero.
+
+    vector_batch<T> zero(1), unit;
+    batch_normalize(zero, unit, normalize_mode::fast);
+    CHECK(unit.get(0).x == 0 && unit.get(0).y == 0 && unit.get(0).z == 0);
+
+    // A batch converts from and to vectors, and its pointers feed batch_apply directly.
+
+    const std::vector<vector<T>> list = {vector<T>(1, 2, 3), vector<T>(-4, 5, -6)};
+    vector_batch<T> from_list(list);
+    CHECK(from_list.size() == 2 && distance(from_list.get(1), list[1]) == 0);
+    CHECK(from_list.component(2)[0] == 3 && from_list.component(0)[1] == -4);
+
+    matrix_batch<3, T> rotate(2);
+    for(size_t k = 0; k < 2; ++ k) {
+        rotate(k, 0, 1) = -1;
+        rotate(k, 1, 0) = 1;
+        rotate(k, 2, 2) = 1;
+    }
+    vector_batch<T> rotated(2);
+    const T *x[3];
+    T *r[3];
+    from_list.pointers(x);
+    rotated.pointers(r);
+    batch_apply(rotate, x, r);
+    CHECK(distance(rotated.get(0), vector<T>(-2, 1, 3)) == 0);
+    CHECK(distance(rotated.get(1), vector<T>(-5, -4, -6)) == 0);
+}
+
+int main() {
+    test_vector_batch<float>();
+    test_vector_batch<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_vector_batch<float>();
+    test_vector_batch<double>();
+    set_executor(nullptr);
+
+    return algebra_test::failures() != 0;
+}
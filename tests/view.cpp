@@ -0,0 +1,167 @@
+/**
+ *  view.cpp
+ *  Purpose: tests of matrix_view and matrix_ref over blocks of matrices and external buffers
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "check.h"
+#include "random.h"
+
+#include "cholesky.h"
+#include "expression.h"
+#include "lu.h"
+#include "matrix.h"
+#include "thread_pool.h"
+#include "view.h"
+
+using namespace algebra_test;
+
+template <typename T>
+static long double max_error(const matrix<T> &a, const matrix<T> &b) {
+    long double error = 0;
+    for(size_t i = 0; i < a.rows(); ++ i)
+        for(size_t j = 0; j < a.columns(); ++ j)
+            error = std::max(error, (long double) std::fabs((long double) a(i,j) - (long double) b(i,j)));
+    return error;
+}
+
+/**
+ *  The block of a starting at (row, column), copied entry by entry.
+ */
+
+template <typename T>
+static matrix<T> copy_block(const matrix<T> &a, size_t row, size_t column, size_t rows, size_t columns) {
+    matrix<T> ret(rows, columns);
+    for(size_t i = 0; i < rows; ++ i)
+        for(size_t j = 0; j < columns; ++ j)
+            ret(i,j) = a(row + i, column + j);
+    return ret;
+}
+
+template <typename T>
+static void test_windows() {
+    const matrix<T> a = random_matrix<T>(9, 13);
+
+    const matrix_view<T> v = a.block(2, 3, 4, 5);
+    CHECK(v.rows() == 4 && v.columns() == 5 && v.stride() == a.stride());
+    CHECK(v.data() == &a(2,3) && v(1,2) == a(3,5));
+    CHECK(matrix<T>(v) == copy_block(a, 2, 3, 4, 5));
+    CHECK(matrix<T>(v.block(1, 1, 2, 2)) == copy_block(a, 3, 4, 2, 2));
+    CHECK(matrix<T>(a.row(4)) == copy_block(a, 4, 0, 1, 13));
+    CHECK(matrix<T>(a.column(7)) == copy_block(a, 0, 7, 9, 1));
+    CHECK(matrix<T>(a.view()) == a);
+
+    // A ref writes through to its parent and leaves every other entry alone.
+
+    matrix<T> b = a;
+    b.block(1, 2, 3, 4) = a.block(5, 6, 3, 4) * T(2) + a.block(0, 0, 3, 4);
+    b.row(8).fill(T(7));
+    b.column(0) *= T(3);
+    bool same = true;
+    for(size_t i = 0; i < 9; ++ i) {
+        for(size_t j = 0; j < 13; ++ j) {
+            T expected = a(i,j);
+            if(i >= 1 && i < 4 && j >= 2 && j < 6)
+                expected = a(i + 4, j + 4) * T(2) + a(i - 1, j - 2);
+            if(i == 8)
+                expected = T(7);
+            if(j == 0)
+                expected = expected * T(3);
+            same = same && b(i,j) == expected;
+        }
+    }
+    CHECK(same);
+
+    b = a;
+    b.block(0, 0, 2, 2) += a.block(3, 3, 2, 2);
+    b.block(4, 4, 2, 2) -= a.block(0, 0, 2, 2);
+    CHECK(b(1,1) == a(1,1) + a(4,4) && b(5,4) == a(5,4) - a(1,0) && b(2,2) == a(2,2));
+
+    matrix<T> c = a;
+    c.block(0, 0, 9, 6) = a.block(0, 7, 9, 6);
+    CHECK(matrix<T>(c.block(0, 0, 9, 6)) == copy_block(a, 0, 7, 9, 6));
+
+    // Views and refs over buffers owned elsewhere.
+
+    std::vector<T> buffer(6 * 10, T(0));
+    const matrix_ref<T> r(buffer.data(), 4, 5, 10);
+    r = a.block(0, 0, 4, 5);
+    CHECK(buffer[10 + 2] == a(1,2) && buffer[5] == T(0));
+    CHECK(matrix<T>(matrix_view<T>(buffer.data(), 4, 5, 10)) == copy_block(a, 0, 0, 4, 5));
+    CHECK(matrix<T>(matrix_view<T>(buffer.data(), 6, 10)).rows() == 6);
+
+    matrix<T> t(5, 4);
+    transpose_into(t.ref(), a.block(0, 0, 4, 5));
+    CHECK(t == copy_block(a, 0, 0, 4, 5).transpose());
+}
+
+/**
+ *  Products of blocks reach gemm with the parent's stride, on both sides of the dispatch
+ *  threshold.
+ */
+
+template <typename T>
+static void test_products() {
+    const size_t shapes[][3] = {{1, 1, 1}, {7, 13, 5}, {65, 63, 66}, {129, 70, 201}};
+
+    for(const auto &shape : shapes) {
+        const size_t M = shape[0], K = shape[1], N = shape[2];
+        const matrix<T> a = random_matrix<T>(M + 3, K + 5), b = random_matrix<T>(K + 2, N + 1);
+        const matrix<T> x = copy_block(a, 1, 2, M, K), y = copy_block(b, 2, 1, K, N);
+        const matrix<T> expected = x * y, yt = y.transpose();
+
+        CHECK(max_error(a.block(1, 2, M, K) * b.block(2, 1, K, N), expected) <= tolerance<T>(K));
+        CHECK(max_error(x * b.block(2, 1, K, N), expected) <= tolerance<T>(K));
+        CHECK(max_error(a.block(1, 2, M, K) * transposed(yt), expected) <= tolerance<T>(K));
+
+        matrix<T> c = random_matrix<T>(M + 4, N + 4);
+        const matrix<T> c0 = c;
+        multiply_accumulate(c.block(2, 3, M, N), a.block(1, 2, M, K), b.block(2, 1, K, N), T(2), T(-1));
+        CHECK(max_error(copy_block(c, 2, 3, M, N), matrix<T>(expected * T(2) - copy_block(c0, 2, 3, M, N))) <=
+              3 * tolerance<T>(K));
+        CHECK(c(0,0) == c0(0,0) && c(M + 3, N + 3) == c0(M + 3, N + 3));
+
+        multiply_into(c.block(0, 0, M, N), x.view(), y);
+        CHECK(max_error(copy_block(c, 0, 0, M, N), expected) <= tolerance<T>(K));
+
+        matrix<T> out;
+        multiply_into(out, a.block(1, 2, M, K), y);
+        CHECK(max_error(out, expected) <= tolerance<T>(K));
+    }
+}
+
+template <typename T>
+static void test_factorizations() {
+    const size_t n = 70;
+    matrix<T> a = random_matrix<T>(n + 6, n + 6);
+    matrix<T> spd = a.transpose() * a;
+    for(size_t i = 0; i < n + 6; ++ i)
+        spd(i,i) += T(n);
+
+    const matrix<T> x = copy_block(a, 3, 2, n, n), s = copy_block(spd, 3, 3, n, n);
+    CHECK(lu_decomposition<T>(a.block(3, 2, n, n)).determinant() == lu_decomposition<T>(x).determinant());
+    CHECK(cholesky_decomposition<T>(spd.block(3, 3, n, n)).factor() == cholesky_decomposition<T>(s).factor());
+    CHECK(ldlt_decomposition<T>(spd.block(3, 3, n, n)).factors() == ldlt_decomposition<T>(s).factors());
+    CHECK(lu_decomposition<T>(a.ref().block(3, 2, n, n)).determinant() == lu_decomposition<T>(x).determinant());
+}
+
+int main() {
+    test_windows<int>();
+    test_windows<double>();
+    test_products<float>();
+    test_products<double>();
+    test_products<int>();
+    test_factorizations<double>();
+
+    thread_pool pool(4);
+    set_executor(&pool);
+    test_products<double>();
+    set_executor(nullptr);
+    return algebra_test::failures() != 0;
+}
@@ -0,0 +1,350 @@
+/**
+ *  thread_pool.h
+ *  Purpose: work-stealing thread pool and pluggable executors for parallel kernels
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef THREAD_POOL_H
+
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ *  executor class, the interface the library parallelises through. Implement it to run the
+ *  library's work on an existing pool instead of the built-in one.
+ */
+
+class executor {
+
+    public:
+
+    virtual ~executor() = default;
+
+    /**
+     *  Retrieves the number of threads that may run work at once, including the caller.
+     *
+     *  @return the degree of parallelism.
+     */
+
+    virtual size_t concurrency() const = 0;
+
+    /**
+     *  Splits [begin, end) into chunks of at least grain indices and runs body on each,
+     *  returning once every chunk has finished. The calling thread may run chunks itself.
+     *  If any chunk throws, one of the exceptions is rethrown after all chunks finish.
+     *
+     *  @param begin the first index.
+     *  @param end one past the last index.
+     *  @param grain the smallest chunk worth running on its own.
+     *  @param body called as body(chunk_begin, chunk_end).
+     */
+
+    virtual void parallel_for(size_t begin, size_t end, size_t grain,
+                              const std::function<void(size_t, size_t)> &body) = 0;
+};
+
+/**
+ *  serial_executor class, runs all work on the calling thread.
+ */
+
+class serial_executor : public executor {
+
+    public:
+
+    inline size_t concurrency() const override {
+        return 1;
+    }
+
+    inline void parallel_for(size_t begin, size_t end, size_t,
+                             const std::function<void(size_t, size_t)> &body) override {
+        if(begin < end) {
+            body(begin, end);
+        }
+    }
+};
+
+/**
+ *  thread_pool class, a work-stealing pool of worker threads.
+ *
+ *  Every worker owns a task queue. Workers run their own newest task first and, when idle,
+ *  steal the oldest task of another worker. A thread waiting in parallel_for keeps running
+ *  queued tasks, so nested parallel loops cannot deadlock the pool.
+ */
+
+class thread_pool : public executor {
+
+    private:
+
+    struct task_queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    std::atomic<size_t> next_queue{0};
+    bool stopping = false;
+
+    /**
+     *  The pool the current thread works for and the index of the queue it owns there.
+     */
+
+    struct worker_identity {
+        const thread_pool *pool = nullptr;
+        int index = -1;
+    };
+
+    static inline worker_identity &identity() {
+        thread_local worker_identity self;
+        return self;
+    }
+
+    inline int worker_index() const {
+        return identity().pool == this ? identity().index : -1;
+    }
+
+    inline void submit(std::function<void()> task) {
+        const int self = worker_index();
+        const size_t q = self >= 0 ? size_t(self) : next_queue.fetch_add(1) % queues.size();
+        {
+            std::lock_guard<std::mutex> guard(queues[q]->lock);
+            queues[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            pending.fetch_add(1);
+        }
+        wake.notify_one();
+    }
+
+    /**
+     *  Runs one queued task: the newest of the current worker's own queue, otherwise the
+     *  oldest task of any other queue.
+     *
+     *  @return true if a task was run.
+     */
+
+    inline bool run_one() {
+        const int self = worker_index();
+        std::function<void()> task;
+
+        if(self >= 0) {
+            task_queue &own = *queues[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if(!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+            }
+        }
+        for(size_t i = 0; !task && i < queues.size(); ++ i) {
+            task_queue &victim = *queues[(size_t(std::max(self, 0)) + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if(!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+            }
+        }
+        if(!task) {
+            return false;
+        }
+
+        pending.fetch_sub(1);
+        task();
+        return true;
+    }
+
+    inline void work(int index) {
+        identity().pool = this;
+        identity().index = index;
+        while(true) {
+            if(run_one()) {
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleep_lock);
+            wake.wait(guard, [this] { return stopping || pending.load() > 0; });
+            if(stopping && pending.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    public:
+
+    /**
+     *  Constructor for a thread_pool.
+     *
+     *  @param threads the degree of parallelism, counting the thread that calls parallel_for.
+     *  Pass 0 to use std::thread::hardware_concurrency().
+     */
+
+    inline explicit thread_pool(size_t threads = 0) {
+        if(threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for(size_t i = 0; i < std::max<size_t>(1, threads - 1); ++ i) {
+            queues.push_back(std::unique_ptr<task_queue>(new task_queue()));
+        }
+        for(size_t i = 0; i + 1 < threads; ++ i) {
+            workers.emplace_back(&thread_pool::work, this, int(i));
+        }
+    }
+
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator = (const thread_pool &) = delete;
+
+    inline ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> guard(sleep_lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for(auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    inline size_t concurrency() const override {
+        return workers.size() + 1;
+    }
+
+    inline void parallel_for(size_t begin, size_t end, size_t grain,
+                             const std::function<void(size_t, size_t)> &body) override {
+        if(begin >= end) {
+            return;
+        }
+
+        const size_t n = end - begin;
+        grain = std::max<size_t>(1, grain);
+        const size_t chunks = std::min(n / grain, 4 * concurrency());
+
+        if(chunks <= 1 || workers.empty()) {
+            body(begin, end);
+            return;
+        }
+
+        struct loop_state {
+            std::atomic<size_t> remaining;
+            std::mutex lock;
+            std::exception_ptr error;
+        };
+
+        auto state = std::make_shared<loop_state>();
+        state->remaining = chunks;
+
+        auto run = [state, &body](size_t lo, size_t hi) {
+            try {
+                body(lo, hi);
+            } catch(...) {
+                std::lock_guard<std::mutex> guard(state->lock);
+                if(!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            state->remaining.fetch_sub(1);
+        };
+
+        for(size_t c = 1; c < chunks; ++ c) {
+            const size_t lo = begin + n * c / chunks, hi = begin + n * (c + 1) / chunks;
+            submit([run, lo, hi] { run(lo, hi); });
+        }
+        run(begin, begin + n / chunks);
+
+        while(state->remaining.load() > 0) {
+            if(!run_one()) {
+                std::this_thread::yield();
+            }
+        }
+
+        if(state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+};
+
+namespace algebra_detail {
+
+inline std::atomic<executor *> &executor_slot() {
+    static std::atomic<executor *> slot{nullptr};
+    return slot;
+}
+
+}
+
+/**
+ *  Retrieves the built-in pool, sized from std::thread::hardware_concurrency().
+ *
+ *  @return the process-wide thread_pool, started on first use.
+ */
+
+inline thread_pool &default_thread_pool() {
+    static thread_pool pool;
+    return pool;
+}
+
+/**
+ *  Routes all of the library's parallel work to e. The executor must outlive its use.
+ *
+ *  @param e the executor to use, or nullptr to return to default_thread_pool().
+ */
+
+inline void set_executor(executor *e) {
+    algebra_detail::executor_slot().store(e);
+}
+
+/**
+ *  Retrieves the executor the library's parallel work runs on.
+ *
+ *  @return the executor passed to set_executor, or default_thread_pool().
+ */
+
+inline executor &current_executor() {
+    executor *e = algebra_detail::executor_slot().load();
+    return e != nullptr ? *e : default_thread_pool();
+}
+
+/**
+ *  Runs body over [begin, end) on current_executor().
+ *
+ *  @param begin the first index.
+ *  @param end one past the last index.
+ *  @param grain the smallest chunk worth running on its own.
+ *  @param body called as body(chunk_begin, chunk_end).
+ */
+
+template <typename F>
+inline void parallel_for(size_t begin, size_t end, size_t grain, F &&body) {
+    if(end - begin <= grain) {
+        if(begin < end) {
+            body(begin, end);
+        }
+        return;
+    }
+    executor &e = current_executor();
+    if(e.concurrency() == 1) {
+        body(begin, end);
+        return;
+    }
+
+    // Wrapping a reference keeps std::function from copying body to the heap.
+
+    e.parallel_for(begin, end, grain, std::function<void(size_t, size_t)>(std::ref(body)));
+}
+
+#endif
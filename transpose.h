@@ -0,0 +1,244 @@
+/**
+ *  transpose.h
+ *  Purpose: cache-blocked, vectorised and parallel transposes of row-major buffers
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef TRANSPOSE_H
+
+#define TRANSPOSE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+/**
+ *  The side of the square tiles the transposes work through, chosen so that a tile of the
+ *  source and one of the destination stay in L1 together.
+ */
+
+constexpr size_t transpose_tile = 64;
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+/**
+ *  The register tile: up to 8 x 8 entries, one vector per row.
+ */
+
+template <size_t W, typename T>
+struct transpose_tile_type {
+    static constexpr size_t R = std::min<size_t>(W / sizeof(T), 8);
+    typedef T vec __attribute__((vector_size(R * sizeof(T))));
+    typedef typename std::conditional<sizeof(T) == 8, int64_t, int32_t>::type index;
+    typedef index mask __attribute__((vector_size(R * sizeof(T))));
+};
+
+/**
+ *  Exchanges the D x D blocks that straddle the diagonal between rows a and b (which are D
+ *  rows apart) of an R x R tile held in registers, two shuffles per pair of rows.
+ */
+
+template <size_t D, typename Tile, typename V, size_t... J>
+ALGEBRA_ALWAYS_INLINE void transpose_exchange(V &a, V &b, std::index_sequence<J...>) {
+    typedef typename Tile::index index;
+    typedef typename Tile::mask mask;
+    constexpr size_t R = sizeof...(J);
+    const V low = __builtin_shuffle(a, b, mask{static_cast<index>((J & D) ? R + J - D : J)...});
+    const V high = __builtin_shuffle(a, b, mask{static_cast<index>((J & D) ? R + J : J + D)...});
+    a = low;
+    b = high;
+}
+
+/**
+ *  Transposes an R x R tile held in R vector registers, in log2(R) rounds of block exchanges
+ *  from the widest blocks down.
+ */
+
+template <size_t D, typename Tile, typename V, size_t R>
+ALGEBRA_ALWAYS_INLINE void transpose_registers(V (&v)[R]) {
+    if constexpr (D > 0) {
+        for(size_t i = 0; i < R; ++ i)
+            if(!(i & D)) {
+                transpose_exchange<D, Tile>(v[i], v[i + D], std::make_index_sequence<R>());
+            }
+        transpose_registers<D / 2, Tile>(v);
+    }
+}
+
+/**
+ *  Writes the transpose of the rows x cols block a (row stride lda) to b (row stride ldb),
+ *  one register tile at a time; the ragged edges are copied entry by entry.
+ */
+
+struct transpose_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t rows, size_t cols, const T *a, size_t lda, T *b, size_t ldb) {
+        typedef transpose_tile_type<W, T> tile;
+        typedef typename tile::vec vec;
+        constexpr size_t R = tile::R;
+
+        size_t i = 0;
+        for(; i + R <= rows; i += R) {
+            size_t j = 0;
+            for(; j + R <= cols; j += R) {
+                vec v[R];
+                for(size_t r = 0; r < R; ++ r)
+                    v[r] = simd_load<vec>(a + (i + r) * lda + j);
+                transpose_registers<R / 2, tile>(v);
+                for(size_t r = 0; r < R; ++ r)
+                    simd_store(b + (j + r) * ldb + i, v[r]);
+            }
+            for(; j < cols; ++ j)
+                for(size_t r = 0; r < R; ++ r)
+                    b[j * ldb + i + r] = a[(i + r) * lda + j];
+        }
+        for(; i < rows; ++ i)
+            for(size_t j = 0; j < cols; ++ j)
+                b[j * ldb + i] = a[i * lda + j];
+    }
+};
+
+/**
+ *  Swaps the rows x cols block x with the transpose of the cols x rows block y, both with a
+ *  row stride of ld. When diagonal is set, x and y are the same square block on the diagonal,
+ *  which is transposed in place.
+ */
+
+struct transpose_swap_kernel {
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t rows, size_t cols, T *x, T *y, size_t ld, bool diagonal) {
+        typedef transpose_tile_type<W, T> tile;
+        typedef typename tile::vec vec;
+        constexpr size_t R = tile::R;
+
+        for(size_t i = 0; i < rows; i += R) {
+            for(size_t j = diagonal ? i : 0; j < cols; j += R) {
+                if(i + R > rows || j + R > cols) {
+                    for(size_t r = i; r < std::min(rows, i + R); ++ r)
+                        for(size_t c = j; c < std::min(cols, j + R); ++ c)
+                            if(!diagonal || r < c) {
+                                std::swap(x[r * ld + c], y[c * ld + r]);
+                            }
+                    continue;
+                }
+
+                vec u[R], v[R];
+                for(size_t r = 0; r < R; ++ r) {
+                    u[r] = simd_load<vec>(x + (i + r) * ld + j);
+                    v[r] = simd_load<vec>(y + (j + r) * ld + i);
+                }
+                transpose_registers<R / 2, tile>(u);
+                transpose_registers<R / 2, tile>(v);
+                for(size_t r = 0; r < R; ++ r) {
+                    simd_store(x + (i + r) * ld + j, v[r]);
+                    simd_store(y + (j + r) * ld + i, u[r]);
+                }
+            }
+        }
+    }
+};
+
+#pragma GCC diagnostic pop
+
+#endif
+
+/**
+ *  Transposes one tile, through the register kernel when there is one for T.
+ */
+
+template <typename T>
+inline void transpose_block(size_t rows, size_t cols, const T *a, size_t lda, T *b, size_t ldb) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return simd_dispatch<transpose_kernel>(rows, cols, a, lda, b, ldb);
+    }
+#endif
+    for(size_t i = 0; i < rows; ++ i)
+        for(size_t j = 0; j < cols; ++ j)
+            b[j * ldb + i] = a[i * lda + j];
+}
+
+template <typename T>
+inline void transpose_swap_block(size_t rows, size_t cols, T *x, T *y, size_t ld, bool diagonal) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        return simd_dispatch<transpose_swap_kernel>(rows, cols, x, y, ld, diagonal);
+    }
+#endif
+    for(size_t r = 0; r < rows; ++ r)
+        for(size_t c = diagonal ? r + 1 : 0; c < cols; ++ c)
+            std::swap(x[r * ld + c], y[c * ld + r]);
+}
+
+/**
+ *  The number of tile rows each task takes, so that small transposes stay on one thread.
+ */
+
+inline size_t transpose_grain(size_t cols) {
+    return std::max<size_t>(1, (size_t(1) << 16) / (transpose_tile * std::max<size_t>(1, cols)));
+}
+
+}
+
+/**
+ *  Writes the transpose of a matrix to another buffer, b = a^T. Works through
+ *  transpose_tile-sized tiles so both sides stay in cache, transposes each tile in vector
+ *  registers (up to 8 x 8 entries at a time, for float and double), and spreads the rows of
+ *  tiles over current_executor().
+ *
+ *  @param rows the number of rows of a (and columns of b).
+ *  @param cols the number of columns of a (and rows of b).
+ *  @param a the matrix to transpose, with a row stride of lda.
+ *  @param b receives the transpose, with a row stride of ldb; must not overlap a.
+ */
+
+template <typename T>
+void transpose_copy(size_t rows, size_t cols, const T *a, size_t lda, T *b, size_t ldb) {
+    const size_t tiles = (rows + transpose_tile - 1) / transpose_tile;
+
+    parallel_for(0, tiles, algebra_detail::transpose_grain(cols), [&](size_t t0, size_t t1) {
+        for(size_t i0 = t0 * transpose_tile; i0 < std::min(rows, t1 * transpose_tile); i0 += transpose_tile) {
+            const size_t ib = std::min(transpose_tile, rows - i0);
+            for(size_t j0 = 0; j0 < cols; j0 += transpose_tile)
+                algebra_detail::transpose_block(ib, std::min(transpose_tile, cols - j0),
+                                                a + i0 * lda + j0, lda, b + j0 * ldb + i0, ldb);
+        }
+    });
+}
+
+/**
+ *  Transposes a square matrix in place. Each pair of tiles mirrored across the diagonal is
+ *  loaded, transposed in registers and stored crosswise, so no scratch is needed; rows of
+ *  tiles are spread over current_executor().
+ *
+ *  @param n the order of a.
+ *  @param a the matrix to transpose, with a row stride of lda.
+ */
+
+template <typename T>
+void transpose_square(size_t n, T *a, size_t lda) {
+    const size_t tiles = (n + transpose_tile - 1) / transpose_tile;
+
+    parallel_for(0, tiles, algebra_detail::transpose_grain(n), [&](size_t t0, size_t t1) {
+        for(size_t ti = t0; ti < t1; ++ ti) {
+            const size_t i0 = ti * transpose_tile, ib = std::min(transpose_tile, n - i0);
+            for(size_t j0 = i0; j0 < n; j0 += transpose_tile)
+                algebra_detail::transpose_swap_block(ib, std::min(transpose_tile, n - j0), a + i0 * lda + j0,
+                                                     a + j0 * lda + i0, lda, j0 == i0);
+        }
+    });
+}
+
+#endif
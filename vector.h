@@ -10,7 +10,7 @@
 
 #define VECTOR_H
 
-#include "matrix.h"
+#include "fixed_matrix.h"
 
 /**
  *  vector class, for representation and manipulation of vectors
@@ -141,12 +141,8 @@ class vector {
          * @return the vector as a column matrix.
          */
 
-        inline matrix<T> to_matrix() const {
-            matrix<T> ret = matrix<T>(3,1);
-            ret(0, 0) = x;
-            ret(0, 1) = y;
-            ret(0, 2) = z;
-            return ret;
+        inline fixed_matrix<T, 3, 1> to_matrix() const {
+            return fixed_matrix<T, 3, 1>{x, y, z};
         }
 };
 
@@ -0,0 +1,488 @@
+/**
+ *  vector_batch.h
+ *  Purpose: batched operations on many 3D vectors stored as a structure of arrays
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef VECTOR_BATCH_H
+
+#define VECTOR_BATCH_H
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "allocator.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include "vector.h"
+
+/**
+ *  The number of vectors below which the batched vector operations run on the calling thread
+ *  alone; larger batches are split into chunks of about this many for the thread pool.
+ */
+
+constexpr size_t vector_batch_grain = 16384;
+
+/**
+ *  How batch_normalize computes 1 / |v|. exact takes a square root, as vector::normalize
+ *  does. fast refines a bit-level estimate with two Newton steps, which needs no square root
+ *  or division and is within about 5e-6 of the exact result, relative to it; it also maps the
+ *  zero vector to itself, where exact gives NaNs.
+ */
+
+enum class normalize_mode {
+    exact,
+    fast
+};
+
+/**
+ *  vector_batch class, count 3D vectors stored as a structure of arrays: each component of
+ *  every vector is contiguous, so batched kernels load the same component of many vectors in
+ *  one vector register. Its pointers() can be passed straight to batch_apply.
+ *
+ *  @param T the data type being stored.
+ */
+
+template <typename T = double>
+class vector_batch {
+
+    private:
+
+    size_t count = 0;
+    std::vector<T, aligned_allocator<T>> lanes[3];
+
+    public:
+
+    /**
+     *  Constructor for a vector_batch. All components are set to their default.
+     *
+     *  @param Count the number of vectors.
+     */
+
+    inline explicit vector_batch(size_t Count = 0) : count(Count) {
+        for(auto &lane : lanes) {
+            lane.assign(Count, T());
+        }
+    }
+
+    /**
+     *  Constructor for a vector_batch holding copies of some vectors.
+     *
+     *  @param v the vectors to copy.
+     */
+
+    inline explicit vector_batch(const std::vector<vector<T>> &v) : vector_batch(v.size()) {
+        for(size_t k = 0; k < count; ++ k)
+            set(k, v[k]);
+    }
+
+    /**
+     *  Retrieves the number of vectors in the batch.
+     *
+     *  @return the number of vectors.
+     */
+
+    inline size_t size() const {
+        return count;
+    }
+
+    /**
+     *  Retrieves one component of every vector.
+     *
+     *  @param i the component: 0 for x, 1 for y, 2 for z.
+     *  @return a contiguous array of size() values.
+     */
+
+    inline T *component(size_t i) {
+        assert(i < 3);
+        return lanes[i].data();
+    }
+
+    inline const T *component(size_t i) const {
+        assert(i < 3);
+        return lanes[i].data();
+    }
+
+    /**
+     *  Copies one vector out of the batch.
+     *
+     *  @param k the index of the vector.
+     *  @return the vector.
+     */
+
+    inline vector<T> get(size_t k) const {
+        assert(k < count);
+        return vector<T>(lanes[0][k], lanes[1][k], lanes[2][k]);
+    }
+
+    /**
+     *  Stores one vector into the batch.
+     *
+     *  @param k the index of the vector.
+     *  @param v the vector to store.
+     */
+
+    inline void set(size_t k, const vector<T> &v) {
+        assert(k < count);
+        lanes[0][k] = v.x;
+        lanes[1][k] = v.y;
+        lanes[2][k] = v.z;
+    }
+
+    /**
+     *  Retrieves the component pointers expected by the batched kernels.
+     *
+     *  @param out receives component(i) at out[i].
+     */
+
+    inline void pointers(T *out[3]) {
+        for(size_t i = 0; i < 3; ++ i)
+            out[i] = lanes[i].data();
+    }
+
+    inline void pointers(const T *out[3]) const {
+        for(size_t i = 0; i < 3; ++ i)
+            out[i] = lanes[i].data();
+    }
+};
+
+namespace algebra_detail {
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+/**
+ *  Takes the square root of every lane of V, which may also be T itself, in place. Vectors
+ *  are passed by reference, as in the other kernels, so their ABI never matters.
+ */
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void lane_sqrt(V &v) {
+    if constexpr (std::is_same<V, T>::value) {
+        v = std::sqrt(v);
+    } else {
+        for(size_t l = 0; l < sizeof(V) / sizeof(T); ++ l)
+            v[l] = std::sqrt(v[l]);
+    }
+}
+
+/**
+ *  Approximates 1 / sqrt(s) in every lane, into y: the exponent of s is halved and negated with one
+ *  integer subtraction, which is within 3.5% of the result, and two Newton steps bring that
+ *  to about 5e-6.
+ */
+
+template <typename V, typename T>
+ALGEBRA_ALWAYS_INLINE void lane_rsqrt(const V &s, V &y) {
+    typedef typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type U;
+    U magic;
+    if constexpr (sizeof(T) == 4) {
+        magic = U(0x5f375a86);
+    } else {
+        magic = U(0x5fe6eb50c7b537a9);
+    }
+
+    if constexpr (std::is_same<V, T>::value) {
+        U i;
+        std::memcpy(&i, &s, sizeof(T));
+        i = magic - (i >> 1);
+        std::memcpy(&y, &i, sizeof(T));
+    } else {
+        typedef U uvec __attribute__((vector_size(sizeof(V))));
+        uvec i;
+        std::memcpy(&i, &s, sizeof(V));
+        i = magic - (i >> 1);
+        std::memcpy(&y, &i, sizeof(V));
+    }
+
+    const V h = s * T(0.5);
+    y = y * (T(1.5) - h * y * y);
+    y = y * (T(1.5) - h * y * y);
+}
+
+/**
+ *  The vector loop shared by the kernels below: groups of consecutive vectors, one per lane,
+ *  from begin to end, then the remainder one at a time.
+ */
+
+template <typename Kernel, size_t W, typename T, typename... Args>
+ALGEBRA_ALWAYS_INLINE void vector_batch_loop(size_t begin, size_t end, const Args &... args) {
+    size_t k = begin;
+#if ALGEBRA_VECTOR_EXTENSIONS
+    if constexpr (simd_supported<T>::value) {
+        typedef T vec __attribute__((vector_size(W)));
+        constexpr size_t L = W / sizeof(T);
+        for(; k + L <= end; k += L)
+            Kernel::template step<vec, T>(k, args...);
+    }
+#endif
+    for(; k < end; ++ k)
+        Kernel::template step<T, T>(k, args...);
+}
+
+struct vector_dot_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *a, const T *const *b, T *out) {
+        V s = simd_load<V>(a[0] + k) * simd_load<V>(b[0] + k);
+        s += simd_load<V>(a[1] + k) * simd_load<V>(b[1] + k);
+        s += simd_load<V>(a[2] + k) * simd_load<V>(b[2] + k);
+        simd_store(out + k, s);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *a, const T *const *b, T *out) {
+        vector_batch_loop<vector_dot_kernel, W, T>(begin, end, a, b, out);
+    }
+};
+
+/**
+ *  Results are computed before any are stored, so c may alias a or b.
+ */
+
+struct vector_cross_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *a, const T *const *b, T *const *c) {
+        const V ax = simd_load<V>(a[0] + k), ay = simd_load<V>(a[1] + k), az = simd_load<V>(a[2] + k);
+        const V bx = simd_load<V>(b[0] + k), by = simd_load<V>(b[1] + k), bz = simd_load<V>(b[2] + k);
+        const V cx = ay * bz - az * by, cy = az * bx - ax * bz, cz = ax * by - ay * bx;
+        simd_store(c[0] + k, cx);
+        simd_store(c[1] + k, cy);
+        simd_store(c[2] + k, cz);
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *a, const T *const *b,
+                                          T *const *c) {
+        vector_batch_loop<vector_cross_kernel, W, T>(begin, end, a, b, c);
+    }
+};
+
+template <normalize_mode Mode>
+struct vector_normalize_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, const T *const *a, T *const *out) {
+        const V x = simd_load<V>(a[0] + k), y = simd_load<V>(a[1] + k), z = simd_load<V>(a[2] + k);
+        const V s = x * x + y * y + z * z;
+        V r;
+        if constexpr (Mode == normalize_mode::fast) {
+            lane_rsqrt<V, T>(s, r);
+        } else {
+            r = T(1) / s;
+            lane_sqrt<V, T>(r);
+        }
+        simd_store(out[0] + k, V(x * r));
+        simd_store(out[1] + k, V(y * r));
+        simd_store(out[2] + k, V(z * r));
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, const T *const *a, T *const *out) {
+        vector_batch_loop<vector_normalize_kernel, W, T>(begin, end, a, out);
+    }
+};
+
+struct vector_axpy_kernel {
+    template <typename V, typename T>
+    static ALGEBRA_ALWAYS_INLINE void step(size_t k, T alpha, const T *const *x, T *const *y) {
+        for(size_t i = 0; i < 3; ++ i)
+            simd_store(y[i] + k, V(simd_load<V>(y[i] + k) + simd_load<V>(x[i] + k) * alpha));
+    }
+
+    template <size_t W, typename T>
+    static ALGEBRA_ALWAYS_INLINE void run(size_t begin, size_t end, T alpha, const T *const *x, T *const *y) {
+        vector_batch_loop<vector_axpy_kernel, W, T>(begin, end, alpha, x, y);
+    }
+};
+
+#if ALGEBRA_VECTOR_EXTENSIONS
+#pragma GCC diagnostic pop
+#endif
+
+/**
+ *  Runs Kernel over vectors [0, count), split over the thread pool in chunks of at least
+ *  vector_batch_grain, each chunk on the widest instruction set available.
+ */
+
+template <typename Kernel, typename T, typename... Args>
+inline void vector_batch_for(size_t count, const Args &... args) {
+    parallel_for(0, count, vector_batch_grain, [&](size_t k0, size_t k1) {
+#if ALGEBRA_VECTOR_EXTENSIONS
+        if constexpr (simd_supported<T>::value) {
+            return simd_dispatch<Kernel>(k0, k1, args...);
+        }
+#endif
+        Kernel::template run<sizeof(T)>(k0, k1, args...);
+    });
+}
+
+}
+
+/**
+ *  Computes count dot products, out[k] = a[k] * b[k], in one vectorised pass. Vectors are
+ *  stored as one array per component (a[i][k] is component i of vector k).
+ *
+ *  @param count the number of vectors.
+ *  @param a component pointers of the left operands.
+ *  @param b component pointers of the right operands.
+ *  @param out receives the count dot products; may be a component of a or b.
+ */
+
+template <typename T>
+inline void batch_dot(size_t count, const T *const a[3], const T *const b[3], T *out) {
+    algebra_detail::vector_batch_for<algebra_detail::vector_dot_kernel, T>(count, a, b, out);
+}
+
+template <typename T>
+inline void batch_dot(const vector_batch<T> &a, const vector_batch<T> &b, T *out) {
+    assert(a.size() == b.size());
+    const T *pa[3], *pb[3];
+    a.pointers(pa);
+    b.pointers(pb);
+
+    batch_dot<T>(a.size(), pa, pb, out);
+}
+
+/**
+ *  Computes the squared magnitude of count vectors, out[k] = a[k] * a[k], as
+ *  vector::magnitude does.
+ *
+ *  @param count the number of vectors.
+ *  @param a component pointers of the vectors.
+ *  @param out receives the count squared magnitudes.
+ */
+
+template <typename T>
+inline void batch_magnitude(size_t count, const T *const a[3], T *out) {
+    batch_dot<T>(count, a, a, out);
+}
+
+template <typename T>
+inline void batch_magnitude(const vector_batch<T> &a, T *out) {
+    batch_dot(a, a, out);
+}
+
+/**
+ *  Computes count cross products, c[k] = a[k] ^ b[k], in one vectorised pass.
+ *
+ *  @param count the number of vectors.
+ *  @param a component pointers of the left operands.
+ *  @param b component pointers of the right operands.
+ *  @param c component pointers of the results; may be a or b.
+ */
+
+template <typename T>
+inline void batch_cross(size_t count, const T *const a[3], const T *const b[3], T *const c[3]) {
+    algebra_detail::vector_batch_for<algebra_detail::vector_cross_kernel, T>(count, a, b, c);
+}
+
+/**
+ *  Computes the cross products of two batches of vectors, c[k] = a[k] ^ b[k].
+ *
+ *  @param a the left operands.
+ *  @param b the right operands.
+ *  @param c receives the products; resized if needed, and may be a or b.
+ */
+
+template <typename T>
+inline void batch_cross(const vector_batch<T> &a, const vector_batch<T> &b, vector_batch<T> &c) {
+    assert(a.size() == b.size());
+
+    if(c.size() != a.size()) {
+        c = vector_batch<T>(a.size());
+    }
+
+    const T *pa[3], *pb[3];
+    T *pc[3];
+    a.pointers(pa);
+    b.pointers(pb);
+    c.pointers(pc);
+
+    batch_cross<T>(a.size(), pa, pb, pc);
+}
+
+/**
+ *  Scales count vectors to unit length, out[k] = a[k] / |a[k]|, in one vectorised pass.
+ *
+ *  @param count the number of vectors.
+ *  @param a component pointers of the vectors.
+ *  @param out component pointers of the unit vectors; may be a.
+ *  @param mode whether to compute 1 / |a[k]| exactly or with the fast approximation, which
+ *  float and double support; other types always take the exact path.
+ */
+
+template <typename T>
+inline void batch_normalize(size_t count, const T *const a[3], T *const out[3],
+                            normalize_mode mode = normalize_mode::exact) {
+    using namespace algebra_detail;
+    static_assert(std::is_floating_point<T>::value, "batch_normalize needs a floating point type");
+    constexpr bool estimate = std::is_same<T, float>::value || std::is_same<T, double>::value;
+
+    if constexpr (estimate) {
+        if(mode == normalize_mode::fast) {
+            return vector_batch_for<vector_normalize_kernel<normalize_mode::fast>, T>(count, a, out);
+        }
+    }
+    (void) mode;
+
+    vector_batch_for<vector_normalize_kernel<normalize_mode::exact>, T>(count, a, out);
+}
+
+/**
+ *  Scales a batch of vectors to unit length.
+ *
+ *  @param a the vectors.
+ *  @param out receives the unit vectors; resized if needed, and may be a.
+ *  @param mode whether to compute 1 / |a[k]| exactly or with the fast approximation.
+ */
+
+template <typename T>
+inline void batch_normalize(const vector_batch<T> &a, vector_batch<T> &out,
+                            normalize_mode mode = normalize_mode::exact) {
+    if(out.size() != a.size()) {
+        out = vector_batch<T>(a.size());
+    }
+
+    const T *pa[3];
+    T *pout[3];
+    a.pointers(pa);
+    out.pointers(pout);
+
+    batch_normalize<T>(a.size(), pa, pout, mode);
+}
+
+/**
+ *  Adds a multiple of count vectors to count others, y[k] = y[k] + alpha * x[k], in one
+ *  vectorised pass; with alpha a time step, this advances positions by their velocities.
+ *
+ *  @param count the number of vectors.
+ *  @param alpha the scale applied to every x[k].
+ *  @param x component pointers of the vectors to add.
+ *  @param y component pointers of the vectors to add to.
+ */
+
+template <typename T>
+inline void batch_axpy(size_t count, T alpha, const T *const x[3], T *const y[3]) {
+    algebra_detail::vector_batch_for<algebra_detail::vector_axpy_kernel, T>(count, alpha, x, y);
+}
+
+template <typename T>
+inline void batch_axpy(T alpha, const vector_batch<T> &x, vector_batch<T> &y) {
+    assert(x.size() == y.size());
+    const T *px[3];
+    T *py[3];
+    x.pointers(px);
+    y.pointers(py);
+
+    batch_axpy<T>(x.size(), alpha, px, py);
+}
+
+#endif
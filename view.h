@@ -0,0 +1,357 @@
+/**
+ *  view.h
+ *  Purpose: non-owning views of strided submatrices, of matrices or of external buffers
+ *
+ *  @author Manuel Infosec
+ *  @version 1.0
+ */
+
+#ifndef VIEW_H
+
+#define VIEW_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+
+#include "expression.h"
+
+/**
+ *  matrix_view class, a read-only window onto rows x cols entries of row-major storage that
+ *  someone else owns: a block of a matrix, or an external buffer such as a numpy array or a
+ *  mapped file. Entry (i,j) is data()[i * stride() + j]. Copying a view copies the window,
+ *  not the entries, and a view must not outlive the storage it looks at.
+ *
+ *  @param T the data type of the entries.
+ */
+
+template <typename T>
+class matrix_view : public matrix_expression<matrix_view<T>> {
+
+    private:
+
+    const T *pointer = nullptr;
+    size_t n_rows = 0;
+    size_t n_columns = 0;
+    size_t row_stride = 0;
+
+    public:
+
+    typedef T value_type;
+
+    /**
+     *  Empty view constructor. The view has no rows and no columns.
+     */
+
+    inline matrix_view() = default;
+
+    /**
+     *  Constructor for a view of an external buffer.
+     *
+     *  @param data the first entry.
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @param Stride the distance between the starts of consecutive rows, at least Columns.
+     */
+
+    inline matrix_view(const T *data, size_t Rows, size_t Columns, size_t Stride)
+        : pointer(data), n_rows(Rows), n_columns(Columns), row_stride(Stride) {
+        assert(Rows <= 1 || Stride >= Columns);
+    }
+
+    /**
+     *  Constructor for a view of a dense external buffer, whose rows follow each other.
+     *
+     *  @param data the first entry.
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     */
+
+    inline matrix_view(const T *data, size_t Rows, size_t Columns) : matrix_view(data, Rows, Columns, Columns) {}
+
+    inline size_t rows() const {
+        return n_rows;
+    }
+
+    inline size_t columns() const {
+        return n_columns;
+    }
+
+    inline size_t stride() const {
+        return row_stride;
+    }
+
+    inline const T *data() const {
+        return pointer;
+    }
+
+    inline const T &operator () (size_t row, size_t column) const {
+        return pointer[row * row_stride + column];
+    }
+
+    /**
+     *  Views a block of this view.
+     *
+     *  @param row the first row of the block.
+     *  @param column the first column of the block.
+     *  @param Rows the number of rows in the block.
+     *  @param Columns the number of columns in the block.
+     *  @return a view of the block, sharing this view's storage and stride.
+     */
+
+    inline matrix_view<T> block(size_t row, size_t column, size_t Rows, size_t Columns) const {
+        assert(row + Rows <= n_rows && column + Columns <= n_columns);
+        return matrix_view<T>(pointer + row * row_stride + column, Rows, Columns, row_stride);
+    }
+
+    /**
+     *  Views one row, as a 1 x columns() block.
+     *
+     *  @param i the row to view.
+     *  @return a view of the row.
+     */
+
+    inline matrix_view<T> row(size_t i) const {
+        return block(i, 0, 1, n_columns);
+    }
+
+    /**
+     *  Views one column, as a rows() x 1 block.
+     *
+     *  @param j the column to view.
+     *  @return a view of the column.
+     */
+
+    inline matrix_view<T> column(size_t j) const {
+        return block(0, j, n_rows, 1);
+    }
+};
+
+/**
+ *  matrix_ref class, a writable window onto rows x cols entries of row-major storage that
+ *  someone else owns. Like matrix_view it is cheap to copy, but assigning to it (from a
+ *  matrix, a view or any expression) writes through to the entries it refers to, so a block
+ *  of a matrix can be the destination of a kernel without an intermediate copy.
+ *
+ *  @param T the data type of the entries.
+ */
+
+template <typename T>
+class matrix_ref : public matrix_expression<matrix_ref<T>> {
+
+    private:
+
+    T *pointer = nullptr;
+    size_t n_rows = 0;
+    size_t n_columns = 0;
+    size_t row_stride = 0;
+
+    /**
+     *  Checks if an expression reads the referenced entries through a transposed view of a
+     *  matrix, as matrix::transposes_self does.
+     */
+
+    template <typename E>
+    inline bool transposes_self(const E &e) const {
+        const T *end = n_rows == 0 ? pointer : pointer + (n_rows - 1) * row_stride + n_columns;
+        return algebra_detail::reads_transposed(e, static_cast<const T *>(pointer), end);
+    }
+
+    /**
+     *  Writes every entry of an expression of the same shape through the reference, as
+     *  matrix does: entry (i,j) may only depend on entry (i,j) of each operand, so callers
+     *  check transposes_self first.
+     */
+
+    template <typename E>
+    inline void assign(const E &e) const {
+        for(size_t i = 0; i < n_rows; ++ i) {
+            T *out = pointer + i * row_stride;
+            for(size_t j = 0; j < n_columns; ++ j)
+                out[j] = e(i,j);
+        }
+    }
+
+    inline void assign(const matrix_view<T> &v) const {
+        for(size_t i = 0; i < n_rows; ++ i)
+            std::copy(v.data() + i * v.stride(), v.data() + i * v.stride() + n_columns, pointer + i * row_stride);
+    }
+
+    public:
+
+    typedef T value_type;
+
+    /**
+     *  Empty reference constructor. The reference has no rows and no columns.
+     */
+
+    inline matrix_ref() = default;
+
+    /**
+     *  Constructor for a reference to an external buffer.
+     *
+     *  @param data the first entry.
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     *  @param Stride the distance between the starts of consecutive rows, at least Columns.
+     */
+
+    inline matrix_ref(T *data, size_t Rows, size_t Columns, size_t Stride)
+        : pointer(data), n_rows(Rows), n_columns(Columns), row_stride(Stride) {
+        assert(Rows <= 1 || Stride >= Columns);
+    }
+
+    /**
+     *  Constructor for a reference to a dense external buffer, whose rows follow each other.
+     *
+     *  @param data the first entry.
+     *  @param Rows the number of rows.
+     *  @param Columns the number of columns.
+     */
+
+    inline matrix_ref(T *data, size_t Rows, size_t Columns) : matrix_ref(data, Rows, Columns, Columns) {}
+
+    inline matrix_ref(const matrix_ref<T> &r) = default;
+
+    /**
+     *  Copies the entries r refers to into the entries this refers to. Both must have the
+     *  same shape.
+     *
+     *  @param r the entries to copy.
+     *  @return this reference.
+     */
+
+    inline const matrix_ref<T> &operator = (const matrix_ref<T> &r) const {
+        return *this = matrix_view<T>(r);
+    }
+
+    /**
+     *  Evaluates an expression into the entries this refers to, in one pass. Both must have
+     *  the same shape.
+     *
+     *  @param e the expression to evaluate.
+     *  @return this reference.
+     */
+
+    template <typename E>
+    inline const matrix_ref<T> &operator = (const matrix_expression<E> &e) const {
+        assert(e.rows() == n_rows && e.columns() == n_columns);
+        if(transposes_self(e.self())) {
+            return *this = matrix<T>(e.self());
+        }
+        if constexpr (algebra_detail::is_matrix_of<E, T>::value || std::is_same<E, matrix_ref<T>>::value) {
+            assign(matrix_view<T>(e.self().data(), e.rows(), e.columns(), e.self().stride()));
+        } else {
+            assign(e.self());
+        }
+        return *this;
+    }
+
+    /**
+     *  Adds an expression of the same shape to the entries.
+     */
+
+    template <typename E>
+    inline const matrix_ref<T> &operator += (const matrix_expression<E> &e) const {
+        assert(e.rows() == n_rows && e.columns() == n_columns);
+        if(transposes_self(e.self())) {
+            return *this += matrix<T>(e.self());
+        }
+        for(size_t i = 0; i < n_rows; ++ i)
+            for(size_t j = 0; j < n_columns; ++ j)
+                (*this)(i,j) = (*this)(i,j) + e.self()(i,j);
+        return *this;
+    }
+
+    /**
+     *  Subtracts an expression of the same shape from the entries.
+     */
+
+    template <typename E>
+    inline const matrix_ref<T> &operator -= (const matrix_expression<E> &e) const {
+        assert(e.rows() == n_rows && e.columns() == n_columns);
+        if(transposes_self(e.self())) {
+            return *this -= matrix<T>(e.self());
+        }
+        for(size_t i = 0; i < n_rows; ++ i)
+            for(size_t j = 0; j < n_columns; ++ j)
+                (*this)(i,j) = (*this)(i,j) - e.self()(i,j);
+        return *this;
+    }
+
+    /**
+     *  Scales every entry by a constant.
+     */
+
+    inline const matrix_ref<T> &operator *= (const T &t) const {
+        for(size_t i = 0; i < n_rows; ++ i)
+            for(size_t j = 0; j < n_columns; ++ j)
+                (*this)(i,j) = (*this)(i,j) * t;
+        return *this;
+    }
+
+    /**
+     *  Sets every entry to t.
+     *
+     *  @param t the value to set.
+     */
+
+    inline void fill(const T &t) const {
+        for(size_t i = 0; i < n_rows; ++ i)
+            std::fill(pointer + i * row_stride, pointer + i * row_stride + n_columns, t);
+    }
+
+    /**
+     *  Views the same entries read-only.
+     */
+
+    inline operator matrix_view<T>() const {
+        return matrix_view<T>(pointer, n_rows, n_columns, row_stride);
+    }
+
+    inline size_t rows() const {
+        return n_rows;
+    }
+
+    inline size_t columns() const {
+        return n_columns;
+    }
+
+    inline size_t stride() const {
+        return row_stride;
+    }
+
+    inline T *data() const {
+        return pointer;
+    }
+
+    inline T &operator () (size_t row, size_t column) const {
+        return pointer[row * row_stride + column];
+    }
+
+    /**
+     *  Refers to a block of this reference.
+     *
+     *  @param row the first row of the block.
+     *  @param column the first column of the block.
+     *  @param Rows the number of rows in the block.
+     *  @param Columns the number of columns in the block.
+     *  @return a reference to the block, sharing this reference's storage and stride.
+     */
+
+    inline matrix_ref<T> block(size_t row, size_t column, size_t Rows, size_t Columns) const {
+        assert(row + Rows <= n_rows && column + Columns <= n_columns);
+        return matrix_ref<T>(pointer + row * row_stride + column, Rows, Columns, row_stride);
+    }
+
+    inline matrix_ref<T> row(size_t i) const {
+        return block(i, 0, 1, n_columns);
+    }
+
+    inline matrix_ref<T> column(size_t j) const {
+        return block(0, j, n_rows, 1);
+    }
+};
+
+#endif